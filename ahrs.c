@@ -0,0 +1,411 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  main
+ *  @{
+ *      @file       ahrs.c
+ *      @brief      Orientation filter fusing the IMU and the magnetometer.
+ *      @details    The gains and scales are worked out in float by ahrs_init
+ *                  and kept in Q30 (Q38 for the gyro scale); the update is
+ *                  integer only, 32 x 32 -> 64 bits products, one 64 bits
+ *                  division and square root per normalised vector, so it does
+ *                  not depend on the software floating point of the PIC32MX.
+ *                  Unit vectors and the quaternion are Q30, the rotation
+ *                  applied per update is kept as half angles in Q30 radians.
+ *                  The quaternion is renormalised every update with one
+ *                  Newton step, its norm never drifts far from 1.
+ *
+ *                  Only the alignment at start (ahrs_align) uses float.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "ahrs.h"
+#include "scheduler.h"
+#include "uart.h"
+
+#define HALF        (AHRS_ONE / 2)
+
+static INT32  q[4] = { AHRS_ONE, 0, 0, 0 };
+static INT32  bias[3];                  // integral term, Q30 rad/s
+static INT32  gyro_k;                   // counts to half angle per update, Q38
+static INT32  kp_half, half_dt, ki_dt;  // Q30
+static UINT32 acc_min, acc_max;         // accepted accelerometer norms, counts
+static UINT16 rate = 0;
+static BOOL   aligned = FALSE;
+static UINT16 wait    = 0;              // updates waiting for a field sample to align
+
+static INT32  mag[3];                   // nT
+static UINT16 mag_age = 0xFFFF;         // updates since the last field sample
+static UINT16 mag_timeout;
+
+static imu_sample queue[AHRS_QUEUE];
+static BYTE       q_head = 0, q_tail = 0;
+static UINT16     report = 0, n_report = 0;
+static ahrs_bench bench;
+
+/** Q30 product */
+static INT32 mul ( INT32 a, INT32 b ) {
+
+    return (INT32) (((INT64) a * b) >> 30);
+}
+
+/** Integer square root */
+static UINT32 isqrt64 ( UINT64 v ) {
+
+    UINT64 r = 0, bit = (UINT64) 1 << 62;
+
+    while (bit > v)
+        bit >>= 2;
+    while (bit){
+        if (v >= r + bit){
+            v -= r + bit;
+            r  = (r >> 1) + bit;
+        }
+        else
+            r >>= 1;
+        bit >>= 2;
+    }
+    return (UINT32) r;
+}
+
+/**
+ *  Unit vector of v (components below 2^24) in Q30.
+ *  @return 0 if v is null, its norm otherwise
+ */
+static UINT32 normalise ( const INT32 v[3], INT32 u[3] ) {
+
+    UINT32 n = isqrt64((INT64) v[0] * v[0] + (INT64) v[1] * v[1] + (INT64) v[2] * v[2]);
+    INT64 inv;
+    BYTE i;
+
+    if (!n)
+        return 0;
+    inv = ((INT64) 1 << 60) / n;
+    for (i = 0; i < 3; i++)
+        u[i] = (INT32) ((v[i] * inv) >> 30);
+    return n;
+}
+
+/**
+ *  @brief  Sets the sample rate and scales and restarts the filter.
+ *  @param[in]  rate_hz - IMU samples per second
+ *  @param[in]  gyro_dps - gyro full scale
+ *  @param[in]  accel_lsb_g - accelerometer counts per g
+ *  @return     none
+ */
+void ahrs_init ( UINT16 rate_hz, UINT16 gyro_dps, UINT16 accel_lsb_g ) {
+
+    float dt = 1.0f / rate_hz;
+
+    rate        = rate_hz;
+    gyro_k      = (INT32) lroundf(gyro_dps / 32768.0f * 3.14159265f / 180 * dt / 2 * 274877906944.0f);
+    kp_half     = (INT32) lroundf(AHRS_KP * dt / 2 * AHRS_ONE);
+    half_dt     = (INT32) lroundf(dt / 2 * AHRS_ONE);
+    ki_dt       = (INT32) lroundf(AHRS_KI * dt * AHRS_ONE);
+    acc_min     = (UINT32) accel_lsb_g * (100 - AHRS_ACCEL_GATE) / 100;
+    acc_max     = (UINT32) accel_lsb_g * (100 + AHRS_ACCEL_GATE) / 100;
+    mag_timeout = (UINT16) ((UINT32) AHRS_MAG_TIMEOUT_MS * rate_hz / 1000);
+    memset(&bench, 0, sizeof(bench));
+    q_head = q_tail = 0;
+    ahrs_reset();
+}
+
+/**
+ *  @brief  Aligns the filter again on the next samples.
+ *  @param[in]  none
+ *  @return     none
+ */
+void ahrs_reset ( void ) {
+
+    aligned = FALSE;
+    wait    = 0;
+    bias[0] = bias[1] = bias[2] = 0;
+}
+
+/**
+ *  @brief  Latest calibrated field, in the IMU axes.
+ *  @param[in]  x, y, z - uT
+ *  @return     none
+ */
+void ahrs_mag ( float x, float y, float z ) {
+
+    mag[0]  = (INT32) (x * 1000);
+    mag[1]  = (INT32) (y * 1000);
+    mag[2]  = (INT32) (z * 1000);
+    mag_age = 0;
+}
+
+/** Quaternion of the rotation matrix with rows north, west, up in sensor axes */
+static void ahrs_align ( const imu_sample *s, BOOL use_mag ) {
+
+    float z[3] = { s->ax, s->ay, s->az }, m[3] = { 1, 0, 0 }, w[3], n[3], r[3][3], t, k;
+    BYTE i;
+
+    if (use_mag){
+        m[0] = mag[0];
+        m[1] = mag[1];
+        m[2] = mag[2];
+    }
+    else if (fabsf(z[0]) > fabsf(z[2])){
+        m[0] = 0;                           // any horizontal reference, heading 0
+        m[2] = 1;
+    }
+
+    t = sqrtf(z[0] * z[0] + z[1] * z[1] + z[2] * z[2]);
+    if (t == 0)
+        return;                             // try the next sample
+    for (i = 0; i < 3; i++)
+        z[i] /= t;
+    w[0] = z[1] * m[2] - z[2] * m[1];
+    w[1] = z[2] * m[0] - z[0] * m[2];
+    w[2] = z[0] * m[1] - z[1] * m[0];
+    t = sqrtf(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]);
+    if (t == 0)
+        return;
+    for (i = 0; i < 3; i++)
+        w[i] /= t;
+    n[0] = w[1] * z[2] - w[2] * z[1];
+    n[1] = w[2] * z[0] - w[0] * z[2];
+    n[2] = w[0] * z[1] - w[1] * z[0];
+    for (i = 0; i < 3; i++){
+        r[0][i] = n[i];
+        r[1][i] = w[i];
+        r[2][i] = z[i];
+    }
+
+    /* largest component first, the others from it */
+    t = r[0][0] + r[1][1] + r[2][2];
+    if (t > 0){
+        k = 0.5f / sqrtf(1 + t);
+        m[0] = 0.25f / k;
+        n[0] = (r[2][1] - r[1][2]) * k;
+        n[1] = (r[0][2] - r[2][0]) * k;
+        n[2] = (r[1][0] - r[0][1]) * k;
+    }
+    else if (r[0][0] > r[1][1] && r[0][0] > r[2][2]){
+        k = 0.5f / sqrtf(1 + r[0][0] - r[1][1] - r[2][2]);
+        m[0] = (r[2][1] - r[1][2]) * k;
+        n[0] = 0.25f / k;
+        n[1] = (r[0][1] + r[1][0]) * k;
+        n[2] = (r[0][2] + r[2][0]) * k;
+    }
+    else if (r[1][1] > r[2][2]){
+        k = 0.5f / sqrtf(1 + r[1][1] - r[0][0] - r[2][2]);
+        m[0] = (r[0][2] - r[2][0]) * k;
+        n[0] = (r[0][1] + r[1][0]) * k;
+        n[1] = 0.25f / k;
+        n[2] = (r[1][2] + r[2][1]) * k;
+    }
+    else{
+        k = 0.5f / sqrtf(1 + r[2][2] - r[0][0] - r[1][1]);
+        m[0] = (r[1][0] - r[0][1]) * k;
+        n[0] = (r[0][2] + r[2][0]) * k;
+        n[1] = (r[1][2] + r[2][1]) * k;
+        n[2] = 0.25f / k;
+    }
+    q[0] = (INT32) lroundf(m[0] * AHRS_ONE);
+    for (i = 0; i < 3; i++)
+        q[i + 1] = (INT32) lroundf(n[i] * AHRS_ONE);
+    aligned = TRUE;
+}
+
+/**
+ *  @brief  One filter step with an IMU sample and the latest field.
+ *  Directly usable off the scheduler, e.g. by a host replay.
+ *  @param[in]  s - IMU sample
+ *  @return     none
+ */
+void ahrs_update ( const imu_sample *s ) {
+
+    UINT32 t0 = ReadCoreTimer(), t;
+    INT32 v[3], a[3], m[3], e[3] = { 0, 0, 0 }, h[3], w[3], k;
+    INT32 q0q0, q0q1, q0q2, q0q3, q1q1, q1q2, q1q3, q2q2, q2q3, q3q3, bx, bz, d[4];
+    UINT32 n;
+    BOOL use_mag = mag_age <= mag_timeout && (mag[0] || mag[1] || mag[2]);
+    BYTE i;
+
+    if (mag_age != 0xFFFF)
+        mag_age++;
+
+    if (!aligned){
+        if (!use_mag && wait++ < mag_timeout)
+            return;                         // give the field a chance
+        ahrs_align(s, use_mag);
+        if (!aligned)
+            return;
+    }
+
+    q0q0 = mul(q[0], q[0]);  q0q1 = mul(q[0], q[1]);  q0q2 = mul(q[0], q[2]);
+    q0q3 = mul(q[0], q[3]);  q1q1 = mul(q[1], q[1]);  q1q2 = mul(q[1], q[2]);
+    q1q3 = mul(q[1], q[3]);  q2q2 = mul(q[2], q[2]);  q2q3 = mul(q[2], q[3]);
+    q3q3 = mul(q[3], q[3]);
+
+    /* gravity (up) as the quaternion sees it, in sensor axes */
+    v[0] = 2 * (q1q3 - q0q2);
+    v[1] = 2 * (q0q1 + q2q3);
+    v[2] = q0q0 - q1q1 - q2q2 + q3q3;
+
+    a[0] = s->ax;
+    a[1] = s->ay;
+    a[2] = s->az;
+    n = normalise(a, a);
+    if (n >= acc_min && n <= acc_max){
+        e[0] = mul(a[1], v[2]) - mul(a[2], v[1]);
+        e[1] = mul(a[2], v[0]) - mul(a[0], v[2]);
+        e[2] = mul(a[0], v[1]) - mul(a[1], v[0]);
+    }
+
+    if (use_mag && normalise(mag, m)){
+        /* field in earth axes, its horizontal part taken as north */
+        h[0] = 2 * (mul(m[0], HALF - q2q2 - q3q3) + mul(m[1], q1q2 - q0q3) + mul(m[2], q1q3 + q0q2));
+        h[1] = 2 * (mul(m[0], q1q2 + q0q3) + mul(m[1], HALF - q1q1 - q3q3) + mul(m[2], q2q3 - q0q1));
+        bz   = 2 * (mul(m[0], q1q3 - q0q2) + mul(m[1], q2q3 + q0q1) + mul(m[2], HALF - q1q1 - q2q2));
+        bx   = (INT32) isqrt64((INT64) h[0] * h[0] + (INT64) h[1] * h[1]);
+        /* back in sensor axes */
+        w[0] = 2 * (mul(bx, HALF - q2q2 - q3q3) + mul(bz, q1q3 - q0q2));
+        w[1] = 2 * (mul(bx, q1q2 - q0q3) + mul(bz, q0q1 + q2q3));
+        w[2] = 2 * (mul(bx, q0q2 + q1q3) + mul(bz, HALF - q1q1 - q2q2));
+        /* heading part only: the error component along the vertical */
+        h[0] = mul(m[1], w[2]) - mul(m[2], w[1]);
+        h[1] = mul(m[2], w[0]) - mul(m[0], w[2]);
+        h[2] = mul(m[0], w[1]) - mul(m[1], w[0]);
+        k = mul(h[0], v[0]) + mul(h[1], v[1]) + mul(h[2], v[2]);
+        for (i = 0; i < 3; i++)
+            e[i] += mul(k, v[i]);
+    }
+
+    /* PI feedback on the rates, then half angles of this update */
+    h[0] = (INT32) (((INT64) s->gx * gyro_k) >> 8);
+    h[1] = (INT32) (((INT64) s->gy * gyro_k) >> 8);
+    h[2] = (INT32) (((INT64) s->gz * gyro_k) >> 8);
+    for (i = 0; i < 3; i++){
+        bias[i] += mul(e[i], ki_dt);
+        h[i]    += mul(e[i], kp_half) + mul(bias[i], half_dt);
+    }
+
+    d[0] = -mul(q[1], h[0]) - mul(q[2], h[1]) - mul(q[3], h[2]);
+    d[1] =  mul(q[0], h[0]) + mul(q[2], h[2]) - mul(q[3], h[1]);
+    d[2] =  mul(q[0], h[1]) - mul(q[1], h[2]) + mul(q[3], h[0]);
+    d[3] =  mul(q[0], h[2]) + mul(q[1], h[1]) - mul(q[2], h[0]);
+    for (i = 0; i < 4; i++)
+        q[i] += d[i];
+
+    /* 1 / |q| ~ (3 - |q|^2) / 2 near 1 */
+    k = (INT32) (((INT64) q[0] * q[0] + (INT64) q[1] * q[1] + (INT64) q[2] * q[2] + (INT64) q[3] * q[3]) >> 30);
+    k = 3 * HALF - k / 2;
+    for (i = 0; i < 4; i++)
+        q[i] = mul(q[i], k);
+
+    t = ReadCoreTimer() - t0;
+    bench.updates++;
+    bench.ticks += t;
+    if (t > bench.max_ticks)
+        bench.max_ticks = t;
+}
+
+/**
+ *  @brief  request orientation
+ *  @param[out] out - w, x, y, z in Q30 (AHRS_ONE = 1)
+ *  @return     none
+ */
+void ahrs_get ( INT32 out[4] ) {
+
+    BYTE i;
+
+    for (i = 0; i < 4; i++)
+        out[i] = q[i];
+}
+
+/**
+ *  @brief  Queues an IMU sample for the AHRS task, mpu_init callback.
+ *  @param[in]  s - IMU sample
+ *  @return     none
+ */
+void ahrs_push_imu ( const imu_sample *s ) {
+
+    if ((BYTE)(q_head - q_tail) >= AHRS_QUEUE){
+        bench.dropped++;
+        return;
+    }
+    queue[q_head++ & (AHRS_QUEUE-1)] = *s;
+    sched_post(EV_AHRS);
+}
+
+/**
+ *  @brief  Sets the quaternion output.
+ *  @param[in]  every - a "Q" line every n updates, 0 = off
+ *  @return     none
+ */
+void ahrs_set_report ( UINT16 every ) {
+
+    report   = every;
+    n_report = 0;
+}
+
+/** Q30 as -d.ddddd */
+static int ahrs_fixed ( char *out, INT32 v ) {
+
+    UINT32 u = (UINT32) ((((UINT64) (v < 0 ? -(INT64) v : v)) * 100000 + HALF) >> 30);
+
+    return sprintf(out, " %s%lu.%05lu", v < 0 ? "-" : "", (unsigned long) (u / 100000), (unsigned long) (u % 100000));
+}
+
+/** Sends the quaternion, skipped if the transmit ring is full */
+static void ahrs_send ( void ) {
+
+    BYTE bounce[AHRS_MAX_LINE];
+    uart_txw w;
+    char *p;
+    int n;
+    BYTE i;
+
+    if (UARTTxReserve(&w, AHRS_MAX_LINE))
+        return;
+    p = (char *) UARTTxDirect(&w, AHRS_MAX_LINE, bounce);
+    n = sprintf(p, "Q %lu", (unsigned long) ((UINT64) bench.updates * 1000 / rate));
+    for (i = 0; i < 4; i++)
+        n += ahrs_fixed(&p[n], q[i]);
+    p[n++] = '\n';
+    UARTTxAdvance(&w, (BYTE *) p, n);
+    UARTTxCommit(&w);
+}
+
+/**
+ *  @brief  AHRS task: runs the filter on the queued IMU samples.
+ *  @param[in]  events - EV_AHRS
+ *  @return     none
+ */
+void ahrs_task ( UINT32 events ) {
+
+    while (q_tail != q_head){
+        ahrs_update(&queue[q_tail++ & (AHRS_QUEUE-1)]);
+        if (report && aligned && ++n_report >= report){
+            n_report = 0;
+            ahrs_send();
+        }
+    }
+}
+
+/**
+ *  @brief  Update time statistics.
+ *  @param[out] b - copy
+ *  @return     none
+ */
+void ahrs_get_bench ( ahrs_bench *b ) { *b = bench; }
+
+/**
+ *  @brief  Formats the benchmark: "AHRS updates n cycles mean c max m dropped d",
+ *  in CPU cycles (two per core timer tick).
+ *  @param[out] out - AHRS_MAX_LINE bytes
+ *  @return     line length
+ */
+UINT32 ahrs_format ( char *out ) {
+
+    UINT32 mean = bench.updates ? (UINT32) (bench.ticks / bench.updates) : 0;
+
+    return sprintf(out, "AHRS updates %lu cycles %lu max %lu dropped %lu\n",
+                   (unsigned long) bench.updates, (unsigned long) (mean * (SYS_FREQ / ONE_SECOND)),
+                   (unsigned long) (bench.max_ticks * (SYS_FREQ / ONE_SECOND)), (unsigned long) bench.dropped);
+}
@@ -0,0 +1,67 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  main
+ *  @{
+ *      @file       ahrs.h
+ *      @brief      Orientation filter fusing the IMU and the magnetometer.
+ *      @details    A Mahony complementary filter in fixed point: the gyro
+ *                  is integrated into a quaternion every IMU sample and the
+ *                  drift is pulled back by a PI feedback on two errors, the
+ *                  accelerometer against the gravity direction the quaternion
+ *                  predicts, and the calibrated field (pipeline.c) against
+ *                  the predicted magnetic north. The magnetic error is
+ *                  projected on the vertical, so it only ever corrects the
+ *                  heading: a disturbed field cannot tilt the estimate
+ *                  (tilt compensation). The integral term tracks the gyro
+ *                  bias. Accelerations more than AHRS_ACCEL_GATE off 1 g are
+ *                  not trusted as gravity.
+ *
+ *                  The quaternion (Q30) rotates the sensor frame into the
+ *                  earth frame x magnetic north, y west, z up; the field must
+ *                  be given in the IMU axes, a mounting rotation between
+ *                  the two sensors goes into the calibration matrix. The
+ *                  filter starts aligned on the first accelerometer and
+ *                  field samples.
+ *
+ *                  Samples come from the IMU driver in the bus task and are
+ *                  queued for ahrs_task (EV_AHRS). The update time is
+ *                  measured with the core timer (ahrs_get_bench, AHRS
+ *                  command) and the quaternion is sent every n updates as
+ *                  "Q t_ms w x y z".
+ */
+#ifndef AHRS_H
+#define	AHRS_H
+
+#include "platform.h"
+#include "mpu.h"
+
+#define AHRS_KP             (1.0f)      /**< proportional gain, rad/s per unit error */
+#define AHRS_KI             (0.1f)      /**< integral gain, rad/s^2 per unit error */
+#define AHRS_ACCEL_GATE     (20)        /**< percent off 1 g still taken as gravity */
+#define AHRS_MAG_TIMEOUT_MS (200)       /**< older field samples do not correct the heading */
+#define AHRS_QUEUE          (16)        /**< IMU samples waiting, power of 2 */
+#define AHRS_MAX_LINE       (64)
+#define AHRS_ONE            (1L << 30)  /**< 1.0 in Q30 */
+
+/** @details Update time, core timer ticks, since ahrs_init. */
+typedef struct {
+    UINT32 updates;
+    UINT32 dropped;     /// IMU samples lost, queue full
+    UINT64 ticks;       /// sum of all updates
+    UINT32 max_ticks;
+}ahrs_bench;
+
+void   ahrs_init        ( UINT16 rate_hz, UINT16 gyro_dps, UINT16 accel_lsb_g );
+void   ahrs_reset       ( void );
+void   ahrs_mag         ( float x, float y, float z );
+void   ahrs_push_imu    ( const imu_sample *s );
+void   ahrs_update      ( const imu_sample *s );
+void   ahrs_get         ( INT32 q[4] );
+void   ahrs_set_report  ( UINT16 every );
+void   ahrs_task        ( UINT32 events );
+void   ahrs_get_bench   ( ahrs_bench *b );
+UINT32 ahrs_format      ( char *out );
+
+#endif	/* AHRS_H */
@@ -0,0 +1,114 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  main
+ *  @{
+ *      @file       boot.c
+ *      @brief      Boot milestones, from reset to the first sample.
+ *      @details    Each milestone keeps the core timer of its first mark.
+ */
+#include <stdio.h>
+#include "boot.h"
+
+#define TICKS_PER_US    (ONE_SECOND / 1000000)
+
+static UINT32 marks[BOOT_MARKS];
+static BYTE   marked = 0;           // bit per milestone
+#if defined(__PIC32MX__)
+static UINT32 cause  = 0;           // RCON at reset
+#endif
+static BYTE   revid  = 0;
+static UINT16 probes = 0;
+
+/**
+ *  @brief  First thing in main: zeroes the core timer and latches (then
+ *  clears) the reset cause.
+ *  @param[in]  none
+ *  @return     none
+ */
+void boot_start ( void ) {
+
+#if defined(__PIC32MX__)
+    WriteCoreTimer(0);
+    cause   = RCON;
+    RCONCLR = _RCON_POR_MASK | _RCON_BOR_MASK | _RCON_WDTO_MASK | _RCON_SWR_MASK | _RCON_EXTR_MASK;
+#endif
+    marked = 0;
+}
+
+/**
+ *  @brief  Notes a milestone; later marks of the same one are ignored.
+ *  @param[in]  milestone - BOOT_*
+ *  @return     none
+ */
+void boot_mark ( BYTE milestone ) {
+
+    if (milestone >= BOOT_MARKS || (marked & (1 << milestone)))
+        return;
+    marks[milestone] = ReadCoreTimer();
+    marked |= 1 << milestone;
+}
+
+/**
+ *  @brief  Notes the sensor probe result.
+ *  @param[in]  id - REVID_REG, 0 if the sensor did not answer
+ *  @param[in]  tries - reads it took
+ *  @return     none
+ */
+void boot_set_sensor ( BYTE id, UINT16 tries ) {
+
+    revid  = id;
+    probes = tries;
+}
+
+/**
+ *  @brief  request a milestone
+ *  @param[in]  milestone - BOOT_*
+ *  @return     core timer ticks since boot_start, 0 if not reached
+ */
+UINT32 boot_ticks ( BYTE milestone ) {
+
+    if (milestone >= BOOT_MARKS || !(marked & (1 << milestone)))
+        return 0;
+    return marks[milestone];
+}
+
+/** Name of the reset cause */
+static const char * boot_cause ( void ) {
+
+#if defined(__PIC32MX__)
+    if (cause & _RCON_POR_MASK)
+        return "por";
+    if (cause & _RCON_BOR_MASK)
+        return "bor";
+    if (cause & _RCON_WDTO_MASK)
+        return "wdt";
+    if (cause & _RCON_SWR_MASK)
+        return "sw";
+    if (cause & _RCON_EXTR_MASK)
+        return "mclr";
+#endif
+    return "other";
+}
+
+/**
+ *  @brief  Formats the milestones (see boot.h).
+ *  @param[out] out - BOOT_MAX_LINE bytes
+ *  @return     line length
+ */
+UINT32 boot_format ( char *out ) {
+
+    static const char * const name[BOOT_MARKS] = { "board", "sensor", "config", "request", "ready", "sample", "bist" };
+    UINT32 n;
+    BYTE i;
+
+    n = sprintf(out, "BOOT cause %s revid 0x%02X probes %u", boot_cause(), revid, probes);
+    for (i = 0; i < BOOT_MARKS; i++)
+        n += sprintf(out + n, " %s_us %lu", name[i], (unsigned long) (boot_ticks(i) / TICKS_PER_US));
+    if (boot_ticks(BOOT_SAMPLE) > MS_TO_CORE_TICKS(BOOT_TARGET_MS))
+        n += sprintf(out + n, " late");
+    out[n++] = '\n';
+    out[n]   = 0;
+    return n;
+}
@@ -0,0 +1,57 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  main
+ *  @{
+ *      @file       boot.h
+ *      @brief      Boot milestones, from reset to the first sample.
+ *      @details    The boot is ordered for the first sample: board set up,
+ *                  the sensor polled on REVID_REG until it answers, the
+ *                  saved settings applied (config.h), the first conversion
+ *                  started, and only then the rest of the bring-up (radio,
+ *                  IMU, tasks) while the sensor converts. The self test runs
+ *                  in the background in place of one of the first samples
+ *                  instead of blocking the boot.
+ *
+ *                  The core timer is zeroed first thing in main and left
+ *                  running by BoardInit, so each milestone is the core timer
+ *                  when it was reached; only the C start up code before main
+ *                  is not counted. The BOOT command reports them, with the
+ *                  reset cause, as
+ *
+ *                  BOOT cause c revid r probes p board_us b sensor_us s
+ *                  config_us c request_us q ready_us r sample_us f bist_us t [late]
+ *
+ *                  0 for a milestone not reached yet.
+ *
+ *                  late: the first sample came after BOOT_TARGET_MS, not
+ *                  reported before it came. The time of the first sample is
+ *                  also in the CONFIG report (config.h).
+ */
+#ifndef BOOT_H
+#define	BOOT_H
+
+#include "platform.h"
+
+/// Milestones
+#define BOOT_BOARD          0   /** BoardInit done */
+#define BOOT_SENSOR         1   /** RM3100 answered REVID_REG */
+#define BOOT_CONFIG         2   /** settings applied */
+#define BOOT_REQUEST        3   /** first conversion started */
+#define BOOT_READY          4   /** bring-up done, scheduler running */
+#define BOOT_SAMPLE         5   /** first good sample */
+#define BOOT_BIST           6   /** first self test done */
+#define BOOT_MARKS          7
+
+#define BOOT_TARGET_MS      (10)        /**< first sample expected within */
+#define BOOT_PROBE_MS       (50)        /**< REVID_REG polled this long, then the boot goes on */
+#define BOOT_MAX_LINE       (192)
+
+void   boot_start      ( void );
+void   boot_mark       ( BYTE milestone );
+void   boot_set_sensor ( BYTE revid, UINT16 probes );
+UINT32 boot_ticks      ( BYTE milestone );
+UINT32 boot_format     ( char *out );
+
+#endif	/* BOOT_H */
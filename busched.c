@@ -0,0 +1,263 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  I2C
+ *  @{
+ *      @file       busched.c
+ *      @brief      Shared I2C bus scheduler.
+ *      @details    Earliest deadline first over the queue heads, without
+ *                  preemption. The queues hold pointers to the caller's
+ *                  requests, so submitting copies nothing. Deadlines are core
+ *                  timer ticks compared through their signed difference, so
+ *                  the timer wrap does not matter as long as they are less
+ *                  than 53 s away.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "busched.h"
+#include "i2c.h"
+#include "scheduler.h"
+
+/** @details A device and its request queue. */
+typedef struct {
+    BYTE          prio;         /// 0 - highest
+    bus_request  *queue[BUS_QUEUE_DEPTH];
+    BYTE          head, tail;
+    bus_dev_stats stats;
+}bus_device;
+
+static bus_device dev[BUS_MAX_DEVICES];
+static BYTE       n_dev = 0;
+static UINT64     busy_ticks = 0;       // bus time of all devices
+static UINT64     elapsed    = 0;       // since busched_reset_stats
+static UINT32     last_tick  = 0;
+
+/** Urgency class: 0 - deadline still reachable, 1 - overdue, 2 - none */
+static BYTE bus_class ( const bus_request *r, UINT32 now ) {
+
+    if (r->deadline == BUS_NO_DEADLINE)
+        return 2;
+    return (INT32) (now - r->deadline) > 0;
+}
+
+/** TRUE if request a must go before b */
+static BOOL bus_before ( const bus_request *a, BYTE pa, const bus_request *b, BYTE pb, UINT32 now ) {
+
+    BYTE ca = bus_class(a, now), cb = bus_class(b, now);
+
+    if (ca != cb)
+        return ca < cb;
+    if (ca != 2 && a->deadline != b->deadline)
+        return (INT32) (a->deadline - b->deadline) < 0;
+    return pa < pb;
+}
+
+/**
+ *  @brief  Registers a device sharing the bus.
+ *  @param[in]  name - for the report
+ *  @param[in]  prio - breaks deadline ties, 0 is the highest
+ *  @return     device number, BUS_NO_DEVICE if the table is full
+ */
+BYTE busched_add_device ( const char *name, BYTE prio ) {
+
+    bus_device *d;
+
+    if (n_dev >= BUS_MAX_DEVICES)
+        return BUS_NO_DEVICE;
+
+    d = &dev[n_dev];
+    memset(d, 0, sizeof(bus_device));
+    d->prio       = prio;
+    d->stats.name = name;
+    if (!n_dev)
+        last_tick = ReadCoreTimer();
+    return n_dev++;
+}
+
+/**
+ *  @brief  Deadline a number of core timer ticks from now.
+ *  @param[in]  ticks - less than 2^31
+ *  @return     deadline for bus_request, never BUS_NO_DEADLINE
+ */
+UINT32 busched_deadline ( UINT32 ticks ) {
+
+    UINT32 t = ReadCoreTimer() + ticks;
+
+    return t == BUS_NO_DEADLINE ? t + 1 : t;
+}
+
+/**
+ *  @brief  Queues a transaction. The deadline and the rest of the request
+ *  must be filled in; done is called from the bus task once it is over.
+ *  @param[in]  device - from busched_add_device
+ *  @param[in]  r - request, not to be touched until done
+ *  @return     0 if successful, 1 if the queue is full or r is still busy.
+ */
+BOOL busched_submit ( BYTE device, bus_request *r ) {
+
+    bus_device *d;
+
+    if (device >= n_dev)
+        return TRUE;
+    d = &dev[device];
+    if (r->busy || (BYTE)(d->tail - d->head) >= BUS_QUEUE_DEPTH){
+        d->stats.rejected++;
+        return TRUE;
+    }
+
+    r->busy      = TRUE;
+    r->late      = FALSE;
+    r->status    = I2C_OK;
+    r->attempt   = 0;
+    r->submitted = ReadCoreTimer();
+    d->queue[d->tail++ & (BUS_QUEUE_DEPTH-1)] = r;
+    sched_post(EV_BUS);
+    return FALSE;
+}
+
+/**
+ *  @brief  Runs the most urgent queued transaction.
+ *  @param[in]  none
+ *  @return     TRUE if one ran, FALSE if all queues are empty.
+ */
+BOOL busched_run_one ( void ) {
+
+    bus_device *d, *best = NULL;
+    bus_request *r, *rb = NULL;
+    UINT32 t0 = ReadCoreTimer(), t1;
+    BYTE i;
+
+    for (i = 0; i < n_dev; i++){
+        d = &dev[i];
+        if (d->head == d->tail)
+            continue;
+        r = d->queue[d->head & (BUS_QUEUE_DEPTH-1)];
+        if (!best || bus_before(r, d->prio, rb, best->prio, t0)){
+            best = d;
+            rb   = r;
+        }
+    }
+    if (!best)
+        return FALSE;
+
+    if (rb->op == BUS_WRITE)
+        rb->status = i2c_write_attempt(rb->addr, rb->reg, rb->len, rb->data, rb->attempt);
+    else
+        rb->status = i2c_read_attempt(rb->addr, rb->reg, rb->len, rb->data, rb->attempt);
+    t1 = ReadCoreTimer();
+    best->stats.busy += t1 - t0;
+    busy_ticks       += t1 - t0;
+    if (rb->status != I2C_OK && rb->attempt < i2c_get_max_retries()){
+        rb->attempt++;                  // stays at the head, other devices may go first
+        return TRUE;
+    }
+    best->head++;
+
+    rb->late = rb->deadline != BUS_NO_DEADLINE && (INT32) (t1 - rb->deadline) > 0;
+    best->stats.requests++;
+    best->stats.bytes += rb->len;
+    if (rb->status != I2C_OK)
+        best->stats.errors++;
+    if (rb->late)
+        best->stats.misses++;
+    if (t0 - rb->submitted > best->stats.max_wait)
+        best->stats.max_wait = t0 - rb->submitted;
+    elapsed    += t1 - last_tick;
+    last_tick   = t1;
+
+    rb->busy = FALSE;
+    if (rb->done)
+        rb->done(rb);
+    return TRUE;
+}
+
+/**
+ *  @brief  Bus task: one transaction per activation so that higher
+ *  priority tasks get in between, reposts itself while work is queued.
+ *  @param[in]  events - EV_BUS
+ *  @return     none
+ */
+void busched_task ( UINT32 events ) {
+
+    BYTE i;
+
+    if (!busched_run_one())
+        return;
+    for (i = 0; i < n_dev; i++)
+        if (dev[i].head != dev[i].tail){
+            sched_post(EV_BUS);
+            break;
+        }
+}
+
+/**
+ *  @brief  Clears the counters and starts a new utilisation window.
+ *  @param[in]  none
+ *  @return     none
+ */
+void busched_reset_stats ( void ) {
+
+    const char *name;
+    BYTE i;
+
+    for (i = 0; i < n_dev; i++){
+        name = dev[i].stats.name;
+        memset(&dev[i].stats, 0, sizeof(bus_dev_stats));
+        dev[i].stats.name = name;
+    }
+    busy_ticks = elapsed = 0;
+    last_tick  = ReadCoreTimer();
+}
+
+/**
+ *  @brief  Counters of one device.
+ *  @param[in]  device - from busched_add_device
+ *  @param[out] s - copy of the counters
+ *  @return     0 if successful, 1 if there is no such device.
+ */
+BOOL busched_get_stats ( BYTE device, bus_dev_stats *s ) {
+
+    if (device >= n_dev)
+        return TRUE;
+
+    *s = dev[device].stats;
+    return FALSE;
+}
+
+/**
+ *  @brief  Share of the time the bus was busy with scheduled transactions,
+ *  up to the last one.
+ *  @param[in]  none
+ *  @return     per mille
+ */
+UINT16 busched_utilisation ( void ) {
+
+    return elapsed ? (UINT16) (busy_ticks * 1000 / elapsed) : 0;
+}
+
+/**
+ *  @brief  Formats the report: "BUS util u.u% name n req miss m err e
+ *  wait_us w ..." with one group per device.
+ *  @param[out] out - BUS_MAX_LINE bytes
+ *  @return     line length
+ */
+UINT32 busched_format ( char *out ) {
+
+    UINT16 u = busched_utilisation();
+    const bus_dev_stats *s;
+    UINT32 len;
+    BYTE i;
+
+    len = sprintf(out, "BUS util %u.%u%%", u / 10, u % 10);
+    for (i = 0; i < n_dev && len + BUS_MAX_GROUP + 2 <= BUS_MAX_LINE; i++){
+        s = &dev[i].stats;
+        len += sprintf(&out[len], " %.6s %lu miss %lu err %lu wait_us %lu", s->name,
+                       (unsigned long) s->requests, (unsigned long) s->misses,
+                       (unsigned long) s->errors,
+                       (unsigned long) (s->max_wait / (ONE_SECOND/1000000)));
+    }
+    out[len++] = '\n';
+    out[len]   = 0;
+    return len;
+}
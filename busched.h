@@ -0,0 +1,92 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  I2C
+ *  @{
+ *      @file       busched.h
+ *      @brief      Shared I2C bus scheduler.
+ *      @details    The RM3100 and an IMU share I2C1. Each device gets a queue
+ *                  of requests (register read or write) with a deadline, the
+ *                  time by which the data must be off the bus (next DRDY,
+ *                  FIFO overflow). The bus task runs one transaction per
+ *                  activation, always the queue head with the earliest
+ *                  deadline; requests already past their deadline come after
+ *                  those that can still make it (no domino effect when the
+ *                  bus is overloaded), requests without deadline go last and
+ *                  the device priority breaks ties. Transactions are not preempted, so a
+ *                  long IMU FIFO burst should be split in chunks short enough
+ *                  for the magnetometer deadline.
+ *
+ *                  A failed transaction is retried up to the I2C retry
+ *                  policy, one attempt per activation, so the other devices
+ *                  get the bus between two attempts.
+ *
+ *                  A request completing after its deadline is a miss. Per
+ *                  device the scheduler counts transactions, bytes, misses and
+ *                  the worst wait (submit to start); for the bus, the busy
+ *                  time since busched_reset_stats, i.e. the utilisation.
+ *
+ *                  Transfers made with i2c_read / i2c_write directly (setup,
+ *                  self test) are still possible between two scheduled ones,
+ *                  they are just not accounted.
+ */
+#ifndef BUSCHED_H
+#define	BUSCHED_H
+
+#include "platform.h"
+
+#define BUS_MAX_DEVICES     (4)
+#define BUS_QUEUE_DEPTH     (4)         /**< Requests per device, power of 2 */
+#define BUS_NO_DEADLINE     (0)
+#define BUS_NO_DEVICE       (0xFF)
+#define BUS_MAX_GROUP       (68)        /**< " name requests miss m err e wait_us w" */
+#define BUS_MAX_LINE        (16 + BUS_MAX_DEVICES * BUS_MAX_GROUP + 2)  /**< "BUS util 6553.5%", the devices, "\n" */
+
+/// Operations
+#define BUS_READ            0
+#define BUS_WRITE           1
+
+struct bus_request;
+typedef void (*bus_done_fn)( struct bus_request *r );
+
+/** @details One transaction. Owned by the caller, must stay valid until done is called. */
+typedef struct bus_request {
+    BYTE        op;         /// BUS_READ / BUS_WRITE
+    BYTE        addr;       /// 7 bits slave address
+    BYTE        reg;
+    BYTE        len;
+    BYTE       *data;
+    UINT32      deadline;   /// core timer tick, BUS_NO_DEADLINE = none
+    bus_done_fn done;       /// called from the bus task, may be NULL
+    /* set by the scheduler */
+    BYTE        status;     /// I2C_OK or I2C_ERR_*
+    BOOL        late;       /// completed after the deadline
+    BOOL        busy;       /// queued or running
+    BYTE        attempt;    /// failed attempts so far
+    UINT32      submitted;  /// core timer tick
+}bus_request;
+
+/** @details Counters of one device. */
+typedef struct {
+    const char *name;
+    UINT32 requests;    /// completed
+    UINT32 bytes;
+    UINT32 errors;      /// completed with an I2C error
+    UINT32 misses;      /// completed after the deadline
+    UINT32 rejected;    /// queue full
+    UINT32 max_wait;    /// core timer ticks, submit to start
+    UINT32 busy;        /// core timer ticks on the bus
+}bus_dev_stats;
+
+BYTE   busched_add_device  ( const char *name, BYTE prio );
+UINT32 busched_deadline    ( UINT32 ticks );
+BOOL   busched_submit      ( BYTE dev, bus_request *r );
+BOOL   busched_run_one     ( void );
+void   busched_task        ( UINT32 events );
+void   busched_reset_stats ( void );
+BOOL   busched_get_stats   ( BYTE dev, bus_dev_stats *s );
+UINT16 busched_utilisation ( void );
+UINT32 busched_format      ( char *out );
+
+#endif	/* BUSCHED_H */
@@ -0,0 +1,354 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  nvm
+ *  @{
+ *      @file       capture.c
+ *      @brief      High rate burst capture to program flash.
+ *      @details    capture_push() runs in the acquisition task and only copies
+ *                  into RAM. All flash work is done by capture_task(), one
+ *                  page erase or one row program per activation, so the
+ *                  acquisition task can run in between.
+ */
+#include <stdio.h>
+#include "capture.h"
+#include "scheduler.h"
+#include "uart.h"
+
+/* Reserved flash */
+static NVM_REGION(capture_flash, CAPTURE_REGION_SIZE);
+
+/* Page buffers, a ring */
+static UINT32 page_buf[CAPTURE_RAM_PAGES][NVM_PAGE_SIZE/4];
+static BYTE   buf_rows[CAPTURE_RAM_PAGES];  // rows used in each buffer
+static BYTE   buf_full[CAPTURE_RAM_PAGES];  // buffer waiting to be programmed
+static BYTE   buf_page[CAPTURE_RAM_PAGES];  // flash page of each buffer
+static BYTE   flush_row[CAPTURE_RAM_PAGES]; // next row to program
+static BYTE   flush;                        // oldest buffer to program
+/* Fill position */
+static BYTE   fill, fill_row, fill_rec;
+static BYTE   next_page;
+static BYTE   row_epoch;            // of the row being filled
+static UINT32 last_t;
+static UINT32 min_gap;              // shortest sample interval, core ticks
+/* Erase / dump position */
+static BYTE   erase_page;
+static UINT32 dump_index, dump_row;
+static BYTE   dump_rec;
+static UINT32 dump_t_us;
+static UINT32 dump_cfg;             // epoch | cycle count << 8 of the last configuration frame
+
+static capture_stats cap = { .state = CAP_IDLE };
+
+/**
+ *  @brief  Starts a capture. The region is erased first, in the background.
+ *  @param[in]  samples - samples to capture, 0 or too many fills the region
+ *  @return     0 if started, 1 if a capture or dump is in progress.
+ */
+BOOL capture_start ( UINT32 samples ) {
+
+    if (cap.state != CAP_IDLE && cap.state != CAP_DONE)
+        return TRUE;
+
+    memset(&cap, 0, sizeof(cap));
+    cap.requested = (samples && samples < CAPTURE_MAX_SAMPLES) ? samples : CAPTURE_MAX_SAMPLES;
+    cap.state     = CAP_ERASING;
+    erase_page    = 0;
+    sched_post(EV_CAPTURE);
+
+    return FALSE;
+}
+
+/**
+ *  @brief  Starts sending the last capture over the UART.
+ *  @param[in]  none
+ *  @return     0 if started, 1 if there is no finished capture.
+ */
+BOOL capture_dump ( void ) {
+
+    char buf[32];
+
+    if (cap.state != CAP_DONE)
+        return TRUE;
+
+    sprintf(buf, "CAPTURE %u\n", (unsigned) cap.captured);
+    SendDataBuffer(buf, strlen(buf));
+
+    cap.state  = CAP_DUMPING;
+    cap.dumped = 0;
+    dump_index = 0;
+    dump_row   = 0;
+    dump_rec   = 0;
+    dump_t_us  = 0;
+    sched_post(EV_CAPTURE);
+
+    return FALSE;
+}
+
+/**
+ *  @brief  TRUE while samples must go to capture_push() instead of the
+ *  pipeline; during the erase they still go to the pipeline.
+ */
+BOOL capture_active ( void ) {
+
+    return cap.state == CAP_RUNNING;
+}
+
+/** TRUE if a row can be programmed while sampling: the samples seen so far
+ *  leave room for the stall */
+static BOOL capture_can_program ( void ) {
+
+    return cap.captured >= 2 && min_gap >= ONE_SECOND / CAPTURE_FLASH_MAX_HZ;
+}
+
+/** The rest of the row being filled stays erased */
+static void capture_pad_row ( void ) {
+
+    memset((BYTE *) page_buf[fill] + fill_row * NVM_ROW_SIZE + CAPTURE_ROW_HEADER + fill_rec * CAPTURE_RECORD_SIZE,
+           0xFF, (CAPTURE_PER_ROW - fill_rec) * CAPTURE_RECORD_SIZE);
+}
+
+/** Hands the fill buffer to the flash task and moves to the other one */
+static void capture_switch ( void ) {
+
+    if (fill_row == 0 && fill_rec == 0)
+        return;
+    if (fill_rec){                      // partial row
+        capture_pad_row();
+        fill_row++;
+    }
+    buf_rows[fill]  = fill_row;
+    flush_row[fill] = 0;
+    buf_full[fill]  = TRUE;
+    sched_post(EV_CAPTURE);
+
+    fill     = (fill + 1) % CAPTURE_RAM_PAGES;
+    fill_row = 0;
+    fill_rec = 0;
+}
+
+/** Ends the capture, remaining rows are flushed by the task */
+static void capture_stop ( void ) {
+
+    capture_switch();
+    cap.state = CAP_FLUSHING;
+    sched_post(EV_CAPTURE);
+}
+
+/**
+ *  @brief  Stores one sample. Constant time, RAM only.
+ *  @param[in]  s - sample
+ *  @return     0 if stored, 1 if dropped.
+ */
+BOOL capture_push ( const mag_sample *s ) {
+
+    BYTE *row, *rec;
+    UINT32 dt;
+    UINT16 cc;
+
+    if (cap.state != CAP_RUNNING)
+        return TRUE;
+    if (fill_rec && s->raw.epoch != row_epoch){     // a row holds one configuration
+        capture_pad_row();
+        fill_rec = 0;
+        if (++fill_row == CAPTURE_ROWS_PER_PAGE)
+            capture_switch();
+    }
+    if (fill_row == 0 && fill_rec == 0 && next_page >= CAPTURE_FLASH_PAGES){  // region full, rows ended early
+        capture_stop();
+        return TRUE;
+    }
+    if (buf_full[fill]){                // flash still busy with this buffer
+        if (!capture_can_program()){    // RAM ring full, the rows go after it
+            cap.held = TRUE;
+            capture_stop();
+        }
+        else
+            cap.overruns++;
+        return TRUE;
+    }
+    if (fill_row == 0 && fill_rec == 0)     // page of the buffer, once it is free
+        buf_page[fill] = next_page++;
+
+    row = (BYTE *) page_buf[fill] + fill_row * NVM_ROW_SIZE;
+    if (fill_rec == 0){
+        cc     = RM3100_getEpoch(s->raw.epoch)->cycle_count;
+        row[0] = cap.captured;
+        row[1] = cap.captured >> 8;
+        row[2] = cc;
+        row[3] = cc >> 8;
+        row[5] = s->raw.epoch;
+        row[6] = CAPTURE_ROW_MAGIC & 0xFF;
+        row[7] = CAPTURE_ROW_MAGIC >> 8;
+        row_epoch = s->raw.epoch;
+    }
+    row[4] = fill_rec + 1;
+
+    if (cap.captured == 0){
+        cap.start_tick = s->t;
+        min_gap        = 0xFFFFFFFF;
+        dt = 0;
+    }
+    else{
+        if (s->t - last_t < min_gap)
+            min_gap = s->t - last_t;
+        dt = (s->t - last_t) / (ONE_SECOND / 1000000 * CAPTURE_DT_UNIT_US);
+    }
+    if (dt > 0xFFFF)
+        dt = 0xFFFF;
+    last_t       = s->t;
+    cap.end_tick = s->t;
+
+    rec = row + CAPTURE_ROW_HEADER + fill_rec * CAPTURE_RECORD_SIZE;
+    rec[0]  = s->raw.x >> 16;
+    rec[1]  = s->raw.x >> 8;
+    rec[2]  = s->raw.x;
+    rec[3]  = s->raw.y >> 16;
+    rec[4]  = s->raw.y >> 8;
+    rec[5]  = s->raw.y;
+    rec[6]  = s->raw.z >> 16;
+    rec[7]  = s->raw.z >> 8;
+    rec[8]  = s->raw.z;
+    rec[9]  = s->raw.flags;
+    rec[10] = dt;
+    rec[11] = dt >> 8;
+
+    cap.captured++;
+    if (++fill_rec == CAPTURE_PER_ROW){
+        fill_rec = 0;
+        if (++fill_row == CAPTURE_ROWS_PER_PAGE)
+            capture_switch();
+    }
+    if (cap.captured >= cap.requested)
+        capture_stop();
+
+    return FALSE;
+}
+
+/** Programs one pending row, oldest buffer first, TRUE if there was one */
+static BOOL capture_flush_one ( void ) {
+
+    BYTE b = flush;
+    const BYTE *dst;
+
+    if (!buf_full[b])
+        return FALSE;
+    dst = capture_flash + buf_page[b] * NVM_PAGE_SIZE + flush_row[b] * NVM_ROW_SIZE;
+    nvm_write_row(dst, (BYTE *) page_buf[b] + flush_row[b] * NVM_ROW_SIZE);
+    if (++flush_row[b] >= buf_rows[b]){
+        buf_full[b] = FALSE;
+        flush = (b + 1) % CAPTURE_RAM_PAGES;
+    }
+    return TRUE;
+}
+
+/** Sends a few records of the capture as binary frames, formatted in the
+ *  transmit ring, with a configuration frame where it changes. Returns 1 if
+ *  the ring is full. */
+static BOOL capture_dump_some ( void ) {
+
+    BYTE bounce[FRAME_CFG_SIZE + FRAME_SIZE];
+    BYTE *frame;
+    BYTE n, len;
+    UINT32 cfg;
+    const BYTE *row, *rec;
+    sensor_xyz raw;
+    uart_txw w;
+
+    for (n = 0; n < CAPTURE_DUMP_CHUNK && dump_index < cap.captured; n++, dump_index++){
+        if (UARTTxReserve(&w, FRAME_CFG_SIZE + FRAME_SIZE))
+            return TRUE;
+
+        row = capture_flash + dump_row * NVM_ROW_SIZE;
+        if (dump_rec == row[4]){        // rows may end early
+            row += NVM_ROW_SIZE;
+            dump_row++;
+            dump_rec = 0;
+        }
+        rec = row + CAPTURE_ROW_HEADER + dump_rec++ * CAPTURE_RECORD_SIZE;
+
+        raw.x     = ((INT32)((UINT32) rec[0] << 24 | (UINT32) rec[1] << 16 | (UINT32) rec[2] << 8)) >> 8;
+        raw.y     = ((INT32)((UINT32) rec[3] << 24 | (UINT32) rec[4] << 16 | (UINT32) rec[5] << 8)) >> 8;
+        raw.z     = ((INT32)((UINT32) rec[6] << 24 | (UINT32) rec[7] << 16 | (UINT32) rec[8] << 8)) >> 8;
+        raw.flags = rec[9];
+        raw.epoch = row[5];
+        dump_t_us += (rec[10] | (UINT32) rec[11] << 8) * CAPTURE_DT_UNIT_US;
+
+        frame = UARTTxDirect(&w, FRAME_CFG_SIZE + FRAME_SIZE, bounce);
+        len   = 0;
+        cfg   = row[5] | (UINT32) row[2] << 8 | (UINT32) row[3] << 16;
+        if (dump_index == 0 || cfg != dump_cfg){
+            dump_cfg = cfg;
+            len = pipeline_pack_config(frame, row[5], row[2] | (UINT16) row[3] << 8);
+        }
+        len += pipeline_pack_frame(frame + len, dump_index, dump_t_us, &raw);
+        UARTTxAdvance(&w, frame, len);
+        UARTTxCommit(&w);
+        cap.dumped++;
+    }
+    return FALSE;
+}
+
+/**
+ *  @brief  Capture task: erases, programs and dumps in small steps.
+ *  @param[in]  events - EV_CAPTURE, EV_UART_TX
+ *  @return     none
+ */
+void capture_task ( UINT32 events ) {
+
+    char buf[80];
+    UINT32 us;
+
+    switch (cap.state){
+        case CAP_ERASING:
+            nvm_erase_page(capture_flash + erase_page * NVM_PAGE_SIZE);
+            if (++erase_page >= CAPTURE_FLASH_PAGES){
+                fill = fill_row = fill_rec = flush = 0;
+                memset(buf_full, FALSE, sizeof(buf_full));
+                next_page   = 0;
+                cap.state   = CAP_RUNNING;
+            }
+            else
+                sched_post(EV_CAPTURE);
+            break;
+
+        case CAP_RUNNING:
+            if (capture_can_program() && capture_flush_one())
+                sched_post(EV_CAPTURE);
+            break;
+
+        case CAP_FLUSHING:
+            if (capture_flush_one()){
+                sched_post(EV_CAPTURE);
+                break;
+            }
+            cap.state = CAP_DONE;
+            us = (cap.end_tick - cap.start_tick) / (ONE_SECOND / 1000000);
+            sprintf(buf, "OK CAPTURE n=%u overruns=%u us=%u rows=%u held=%u\n", (unsigned) cap.captured,
+                    (unsigned) cap.overruns, (unsigned) us, (unsigned) nvm_get_stats()->rows, (unsigned) cap.held);
+            SendDataBuffer(buf, strlen(buf));
+            break;
+
+        case CAP_DUMPING:
+            if (capture_dump_some())
+                break;                  // ring full, resume on EV_UART_TX
+            if (dump_index < cap.captured){
+                sched_post(EV_CAPTURE);
+                break;
+            }
+            cap.state = CAP_DONE;
+            SendDataBuffer("END\n", 4);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+ *  @brief  Capture progress and counters.
+ *  @param[in]  none
+ *  @return     pointer to the counters
+ */
+const capture_stats * capture_get_stats ( void ) { return &cap; }
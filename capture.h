@@ -0,0 +1,89 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  nvm
+ *  @{
+ *      @file       capture.h
+ *      @brief      High rate burst capture to program flash.
+ *      @details    While a capture runs, samples go to flash instead of the
+ *                  UART stream. They are packed in a ring of
+ *                  CAPTURE_RAM_PAGES page sized RAM buffers, programmed row
+ *                  by row between samples. The region is erased before the
+ *                  capture starts, so no erase happens while sampling; the
+ *                  stream goes on between the page erases. Afterwards the capture
+ *                  is downloaded over the UART as binary frames.
+ *
+ *                  Programming a row stalls the CPU for about
+ *                  CAPTURE_ROW_US, and a DRDY in the stall is missed if the
+ *                  next one comes first. Rows are therefore only
+ *                  programmed during the capture while the samples come at
+ *                  most at CAPTURE_FLASH_MAX_HZ (shortest interval seen);
+ *                  then the capture can fill the whole region. Faster, e.g.
+ *                  CMM_UPDATERATE_600, every sample is kept in the RAM ring
+ *                  and the capture ends when it is full,
+ *                  CAPTURE_RAM_SAMPLES samples (2.2 s at 600 Hz); the rows
+ *                  are programmed after it.
+ *
+ *                  Flash row: header (first sample index u16, cycle count
+ *                  u16, count, epoch, CAPTURE_ROW_MAGIC u16, all LE)
+ *                  followed by up to CAPTURE_PER_ROW records of x,y,z (24
+ *                  bits big endian), flags and dt (u16 LE, in
+ *                  CAPTURE_DT_UNIT_US units, saturated). A row holds one
+ *                  sensor configuration: a sample of another epoch ends the
+ *                  row early, so a capture with configuration changes may
+ *                  fill the region before CAPTURE_MAX_SAMPLES. The dump
+ *                  sends a configuration frame (pipeline.h) before the
+ *                  first frame and at each change.
+ */
+#ifndef CAPTURE_H
+#define	CAPTURE_H
+
+#include "platform.h"
+#include "nvm.h"
+#include "pipeline.h"
+
+#define CAPTURE_FLASH_PAGES     (16)                                        /**< 64 KB of program flash */
+#define CAPTURE_RAM_PAGES       (4)                                         /**< 16 KB of RAM buffers, >= 2 */
+#define CAPTURE_REGION_SIZE     (CAPTURE_FLASH_PAGES * NVM_PAGE_SIZE)
+#define CAPTURE_ROW_HEADER      (8)
+#define CAPTURE_RECORD_SIZE     (12)
+#define CAPTURE_PER_ROW         ((NVM_ROW_SIZE - CAPTURE_ROW_HEADER) / CAPTURE_RECORD_SIZE)
+#define CAPTURE_ROWS_PER_PAGE   (NVM_PAGE_SIZE / NVM_ROW_SIZE)
+#define CAPTURE_MAX_SAMPLES     (CAPTURE_FLASH_PAGES * CAPTURE_ROWS_PER_PAGE * CAPTURE_PER_ROW)   /**< < 2^16 */
+#define CAPTURE_RAM_SAMPLES     (CAPTURE_RAM_PAGES * CAPTURE_ROWS_PER_PAGE * CAPTURE_PER_ROW)     /**< above CAPTURE_FLASH_MAX_HZ */
+#define CAPTURE_ROW_US          (3000)  /**< row program stall, typical */
+#define CAPTURE_FLASH_MAX_HZ    (250)   /**< fastest rate programmed while sampling: row stall, read and slack */
+#define CAPTURE_ROW_MAGIC       (0xCA57)
+#define CAPTURE_DT_UNIT_US      (10)
+#define CAPTURE_DUMP_CHUNK      (4)     /**< Frames sent per task activation while dumping */
+
+typedef enum {
+    CAP_IDLE,
+    CAP_ERASING,        /// erasing the region, one page per activation
+    CAP_RUNNING,        /// storing samples
+    CAP_FLUSHING,       /// programming the last buffered rows
+    CAP_DONE,           /// capture in flash
+    CAP_DUMPING         /// sending the capture over the UART
+}capture_state;
+
+/** @details Capture progress and performance. */
+typedef struct {
+    capture_state state;
+    UINT32 requested;       /// samples wanted
+    UINT32 captured;        /// samples stored
+    UINT32 overruns;        /// samples lost, every page buffer busy
+    BOOL   held;            /// ended by the full RAM ring, rate above CAPTURE_FLASH_MAX_HZ
+    UINT32 start_tick;      /// first sample
+    UINT32 end_tick;        /// last sample
+    UINT32 dumped;          /// samples sent by the last dump
+}capture_stats;
+
+BOOL capture_start  ( UINT32 samples );
+BOOL capture_dump   ( void );
+BOOL capture_active ( void );
+BOOL capture_push   ( const mag_sample *s );
+void capture_task   ( UINT32 events );
+const capture_stats * capture_get_stats ( void );
+
+#endif	/* CAPTURE_H */
@@ -0,0 +1,329 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  uart
+ *  @{
+ *      @file       cmd.c
+ *      @brief      UART command channel for runtime reconfiguration.
+ *      @details    The parser runs as a scheduler task on EV_UART_RX and never
+ *                  touches the sensor. The acquisition task calls cmd_apply()
+ *                  when no measurement is in flight.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "cmd.h"
+#include "rm3100.h"
+#include "pipeline.h"
+#include "capture.h"
+#include "uart.h"
+#include "textfmt.h"
+#include "stats.h"
+#include "fft.h"
+#include "notch.h"
+#include "radio_link.h"
+#include "busched.h"
+#include "ahrs.h"
+#include "mpu.h"
+#include "pps.h"
+#include "resample.h"
+#include "config.h"
+#include "boot.h"
+#include "quality.h"
+#include "power.h"
+
+static char       line[CMD_LINE_SIZE];
+static BYTE       line_len = 0;
+static cmd_config pending;
+
+/** Sends a reply line */
+static void cmd_reply ( const char *text ) {
+
+    SendDataBuffer(text, strlen(text));
+}
+
+/** Reports the settings in use */
+static void cmd_report ( const char *status ) {
+
+    char buf[96 + 2 * TEXTFMT_MAX_FIELD];
+    char rate[TEXTFMT_MAX_FIELD + 1], gain[TEXTFMT_MAX_FIELD + 1];
+
+    textfmt_fixed(rate, getRM3100SampleRate(), 3);
+    textfmt_fixed(gain, getRM3100Gain(), 2);
+    sprintf(buf, "%s CC=%u TMRC=0x%02X CMM=0x%02X RATE=%s GAIN=%s EPOCH=%u FMT=%u AVG=%u GRID=%u\n",
+            status, getRM3100CycleCount(), getRM3100DataRateCode(), getRM3100CMMConfig(),
+            rate, gain, getRM3100Epoch(), pipeline_get_format(), pipeline_get_average(), resample_get_rate());
+    cmd_reply(buf);
+}
+
+/** Parses one line into the staged configuration */
+static void cmd_parse ( char *text ) {
+
+    char *key, *arg, *end;
+    unsigned long value = 0;
+
+    key = strtok(text, " \t");
+    if (!key)
+        return;
+    arg = strtok(NULL, " \t");
+    if (arg){
+        value = strtoul(arg, &end, 0);
+        if (*end){
+            cmd_reply("ERR bad number\n");
+            return;
+        }
+    }
+
+    if (!strcmp(key, "GET")){
+        cmd_report("OK");
+        return;
+    }
+    if (!strcmp(key, "DUMP")){
+        if (capture_dump())
+            cmd_reply("ERR no capture\n");
+        return;
+    }
+    if (!strcmp(key, "BUS")){
+        char reply[BUS_MAX_LINE];
+        busched_format(reply);
+        cmd_reply(reply);
+        busched_reset_stats();
+        return;
+    }
+    if (!strcmp(key, "SAVE") && !arg){
+        pending.staged |= CMD_SAVE;     // at the sample boundary, the CPU stalls
+        return;
+    }
+    if (!strcmp(key, "CONFIG")){
+        char reply[CONFIG_MAX_LINE];
+        config_format(reply);
+        cmd_reply(reply);
+        return;
+    }
+    if (!strcmp(key, "BOOT")){
+        char reply[BOOT_MAX_LINE];
+        boot_format(reply);
+        cmd_reply(reply);
+        return;
+    }
+    if (!strcmp(key, "QUAL") && !arg){
+        char reply[QUALITY_MAX_LINE];
+        quality_format(reply);
+        cmd_reply(reply);
+        return;
+    }
+    if (!strcmp(key, "POWER") && !arg){
+        char reply[POWER_MAX_LINE];
+        power_format(reply);
+        cmd_reply(reply);
+        return;
+    }
+    if (!strcmp(key, "GRID") && !arg){
+        char reply[RESAMPLE_MAX_LINE];
+        resample_format(reply);
+        cmd_reply(reply);
+        return;
+    }
+    if (!arg){
+        cmd_reply("ERR missing value\n");
+        return;
+    }
+
+    if ((!strcmp(key, "CC") && value <= 65535) || (!strcmp(key, "TMRC") && value <= 0xFF)
+        || (!strcmp(key, "CMM") && value <= 0xFF)){
+        rm3100_config c;
+
+        RM3100_getStagedConfig(&c);
+        if (!strcmp(key, "CC"))
+            c.cycle_count = value;
+        else if (!strcmp(key, "TMRC"))
+            c.tmrc = value;
+        else
+            c.cmm = value;
+        if (RM3100_stageConfig(&c))
+            cmd_reply("ERR bad sensor configuration\n");
+        else
+            pending.staged |= CMD_SENSOR;
+    }
+    else if (!strcmp(key, "FMT") && value < FMT_COUNT){
+        pending.format = value;
+        pending.staged |= CMD_FMT;
+    }
+    else if (!strcmp(key, "AVG") && value >= 1 && value <= PIPE_MAX_AVERAGE){
+        pending.average = value;
+        pending.staged |= CMD_AVG;
+    }
+    else if (!strcmp(key, "GRID") && value <= RESAMPLE_MAX_RATE){
+        pending.grid = value;
+        pending.staged |= CMD_GRID;
+    }
+    else if (!strcmp(key, "STAT")){
+        if (stats_set_period(value))
+            cmd_reply("ERR bad period\n");
+        else
+            cmd_reply("OK STAT\n");
+    }
+    else if (!strcmp(key, "NOISE")){
+        stats_set_target(value);
+        cmd_reply("OK NOISE\n");
+    }
+    else if (!strcmp(key, "FFT")){
+        if (value > 0xFFFF || fft_set_size(value))
+            cmd_reply("ERR bad block size\n");
+        else{
+            fft_set_report(value != 0);
+            cmd_reply("OK FFT\n");
+        }
+    }
+    else if (!strcmp(key, "NOTCH")){
+        if (value > 0xFFFF || notch_set_mains(value))
+            cmd_reply("ERR bad mains frequency\n");
+        else{
+            if (value && !fft_get_size()){
+                fft_set_size(FFT_SIZE_MAX);     // silent spectrum for the tracking
+                fft_set_report(FALSE);
+            }
+            cmd_reply("OK NOTCH\n");
+        }
+    }
+    else if (!strcmp(key, "RADIO") && value <= 1){
+        char buf[RADIO_MAX_LINE + 3] = "OK ";
+
+        radio_link_enable(value);
+        radio_format(&buf[3]);
+        cmd_reply(buf);
+    }
+    else if (!strcmp(key, "AHRS") && value <= 65535){
+        char buf[AHRS_MAX_LINE + 3] = "OK ";
+
+        if (!mpu_present())
+            cmd_reply("ERR no IMU\n");
+        else{
+            ahrs_set_report(value);
+            ahrs_format(&buf[3]);
+            cmd_reply(buf);
+        }
+    }
+    else if (!strcmp(key, "PPS") && value <= PPS_TRIGGER){
+        char buf[PPS_MAX_LINE + 3] = "OK ";
+
+        pps_set_mode(value);
+        pps_format(&buf[3]);
+        cmd_reply(buf);
+    }
+    else if ((!strcmp(key, "HAMPEL") && value <= 1) || !strcmp(key, "SLEW") || !strcmp(key, "NORM")){
+        char buf[QUALITY_MAX_LINE + 3] = "OK ";
+        char *v = !strcmp(key, "NORM") ? strtok(NULL, " \t") : NULL;
+        unsigned long tol = v ? strtoul(v, &end, 0) : 0;
+        BOOL bad = v && *end;
+
+        if (!strcmp(key, "HAMPEL"))
+            quality_set_hampel(value);
+        else if (!strcmp(key, "SLEW"))
+            bad = bad || quality_set_slew(value);
+        else
+            bad = bad || quality_set_norm(value, tol);
+        if (bad)
+            cmd_reply("ERR bad value\n");
+        else{
+            quality_format(&buf[3]);
+            cmd_reply(buf);
+        }
+    }
+    else if (!strcmp(key, "POWER") && value <= POWER_RUN){
+        char buf[POWER_MAX_LINE + 3] = "OK ";
+
+        power_set_mode(value);
+        power_format(&buf[3]);
+        cmd_reply(buf);
+    }
+    else if (!strcmp(key, "CAL") && value < 12){
+        float offsets[3], matrix[3][3];
+        char *v = strtok(NULL, " \t");
+        long  x = v ? strtol(v, &end, 0) : 0;
+
+        if (!v || *end)
+            cmd_reply("ERR bad number\n");
+        else{
+            pipeline_get_calibration(offsets, matrix);
+            if (value < 3)
+                offsets[value] = x / 1000.0f;
+            else
+                matrix[(value - 3) / 3][(value - 3) % 3] = x / 1000000.0f;
+            pipeline_set_calibration(offsets, matrix);
+            cmd_reply("OK CAL\n");
+        }
+    }
+    else if (!strcmp(key, "CAP")){
+        if (capture_start(value))
+            cmd_reply("ERR capture busy\n");
+        else
+            cmd_reply("OK CAP\n");
+    }
+    else
+        cmd_reply("ERR unknown command or value\n");
+}
+
+/**
+ *  @brief  Command task: assembles lines from the receive ring and parses them.
+ *  @param[in]  events - EV_UART_RX
+ *  @return     none
+ */
+void cmd_task ( UINT32 events ) {
+
+    BYTE c;
+
+    while (UARTReadByte(&c)){
+        if (c == '\r' || c == '\n'){
+            if (line_len){
+                line[line_len] = 0;
+                cmd_parse(line);
+                line_len = 0;
+            }
+        }
+        else if (line_len < CMD_LINE_SIZE-1)
+            line[line_len++] = c;
+        else
+            line_len = 0;       // too long, drop it
+    }
+}
+
+/**
+ *  @brief  Applies the staged changes. Call only between samples.
+ *  The sensor configuration is written in one go (RM3100_commitConfig):
+ *  CMM is stopped around cycle count and rate changes and restarted with
+ *  the new settings, and the samples after it carry a new epoch.
+ *  @param[in]  none
+ *  @return     0 if nothing was staged or all applied, 1 if something failed.
+ */
+BOOL cmd_apply ( void ) {
+
+    BOOL err = FALSE;
+
+    if (!pending.staged)
+        return FALSE;
+
+    if (pending.staged & CMD_SENSOR)
+        err |= RM3100_commitConfig ();
+    if (pending.staged & CMD_FMT)
+        err |= pipeline_set_format (pending.format);
+    if (pending.staged & CMD_AVG)
+        err |= pipeline_set_average (pending.average);
+    if (pending.staged & CMD_GRID)
+        err |= resample_set_rate (pending.grid);
+
+    if (pending.staged != CMD_SAVE)
+        cmd_report(err ? "ERR" : "OK");
+    if (pending.staged & CMD_SAVE){
+        char reply[CONFIG_MAX_LINE + 4];
+        BOOL failed = config_save();
+
+        strcpy(reply, failed ? "ERR " : "OK ");
+        config_format(reply + strlen(reply));
+        cmd_reply(reply);
+        err |= failed;
+    }
+    pending.staged = 0;
+
+    return err;
+}
@@ -0,0 +1,74 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  uart
+ *  @{
+ *      @file       cmd.h
+ *      @brief      UART command channel for runtime reconfiguration.
+ *      @details    One command per line, keyword and an optional number
+ *                  (decimal or 0x hex):
+ *                  command   | effect
+ *                  --------- | ------------------------------------------
+ *                  CC n      | setCycleCount(n)
+ *                  TMRC n    | setCMMdatarate(n), n = CMM_UPDATERATE_*
+ *                  CMM n     | continuousModeConfig(n), CM_START runs CMM
+ *                  FMT n     | output format, FMT_*
+ *                  AVG n     | samples averaged per output (1 = off)
+ *                  GRID n    | output resampled on a uniform grid of n Hz (0 = off, samples as measured)
+ *                  STAT n    | statistics summary every n samples (FMT 3), restarts them
+ *                  NOISE n   | noise target in nT for the summary cycle count suggestion
+ *                  FFT n     | spectrum lines every block of n samples (32, 128, 512, 0 = off)
+ *                  NOTCH n   | mains notch filter at n Hz (45..65, 0 = off), tracked by the spectrum
+ *                  RADIO n   | radio uplink on (1) / off (0), answers with the link statistics
+ *                  AHRS n    | quaternion line every n IMU updates (0 = off), answers with the update time
+ *                  PPS n     | PPS input off (0), disciplining the time stamps (1) or triggering samples (2)
+ *                  CAP n     | burst capture of n samples to flash (0 = full region)
+ *                  BUS       | shared I2C bus utilisation and deadline misses, restarts the counters
+ *                  GRID      | resampler counters and latency
+ *                  HAMPEL n  | outliers replaced by the median of the readings before (1) or only flagged (0)
+ *                  SLEW n    | largest field change in uT/s, faster is flagged as a jump (0 = no check)
+ *                  NORM n [t]| calibrated field magnitude in nT expected within t nT (default 10 %), 0 = no check
+ *                  QUAL      | sample quality counters: saturated, stuck, jumps, norm, replaced
+ *                  POWER n   | CPU idle between events (0), also peripheral bus clock divided by the rate (1), no idle (2)
+ *                  POWER     | idle policy, duty cycle, wake up latency and estimated current of the last second
+ *                  CAL i v   | calibration element i: offsets 0..2 in nT, matrix 3..11 by rows in millionths
+ *                  SAVE      | store the settings and calibration in flash, restored at boot
+ *                  CONFIG    | flash store state
+ *                  BOOT      | reset cause and boot milestones up to the first sample
+ *                  DUMP      | send the last capture as binary frames
+ *                  GET       | report current settings
+ *                  Changes are staged and applied together between two
+ *                  samples. CC, TMRC and CMM build one sensor configuration,
+ *                  checked as a whole when staged (ERR if CMM would run
+ *                  faster than the cycle count allows) and written in one
+ *                  go; the samples after it carry a new epoch (EPOCH in GET)
+ *                  and are scaled with the new gain. Each line is answered
+ *                  with "OK ..." and the applied values, or "ERR ...".
+ */
+#ifndef CMD_H
+#define	CMD_H
+
+#include "platform.h"
+
+#define CMD_LINE_SIZE   (32)
+
+/// Staged fields
+#define CMD_SENSOR      0x01    /** CC, TMRC, CMM: staged in the driver, RM3100_stageConfig */
+#define CMD_FMT         0x02
+#define CMD_AVG         0x04
+#define CMD_GRID        0x08
+#define CMD_SAVE        0x10
+
+/** @details Changes waiting for the next sample boundary. */
+typedef struct {
+    BYTE   staged;      /// CMD_* fields set
+    BYTE   format;
+    BYTE   average;
+    UINT16 grid;
+}cmd_config;
+
+void cmd_task  ( UINT32 events );
+BOOL cmd_apply ( void );
+
+#endif	/* CMD_H */
@@ -0,0 +1,263 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  uart
+ *  @{
+ *      @file       compress.c
+ *      @brief      Delta + varint compression of the raw sample stream.
+ *      @details    Integer only, constant work per sample. The decoder builds
+ *                  on the host as well (host tools link this file).
+ */
+#include "compress.h"
+#include "pipeline.h"
+
+/** Maps signed to unsigned so small magnitudes give small codes */
+static UINT32 zigzag ( INT32 v ) { return ((UINT32) v << 1) ^ (UINT32)(v >> 31); }
+
+static INT32 unzigzag ( UINT32 v ) { return (INT32)(v >> 1) ^ -(INT32)(v & 1); }
+
+/** Writes a varint, returns its length */
+static BYTE put_varint ( BYTE *out, UINT32 v ) {
+
+    BYTE n = 0;
+
+    while (v >= 0x80){
+        out[n++] = (v & 0x7F) | 0x80;
+        v >>= 7;
+    }
+    out[n++] = v;
+    return n;
+}
+
+/** Reads a varint checked by zs_decode, returns its length */
+static BYTE get_varint ( const BYTE *in, UINT32 *v ) {
+
+    BYTE n = 0, shift = 0;
+
+    *v = 0;
+    do {
+        *v |= (UINT32)(in[n] & 0x7F) << shift;
+        shift += 7;
+    } while ((in[n++] & 0x80) && n < ZS_MAX_VARINT);
+    return n;
+}
+
+static long get24 ( const BYTE *p ) {
+
+    return ((INT32)((UINT32) p[0] << 24 | (UINT32) p[1] << 16 | (UINT32) p[2] << 8)) >> 8;
+}
+
+/**
+ *  @brief  Resets the encoder, the next sample is a keyframe.
+ *  @param[in]  z        - encoder
+ *  @param[in]  interval - samples per block (1 = keyframes only)
+ *  @return     none
+ */
+void zs_init ( zstream *z, BYTE interval ) {
+
+    memset(z, 0, sizeof(zstream));
+    z->interval = interval ? interval : 1;
+}
+
+/**
+ *  @brief  Encodes one sample. A sample of another sensor configuration
+ *  ends the block and starts a new one with a keyframe.
+ *  @param[in]  z    - encoder
+ *  @param[out] out  - at least ZS_MAX_OUTPUT bytes
+ *  @param[in]  t_us - sample time
+ *  @param[in]  raw  - counts, flags and epoch
+ *  @param[in]  cycle_count - of the epoch
+ *  @return     bytes written
+ */
+BYTE zs_encode ( zstream *z, BYTE *out, UINT32 t_us, const sensor_xyz *raw, UINT16 cycle_count ) {
+
+    BYTE n = 0, *k;
+    INT32 dt = t_us - z->t_us;
+
+    if (z->left && (raw->epoch != z->epoch || cycle_count != z->cycle_count)){
+        memset(out, 0, ZS_END_SIZE);            // end record
+        out[0]  = 0x01;
+        n       = ZS_END_SIZE;
+        z->left = 0;
+    }
+    if (z->left == 0){                          // keyframe, no prediction carried over
+        k = &out[n];
+        k[0]  = ZS_SYNC0;
+        k[1]  = ZS_SYNC1;
+        k[2]  = z->seq;
+        k[3]  = z->seq >> 8;
+        k[4]  = t_us;
+        k[5]  = t_us >> 8;
+        k[6]  = t_us >> 16;
+        k[7]  = t_us >> 24;
+        k[8]  = raw->x >> 16;
+        k[9]  = raw->x >> 8;
+        k[10] = raw->x;
+        k[11] = raw->y >> 16;
+        k[12] = raw->y >> 8;
+        k[13] = raw->y;
+        k[14] = raw->z >> 16;
+        k[15] = raw->z >> 8;
+        k[16] = raw->z;
+        k[17] = raw->flags;
+        k[18] = z->interval;
+        k[19] = raw->epoch;
+        k[20] = cycle_count;
+        k[21] = cycle_count >> 8;
+        k[22] = pipeline_crc8(&k[2], ZS_KEY_SIZE-3);
+        n += ZS_KEY_SIZE;
+        z->left        = z->interval - 1;
+        z->epoch       = raw->epoch;
+        z->cycle_count = cycle_count;
+        dt = 0;
+    }
+    else{
+        n  = put_varint(out, zigzag(dt - z->dt) << 1 | (raw->flags != 0));
+        n += put_varint(out+n, zigzag(raw->x - z->x));
+        n += put_varint(out+n, zigzag(raw->y - z->y));
+        n += put_varint(out+n, zigzag(raw->z - z->z));
+        if (raw->flags)
+            out[n++] = raw->flags;
+        z->left--;
+    }
+
+    z->dt   = dt;
+    z->t_us = t_us;
+    z->x    = raw->x;
+    z->y    = raw->y;
+    z->z    = raw->z;
+    z->seq++;
+
+    return n;
+}
+
+/**
+ *  @brief  Resets a decoder, it waits for the next keyframe.
+ */
+void zs_decoder_init ( zs_decoder *d ) {
+
+    memset(d, 0, sizeof(zs_decoder));
+}
+
+/** Drops the current block and hunts for a keyframe */
+static void zs_resync ( zs_decoder *d ) {
+
+    d->synced  = FALSE;
+    d->len     = 0;
+    d->varints = 0;
+    d->vbytes  = 0;
+    d->resyncs++;
+}
+
+/**
+ *  @brief  Feeds one byte of the stream.
+ *  @param[in]  d    - decoder
+ *  @param[in]  byte - next stream byte
+ *  @param[out] out  - decoded sample
+ *  @return     TRUE when out holds a new sample.
+ */
+BOOL zs_decode ( zs_decoder *d, BYTE byte, zs_sample *out ) {
+
+    UINT32 head, v[3];
+    UINT16 cc;
+    BYTE n, i;
+    INT32 dt;
+
+    if (!d->synced || d->st.left == 0){                     // keyframe
+        if ((d->len == 0 && byte != ZS_SYNC0) || (d->len == 1 && byte != ZS_SYNC1)){
+            if (d->synced)
+                zs_resync(d);
+            d->len = 0;
+            return FALSE;
+        }
+        d->buf[d->len++] = byte;
+        if (d->len < ZS_KEY_SIZE)
+            return FALSE;
+
+        d->len = 0;
+        cc     = d->buf[20] | (UINT16) d->buf[21] << 8;
+        if (pipeline_crc8(&d->buf[2], ZS_KEY_SIZE-3) != d->buf[ZS_KEY_SIZE-1] || !d->buf[18]
+            || cc < CC_MIN || cc > CC_MAX){
+            if (d->synced)
+                zs_resync(d);
+            return FALSE;
+        }
+        d->st.seq      = d->buf[2] | (UINT16) d->buf[3] << 8;
+        out->t_us      = d->buf[4] | (UINT32) d->buf[5] << 8 | (UINT32) d->buf[6] << 16 | (UINT32) d->buf[7] << 24;
+        out->raw.x     = get24(&d->buf[8]);
+        out->raw.y     = get24(&d->buf[11]);
+        out->raw.z     = get24(&d->buf[14]);
+        out->raw.flags = d->buf[17];
+        d->st.interval = d->buf[18];
+        d->st.epoch    = d->buf[19];
+        d->st.cycle_count = cc;
+        d->st.left     = d->st.interval - 1;
+        d->st.dt       = 0;
+        d->synced      = TRUE;
+        d->keyframes++;
+    }
+    else{                                                   // delta record
+        if (d->len >= ZS_MAX_DELTA){
+            d->errors++;
+            zs_resync(d);
+            return FALSE;
+        }
+        d->buf[d->len++] = byte;
+        if (d->varints < 4){
+            if (++d->vbytes == ZS_MAX_VARINT && byte > 0x0F){
+                d->errors++;                                // more than 32 bits
+                zs_resync(d);
+                return FALSE;
+            }
+            if (byte & 0x80)
+                return FALSE;
+            d->vbytes = 0;
+            d->varints++;
+            if (d->varints < 4)
+                return FALSE;
+            get_varint(d->buf, &head);
+            if (head & 1)
+                return FALSE;                               // flags byte follows
+        }
+
+        n = get_varint(d->buf, &head);
+        for (i = 0; i < 3; i++)
+            n += get_varint(d->buf + n, &v[i]);
+        if ((head & 1) && !d->buf[n]){                      // end record, a keyframe follows
+            if (head != 1 || v[0] || v[1] || v[2]){
+                d->errors++;
+                zs_resync(d);
+                return FALSE;
+            }
+            d->st.left = 0;
+            d->len     = 0;
+            d->varints = 0;
+            return FALSE;
+        }
+
+        dt             = d->st.dt + unzigzag(head >> 1);
+        out->t_us      = d->st.t_us + dt;
+        out->raw.x     = d->st.x + unzigzag(v[0]);
+        out->raw.y     = d->st.y + unzigzag(v[1]);
+        out->raw.z     = d->st.z + unzigzag(v[2]);
+        out->raw.flags = (head & 1) ? d->buf[n] : 0;
+        d->st.dt       = dt;
+        d->st.seq++;
+        d->st.left--;
+        d->len         = 0;
+        d->varints     = 0;
+        d->vbytes      = 0;
+    }
+
+    d->st.t_us = out->t_us;
+    d->st.x    = out->raw.x;
+    d->st.y    = out->raw.y;
+    d->st.z    = out->raw.z;
+    out->raw.epoch   = d->st.epoch;
+    out->cycle_count = d->st.cycle_count;
+    out->seq   = d->st.seq;
+    d->samples++;
+
+    return TRUE;
+}
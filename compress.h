@@ -0,0 +1,93 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  uart
+ *  @{
+ *      @file       compress.h
+ *      @brief      Delta + varint compression of the raw sample stream.
+ *      @details    The stream is made of blocks. A block starts with a keyframe
+ *                  holding the full sample, followed by interval-1 delta
+ *                  records.
+ *
+ *                  Keyframe (ZS_KEY_SIZE bytes): sync ZS_SYNC0 ZS_SYNC1,
+ *                  seq u16 LE, t_us u32 LE, x,y,z 24 bits big endian, flags,
+ *                  interval, epoch, cycle count u16 LE, crc8 over
+ *                  seq..cycle count. The epoch and cycle count are those of
+ *                  the sensor configuration of the block (rm3100.h), so the
+ *                  counts can be scaled with CC_GAIN(cycle count).
+ *
+ *                  Delta record: varint(zigzag(ddt) << 1 | has_flags),
+ *                  varint(zigzag(dx)), varint(zigzag(dy)), varint(zigzag(dz))
+ *                  and a flags byte if has_flags. ddt is the change of the
+ *                  sample interval in us, so a steady rate costs one byte.
+ *                  Varints are 7 bits per byte, low bits first.
+ *
+ *                  End record (ZS_END_SIZE bytes): a delta record of zeros
+ *                  with has_flags and a 0 flags byte, which no sample
+ *                  encodes to. The block ends there and a keyframe follows;
+ *                  the encoder ends a block this way when the epoch of the
+ *                  sample differs from the block's.
+ *
+ *                  Delta records carry no check. A lost or corrupted byte can
+ *                  spoil the rest of its block; the decoder notices when the
+ *                  next keyframe is not where expected and hunts for one by
+ *                  its sync bytes and crc, so errors never outlive a block.
+ *                  A varint longer than ZS_MAX_VARINT bytes or a delta
+ *                  record longer than ZS_MAX_DELTA is malformed: the decoder counts
+ *                  an error and hunts for the next keyframe the same way.
+ */
+#ifndef COMPRESS_H
+#define	COMPRESS_H
+
+#include "platform.h"
+#include "rm3100.h"
+
+#define ZS_SYNC0            0xA5
+#define ZS_SYNC1            0x5B
+#define ZS_KEY_SIZE         (23)
+#define ZS_END_SIZE         (5)
+#define ZS_MAX_RECORD       (ZS_KEY_SIZE)       /**< Longest record */
+#define ZS_MAX_DELTA        (20)                /**< Longest delta record accepted, the encoder's are 18 at most */
+#define ZS_MAX_OUTPUT       (ZS_END_SIZE + ZS_KEY_SIZE) /**< Longest zs_encode output */
+#define ZS_MAX_VARINT       (5)                 /**< 32 bits, 4 in the last byte */
+#define ZS_INTERVAL         (32)                /**< Default samples per block */
+
+/** @details Encoder / decoder prediction state. */
+typedef struct {
+    long   x, y, z;
+    UINT32 t_us;
+    INT32  dt;          /// last sample interval, us
+    UINT16 seq;
+    BYTE   interval;    /// samples per block
+    BYTE   left;        /// delta records left in the block
+    BYTE   epoch;       /// sensor configuration of the block
+    UINT16 cycle_count;
+}zstream;
+
+/** @details Decoded sample. */
+typedef struct {
+    sensor_xyz raw;     /// raw.epoch of the keyframe
+    UINT32     t_us;
+    UINT16     seq;
+    UINT16     cycle_count;
+}zs_sample;
+
+/** @details Byte at a time decoder. */
+typedef struct {
+    zstream st;
+    BYTE    synced;
+    BYTE    buf[ZS_MAX_RECORD];
+    BYTE    len;
+    BYTE    varints;    /// complete varints in buf
+    BYTE    vbytes;     /// bytes of the varint being read
+    UINT32  keyframes, samples, resyncs;
+    UINT32  errors;     /// malformed delta records
+}zs_decoder;
+
+void zs_init       ( zstream *z, BYTE interval );
+BYTE zs_encode     ( zstream *z, BYTE *out, UINT32 t_us, const sensor_xyz *raw, UINT16 cycle_count );
+void zs_decoder_init ( zs_decoder *d );
+BOOL zs_decode     ( zs_decoder *d, BYTE byte, zs_sample *out );
+
+#endif	/* COMPRESS_H */
@@ -0,0 +1,248 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  nvm
+ *  @{
+ *      @file       config.c
+ *      @brief      Settings and calibration kept in program flash across resets.
+ *      @details    A save programs the record word by word, the magic word
+ *                  last, and reads it back. The boot scan only checks the
+ *                  magic, version and size of each slot; the CRC is worked
+ *                  out for the newest candidate only, and for older ones if
+ *                  it fails.
+ */
+#include <stdio.h>
+#include "config.h"
+#include "rm3100.h"
+#include "pipeline.h"
+#include "resample.h"
+#include "notch.h"
+#include "fft.h"
+#include "stats.h"
+#include "power.h"
+
+#define WORDS       (sizeof(config_record) / 4)
+
+/* Reserved flash */
+static NVM_REGION(config_flash, CONFIG_PAGES * NVM_PAGE_SIZE);
+
+static INT16  cur_slot    = -1;     // latest good record, -1 = none
+static UINT32 cur_seq     = 0;
+static UINT32 write_ticks = 0;      // last save
+static config_boot boot;
+
+/** CRC-32 (reflected, poly 0xEDB88320) */
+static UINT32 config_crc ( const BYTE *data, UINT32 length ) {
+
+    UINT32 crc = 0xFFFFFFFF;
+    BYTE i;
+
+    while (length--){
+        crc ^= *data++;
+        for (i = 0; i < 8; i++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+    }
+    return ~crc;
+}
+
+/** CRC of a record, from version to crc */
+static UINT32 config_record_crc ( const config_record *r ) {
+
+    return config_crc((const BYTE *) &r->version, (const BYTE *) &r->crc - (const BYTE *) &r->version);
+}
+
+static const config_record * config_slot ( UINT16 slot ) {
+
+    return (const config_record *) (config_flash + (UINT32) slot * CONFIG_SLOT_SIZE);
+}
+
+/** TRUE if the slot is erased */
+static BOOL config_blank ( UINT16 slot ) {
+
+    const UINT32 *w = (const UINT32 *) config_slot(slot);
+    UINT16 i;
+
+    for (i = 0; i < CONFIG_SLOT_SIZE / 4; i++)
+        if (w[i] != 0xFFFFFFFF)
+            return FALSE;
+    return TRUE;
+}
+
+/**
+ *  @brief  Fills a record with the settings in use.
+ *  @param[out] r - record, magic and crc included
+ *  @return     none
+ */
+void config_capture ( config_record *r ) {
+
+    memset(r, 0, sizeof(*r));
+    r->magic       = CONFIG_MAGIC;
+    r->version     = CONFIG_VERSION;
+    r->size        = sizeof(config_record);
+    r->seq         = cur_seq + 1;
+    r->cycle_count = getRM3100CycleCount();
+    r->tmrc        = getRM3100DataRateCode();
+    r->cmm         = getRM3100CMMConfig();
+    r->format      = pipeline_get_format();
+    r->average     = pipeline_get_average();
+    r->grid_hz     = resample_get_rate();
+    r->mains_hz    = notch_get_nominal();
+    r->stat_period = stats_get_period();
+    r->power       = power_get_mode();
+    pipeline_get_calibration(r->offsets, r->matrix);
+    r->crc         = config_record_crc(r);
+}
+
+/**
+ *  @brief  Applies a record: the sensor registers first, in one go, then
+ *  the processing settings. Call between samples.
+ *  @param[in]  r - record
+ *  @return     0 if successful, 1 if something failed (the rest is applied).
+ */
+BOOL config_apply ( const config_record *r ) {
+
+    rm3100_config c = { r->cycle_count, r->tmrc, r->cmm };
+    BOOL err;
+
+    err  = RM3100_stageConfig(&c) || RM3100_commitConfig();
+    err |= pipeline_set_format(r->format);
+    err |= pipeline_set_average(r->average);
+    err |= resample_set_rate(r->grid_hz);
+    err |= stats_set_period(r->stat_period);
+    err |= notch_set_mains(r->mains_hz);
+    err |= power_set_mode(r->power);
+    if (r->mains_hz && !fft_get_size()){
+        fft_set_size(FFT_SIZE_MAX);     // silent spectrum for the tracking
+        fft_set_report(FALSE);
+    }
+    pipeline_set_calibration(r->offsets, r->matrix);
+    return err;
+}
+
+/**
+ *  @brief  Finds the latest good record in flash.
+ *  @param[out] r - copy of the record
+ *  @return     0 if found, 1 if there is none.
+ */
+BOOL config_load ( config_record *r ) {
+
+    const config_record *c;
+    UINT32 bound = 0xFFFFFFFF, best_seq;
+    INT16  best;
+    UINT16 i;
+
+    for (;;){
+        best = -1;
+        best_seq = 0;
+        for (i = 0; i < CONFIG_SLOTS; i++){
+            c = config_slot(i);
+            if (c->magic == CONFIG_MAGIC && c->version == CONFIG_VERSION && c->size == sizeof(config_record)
+                && c->seq < bound && (best < 0 || c->seq > best_seq)){
+                best     = i;
+                best_seq = c->seq;
+            }
+        }
+        if (best < 0)
+            return TRUE;
+        c = config_slot(best);
+        if (c->crc == config_record_crc(c)){
+            *r       = *c;
+            cur_slot = best;
+            cur_seq  = best_seq;
+            return FALSE;
+        }
+        bound = best_seq;               // torn or corrupted, try the one before
+    }
+}
+
+/**
+ *  @brief  Saves the settings in use in the next slot of the ring, erasing
+ *  its page first if the ring comes back to it. Slots that are not blank
+ *  (torn saves) are skipped.
+ *  @param[in]  none
+ *  @return     0 if saved and read back correctly, 1 otherwise.
+ */
+BOOL config_save ( void ) {
+
+    config_record r;
+    const UINT32 *src = (const UINT32 *) &r;
+    const UINT32 *dst;
+    UINT32 start = ReadCoreTimer();
+    UINT16 slot = cur_slot < 0 ? 0 : (cur_slot + 1) % CONFIG_SLOTS, tries, i;
+    BOOL err;
+
+    config_capture(&r);
+    for (tries = 0; tries < CONFIG_SLOTS; tries++, slot = (slot + 1) % CONFIG_SLOTS){
+        if (!config_blank(slot)){
+            if (slot % CONFIG_SLOTS_PER_PAGE)
+                continue;
+            if (nvm_erase_page(config_flash + (UINT32) slot * CONFIG_SLOT_SIZE))
+                continue;
+        }
+        dst = (const UINT32 *) config_slot(slot);
+        err = FALSE;
+        for (i = 1; i < WORDS; i++)
+            err |= nvm_write_word(&dst[i], src[i]);
+        err |= nvm_write_word(&dst[0], src[0]);
+        if (!err && !memcmp(dst, src, sizeof(r))){
+            cur_slot    = slot;
+            cur_seq     = r.seq;
+            write_ticks = ReadCoreTimer() - start;
+            return FALSE;
+        }
+    }
+    write_ticks = ReadCoreTimer() - start;
+    return TRUE;
+}
+
+/**
+ *  @brief  Boot: applies the latest good record, if any.
+ *  @param[in]  none
+ *  @return     0 if restored, 1 if the defaults must be set up.
+ */
+BOOL config_restore ( void ) {
+
+    config_record r;
+    UINT32 start = ReadCoreTimer();
+
+    boot.restored = !config_load(&r) && !config_apply(&r);
+    boot.seq      = boot.restored ? r.seq : 0;
+    boot.slot     = boot.restored ? cur_slot : 0;
+    boot.load_ticks = ReadCoreTimer() - start;
+    return !boot.restored;
+}
+
+/**
+ *  @brief  Notes the first good sample after boot.
+ *  @param[in]  tick - core timer of the sample
+ *  @return     none
+ */
+void config_first_sample ( UINT32 tick ) {
+
+    if (!boot.first_sample)
+        boot.first_sample = tick ? tick : 1;
+}
+
+/**
+ *  @brief  request boot information
+ *  @param[in]  none
+ *  @return     pointer to it
+ */
+const config_boot * config_get_boot ( void ) { return &boot; }
+
+/**
+ *  @brief  Formats the store state: "CONFIG seq n slot s write_us w boot
+ *  restored|defaults load_us l first_sample_us f".
+ *  @param[out] out - CONFIG_MAX_LINE bytes
+ *  @return     line length
+ */
+UINT32 config_format ( char *out ) {
+
+    return sprintf(out, "CONFIG seq %lu slot %d write_us %lu boot %s load_us %lu first_sample_us %lu\n",
+                   (unsigned long) cur_seq, cur_slot,
+                   (unsigned long) (write_ticks / (ONE_SECOND / 1000000)),
+                   boot.restored ? "restored" : "defaults",
+                   (unsigned long) (boot.load_ticks / (ONE_SECOND / 1000000)),
+                   (unsigned long) (boot.first_sample / (ONE_SECOND / 1000000)));
+}
@@ -0,0 +1,83 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  nvm
+ *  @{
+ *      @file       config.h
+ *      @brief      Settings and calibration kept in program flash across resets.
+ *      @details    The SAVE command stores the settings in use (sensor cycle
+ *                  count, TMRC, CMM, output format, averaging, grid, mains
+ *                  notch, summary period, idle policy) and the calibration as one record;
+ *                  at boot the latest good record is read back and applied in
+ *                  one go, instead of the defaults.
+ *
+ *                  Records are CRC-32 protected and carry a layout version:
+ *                  a record of another version, or one torn by a reset
+ *                  during the save, is ignored. They are appended in
+ *                  CONFIG_SLOT_SIZE slots over CONFIG_PAGES flash pages used
+ *                  as a ring, each with a save count, and the highest valid
+ *                  count wins. A page is only erased when the ring comes
+ *                  back to it, so a page sees one erase every
+ *                  CONFIG_SLOTS_PER_PAGE saves and the previous record
+ *                  always survives an interrupted save.
+ *
+ *                  The CPU stalls while flash is written: a save costs
+ *                  about 1 ms, plus about 20 ms when it erases a page. It is
+ *                  therefore done at a sample boundary, like the other
+ *                  staged commands.
+ */
+#ifndef CONFIG_H
+#define	CONFIG_H
+
+#include "platform.h"
+#include "nvm.h"
+
+#define CONFIG_MAGIC            (0x52436667)    /**< "RCfg", programmed last */
+#define CONFIG_VERSION          (1)             /**< bump when config_record changes */
+#define CONFIG_PAGES            (2)
+#define CONFIG_SLOT_SIZE        (128)           /**< bytes, >= sizeof(config_record), multiple of 4 */
+#define CONFIG_SLOTS_PER_PAGE   (NVM_PAGE_SIZE / CONFIG_SLOT_SIZE)
+#define CONFIG_SLOTS            (CONFIG_PAGES * CONFIG_SLOTS_PER_PAGE)
+#define CONFIG_MAX_LINE         (120)
+
+/** @details Flash record, 32 bits words. */
+typedef struct {
+    UINT32 magic;           /// CONFIG_MAGIC
+    UINT16 version;         /// CONFIG_VERSION
+    UINT16 size;            /// sizeof(config_record)
+    UINT32 seq;             /// save count
+    UINT16 cycle_count;
+    BYTE   tmrc;
+    BYTE   cmm;
+    BYTE   format;          /// FMT_*
+    BYTE   average;
+    UINT16 grid_hz;         /// resampler, 0 = off
+    UINT16 mains_hz;        /// notch filter, 0 = off
+    BYTE   power;           /// POWER_*, 0 (POWER_IDLE) in records saved before it
+    BYTE   reserved;
+    UINT32 stat_period;     /// samples per summary
+    float  offsets[3];      /// hard iron, uT
+    float  matrix[3][3];    /// soft iron
+    UINT32 crc;             /// CRC-32 from version to here
+}config_record;
+
+/** @details What the boot did. */
+typedef struct {
+    BOOL   restored;        /// settings from flash, otherwise the defaults
+    UINT32 seq;             /// of the record restored
+    UINT16 slot;
+    UINT32 load_ticks;      /// reading and applying the record
+    UINT32 first_sample;    /// core timer at the first good sample, 0 = none yet
+}config_boot;
+
+void   config_capture      ( config_record *r );
+BOOL   config_apply        ( const config_record *r );
+BOOL   config_load         ( config_record *r );
+BOOL   config_save         ( void );
+BOOL   config_restore      ( void );
+void   config_first_sample ( UINT32 tick );
+const config_boot * config_get_boot ( void );
+UINT32 config_format       ( char *out );
+
+#endif	/* CONFIG_H */
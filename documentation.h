@@ -17,6 +17,24 @@
  * \defgroup main Main
  * \brief  Entry point and main control.
  *
+ * \defgroup sched Scheduler
+ * \brief  Cooperative event driven scheduler.
+ *
+ * ISRs (core timer tick, DRDY, I2C, UART) only post event flags; Timer1
+ * is left off, the core timer paces everything.
+ * Acquisition, processing, output and housekeeping are run-to-completion
+ * tasks with priorities; the CPU idles when nothing is pending, with
+ * the peripheral bus clock lowered at slow sample rates (power.h).
+ *
+ * \defgroup nvm Flash Storage
+ * \brief  Reserved program flash regions and burst capture.
+ *
+ * \defgroup host Host Tools
+ * \brief  Linux programs that receive the board output, in host/.
+ *
+ * They share the stream decoders and the sample types with the firmware
+ * and are built with the system compiler, see each program's header.
+ *
  * \defgroup RM3100 RM3100 Driver
  * \brief  Basic driver for RM3100
  *
@@ -42,6 +60,10 @@
  * stop bits          | 1
  * PIC UARTmodule     | UART1
  *
+ * Received bytes are stored by the UART1 ISR in a ring and parsed by the
+ * command task (see cmd.h) to reconfigure the sensor and the output at
+ * runtime.
+ *
  */
 
 /** \page license License
@@ -0,0 +1,494 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  main
+ *  @{
+ *      @file       fft.c
+ *      @brief      Block spectrum of the raw sample stream.
+ *      @details    Fixed point throughout. The block is scaled so the largest
+ *                  deviation from the mean is just below 2^14 (block floating
+ *                  point, exponent kept in shift) and every radix-4 stage
+ *                  divides by 4, so the Q15 data never overflows and the
+ *                  output is X * 2^shift / N.
+ *
+ *                  Twiddles and window come from one quarter wave sine table
+ *                  of the 512 points circle. The radix-4 butterflies are
+ *                  decimation in frequency with the multiplies skipped for
+ *                  the zero angle column; the output is put back in order by
+ *                  a base 4 digit reversal.
+ *
+ *                  Memory: 2 x 3 x FFT_SIZE_MAX INT16 for the collection
+ *                  buffers (deviations from the first sample of the block,
+ *                  saturated), FFT_SIZE_MAX INT16 of work and FFT_SIZE_MAX/2
+ *                  words of bin power.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "fft.h"
+#include "pipeline.h"
+#include "scheduler.h"
+#include "uart.h"
+
+/// Analysis steps
+#define STEP_PREPARE    0       /**< mean, window, scale one axis */
+#define STEP_STAGE      1       /**< one radix-4 stage */
+#define STEP_SPECTRUM   2       /**< reorder, split, bands and peaks */
+#define STEP_REPORT     3       /**< send the lines */
+
+/** sin(2 pi i / 512), i = 0..128, Q15 */
+static const INT16 sine_q15[129] = {
+         0,    402,    804,   1206,   1608,   2009,   2410,   2811,
+      3212,   3612,   4011,   4410,   4808,   5205,   5602,   5998,
+      6393,   6786,   7179,   7571,   7962,   8351,   8739,   9126,
+      9512,   9896,  10278,  10659,  11039,  11417,  11793,  12167,
+     12539,  12910,  13279,  13645,  14010,  14372,  14732,  15090,
+     15446,  15800,  16151,  16499,  16846,  17189,  17530,  17869,
+     18204,  18537,  18868,  19195,  19519,  19841,  20159,  20475,
+     20787,  21096,  21403,  21705,  22005,  22301,  22594,  22884,
+     23170,  23452,  23731,  24007,  24279,  24547,  24811,  25072,
+     25329,  25582,  25832,  26077,  26319,  26556,  26790,  27019,
+     27245,  27466,  27683,  27896,  28105,  28310,  28510,  28706,
+     28898,  29085,  29268,  29447,  29621,  29791,  29956,  30117,
+     30273,  30424,  30571,  30714,  30852,  30985,  31113,  31237,
+     31356,  31470,  31580,  31685,  31785,  31880,  31971,  32057,
+     32137,  32213,  32285,  32351,  32412,  32469,  32521,  32567,
+     32609,  32646,  32678,  32705,  32728,  32745,  32757,  32765,
+     32767,
+};
+
+static INT16  blk[2][3][FFT_SIZE_MAX];      // collection buffers
+static INT32  blk_ref[2][3];                // first sample of each block
+static UINT32 blk_fs[2];                    // sample rate, mHz
+static INT16  work[FFT_SIZE_MAX];           // N/2 complex, re / im interleaved
+static UINT32 power[FFT_SIZE_MAX/2];        // |X|^2 of the bins, scaled
+static fft_result result[3];
+
+static UINT16 size     = 0;                 // block size, 0 = off
+static UINT16 fill     = 0;                 // samples in the collecting buffer
+static BYTE   collect  = 0;                 // buffer being filled
+static BYTE   busy     = FALSE;             // other buffer under analysis
+static UINT32 overruns = 0;                 // blocks dropped, analysis too slow
+static UINT32 blocks   = 0;
+static BOOL   report   = TRUE;              // send the lines
+
+/* analysis state */
+static UINT16 wsize;                        // N of the block under analysis
+static BYTE   stages;                       // log4(N/2)
+static BYTE   step, stage, axis;
+static INT8   shift;
+static UINT32 ticks, last_ticks;
+
+/** sin(2 pi i / 512), Q15 */
+static INT32 sin512 ( UINT32 i ) {
+
+    i &= 511;
+    if (i <= 128)
+        return sine_q15[i];
+    if (i <= 256)
+        return sine_q15[256 - i];
+    if (i <= 384)
+        return -sine_q15[i - 256];
+    return -sine_q15[512 - i];
+}
+
+/** cos(2 pi i / 512), Q15 */
+static INT32 cos512 ( UINT32 i ) { return sin512(i + 128); }
+
+/** Integer square root, floor */
+static UINT32 isqrt64 ( UINT64 v ) {
+
+    UINT64 r = 0, bit = (UINT64) 1 << 62;
+
+    while (bit > v)
+        bit >>= 2;
+    while (bit){
+        if (v >= r + bit){
+            v -= r + bit;
+            r  = (r >> 1) + bit;
+        }
+        else
+            r >>= 1;
+        bit >>= 2;
+    }
+    return (UINT32) r;
+}
+
+/**
+ *  @brief  Sets the block size and restarts the collection.
+ *  @param[in]  n - 0 (off), 32, 128 or 512
+ *  @return     0 if successful, 1 otherwise.
+ */
+BOOL fft_set_size ( UINT16 n ) {
+
+    if (n != 0 && n != 32 && n != 128 && n != 512)
+        return TRUE;
+
+    size = n;
+    fill = 0;
+    return FALSE;
+}
+
+/**
+ *  @brief  Turns the spectrum lines on or off, the analysis keeps running
+ *  for fft_get() users.
+ *  @param[in]  on - TRUE to send the lines
+ *  @return     none
+ */
+void fft_set_report ( BOOL on ) { report = on; }
+
+/**
+ *  @brief  request block size
+ *  @param[in]  none
+ *  @return     samples, 0 if the analysis is off
+ */
+UINT16 fft_get_size ( void ) { return size; }
+
+/**
+ *  @brief  Adds a raw sample to the block. A bus error restarts the
+ *  block, a gap would smear the spectrum. Samples that are not paced
+ *  (pipeline_get_rate() 0) have no spectrum.
+ *  @param[in]  raw - counts
+ *  @return     none
+ */
+void fft_update ( const sensor_xyz *raw ) {
+
+    const INT32 v[3] = { raw->x, raw->y, raw->z };
+    INT32 d;
+    BYTE i;
+
+    if (!size)
+        return;
+    if ((raw->flags & SAMPLE_I2C_ERROR) || pipeline_get_rate() <= 0){
+        fill = 0;
+        return;
+    }
+
+    for (i = 0; i < 3; i++){
+        if (fill == 0)
+            blk_ref[collect][i] = v[i];
+        d = v[i] - blk_ref[collect][i];
+        if (d > 32767)
+            d = 32767;
+        if (d < -32768)
+            d = -32768;
+        blk[collect][i][fill] = d;
+    }
+    if (++fill < size)
+        return;
+
+    fill = 0;
+    if (busy){
+        overruns++;                     // keep collecting in the same buffer
+        return;
+    }
+    blk_fs[collect] = (UINT32) (pipeline_get_rate() * 1000 + 0.5f);
+    wsize   = size;
+    stages  = size == 32 ? 2 : size == 128 ? 3 : 4;
+    step    = STEP_PREPARE;
+    axis    = 0;
+    ticks   = 0;
+    busy    = TRUE;
+    collect ^= 1;
+    sched_post(EV_FFT);
+}
+
+/** Removes the mean, applies the Hann window and scales to Q15 */
+static void fft_prepare ( const INT16 *x ) {
+
+    UINT16 n = wsize, i;
+    UINT32 k = 512 / n;
+    INT32 sum = 0, mean, d, max = 0, w;
+    INT8 s = 13;
+
+    for (i = 0; i < n; i++)
+        sum += x[i];
+    mean = sum / n;
+    for (i = 0; i < n; i++){
+        d = x[i] - mean;
+        if (d < 0)
+            d = -d;
+        if (d > max)
+            max = d;
+    }
+    /* max < 2^16, so s ends between -2 and 13 */
+    while ((s >= 0 ? max << s : max >> -s) >= (1 << 14))
+        s--;
+    shift = s;
+
+    /* (d * w) is below 2^31, w is the Hann window in Q15 */
+    for (i = 0; i < n; i++){
+        w = (32767 - cos512(i * k)) >> 1;
+        work[i] = (INT16) (((x[i] - mean) * w) >> (15 - s));
+    }
+}
+
+/** One radix-4 decimation in frequency stage, outputs divided by 4 */
+static void fft_stage ( BYTE st ) {
+
+    UINT16 m  = wsize / 2;                  // complex points
+    UINT16 l  = m >> (2 * st);              // butterfly span
+    UINT16 q  = l / 4;
+    UINT32 k  = 512 / l;                    // table step of the twiddles
+    INT32 ar, ai, br, bi, cr, ci, dr, di;
+    INT32 t0r, t0i, t1r, t1i, t2r, t2i, t3r, t3i;
+    INT32 c1, s1, c2, s2, c3, s3, yr, yi;
+    INT16 *p;
+    UINT16 j, g;
+
+    for (j = 0; j < q; j++){
+        c1 = cos512(j * k);     s1 = sin512(j * k);
+        c2 = cos512(2 * j * k); s2 = sin512(2 * j * k);
+        c3 = cos512(3 * j * k); s3 = sin512(3 * j * k);
+        for (g = j; g < m; g += l){
+            p  = &work[2 * g];
+            ar = p[0];         ai = p[1];
+            br = p[2 * q];     bi = p[2 * q + 1];
+            cr = p[4 * q];     ci = p[4 * q + 1];
+            dr = p[6 * q];     di = p[6 * q + 1];
+
+            t0r = ar + cr;  t0i = ai + ci;
+            t1r = ar - cr;  t1i = ai - ci;
+            t2r = br + dr;  t2i = bi + di;
+            t3r = br - dr;  t3i = bi - di;
+
+            p[0] = (t0r + t2r) >> 2;
+            p[1] = (t0i + t2i) >> 2;
+            if (j == 0){
+                p[2 * q]     = (t1r + t3i) >> 2;
+                p[2 * q + 1] = (t1i - t3r) >> 2;
+                p[4 * q]     = (t0r - t2r) >> 2;
+                p[4 * q + 1] = (t0i - t2i) >> 2;
+                p[6 * q]     = (t1r - t3i) >> 2;
+                p[6 * q + 1] = (t1i + t3r) >> 2;
+                continue;
+            }
+            /* y * W^n with W = cos - j sin */
+            yr = (t1r + t3i) >> 2;  yi = (t1i - t3r) >> 2;
+            p[2 * q]     = (yr * c1 + yi * s1 + 0x4000) >> 15;
+            p[2 * q + 1] = (yi * c1 - yr * s1 + 0x4000) >> 15;
+            yr = (t0r - t2r) >> 2;  yi = (t0i - t2i) >> 2;
+            p[4 * q]     = (yr * c2 + yi * s2 + 0x4000) >> 15;
+            p[4 * q + 1] = (yi * c2 - yr * s2 + 0x4000) >> 15;
+            yr = (t1r - t3i) >> 2;  yi = (t1i + t3r) >> 2;
+            p[6 * q]     = (yr * c3 + yi * s3 + 0x4000) >> 15;
+            p[6 * q + 1] = (yi * c3 - yr * s3 + 0x4000) >> 15;
+        }
+    }
+}
+
+/** Base 4 digit reversal of the N/2 point result */
+static void fft_reorder ( void ) {
+
+    UINT16 m = wsize / 2, i, r, v;
+    INT16 t;
+    BYTE d;
+
+    for (i = 1; i < m; i++){
+        for (r = 0, v = i, d = 0; d < stages; d++, v >>= 2)
+            r = (r << 2) | (v & 3);
+        if (r > i){
+            t = work[2 * i];     work[2 * i]     = work[2 * r];     work[2 * r]     = t;
+            t = work[2 * i + 1]; work[2 * i + 1] = work[2 * r + 1]; work[2 * r + 1] = t;
+        }
+    }
+}
+
+/** Split pass: power of the N/2 bins of the real N point transform */
+static void fft_split ( void ) {
+
+    UINT16 m = wsize / 2, k, mk;
+    UINT32 step = 512 / wsize;
+    INT32 ar, ai, dr, di, c, s, xr, xi;
+
+    for (k = 0; k < m; k++){
+        mk = (m - k) & (m - 1);
+        ar = work[2 * k]     + work[2 * mk];        // 2 x even part
+        ai = work[2 * k + 1] - work[2 * mk + 1];
+        dr = work[2 * k]     - work[2 * mk];        // 2 x odd part times j
+        di = work[2 * k + 1] + work[2 * mk + 1];
+        c  = cos512(k * step);
+        s  = sin512(k * step);
+        xr = (ar + ((c * di - s * dr) >> 15)) >> 2;
+        xi = (ai - ((c * dr + s * di) >> 15)) >> 2;
+        power[k] = (UINT32) (xr * xr) + (UINT32) (xi * xi);
+    }
+}
+
+/** Milli counts of an amplitude, undoing the block scaling */
+static UINT32 unscale ( UINT64 v ) {
+
+    return (UINT32) (shift >= 0 ? v >> shift : v << -shift);
+}
+
+/** Band RMS and interpolated peaks of one axis */
+static void fft_analyse ( fft_result *r ) {
+
+    UINT16 m = wsize / 2, k, lo, hi;
+    UINT16 bin[FFT_PEAKS];
+    UINT32 a0, am, ap, d, mag;
+    INT32 delta;
+    UINT64 sum, corr;
+    BYTE b, i;
+
+    /* Hann: mean square = sum(|X|^2) * 2 / N^2 / 0.375 */
+    for (b = 0; b < FFT_BANDS; b++){
+        lo  = b * m / FFT_BANDS;
+        hi  = (b + 1) * m / FFT_BANDS;
+        sum = 0;
+        for (k = lo ? lo : 1; k < hi; k++)
+            sum += power[k];
+        r->band[b] = unscale(isqrt64(sum * 16 * 1000000 / 3));
+    }
+
+    /* strongest local maxima, bin 0 = none */
+    memset(bin, 0, sizeof(bin));
+    for (k = 2; k < m - 1; k++){
+        if (power[k] <= power[k-1] || power[k] < power[k+1])
+            continue;
+        for (i = FFT_PEAKS; i > 0 && (!bin[i-1] || power[k] > power[bin[i-1]]); i--)
+            if (i < FFT_PEAKS)
+                bin[i] = bin[i-1];
+        if (i < FFT_PEAKS)
+            bin[i] = k;
+    }
+
+    memset(r->peak, 0, sizeof(r->peak));
+    for (i = 0; i < FFT_PEAKS && bin[i]; i++){
+        k  = bin[i];
+        a0 = isqrt64(power[k]);
+        am = isqrt64(power[k-1]);
+        ap = isqrt64(power[k+1]);
+        /* Hann window: a tone at k + delta gives m(k+1)/m(k) = (1 + delta) / (2 - delta) */
+        if (ap >= am)
+            delta = (INT32) (((INT64) 2 * ap - a0) * 256 / (a0 + ap));
+        else
+            delta = -(INT32) (((INT64) 2 * am - a0) * 256 / (a0 + am));
+        if (delta > 128)
+            delta = 128;
+        if (delta < -128)
+            delta = -128;
+        r->peak[i].freq_mhz = (UINT32) (((INT64) k * 256 + delta) * r->fs_mhz / (256 * wsize));
+
+        /* amplitude = 4 |X| / 2^shift, scalloping loss sin(pi d) / (pi d (1 - d^2)) undone */
+        d   = delta < 0 ? -delta : delta;
+        mag = a0 * 4000;
+        if (d){
+            corr = (UINT64) 12868 * d * (65536 - d * d) / (32 * sin512(d));   // Q16, 12868 = pi Q12
+            mag  = (UINT32) ((UINT64) mag * corr >> 16);
+        }
+        r->peak[i].amp = unscale(mag);
+    }
+}
+
+/** Formats the line of one axis, returns its length */
+static UINT32 fft_format ( BYTE a, char *out ) {
+
+    static const char axis_name[3] = { 'X', 'Y', 'Z' };
+    const fft_result *r = &result[a];
+    UINT32 len;
+    BYTE i;
+
+    len = sprintf(out, "FFT %c %u %lu B", axis_name[a], wsize, (unsigned long) r->fs_mhz);
+    for (i = 0; i < FFT_BANDS; i++)
+        len += sprintf(&out[len], " %lu", (unsigned long) r->band[i]);
+    len += sprintf(&out[len], " P");
+    for (i = 0; i < FFT_PEAKS; i++)
+        len += sprintf(&out[len], " %lu %lu", (unsigned long) r->peak[i].freq_mhz,
+                                              (unsigned long) r->peak[i].amp);
+    out[len++] = '\n';
+    out[len]   = 0;
+    return len;
+}
+
+/**
+ *  @brief  Analysis task, lowest priority: one step per activation, then
+ *  posts EV_FFT to itself so higher priority work runs in between.
+ *  Waits for EV_UART_TX when the transmit ring is full.
+ *  @param[in]  events - EV_FFT, EV_UART_TX
+ *  @return     none
+ */
+void fft_task ( UINT32 events ) {
+
+    BYTE bounce[FFT_MAX_LINE];
+    BYTE *p;
+    uart_txw w;
+    UINT32 t0 = ReadCoreTimer();
+
+    if (!busy)
+        return;
+
+    switch (step){
+    case STEP_PREPARE:
+        fft_prepare(blk[collect ^ 1][axis]);
+        stage = 0;
+        step  = STEP_STAGE;
+        break;
+    case STEP_STAGE:
+        fft_stage(stage);
+        if (++stage == stages)
+            step = STEP_SPECTRUM;
+        break;
+    case STEP_SPECTRUM:
+        fft_reorder();
+        fft_split();
+        result[axis].fs_mhz = blk_fs[collect ^ 1];
+        fft_analyse(&result[axis]);
+        result[axis].block = blocks + 1;
+        if (++axis < 3){
+            step = STEP_PREPARE;
+            break;
+        }
+        blocks++;
+        last_ticks = ticks + CT_TICKS_SINCE(t0);
+        if (!report){
+            busy = FALSE;
+            return;
+        }
+        step = STEP_REPORT;
+        axis = 0;
+        break;
+    case STEP_REPORT:
+        for (; axis < 3; axis++){
+            if (UARTTxReserve(&w, FFT_MAX_LINE))
+                return;                             // EV_UART_TX resumes
+            p = UARTTxDirect(&w, FFT_MAX_LINE, bounce);
+            UARTTxAdvance(&w, p, fft_format(axis, (char *) p));
+            UARTTxCommit(&w);
+        }
+        busy = FALSE;
+        return;
+    }
+    ticks += CT_TICKS_SINCE(t0);
+    sched_post(EV_FFT);
+}
+
+/**
+ *  @brief  Result of the last analysed block of one axis.
+ *  @param[in]  axis - 0 x, 1 y, 2 z
+ *  @param[out] r - result
+ *  @return     0 if successful, 1 if there is no result yet.
+ */
+BOOL fft_get ( BYTE axis, fft_result *r ) {
+
+    if (axis > 2 || !result[axis].block)
+        return TRUE;
+
+    *r = result[axis];
+    return FALSE;
+}
+
+/**
+ *  @brief  Blocks dropped because the previous one was still analysed.
+ *  @param[in]  none
+ *  @return     count
+ */
+UINT32 fft_overruns ( void ) { return overruns; }
+
+/**
+ *  @brief  Core timer ticks spent analysing the last block (3 axes,
+ *  without the report).
+ *  @param[in]  none
+ *  @return     ticks, one tick is 2 system clocks
+ */
+UINT32 fft_block_ticks ( void ) { return last_ticks; }
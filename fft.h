@@ -0,0 +1,65 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  main
+ *  @{
+ *      @file       fft.h
+ *      @brief      Block spectrum of the raw sample stream.
+ *      @details    Raw counts are collected per axis in blocks of N samples
+ *                  (FFT_SIZE_MIN..FFT_SIZE_MAX, N = 2 x a power of 4: 32,
+ *                  128, 512). A full block is handed to a low priority task
+ *                  which removes the mean, applies a Hann window, scales the
+ *                  block to Q15 and runs a real FFT of N points as a complex
+ *                  radix-4 FFT of N/2 points followed by a split pass. The
+ *                  work is cut in steps (one radix-4 stage of one axis per
+ *                  activation) so sampling is never held up; while a block is
+ *                  analysed the next one is collected in the second buffer.
+ *
+ *                  For each axis one line is sent per block:
+ *
+ *                  FFT a N fs B b0 b1 b2 b3 P f0 a0 f1 a1 f2 a2
+ *
+ *                  a is X, Y or Z, fs the sample rate in mHz, b0..b3 the RMS
+ *                  of the 4 equal bands between 0 and fs/2 (DC excluded),
+ *                  f0..f2 the 3 strongest spectral peaks (mHz, interpolated
+ *                  between bins) and a0..a2 their amplitude. Amplitudes are
+ *                  in milli counts. The lines can be turned off with
+ *                  fft_set_report when only fft_get() is wanted.
+ */
+#ifndef FFT_H
+#define	FFT_H
+
+#include "platform.h"
+#include "rm3100.h"
+
+#define FFT_SIZE_MIN        (32)
+#define FFT_SIZE_MAX        (512)
+#define FFT_BANDS           (4)
+#define FFT_PEAKS           (3)
+#define FFT_MAX_LINE        (160)
+
+/** @details Spectral peak. */
+typedef struct {
+    UINT32 freq_mhz;    /// interpolated frequency, mHz
+    UINT32 amp;         /// amplitude, milli counts
+}fft_peak;
+
+/** @details Result of the last analysed block of one axis. */
+typedef struct {
+    UINT32   band[FFT_BANDS];   /// band RMS, milli counts
+    fft_peak peak[FFT_PEAKS];   /// strongest first, freq_mhz 0 if unused
+    UINT32   fs_mhz;            /// sample rate of the block, mHz
+    UINT32   block;             /// block number, 0 = no result yet
+}fft_result;
+
+BOOL   fft_set_size     ( UINT16 n );
+UINT16 fft_get_size     ( void );
+void   fft_set_report   ( BOOL on );
+void   fft_update       ( const sensor_xyz *raw );
+void   fft_task         ( UINT32 events );
+BOOL   fft_get          ( BYTE axis, fft_result *r );
+UINT32 fft_overruns     ( void );
+UINT32 fft_block_ticks  ( void );
+
+#endif	/* FFT_H */
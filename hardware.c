@@ -2,6 +2,7 @@
 #include "hardware.h"
 #include "uart.h"
 #include "i2c.h"
+#include "scheduler.h"
 
 /** Configuration Bit settings
  * SYSCLK = 80 MHz (8MHz Crystal / FPLLIDIV * FPLLMUL / FPLLODIV)
@@ -49,21 +50,32 @@ void BoardInit(void)
 //#endif
 
     /// UART 1 SETUP ////
-    UARTConfigure(UART_MODULE_ID, UART_ENABLE_PINS_TX_RX_ONLY);
+    UARTConfigure(UART_MODULE_ID, UART_ENABLE_PINS_TX_RX_ONLY | UART_ENABLE_HIGH_SPEED);   // BRGH, 4x: closer baud rates
     UARTSetFifoMode(UART_MODULE_ID, UART_INTERRUPT_ON_TX_NOT_FULL | UART_INTERRUPT_ON_RX_NOT_EMPTY);
     UARTSetLineControl(UART_MODULE_ID, UART_DATA_SIZE_8_BITS | UART_PARITY_NONE | UART_STOP_BITS_1);
     UARTSetDataRate(UART_MODULE_ID, GetPeripheralClock(), UARTBAUDRATE);
     UARTEnable(UART_MODULE_ID, UART_ENABLE_FLAGS(UART_PERIPHERAL | UART_RX | UART_TX));
+    INTSetVectorPriority(INT_VECTOR_UART(UART_MODULE_ID), INT_PRIORITY_LEVEL_2);
+    INTEnable(INT_SOURCE_UART_RX(UART_MODULE_ID), INT_ENABLED);        // command channel
+    INTEnable(INT_SOURCE_UART_ERROR(UART_MODULE_ID), INT_ENABLED);
 
-    /// TIMER 1 SETUP /////
-    OpenTimer1(T1_ON | T1_PS_1_256, 0xFFFF);
-    ConfigIntTimer1(T1_INT_ON | T1_INT_PRIOR_1 | T1_INT_SUB_PRIOR_0);// Set up the core timer interrupt with a priority of 2 and zero sub-priority
+    /// CORE TIMER SETUP (scheduler tick) ////
+    _CP0_SET_COMPARE(ReadCoreTimer() + CORE_TICK_PERIOD);    // not OpenCoreTimer: the count runs since boot_start()
+    mConfigIntCoreTimer(CT_INT_ON | CT_INT_PRIOR_2 | CT_INT_SUB_PRIOR_0);
 
     /// I2C 1 SETUP ////
      i2c_init(MPU_I2C, MASTER, 0); //Enable I2C channel
+     INTSetVectorPriority(INT_VECTOR_I2C(MPU_I2C), INT_PRIORITY_LEVEL_3);
+     INTClearFlag(INT_I2C1B);
+     INTEnable(INT_I2C1B, INT_ENABLED);   // bus collisions wake the housekeeping task
 
     /// EXTERNAL INTERRUPTIONS SETUP ////
-    // ConfigINT2(EXT_INT_PRI_2 | RISING_EDGE_INT | EXT_INT_ENABLE); // EXT INT2
+#if DRDY_INT_ENABLED
+    ConfigINT2(EXT_INT_PRI_2 | RISING_EDGE_INT | EXT_INT_ENABLE); // EXT INT2 - RM3100 DRDY
+#endif
+#if PPS_INT_ENABLED
+    ConfigINT3(EXT_INT_PRI_4 | RISING_EDGE_INT | EXT_INT_ENABLE); // EXT INT3 - PPS / trigger, above the rest for the capture
+#endif
     // EXT INT 1
 //    mINT1SetIntPriority(4);	/* Set the Interrupt Priority */
 //    mINT1SetIntSubPriority(2);	/* Set Interrupt Subpriority Bits for INT1 */
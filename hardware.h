@@ -22,12 +22,26 @@
 #define uS_TO_CORE_TICKS(x)     ((UINT64)(x)*ONE_SECOND/1000000)
 #define CT_TICKS_SINCE(tick)    (ReadCoreTimer() - (tick))	// number of core timer ticks since "tick"
 
+#define CORE_TIMER_INT_VECTOR   (0)                                        /**< Interruption Vector For core timer */
 #define TIMER_1_INT_VECTOR      (4)                                       /**< Interruption Vector For timer1 */
 #define EXTERNAL_2_INT_VECTOR   (11)                                       /**< Interruption Vector For external interrupt 2*/
+#define EXTERNAL_3_INT_VECTOR   (15)                                       /**< Interruption Vector For external interrupt 3*/
+#define UART_1_INT_VECTOR       (24)                                       /**< Interruption Vector For UART1 */
+#define I2C_1_INT_VECTOR        (25)                                       /**< Interruption Vector For I2C1 */
+
+#define DRDY_INT_ENABLED        (0)     /**< 1 - RM3100 DRDY wired to INT2; 0 - poll STATUS register */
+#define PPS_INT_ENABLED         (0)     /**< 1 - PPS / trigger input wired to INT3 (RA14); INT1 is kept for the radio */
 
 #define MPU_I2C                 (I2C1)
+    // I2C1 pins, driven by hand on bus recovery
+#define I2C_SCL_TRIS            TRISGbits.TRISG2
+#define I2C_SCL_LAT             LATGbits.LATG2
+#define I2C_SDA_TRIS            TRISGbits.TRISG3
+#define I2C_SDA_LAT             LATGbits.LATG3
+#define I2C_SDA_PIN             PORTGbits.RG3
 
 //Radio
+#define RADIO_ENABLED           (0)     /**< 1 - MRF24J40 uplink (add MRF24J40.c/h, uncomment the map below); 0 - loopback */
 #define BYTEPTR(x)              ((UINT8*)&(x))	// converts x to a UINT8* for bytewise access ala x[foo]
 
 //#define HARDWARE_SPI			// vs. software bit-bang (slower)
@@ -57,5 +71,7 @@
 //#define SPEEDO              (LATFbits.LATF3)            // "speedometer" debug output pin
 
 
+void BoardInit(void);
+
 #endif	/* HARDWARE_H */
 
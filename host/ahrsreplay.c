@@ -0,0 +1,233 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  host
+ *  @{
+ *      @file       ahrsreplay.c
+ *      @brief      Runs recorded motion through the firmware orientation filter.
+ *      @details    Build on Linux from this directory:
+ *
+ *                  cc -O2 -I.. -o ahrsreplay ahrsreplay.c ../ahrs.c ../uart.c
+ *                     ../scheduler.c ../host_port.c -lm
+ *
+ *                  ahrsreplay [-r rate_hz] [-s settle_s] [-v] recording
+ *                  ahrsreplay -g seconds [-r rate_hz] > recording
+ *
+ *                  A recording is a text file, one IMU sample per line:
+ *
+ *                  t_us ax ay az gx gy gz mx my mz [qw qx qy qz]
+ *
+ *                  accelerometer and gyro in MPU counts (mpu.h scales), the
+ *                  calibrated field in uT in the IMU axes or "-" on lines
+ *                  without a new field sample, then optionally the reference
+ *                  orientation (sensor to earth: x north, y west, z up), e.g.
+ *                  from a motion platform or an optical tracker. Each line
+ *                  goes through ahrs_mag / ahrs_update as on the board.
+ *
+ *                  With a reference, the angle between the filter and the
+ *                  reference is reported after settle_s (default 2): RMS and
+ *                  max of the full rotation, of the tilt and of the heading.
+ *                  The update time goes to stderr. -v prints each quaternion.
+ *
+ *                  -g writes a synthetic recording with its reference: smooth
+ *                  rotation about all axes with still periods, gyro bias and
+ *                  noise, a small linear acceleration, field at half the IMU
+ *                  rate with noise.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "platform.h"
+#include "ahrs.h"
+#include "mpu.h"
+
+#define PI_D        3.14159265358979
+
+/** Earth vector e expressed in the sensor axes of orientation q */
+static void to_sensor ( const double q[4], const double e[3], double s[3] ) {
+
+    double w = q[0], x = q[1], y = q[2], z = q[3];
+
+    /* R(q) transposed */
+    s[0] = (1 - 2*(y*y + z*z)) * e[0] + 2*(x*y + w*z) * e[1] + 2*(x*z - w*y) * e[2];
+    s[1] = 2*(x*y - w*z) * e[0] + (1 - 2*(x*x + z*z)) * e[1] + 2*(y*z + w*x) * e[2];
+    s[2] = 2*(x*z + w*y) * e[0] + 2*(y*z - w*x) * e[1] + (1 - 2*(x*x + y*y)) * e[2];
+}
+
+/** Gaussian noise */
+static double noise ( double sigma ) {
+
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0), v = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+    return sigma * sqrt(-2 * log(u)) * cos(2 * PI_D * v);
+}
+
+/** Writes a synthetic recording to stdout */
+static void generate ( double seconds, int rate ) {
+
+    const double amp[3] = { 60, 45, 90 }, f[3] = { 0.13, 0.21, 0.07 }, ph[3] = { 0, 1.3, 2.1 };
+    const double bias[3] = { 0.5, -0.3, 0.8 };      // deg/s
+    const double field[3] = { 20, 0, -44 };         // uT, north and down
+    const double up[3] = { 0, 0, 1 };
+    double q[4] = { 0.9238795, 0, 0, 0.3826834 };   // 45 deg heading
+    double t, dt = 1.0 / rate, w[3], a[3], m[3], n, hw[3], d[4], env;
+    long i, steps = (long) (seconds * rate);
+    int k, sub;
+
+    srand(1);
+    for (i = 0; i < steps; i++){
+        t = i * dt;
+        /* 8 s of motion, 2 s still */
+        env = fmod(t, 10) < 8 ? sin(PI_D * fmod(t, 10) / 8) : 0;
+        for (k = 0; k < 3; k++)
+            w[k] = env * amp[k] * sin(2 * PI_D * f[k] * t + ph[k]);     // deg/s
+
+        to_sensor(q, up, a);
+        to_sensor(q, field, m);
+        printf("%lu %.0f %.0f %.0f %.0f %.0f %.0f", (unsigned long) (t * 1e6),
+               (a[0] + 0.03 * env * sin(7 * t) + noise(0.01)) * MPU_ACCEL_LSB_G,
+               (a[1] + 0.03 * env * cos(5 * t) + noise(0.01)) * MPU_ACCEL_LSB_G,
+               (a[2] + noise(0.01)) * MPU_ACCEL_LSB_G,
+               (w[0] + bias[0] + noise(0.05)) * 32768 / MPU_GYRO_DPS,
+               (w[1] + bias[1] + noise(0.05)) * 32768 / MPU_GYRO_DPS,
+               (w[2] + bias[2] + noise(0.05)) * 32768 / MPU_GYRO_DPS);
+        if (i % 2 == 0)
+            printf(" %.3f %.3f %.3f", m[0] + noise(0.05), m[1] + noise(0.05), m[2] + noise(0.05));
+        else
+            printf(" - - -");
+        printf(" %.7f %.7f %.7f %.7f\n", q[0], q[1], q[2], q[3]);
+
+        /* true motion over the sample period, in fine steps */
+        for (sub = 0; sub < 10; sub++){
+            for (k = 0; k < 3; k++)
+                hw[k] = w[k] * PI_D / 180 * dt / 10 / 2;
+            d[0] = -q[1]*hw[0] - q[2]*hw[1] - q[3]*hw[2];
+            d[1] =  q[0]*hw[0] + q[2]*hw[2] - q[3]*hw[1];
+            d[2] =  q[0]*hw[1] - q[1]*hw[2] + q[3]*hw[0];
+            d[3] =  q[0]*hw[2] + q[1]*hw[1] - q[2]*hw[0];
+            for (k = 0, n = 0; k < 4; k++){
+                q[k] += d[k];
+                n    += q[k] * q[k];
+            }
+            for (k = 0; k < 4; k++)
+                q[k] /= sqrt(n);
+        }
+    }
+}
+
+/** Heading of orientation q, radians */
+static double heading ( const double q[4] ) {
+
+    return atan2(2 * (q[0]*q[3] + q[1]*q[2]), 1 - 2 * (q[2]*q[2] + q[3]*q[3]));
+}
+
+static double now_s ( void ) {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main ( int argc, char **argv ) {
+
+    const double up[3] = { 0, 0, 1 };
+    int rate = MPU_RATE_HZ, opt, k, fields;
+    double gen = 0, settle = 2, t_us, qr[4], qe[4], vr[3], ve[3], d, c;
+    double sum = 0, sum_tilt = 0, sum_head = 0, max = 0, max_tilt = 0, max_head = 0, cpu = 0, t0;
+    double mx, my, mz, ax, ay, az, gx, gy, gz;
+    unsigned long n = 0, lines = 0;
+    BOOL verbose = FALSE;
+    char line[256], smx[32], smy[32], smz[32], out[AHRS_MAX_LINE];
+    imu_sample s;
+    INT32 q[4];
+    ahrs_bench b;
+    FILE *in;
+
+    while ((opt = getopt(argc, argv, "r:s:g:v")) != -1){
+        switch (opt){
+            case 'r': rate    = atoi(optarg); break;
+            case 's': settle  = atof(optarg); break;
+            case 'g': gen     = atof(optarg); break;
+            case 'v': verbose = TRUE;         break;
+            default:
+                fprintf(stderr, "usage: ahrsreplay [-r rate_hz] [-s settle_s] [-v] recording | -g seconds\n");
+                return 1;
+        }
+    }
+    if (rate <= 0){
+        fprintf(stderr, "ahrsreplay: bad rate\n");
+        return 1;
+    }
+    if (gen > 0){
+        generate(gen, rate);
+        return 0;
+    }
+    if (optind >= argc || !(in = fopen(argv[optind], "r"))){
+        fprintf(stderr, "ahrsreplay: no recording\n");
+        return 1;
+    }
+
+    ahrs_init(rate, MPU_GYRO_DPS, MPU_ACCEL_LSB_G);
+    while (fgets(line, sizeof(line), in)){
+        fields = sscanf(line, "%lf %lf %lf %lf %lf %lf %lf %31s %31s %31s %lf %lf %lf %lf",
+                        &t_us, &ax, &ay, &az, &gx, &gy, &gz, smx, smy, smz, &qr[0], &qr[1], &qr[2], &qr[3]);
+        if (fields < 10)
+            continue;
+        lines++;
+        if (strcmp(smx, "-")){
+            mx = atof(smx);
+            my = atof(smy);
+            mz = atof(smz);
+            ahrs_mag(mx, my, mz);
+        }
+        s.ax = ax;  s.ay = ay;  s.az = az;
+        s.gx = gx;  s.gy = gy;  s.gz = gz;
+        t0 = now_s();
+        ahrs_update(&s);
+        cpu += now_s() - t0;
+
+        ahrs_get(q);
+        for (k = 0; k < 4; k++)
+            qe[k] = (double) q[k] / AHRS_ONE;
+        if (verbose)
+            printf("%.0f %.5f %.5f %.5f %.5f\n", t_us / 1000, qe[0], qe[1], qe[2], qe[3]);
+        if (fields < 14 || t_us < settle * 1e6)
+            continue;
+
+        /* whole rotation between the two */
+        c = fabs(qr[0]*qe[0] + qr[1]*qe[1] + qr[2]*qe[2] + qr[3]*qe[3]);
+        d = 2 * acos(c > 1 ? 1 : c) * 180 / PI_D;
+        sum += d * d;
+        if (d > max)
+            max = d;
+        /* tilt: the vertical in sensor axes */
+        to_sensor(qr, up, vr);
+        to_sensor(qe, up, ve);
+        c = vr[0]*ve[0] + vr[1]*ve[1] + vr[2]*ve[2];
+        d = acos(c > 1 ? 1 : c) * 180 / PI_D;
+        sum_tilt += d * d;
+        if (d > max_tilt)
+            max_tilt = d;
+        d = fabs(remainder(heading(qe) - heading(qr), 2 * PI_D)) * 180 / PI_D;
+        sum_head += d * d;
+        if (d > max_head)
+            max_head = d;
+        n++;
+    }
+    fclose(in);
+
+    ahrs_get_bench(&b);
+    ahrs_format(out);
+    fprintf(stderr, "%s", out);
+    fprintf(stderr, "AHRS %lu samples, %.0f ns per update\n", lines, lines ? cpu / lines * 1e9 : 0);
+    if (n)
+        printf("ERR deg rms %.3f max %.3f tilt rms %.3f max %.3f heading rms %.3f max %.3f (%lu samples)\n",
+               sqrt(sum / n), max, sqrt(sum_tilt / n), max_tilt, sqrt(sum_head / n), max_head, n);
+    return 0;
+}
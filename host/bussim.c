@@ -0,0 +1,215 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  host
+ *  @{
+ *      @file       bussim.c
+ *      @brief      Runs the shared I2C bus scheduler against simulated devices.
+ *      @details    Build on Linux from this directory:
+ *
+ *                  cc -O2 -I.. -o bussim bussim.c ../busched.c ../scheduler.c
+ *
+ *                  bussim [-m mag_hz] [-i imu_hz] [-c chunk_bytes] [-k bus_khz]
+ *                         [-s seconds] [-n] [-I]
+ *
+ *                  The firmware scheduler and busched.c run unmodified on a
+ *                  virtual core timer: the simulated i2c_read_attempt /
+ *                  i2c_write_attempt move the clock forward by the
+ *                  transfer time at the bus speed, the clock jumps to the
+ *                  next device event when nothing is queued.
+ *
+ *                  MAG: the RM3100 in CMM, DRDY at mag_hz (default 300), a 9
+ *                  bytes read per sample due before the next DRDY. A sample
+ *                  not read by then is lost.
+ *                  IMU: a 1 KiB FIFO filled with 12 bytes samples (accel and
+ *                  gyro) at imu_hz (default 1000), read in chunk_bytes
+ *                  (default 48) as soon as that much is waiting, due before
+ *                  the FIFO overflows. Overflowing samples are dropped.
+ *
+ *                  -n submits everything without deadline, the device
+ *                  priority alone decides (MAG first, -I IMU first), for
+ *                  comparison. The BUS report and the loss counts go to
+ *                  stdout.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "platform.h"
+#include "scheduler.h"
+#include "busched.h"
+#include "i2c.h"
+
+#define IMU_SAMPLE      (12)
+#define IMU_FIFO        (1024)
+
+static UINT32 now = 0;          // virtual core timer
+static UINT32 bus_khz = 400;
+
+/*================================================================
+                 P L A T F O R M   S T U B S
+================================================================*/
+UINT32 ReadCoreTimer ( void ) { return now; }
+
+unsigned int INTDisableInterrupts ( void ) { return 0; }
+
+void INTRestoreInterrupts ( unsigned int status ) { (void)status; }
+
+/** Start, address, register, restart, address, data, 9 bits each */
+static void bus_transfer ( unsigned char length ) {
+
+    UINT64 bits = (UINT64) (length + 3) * 9 + 2;
+
+    now += (UINT32) (bits * ONE_SECOND / (bus_khz * 1000));
+}
+
+int i2c_write_attempt ( unsigned char slave_addr, unsigned char reg_addr, unsigned char length, unsigned char const *data, BYTE attempt ) {
+
+    bus_transfer(length);
+    return I2C_OK;
+}
+
+int i2c_read_attempt ( unsigned char slave_addr, unsigned char reg_addr, unsigned char length, unsigned char *data, BYTE attempt ) {
+
+    bus_transfer(length);
+    return I2C_OK;
+}
+
+BYTE i2c_get_max_retries ( void ) { return 0; }
+
+/*================================================================
+                 S I M U L A T E D   D E V I C E S
+================================================================*/
+static BOOL deadlines = TRUE;
+
+static BYTE   mag_dev, imu_dev;
+static UINT32 mag_period, mag_next, mag_due;
+static UINT32 mag_samples = 0, mag_lost = 0;
+static BYTE   mag_data[9];
+static bus_request mag_req;
+
+static UINT32 imu_period, imu_next, imu_chunk;
+static UINT32 imu_level = 0, imu_samples = 0, imu_dropped = 0;
+static BYTE   imu_data[255];
+static bus_request imu_req;
+
+/** Judged against the next DRDY, with or without deadline */
+static void mag_done ( bus_request *r ) {
+
+    if ((INT32) (now - mag_due) > 0)
+        mag_lost++;                     // overwritten by the next sample
+}
+
+static void imu_done ( bus_request *r ) {
+
+    imu_level -= r->len;
+}
+
+/** Submits at the time t the device asked for it, which can be during the
+    transfer that just ended: the wait is then counted from t */
+static void sim_submit ( BYTE dev, bus_request *r, UINT32 t ) {
+
+    UINT32 t_now = now;
+
+    now = t;
+    busched_submit(dev, r);
+    now = t_now;
+}
+
+/** Queues an IMU chunk read if enough is waiting */
+static void sim_imu_read ( UINT32 t ) {
+
+    if (imu_req.busy || imu_level < imu_chunk)
+        return;
+    imu_req.deadline = deadlines ? imu_next + (IMU_FIFO - imu_level) / IMU_SAMPLE * imu_period
+                                 : BUS_NO_DEADLINE;
+    sim_submit(imu_dev, &imu_req, t);
+}
+
+/** Device events up to the virtual time, in time order */
+static void sim_devices ( void ) {
+
+    while ((INT32) (now - mag_next) >= 0 || (INT32) (now - imu_next) >= 0){
+        if ((INT32) (mag_next - imu_next) <= 0){
+            mag_samples++;
+            if (mag_req.busy)
+                mag_lost++;             // previous one never made it
+            else{
+                mag_due          = mag_next + mag_period;
+                mag_req.deadline = deadlines ? mag_due : BUS_NO_DEADLINE;
+                sim_submit(mag_dev, &mag_req, mag_next);
+            }
+            mag_next += mag_period;
+        }
+        else{
+            imu_samples++;
+            if (imu_level + IMU_SAMPLE > IMU_FIFO)
+                imu_dropped++;
+            else
+                imu_level += IMU_SAMPLE;
+            imu_next += imu_period;
+            sim_imu_read(imu_next - imu_period);
+        }
+    }
+    sim_imu_read(now);                  // more waiting after the last read
+}
+
+int main ( int argc, char **argv ) {
+
+    UINT32 mag_hz = 300, imu_hz = 1000, seconds = 10, end;
+    BOOL imu_first = FALSE;
+    char line[BUS_MAX_LINE];
+    int opt;
+
+    imu_chunk = 4 * IMU_SAMPLE;
+    while ((opt = getopt(argc, argv, "m:i:c:k:s:nI")) != -1){
+        switch (opt){
+            case 'm': mag_hz    = strtoul(optarg, NULL, 0); break;
+            case 'i': imu_hz    = strtoul(optarg, NULL, 0); break;
+            case 'c': imu_chunk = strtoul(optarg, NULL, 0); break;
+            case 'k': bus_khz   = strtoul(optarg, NULL, 0); break;
+            case 's': seconds   = strtoul(optarg, NULL, 0); break;
+            case 'n': deadlines = FALSE; break;
+            case 'I': imu_first = TRUE;  break;
+            default:
+                fprintf(stderr, "usage: bussim [-m mag_hz] [-i imu_hz] [-c chunk_bytes] [-k bus_khz] [-s seconds] [-n] [-I]\n");
+                return 1;
+        }
+    }
+    if (!mag_hz || !imu_hz || !bus_khz || imu_chunk < IMU_SAMPLE || imu_chunk > 255){
+        fprintf(stderr, "bussim: bad option\n");
+        return 1;
+    }
+    imu_chunk -= imu_chunk % IMU_SAMPLE;
+
+    mag_dev = busched_add_device("MAG", imu_first);
+    imu_dev = busched_add_device("IMU", !imu_first);
+    sched_add("bus", busched_task, EV_BUS, 0);
+
+    mag_req.op   = imu_req.op   = BUS_READ;
+    mag_req.addr = 0x20;  mag_req.reg = 0x24;  mag_req.len = 9;
+    mag_req.data = mag_data;
+    mag_req.done = mag_done;
+    imu_req.addr = 0x68;  imu_req.reg = 0x74;  imu_req.len = (BYTE) imu_chunk;
+    imu_req.data = imu_data;
+    imu_req.done = imu_done;
+
+    mag_period = ONE_SECOND / mag_hz;
+    imu_period = ONE_SECOND / imu_hz;
+    mag_next   = mag_period;
+    imu_next   = imu_period / 3;        // not in phase with the magnetometer
+    end        = seconds * ONE_SECOND;
+
+    while ((INT32) (now - end) < 0){
+        sim_devices();
+        if (!sched_run_once())
+            now = (INT32) (mag_next - imu_next) < 0 ? mag_next : imu_next;
+    }
+
+    busched_format(line);
+    fputs(line, stdout);
+    printf("SIM %s MAG %lu lost %lu IMU %lu dropped %lu\n", deadlines ? "edf" : "prio",
+           (unsigned long) mag_samples, (unsigned long) mag_lost,
+           (unsigned long) imu_samples, (unsigned long) imu_dropped);
+    return 0;
+}
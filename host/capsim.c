@@ -0,0 +1,282 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  host
+ *  @{
+ *      @file       capsim.c
+ *      @brief      Capture throughput benchmark on simulated program flash.
+ *      @details    Build on Linux from this directory:
+ *
+ *                  cc -O2 -I.. -o capsim capsim.c ../capture.c ../uart.c ../scheduler.c
+ *
+ *                  capsim [-r hz] [-n samples] [-e erase_us] [-w row_us]
+ *                         [-k bus_khz] [-b baud] [-c every] > dump.bin
+ *
+ *                  capture.c and the scheduler run unmodified on a virtual
+ *                  core timer. The simulated nvm_erase_page / nvm_write_row
+ *                  stall the CPU for the typical times of the PIC32MX795
+ *                  datasheet (page erase 20 ms, row program 3 ms), as
+ *                  programming from flash does: no task and no interrupt
+ *                  runs meanwhile.
+ *
+ *                  The RM3100 gives a DRDY at hz (default 600); the sample
+ *                  is read (9 bytes at bus_khz, default 400) and pushed as
+ *                  soon as the CPU is free. A DRDY while the previous sample
+ *                  is still unread overwrites it: lost, counted while the
+ *                  capture runs. Samples refused by capture_push are the
+ *                  overruns of the page buffers; above CAPTURE_FLASH_MAX_HZ
+ *                  the capture ends when the RAM ring is full (held). With
+ *                  -c the sensor configuration (epoch and cycle count)
+ *                  changes every that many samples.
+ *
+ *                  The capture is then dumped; the dump is checked against
+ *                  the samples pushed and its time on the line worked out at
+ *                  baud (default 230400, 10 bits per byte). Every frame must
+ *                  come after the configuration frame of its epoch. The
+ *                  frames and the capture lines go to stdout, the report to
+ *                  stderr:
+ *
+ *                  CAPSIM rate r Hz n n lost l overruns o erase_ms e
+ *                  capture_ms c rows w stall_pct s held h dump_ms d
+ *                  configs k errors x max_dt_us t
+ *
+ *                  max_dt_us is the worst time stamp error of the dump, from
+ *                  the truncated CAPTURE_DT_UNIT_US steps adding up.
+ *                  Exit status 1 if the dump does not match.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "platform.h"
+#include "scheduler.h"
+#include "capture.h"
+#include "uart.h"
+
+#define TICKS_PER_US    (ONE_SECOND / 1000000)
+
+static UINT32 now = 0;          // virtual core timer
+static UINT32 erase_ticks = 20000 * TICKS_PER_US;
+static UINT32 row_ticks   = 3000 * TICKS_PER_US;
+static UINT32 stall_ticks = 0;  // CPU stopped by the flash
+static nvm_stats nvm;
+
+/* Samples pushed, to check the dump */
+static sensor_xyz expect_raw[CAPTURE_MAX_SAMPLES];
+static UINT32     expect_t[CAPTURE_MAX_SAMPLES];
+static UINT32     dump_errors = 0, dump_frames = 0, dump_max_dt_us = 0;
+static UINT32     dump_configs = 0;
+static BYTE       dump_epoch;       // of the last configuration frame
+static rm3100_epoch epoch_info;
+
+/*================================================================
+                 P L A T F O R M   S T U B S
+================================================================*/
+UINT32 ReadCoreTimer ( void ) { return now; }
+
+unsigned int INTDisableInterrupts ( void ) { return 0; }
+
+void INTRestoreInterrupts ( unsigned int status ) { (void)status; }
+
+BOOL nvm_erase_page ( const void *page ) {
+
+    memset((void *) page, 0xFF, NVM_PAGE_SIZE);
+    now         += erase_ticks;
+    stall_ticks += erase_ticks;
+    nvm.erases++;
+    if (erase_ticks > nvm.max_ticks)
+        nvm.max_ticks = erase_ticks;
+    return FALSE;
+}
+
+BOOL nvm_write_row ( const void *row, const void *data ) {
+
+    BYTE *dst = (BYTE *) row;
+    const BYTE *src = data;
+    UINT32 i;
+
+    for (i = 0; i < NVM_ROW_SIZE; i++)
+        dst[i] &= src[i];               // programming only clears bits
+    now         += row_ticks;
+    stall_ticks += row_ticks;
+    nvm.rows++;
+    if (row_ticks > nvm.max_ticks)
+        nvm.max_ticks = row_ticks;
+    return FALSE;
+}
+
+BOOL nvm_write_word ( const void *address, UINT32 word ) {
+
+    *(UINT32 *) address &= word;
+    nvm.words++;
+    return FALSE;
+}
+
+const nvm_stats * nvm_get_stats ( void ) { return &nvm; }
+
+/** Cycle count of a simulated epoch */
+static UINT16 sim_cycle_count ( BYTE epoch ) { return CC_MIN + epoch * 37 % (CC_MAX - CC_MIN + 1); }
+
+const rm3100_epoch * RM3100_getEpoch ( BYTE epoch ) {
+
+    epoch_info.cycle_count = sim_cycle_count(epoch);
+    epoch_info.gain        = CC_GAIN(epoch_info.cycle_count);
+    return &epoch_info;
+}
+
+/** Checks the configuration frame against the next record; the frame
+ *  itself is left out of the dump */
+BYTE pipeline_pack_config ( BYTE *frame, BYTE epoch, UINT16 cycle_count ) {
+
+    BYTE want = expect_raw[dump_frames].epoch;
+
+    if (epoch != want || cycle_count != sim_cycle_count(want))
+        dump_errors++;
+    dump_epoch = epoch;
+    dump_configs++;
+    memset(frame, 0, FRAME_CFG_SIZE);
+    return FRAME_CFG_SIZE;
+}
+
+/** Checks the dumped record against the sample pushed, then packs it as
+ *  pipeline.c does */
+BYTE pipeline_pack_frame ( BYTE *frame, UINT16 seq, UINT32 t_us, const sensor_xyz *raw ) {
+
+    UINT32 i = dump_frames++, want_us, err;
+    BYTE crc = 0, b, k;
+
+    if (raw->x != expect_raw[i].x || raw->y != expect_raw[i].y || raw->z != expect_raw[i].z
+        || raw->flags != expect_raw[i].flags || seq != (UINT16) i
+        || raw->epoch != expect_raw[i].epoch || dump_configs == 0 || dump_epoch != raw->epoch)
+        dump_errors++;
+    want_us = (expect_t[i] - expect_t[0]) / TICKS_PER_US;
+    err     = t_us > want_us ? t_us - want_us : want_us - t_us;
+    if (err > dump_max_dt_us)
+        dump_max_dt_us = err;
+
+    frame[0]  = FRAME_SYNC0;
+    frame[1]  = FRAME_SYNC1;
+    frame[2]  = seq;        frame[3]  = seq >> 8;
+    frame[4]  = t_us;       frame[5]  = t_us >> 8;
+    frame[6]  = t_us >> 16; frame[7]  = t_us >> 24;
+    frame[8]  = raw->x >> 16;  frame[9]  = raw->x >> 8;  frame[10] = raw->x;
+    frame[11] = raw->y >> 16;  frame[12] = raw->y >> 8;  frame[13] = raw->y;
+    frame[14] = raw->z >> 16;  frame[15] = raw->z >> 8;  frame[16] = raw->z;
+    frame[17] = raw->flags;
+    for (b = 2; b < FRAME_SIZE - 1; b++){
+        crc ^= frame[b];
+        for (k = 0; k < 8; k++)
+            crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+    frame[18] = crc;
+    return FRAME_SIZE;
+}
+
+/*================================================================
+                 S I M U L A T E D   S E N S O R
+================================================================*/
+static UINT32 drdy_period, drdy_next, read_ticks, epoch_every = 0;
+static UINT32 samples = 0, lost = 0;
+static BOOL   pending = FALSE;
+static mag_sample sample;
+
+/** DRDYs up to the virtual time; an unread sample is overwritten, lost if
+ *  the capture is running */
+static void sim_sensor ( void ) {
+
+    while ((INT32) (now - drdy_next) >= 0){
+        if (pending && capture_get_stats()->state == CAP_RUNNING)
+            lost++;
+        sample.raw.x     = (INT32) ((samples * 2654435761u) >> 8) - 0x800000;
+        sample.raw.y     = (INT32) (samples * 977) % 0x7FFFFF;
+        sample.raw.z     = -(INT32) samples;
+        sample.raw.flags = samples & 0x0F;
+        sample.raw.epoch = epoch_every ? samples / epoch_every : 0;
+        sample.t         = drdy_next;
+        pending    = TRUE;
+        samples++;
+        drdy_next += drdy_period;
+    }
+}
+
+/** Reads the waiting sample and hands it to the capture */
+static void sim_read ( void ) {
+
+    const capture_stats *c = capture_get_stats();
+    UINT32 i = c->captured;
+
+    now += read_ticks;
+    pending = FALSE;
+    if (c->state != CAP_RUNNING)
+        return;
+    if (!capture_push(&sample)){
+        expect_raw[i] = sample.raw;
+        expect_t[i]   = sample.t;
+    }
+}
+
+int main ( int argc, char **argv ) {
+
+    UINT32 hz = 600, n = 0, bus_khz = 400, baud = 230400;
+    UINT32 erase_end = 0;
+    UINT64 stall_run = 0, dump_bytes;
+    const capture_stats *c = capture_get_stats();
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:n:e:w:k:b:c:")) != -1){
+        switch (opt){
+            case 'r': hz          = strtoul(optarg, NULL, 0); break;
+            case 'n': n           = strtoul(optarg, NULL, 0); break;
+            case 'e': erase_ticks = strtoul(optarg, NULL, 0) * TICKS_PER_US; break;
+            case 'w': row_ticks   = strtoul(optarg, NULL, 0) * TICKS_PER_US; break;
+            case 'k': bus_khz     = strtoul(optarg, NULL, 0); break;
+            case 'b': baud        = strtoul(optarg, NULL, 0); break;
+            case 'c': epoch_every = strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: capsim [-r hz] [-n samples] [-e erase_us] [-w row_us] [-k bus_khz] [-b baud] [-c every]\n");
+                return 1;
+        }
+    }
+    if (!hz || !bus_khz || !baud){
+        fprintf(stderr, "capsim: bad option\n");
+        return 1;
+    }
+
+    sched_add("capture", capture_task, EV_CAPTURE | EV_UART_TX, 0);
+    drdy_period = ONE_SECOND / hz;
+    read_ticks  = (UINT32) (((9 + 3) * 9 + 2) * (UINT64) ONE_SECOND / (bus_khz * 1000));
+
+    capture_start(n);
+    while (c->state == CAP_ERASING)
+        sched_run_once();
+    erase_end = now;
+    drdy_next = now + drdy_period;      // sampling starts with the capture
+    stall_run = stall_ticks;
+
+    while (c->state == CAP_RUNNING || c->state == CAP_FLUSHING){
+        sim_sensor();
+        if (pending)
+            sim_read();
+        else if (!sched_run_once() && c->state == CAP_RUNNING)
+            now = drdy_next;
+    }
+    stall_run = stall_ticks - stall_run;
+
+    capture_dump();
+    while (c->state == CAP_DUMPING)
+        sched_run_once();
+    fflush(stdout);
+
+    dump_bytes = (UINT64) c->dumped * FRAME_SIZE + (UINT64) dump_configs * FRAME_CFG_SIZE;
+    fprintf(stderr, "CAPSIM rate %lu Hz n %lu lost %lu overruns %lu erase_ms %lu capture_ms %lu rows %lu stall_pct %.1f held %u dump_ms %lu configs %lu errors %lu max_dt_us %lu\n",
+            (unsigned long) hz, (unsigned long) c->captured, (unsigned long) lost,
+            (unsigned long) c->overruns, (unsigned long) (erase_end / (ONE_SECOND / 1000)),
+            (unsigned long) ((c->end_tick - c->start_tick) / (ONE_SECOND / 1000)),
+            (unsigned long) nvm.rows,
+            c->end_tick != c->start_tick ? 100.0 * stall_run / (now - erase_end) : 0.0, (unsigned) c->held,
+            (unsigned long) (dump_bytes * 10 * 1000 / baud),
+            (unsigned long) dump_configs, (unsigned long) dump_errors, (unsigned long) dump_max_dt_us);
+
+    return dump_errors || dump_frames != c->captured;
+}
@@ -0,0 +1,29 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  host
+ *  @{
+ *      @file       crc8.c
+ *      @brief      pipeline_crc8 for the tools that do not link pipeline.c
+ *                  (compress.c and rmstream.c need it).
+ */
+#include "pipeline.h"
+
+/**
+ *  @brief  CRC-8 (poly 0x07, init 0), same as the board.
+ *  @param[in]  data, length
+ *  @return     crc
+ */
+BYTE pipeline_crc8 ( const BYTE *data, BYTE length ) {
+
+    BYTE crc = 0, i;
+
+    while (length--){
+        crc ^= *data++;
+        for (i = 0; i < 8; i++)
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+    }
+    return crc;
+}
+
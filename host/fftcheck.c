@@ -0,0 +1,151 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  host
+ *  @{
+ *      @file       fftcheck.c
+ *      @brief      Feeds known tones to the block spectrum and checks the peaks.
+ *      @details    Build on Linux from this directory:
+ *
+ *                  cc -O2 -I.. -o fftcheck fftcheck.c ../fft.c ../scheduler.c ../uart.c ../host_port.c -lm
+ *
+ *                  fft.c runs unmodified. Each case samples a tone (plus a
+ *                  DC offset and a little noise) on one axis at a sample
+ *                  rate and block size, and the strongest peak of that
+ *                  axis must be at the tone frequency folded into 0..fs/2
+ *                  within FREQ_TOL_BIN of a bin, with the tone amplitude
+ *                  within AMP_TOL_PCT. The mains cases put 50 or 60 Hz
+ *                  through the sampling at rates below 100 or 120 Hz, where
+ *                  it shows up at its alias; the two tone case checks the
+ *                  weaker peak as well. The sm cases are single
+ *                  measurements at 100 Hz with the sensor's CMM rate left
+ *                  at its 37.5 Hz default: the block must be scaled with
+ *                  the rate of the stream (pipeline_get_rate), not that
+ *                  one.
+ *
+ *                  One line per case with what was found and
+ *                  fft_block_ticks(), the core timer ticks of the analysis
+ *                  of the block (host clock here: the ratios between block
+ *                  sizes are what carries over). Exit status 1 if a case
+ *                  fails.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "platform.h"
+#include "scheduler.h"
+#include "fft.h"
+#include "pipeline.h"
+
+#define FREQ_TOL_BIN    (0.05)      /**< of fs / N */
+#define AMP_TOL_PCT     (1.0)
+#define NOISE_COUNTS    (20)
+
+static float fs_hz, cmm_hz;
+
+float getRM3100SampleRate ( void ) { return cmm_hz; }
+
+float pipeline_get_rate ( void ) { return fs_hz; }
+
+/** @details One tone, or two. */
+typedef struct {
+    const char *name;
+    float  fs;          /// sample rate, Hz
+    UINT16 n;           /// block size
+    BYTE   axis;
+    double f1, a1;      /// Hz, counts
+    double f2, a2;      /// second tone, a2 = 0 none
+    float  cmm;         /// CMM rate of the sensor, single measurements at fs; 0 = CMM at fs
+}fft_case;
+
+static const fft_case cases[] = {
+    { "tone",       75.0f, 512, 0, 10.0,    8000, 0, 0 },
+    { "off_bin",    75.0f, 128, 1,  3.3,    5000, 0, 0 },
+    { "short",      75.0f,  32, 2, 20.0,   12000, 0, 0 },
+    { "mains50",    75.0f, 512, 0, 50.0,    2000, 0, 0 },
+    { "mains60",    75.0f, 512, 1, 60.0,    2000, 0, 0 },
+    { "mains50",    37.5f, 512, 2, 50.0,    3000, 0, 0 },
+    { "mains60",    37.5f, 128, 0, 60.0,    3000, 0, 0 },
+    { "mains50",     8.0f, 128, 1, 50.0,    1500, 0, 0 },
+    { "mains60",   146.0f, 512, 2, 60.0,    1500, 0, 0 },
+    { "two_tone",  146.0f, 512, 0,  7.7,   10000, 50.0, 800 },
+    { "sm_tone",   100.0f, 512, 1, 10.0,    8000, 0, 0, 37.5f },
+    { "sm_mains",  100.0f, 128, 2, 60.0,    2000, 0, 0, 37.5f },
+};
+
+/** Frequency as sampled at fs, 0..fs/2 */
+static double alias ( double f, double fs ) {
+
+    f = fmod(f, fs);
+    return f > fs / 2 ? fs - f : f;
+}
+
+/** TRUE if the peak is the tone */
+static BOOL match ( const fft_peak *p, double f, double a, double bin, double *df, double *da ) {
+
+    *df = (p->freq_mhz / 1000.0 - f) / bin;
+    *da = (p->amp / 1000.0 - a) * 100 / a;
+    return fabs(*df) <= FREQ_TOL_BIN && fabs(*da) <= AMP_TOL_PCT;
+}
+
+static BOOL run_case ( const fft_case *c ) {
+
+    sensor_xyz raw;
+    fft_result r;
+    double t, v, bin, f1, f2, df, da, df2 = 0, da2 = 0;
+    long *axis[3] = { &raw.x, &raw.y, &raw.z };
+    UINT32 i, seed = 12345;
+    BOOL ok;
+
+    fs_hz  = c->fs;
+    cmm_hz = c->cmm ? c->cmm : c->fs;
+    fft_set_size(c->n);
+    memset(&raw, 0, sizeof(raw));
+    for (i = 0; i < c->n; i++){
+        t = i / (double) c->fs;
+        v = c->a1 * sin(2 * M_PI * c->f1 * t + 0.3) + c->a2 * sin(2 * M_PI * c->f2 * t + 1.1);
+        seed = seed * 1103515245 + 12345;
+        raw.x = raw.y = raw.z = 150000 + (long) ((seed >> 16) % (2 * NOISE_COUNTS + 1)) - NOISE_COUNTS;
+        *axis[c->axis] += (long) lround(v);
+        fft_update(&raw);
+    }
+    while (sched_run_once())
+        ;
+
+    if (fft_get(c->axis, &r)){
+        printf("FAIL %-9s no result\n", c->name);
+        return FALSE;
+    }
+    bin = c->fs / c->n;
+    f1  = alias(c->f1, c->fs);
+    ok  = match(&r.peak[0], f1, c->a1, bin, &df, &da);
+    if (c->a2){
+        f2  = alias(c->f2, c->fs);
+        ok &= match(&r.peak[1], f2, c->a2, bin, &df2, &da2);
+    }
+    printf("%s %-9s fs %6.2f N %3u tone %5.1f Hz -> %7.3f Hz peak %8.3f Hz (%+.3f bin) amp %8.1f (%+.2f%%)",
+           ok ? "ok  " : "FAIL", c->name, c->fs, c->n, c->f1, f1,
+           r.peak[0].freq_mhz / 1000.0, df, r.peak[0].amp / 1000.0, da);
+    if (c->a2)
+        printf(" second %7.3f Hz (%+.3f bin) amp %6.1f (%+.2f%%)", r.peak[1].freq_mhz / 1000.0, df2,
+               r.peak[1].amp / 1000.0, da2);
+    printf(" block_ticks %lu\n", (unsigned long) fft_block_ticks());
+    return ok;
+}
+
+int main ( void ) {
+
+    UINT32 i, fails = 0;
+
+    sched_add("fft", fft_task, EV_FFT | EV_UART_TX, 0);
+    fft_set_report(FALSE);
+
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+        if (!run_case(&cases[i]))
+            fails++;
+
+    printf("FFTCHECK %lu cases %lu failed\n", (unsigned long) i, (unsigned long) fails);
+    return fails != 0;
+}
@@ -0,0 +1,242 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  host
+ *  @{
+ *      @file       gridsim.c
+ *      @brief      Checks the resampler against a known signal sampled like the board does.
+ *      @details    Build on Linux from this directory:
+ *
+ *                  cc -O2 -I.. -o gridsim gridsim.c ../resample.c -lm
+ *
+ *                  gridsim [-s seconds] [-r grid_hz] [-p period_ms] [-b bus_percent]
+ *                          [-e error_percent] [-a amplitude] [-f hz]
+ *
+ *                  The sample instants follow the acquisition task: a
+ *                  single measurement is requested on the first 1 ms
+ *                  scheduler tick at least period_ms (default 10) after the
+ *                  previous one, a few us late; with bus_percent (default 5)
+ *                  a tick is missed because the shared bus is busy, with
+ *                  error_percent (default 0) the read fails. Each axis is
+ *                  a sine of amplitude counts (default 1000, 13 uT at cycle
+ *                  count 200) on a static field, x at f Hz, y at 2f, z at 4f.
+ *                  Without -f, f goes through 0.25 to 16 Hz.
+ *
+ *                  The grid samples (grid_hz, default 100) are compared with
+ *                  the signal at the grid instants: RMS and max error in
+ *                  counts per axis, next to the bound of linear
+ *                  interpolation, A (2 pi f)^2 h^2 / 8 for the longest
+ *                  interval h between good samples, and to the error of taking the samples as
+ *                  measured to be uniform at their mean rate, what the host
+ *                  had to undo before. Then the resampler counters (GRID
+ *                  command) and its cost: host cycles (x86 time stamp
+ *                  counter) and ns per grid sample, push included.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "platform.h"
+#include "resample.h"
+
+#define PI_D        3.14159265358979
+#define TICK_S      (0.001)
+#define BASE        (20000)
+
+UINT32 ReadCoreTimer ( void ) { return 0; }
+
+unsigned int INTDisableInterrupts ( void ) { return 0; }
+
+void INTRestoreInterrupts ( unsigned int status ) { (void)status; }
+
+static double amp = 1000, freq;
+
+/** Field of axis k at t seconds, counts */
+static double signal ( int k, double t ) {
+
+    return BASE * (k + 1) + amp * sin(2 * PI_D * freq * (1 << k) * t + k);
+}
+
+static UINT32 to_tick ( double t ) {
+
+    return (UINT32) (UINT64) fmod(t * ONE_SECOND, 4294967296.0);
+}
+
+static double now_s ( void ) {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static UINT64 cycles ( void ) {
+
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/** Sample instants of the acquisition task; returns the count */
+static long make_times ( double seconds, double period, int bus, int err, double *t, BYTE *flags ) {
+
+    double tick, last = -1;
+    long n = 0;
+
+    srand(3);
+    for (tick = 0; tick < seconds; tick += TICK_S){
+        if (last >= 0 && tick - last < period - 1e-9)
+            continue;
+        if (rand() % 100 < bus)
+            continue;                               // bus busy, next tick
+        t[n]       = tick + (rand() % 20 + 2) * 1e-6;
+        flags[n++] = rand() % 100 < err ? SAMPLE_I2C_ERROR : SAMPLE_OK;
+        last       = tick;
+    }
+    return n;
+}
+
+/** Longest interval between good samples */
+static double longest ( const double *t, const BYTE *flags, long n ) {
+
+    double h = 0, last = -1;
+    long i;
+
+    for (i = 0; i < n; i++){
+        if (flags[i] != SAMPLE_OK)
+            continue;
+        if (last >= 0 && t[i] - last > h)
+            h = t[i] - last;
+        last = t[i];
+    }
+    return h;
+}
+
+/** One run at frequency f; prints a line */
+static void run ( double f, const double *t, const BYTE *flags, long n, double h, int rate, BOOL verbose ) {
+
+    double sum[3] = { 0 }, max[3] = { 0 }, nsum[3] = { 0 }, nmax[3] = { 0 }, e, mean, tg;
+    long i, out = 0, valid = 0;
+    int k;
+    sensor_xyz s, g;
+    UINT32 tick, last = to_tick(t[0]);
+    char line[RESAMPLE_MAX_LINE];
+
+    freq = f;
+    resample_set_rate(rate);
+    mean = (t[n-1] - t[0]) / (n - 1);
+    tg   = t[0];                            // the grid starts at the first sample
+    for (i = 0; i < n; i++){
+        s.x = lround(signal(0, t[i]));
+        s.y = lround(signal(1, t[i]));
+        s.z = lround(signal(2, t[i]));
+        s.flags = flags[i];
+        resample_push(&s, to_tick(t[i]));
+        while (!resample_pull(&g, &tick)){
+            tg  += (double) (UINT32) (tick - last) / ONE_SECOND;
+            last = tick;
+            for (k = 0; k < 3; k++){
+                e = fabs((k == 0 ? g.x : k == 1 ? g.y : g.z) - signal(k, tg));
+                sum[k] += e * e;
+                if (e > max[k])
+                    max[k] = e;
+            }
+            out++;
+        }
+        /* as measured, taken as uniform at the mean rate */
+        if (flags[i] == SAMPLE_OK){
+            for (k = 0; k < 3; k++){
+                e = fabs((k == 0 ? s.x : k == 1 ? s.y : s.z) - signal(k, t[0] + i * mean));
+                nsum[k] += e * e;
+                if (e > nmax[k])
+                    nmax[k] = e;
+            }
+            valid++;
+        }
+    }
+    printf("%6.2f Hz", f);
+    for (k = 0; k < 3; k++)
+        printf("  %6.2f %7.2f (%7.2f) %8.1f", sqrt(sum[k] / out), max[k],
+               amp * pow(2 * PI_D * f * (1 << k) * h, 2) / 8, sqrt(nsum[k] / valid));
+    printf("\n");
+    if (verbose){
+        resample_format(line);
+        printf("%s", line);
+    }
+}
+
+int main ( int argc, char **argv ) {
+
+    const double sweep[] = { 0.25, 0.5, 1, 2, 4, 8, 16 };
+    double seconds = 600, period = 10, f = 0, h, t0, *t;
+    int rate = 100, bus = 5, err = 0, opt;
+    long n, i, reps, out;
+    UINT64 c0;
+    BYTE *flags;
+    sensor_xyz s, g;
+    UINT32 tick;
+    unsigned k;
+
+    while ((opt = getopt(argc, argv, "s:r:p:b:e:a:f:")) != -1){
+        switch (opt){
+            case 's': seconds = atof(optarg); break;
+            case 'r': rate    = atoi(optarg); break;
+            case 'p': period  = atof(optarg); break;
+            case 'b': bus     = atoi(optarg); break;
+            case 'e': err     = atoi(optarg); break;
+            case 'a': amp     = atof(optarg); break;
+            case 'f': f       = atof(optarg); break;
+            default:
+                fprintf(stderr, "usage: gridsim [-s seconds] [-r grid_hz] [-p period_ms] [-b bus_percent] [-e error_percent] [-a amplitude] [-f hz]\n");
+                return 1;
+        }
+    }
+    n     = (long) (seconds / TICK_S);
+    t     = malloc(n * sizeof(double));
+    flags = malloc(n);
+    if (n <= 1 || !t || !flags || rate <= 0 || rate > RESAMPLE_MAX_RATE || period <= 0){
+        fprintf(stderr, "gridsim: bad arguments\n");
+        return 1;
+    }
+    n = make_times(seconds, period * 1e-3, bus, err, t, flags);
+    h = longest(t, flags, n);
+    printf("%ld samples, mean interval %.3f ms, longest %.1f ms, grid %d Hz\n",
+           n, (t[n-1] - t[0]) / (n - 1) * 1e3, h * 1e3, rate);
+    printf("          x: rms     max   (bound)  uniform  y (2f) ...                     z (4f) ...\n");
+    if (f > 0)
+        run(f, t, flags, n, h, rate, TRUE);
+    else
+        for (k = 0; k < sizeof(sweep) / sizeof(sweep[0]); k++)
+            run(sweep[k], t, flags, n, h, rate, k + 1 == sizeof(sweep) / sizeof(sweep[0]));
+
+    /* cost: the same stream, many times, nothing else in the loop */
+    freq = 1;
+    reps = 20;
+    out  = 0;
+    resample_set_rate(rate);
+    t0 = now_s();
+    c0 = cycles();
+    while (reps--){
+        resample_reset();
+        for (i = 0; i < n; i++){
+            s.x = s.y = s.z = BASE + (i & 1023);
+            s.flags = flags[i];
+            resample_push(&s, to_tick(t[i]));
+            while (!resample_pull(&g, &tick))
+                out++;
+        }
+    }
+    c0 = cycles() - c0;
+    t0 = now_s() - t0;
+    printf("GRID cost %.1f host cycles, %.1f ns per grid sample (%ld samples)\n",
+           c0 ? (double) c0 / out : NAN, t0 / out * 1e9, out);
+    return 0;
+}
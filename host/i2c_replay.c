@@ -0,0 +1,90 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  host
+ *  @{
+ *      @file       i2c_replay.c
+ *      @brief      i2c.h on the host: an RM3100 register file fed from a
+ *                  recording.
+ */
+#include <string.h>
+#include "i2c_replay.h"
+
+static BYTE      regs[256];
+static i2c_stats stats;
+
+void i2c_init ( I2C_MODULE i2cnum, i2cmode mode, BYTE address ) {
+
+    (void) i2cnum; (void) mode; (void) address;
+    memset(regs, 0, sizeof(regs));
+    regs[REVID_REG] = REPLAY_REVID;
+}
+
+int i2c_write ( unsigned char slave_addr, unsigned char reg_addr, unsigned char length, unsigned char const *data ) {
+
+    if (slave_addr != RM3100_ADDRESS_00){
+        stats.failures++;
+        return I2C_ERR_NACK;
+    }
+    while (length--){
+        regs[reg_addr] = *data++;
+        if (reg_addr == BIST_REG && (regs[BIST_REG] & STE_ON))
+            regs[BIST_REG] |= BIST_MASK;                    // all axes pass
+        if ((reg_addr == BIST_REG || reg_addr == POLL_REG) && (regs[BIST_REG] & STE_ON))
+            regs[STATUS_REG] |= STATUS_MASK;                // self test result ready
+        reg_addr++;
+    }
+    return I2C_OK;
+}
+
+int i2c_read ( unsigned char slave_addr, unsigned char reg_addr, unsigned char length, unsigned char *data ) {
+
+    if (slave_addr != RM3100_ADDRESS_00){
+        stats.failures++;
+        return I2C_ERR_NACK;
+    }
+    if (reg_addr == MX)
+        regs[STATUS_REG] &= ~STATUS_MASK;
+    while (length--)
+        *data++ = regs[reg_addr++];
+    return I2C_OK;
+}
+
+int i2c_write_attempt ( unsigned char slave_addr, unsigned char reg_addr, unsigned char length, unsigned char const *data, BYTE attempt ) {
+
+    (void) attempt;
+    return i2c_write(slave_addr, reg_addr, length, data);
+}
+
+int i2c_read_attempt ( unsigned char slave_addr, unsigned char reg_addr, unsigned char length, unsigned char *data, BYTE attempt ) {
+
+    (void) attempt;
+    return i2c_read(slave_addr, reg_addr, length, data);
+}
+
+void i2c_set_retry_policy ( BYTE retries, UINT32 timeout_us ) { (void) retries; (void) timeout_us; }
+
+BYTE i2c_get_max_retries ( void ) { return 0; }
+
+void i2c_recover ( void ) { stats.recoveries++; }
+
+const i2c_stats * i2c_get_stats ( void ) { return &stats; }
+
+/**
+ *  @brief  Loads the next measurement and raises DRDY.
+ *  @param[in]  raw - counts
+ *  @return     none
+ */
+void i2c_replay_sample ( const sensor_xyz *raw ) {
+
+    const long v[3] = { raw->x, raw->y, raw->z };
+    BYTE i;
+
+    for (i = 0; i < 3; i++){
+        regs[MX + 3*i]     = v[i] >> 16;
+        regs[MX + 3*i + 1] = v[i] >> 8;
+        regs[MX + 3*i + 2] = v[i];
+    }
+    regs[STATUS_REG] |= STATUS_MASK;
+}
@@ -0,0 +1,27 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  host
+ *  @{
+ *      @file       i2c_replay.h
+ *      @brief      i2c.h on the host: an RM3100 register file fed from a
+ *                  recording.
+ *      @details    Replaces i2c.c so rm3100.c runs unmodified on Linux.
+ *                  Writes land in a 256 byte register file and reads come
+ *                  back from it. i2c_replay_sample loads the next recorded
+ *                  measurement in MX..MZ and sets DRDY in STATUS; reading MX
+ *                  clears it, like the sensor. A self test (STE in BIST)
+ *                  always passes.
+ */
+#ifndef I2C_REPLAY_H
+#define	I2C_REPLAY_H
+
+#include "i2c.h"
+#include "rm3100.h"
+
+#define REPLAY_REVID        0x22
+
+void i2c_replay_sample ( const sensor_xyz *raw );
+
+#endif	/* I2C_REPLAY_H */
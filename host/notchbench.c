@@ -0,0 +1,245 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  host
+ *  @{
+ *      @file       notchbench.c
+ *      @brief      Rejection and cost of the mains notch filter over a sweep
+ *                  of the mains frequency.
+ *      @details    Build on Linux from this directory:
+ *
+ *                  cc -O2 -I.. -o notchbench notchbench.c ../notch.c ../fft.c ../scheduler.c ../uart.c ../host_port.c -lm
+ *
+ *                  notchbench [-n nominal_hz] [-r rate_hz] [-d drift_mhz] [-s step_mhz]
+ *
+ *                  notch.c and fft.c run unmodified, the spectrum on the
+ *                  unfiltered samples for the tracking as in the firmware.
+ *                  The raw stream is a DC field, a 0.37 Hz signal of 1000
+ *                  counts and mains pickup of 200, 60 and 20 counts at the
+ *                  fundamental and the 2nd and 3rd harmonics, with
+ *                  different phases on each axis. The mains frequency is
+ *                  swept from nominal - drift to nominal + drift (default
+ *                  50 Hz, 500 mHz, in 250 mHz steps) at each sample rate
+ *                  (default 600, 300, 150 and 75 Hz in CMM and 100 Hz of
+ *                  single measurements, or the one given in CMM). In single
+ *                  measurements the sensor's CMM rate stays at its 37.5 Hz
+ *                  default; the notches must follow the rate of the stream
+ *                  (pipeline_get_rate), not that one. At 100 Hz the 50 Hz
+ *                  mains folds onto DC and fs/2 and gets no notch; -n 60
+ *                  is the case that exercises it.
+ *
+ *                  After 10 spectrum blocks of tracking, the amplitude
+ *                  left at each aliased harmonic is fitted over the next
+ *                  40 s, worst axis. One line per point:
+ *
+ *                  fs r mode m mains f tracked t notches n h1 d1 h2 d2 h3 d3
+ *                  dB signal g dB ns n cycles c
+ *
+ *                  m cmm or sm, d1..d3 the rejection ("-" for a harmonic folding near
+ *                  DC or fs/2, left alone by design), g the gain of the 0.37 Hz
+ *                  signal, n the time of notch_filter per sample (3 axes,
+ *                  fastest of 5 runs over the window) and c the same in
+ *                  time stamp counter cycles on x86 (0 elsewhere).
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "platform.h"
+#include "scheduler.h"
+#include "notch.h"
+#include "fft.h"
+#include "pipeline.h"
+
+#define HARMONICS       (3)
+#define FIT_SECONDS     (40)
+#define FIT_MAX         (FIT_SECONDS * 600)
+#define TIMED_RUNS      (5)
+#define SETTLE_BLOCKS   (10)
+#define FFT_N           (512)
+#define SIGNAL_HZ       (0.37)
+#define SIGNAL_COUNTS   (1000.0)
+#define DC_COUNTS       (150000)
+#define PI              (3.14159265358979323846)
+
+static const double mains_counts[HARMONICS] = { 200, 60, 20 };
+
+static float  fs_hz, cmm_hz;
+static sensor_xyz in[FIT_MAX], out[FIT_MAX], scratch[FIT_MAX];
+static UINT32 fit_n;
+
+float getRM3100SampleRate ( void ) { return cmm_hz; }
+
+float pipeline_get_rate ( void ) { return fs_hz; }
+
+static UINT64 cycles ( void ) {
+
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static double now_ns ( void ) {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/** Raw sample i of the synthetic stream */
+static void make_sample ( UINT32 i, double mains_hz, sensor_xyz *raw ) {
+
+    long *axis[3] = { &raw->x, &raw->y, &raw->z };
+    double t = i / (double) fs_hz, v;
+    BYTE a, h;
+
+    memset(raw, 0, sizeof(*raw));
+    for (a = 0; a < 3; a++){
+        v = DC_COUNTS + SIGNAL_COUNTS * sin(2 * PI * SIGNAL_HZ * t + a);
+        for (h = 0; h < HARMONICS; h++)
+            v += mains_counts[h] * sin(2 * PI * (h + 1) * mains_hz * t + 0.7 * a + 1.3 * h);
+        *axis[a] = lround(v);
+    }
+}
+
+/** Amplitude of the component at f in the fitted window, one axis: mean
+ *  removed and Hann weighted, so the DC field and the other tones do not
+ *  leak into it. Taken the same way at the input and the output. */
+static double fit ( const sensor_xyz *x, BYTE a, UINT32 first, double f ) {
+
+    double s = 0, c = 0, sw = 0, mean = 0, t, v, w;
+    UINT32 i;
+
+    for (i = 0; i < fit_n; i++)
+        mean += a == 0 ? x[i].x : a == 1 ? x[i].y : x[i].z;
+    mean /= fit_n;
+    for (i = 0; i < fit_n; i++){
+        t  = (first + i) / (double) fs_hz;
+        w  = 0.5 - 0.5 * cos(2 * PI * i / fit_n);
+        v  = (a == 0 ? x[i].x : a == 1 ? x[i].y : x[i].z) - mean;
+        s += w * v * sin(2 * PI * f * t);
+        c += w * v * cos(2 * PI * f * t);
+        sw += w;
+    }
+    return 2 * sqrt(s * s + c * c) / sw;
+}
+
+/** Frequency as sampled at fs, 0..fs/2 */
+static double alias ( double f, double fs ) {
+
+    f = fmod(f, fs);
+    return f > fs / 2 ? fs - f : f;
+}
+
+static void run_point ( float fs, float cmm, UINT16 nominal, double mains_hz ) {
+
+    sensor_xyz raw;
+    UINT32 i, settle = SETTLE_BLOCKS * FFT_N;
+    double worst[HARMONICS], gain = 0, fa, r, t0, ns = 1e30;
+    UINT64 c0, cyc = 0;
+    BYTE a, h, k;
+
+    fs_hz  = fs;
+    cmm_hz = cmm ? cmm : fs;
+    fit_n = (UINT32) (FIT_SECONDS * fs);
+    fft_set_size(FFT_N);
+    notch_set_mains(nominal);
+
+    for (i = 0; i < settle; i++){
+        make_sample(i, mains_hz, &raw);
+        fft_update(&raw);
+        notch_filter(&raw);
+        while (sched_run_once())
+            ;
+    }
+
+    /* the inputs are made first so only the filter is timed; the first
+       run is the one fitted, the fastest of the runs is kept */
+    for (i = 0; i < fit_n; i++){
+        make_sample(settle + i, mains_hz, &in[i]);
+        out[i] = in[i];
+    }
+    for (k = 0; k < TIMED_RUNS; k++){
+        if (k)
+            memcpy(scratch, in, fit_n * sizeof(sensor_xyz));
+        t0 = now_ns();
+        c0 = cycles();
+        for (i = 0; i < fit_n; i++)
+            notch_filter(k ? &scratch[i] : &out[i]);
+        c0 = cycles() - c0;
+        t0 = now_ns() - t0;
+        if (t0 < ns){
+            ns  = t0;
+            cyc = c0;
+        }
+    }
+
+    for (h = 0; h < HARMONICS; h++){
+        worst[h] = 1e9;
+        fa = alias((h + 1) * mains_hz, fs);
+        if (fa * 1000 < NOTCH_MIN_MHZ || fa * 1000 + NOTCH_MIN_MHZ > fs * 500)
+            continue;
+        for (a = 0; a < 3; a++){
+            r = 20 * log10(fit(in, a, settle, fa) / fit(out, a, settle, fa));
+            if (r < worst[h])
+                worst[h] = r;
+        }
+    }
+    for (a = 0; a < 3; a++)
+        gain += 20 * log10(fit(out, a, settle, SIGNAL_HZ) / fit(in, a, settle, SIGNAL_HZ)) / 3;
+
+    printf("fs %6.1f mode %s mains %6.3f tracked %6.3f notches %u", fs, cmm ? "sm " : "cmm", mains_hz,
+           notch_get_mains() / 1000.0, notch_count());
+    for (h = 0; h < HARMONICS; h++)
+        if (worst[h] >= 1e9)
+            printf(" h%u     -", h + 1);
+        else
+            printf(" h%u %5.1f", h + 1, worst[h]);
+    printf(" dB signal %+.3f dB ns %.0f cycles %.0f\n", gain, ns / fit_n, (double) cyc / fit_n);
+}
+
+int main ( int argc, char **argv ) {
+
+    static const float rates[][2] = { { 600, 0 }, { 300, 0 }, { 150, 0 }, { 75, 0 }, { 100, 37.5f } };   // fs, CMM rate in sm
+    UINT32 nominal = 50, drift = 500, step = 250, rate = 0;
+    INT32 d;
+    BYTE k;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:d:s:")) != -1){
+        switch (opt){
+            case 'n': nominal = strtoul(optarg, NULL, 0); break;
+            case 'r': rate    = strtoul(optarg, NULL, 0); break;
+            case 'd': drift   = strtoul(optarg, NULL, 0); break;
+            case 's': step    = strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: notchbench [-n nominal_hz] [-r rate_hz] [-d drift_mhz] [-s step_mhz]\n");
+                return 1;
+        }
+    }
+    if (nominal < 45 || nominal > 65 || !step || drift > NOTCH_TRACK_MHZ){
+        fprintf(stderr, "notchbench: bad option\n");
+        return 1;
+    }
+
+    sched_add("fft", fft_task, EV_FFT | EV_UART_TX, 0);
+    fft_set_report(FALSE);
+
+    for (k = 0; k < sizeof(rates) / sizeof(rates[0]); k++){
+        if (rate && k)
+            break;
+        for (d = -(INT32) drift; d <= (INT32) drift; d += step)
+            run_point(rate ? rate : rates[k][0], rate ? 0 : rates[k][1], nominal, nominal + d / 1000.0);
+    }
+    return 0;
+}
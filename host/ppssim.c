@@ -0,0 +1,183 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  host
+ *  @{
+ *      @file       ppssim.c
+ *      @brief      Runs the PPS discipline against a simulated pulse source.
+ *      @details    Build on Linux from this directory:
+ *
+ *                  cc -O2 -I.. -o ppssim ppssim.c ../pps.c ../scheduler.c -lm
+ *
+ *                  ppssim [-s seconds] [-a ppm_a] [-b ppm_b] [-j jitter_ns]
+ *                         [-l latency_ns] [-d drop_percent] [-g glitch_percent]
+ *
+ *                  Two boards with oscillators off by ppm_a and ppm_b
+ *                  (default +30 and -45, both wandering by 2 ppm over 5
+ *                  minutes, as with temperature) see the same pulse, whose
+ *                  edges have jitter_ns RMS of jitter (default 50, a GPS
+ *                  receiver) and reach the core timer capture after 0 to
+ *                  latency_ns of interrupt latency (default 1000). Edges are
+ *                  dropped or glitches added at the given rates.
+ *
+ *                  pps.c runs unmodified on a virtual core timer per board.
+ *                  Both boards time stamp the same instants (every 10 ms
+ *                  plus some randomness); the report gives, while both are
+ *                  locked, the error of each against the true time and the
+ *                  disagreement between the two, next to the free running
+ *                  disagreement (core timer / ONE_SECOND), and each board's
+ *                  PPS statistics.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+#include "platform.h"
+#include "pps.h"
+#include "scheduler.h"
+
+#define PI_D        3.14159265358979
+#define STEP_S      (0.01)
+
+static UINT32 now;                          // virtual core timer of the board running
+
+UINT32 ReadCoreTimer ( void ) { return now; }
+
+unsigned int INTDisableInterrupts ( void ) { return 0; }
+
+void INTRestoreInterrupts ( unsigned int status ) { (void)status; }
+
+/** Core timer of a board at true time t */
+static UINT32 board_tick ( double ppm, double t ) {
+
+    /* rate (1 + ppm + 2 sin(2 pi t / 300)) 1e-6, integrated */
+    double ticks = ONE_SECOND * (t * (1 + ppm * 1e-6) + 2e-6 * 300 / (2 * PI_D) * (1 - cos(2 * PI_D * t / 300)));
+
+    return (UINT32) (UINT64) fmod(ticks, 4294967296.0);
+}
+
+/** Sample instant i, the same for both boards */
+static double sample_time ( long i ) {
+
+    return i * STEP_S + (i * 7919 % 1000) * 1e-6;
+}
+
+static double gauss ( double sigma ) {
+
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0), v = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+    return sigma * sqrt(-2 * log(u)) * cos(2 * PI_D * v);
+}
+
+/**
+ *  Runs one board over the same pulse train and sample instants (same seed).
+ *  @return time stamps in us (NAN while unlocked) in ts[], free running in fr[]
+ */
+static void run_board ( double ppm, double seconds, double jitter, double latency,
+                        int drop, int glitch, unsigned seed, double *ts, double *fr, char *report ) {
+
+    long i, n = (long) (seconds / STEP_S);
+    double t, next_edge = 1, edge;
+    UINT32 last = 0, lat = seed;
+    UINT64 local = 0;
+
+    srand(7);                                           // the same pulse for both
+    pps_set_mode(PPS_SYNC);
+    now = board_tick(ppm, 0);
+    for (i = 0; i < n; i++){
+        t = sample_time(i);
+
+        while (next_edge <= t){
+            lat  = lat * 1103515245 + 12345;            // interrupt latency of this board
+            edge = next_edge + gauss(jitter * 1e-9) + (lat >> 16) % 1000 / 1000.0 * latency * 1e-9;
+            if (rand() % 100 >= drop){
+                now = board_tick(ppm, edge);
+                pps_edge(now);
+            }
+            if (rand() % 100 < glitch){
+                now = board_tick(ppm, edge + (rand() % 900 + 50) * 1e-3);
+                pps_edge(now);
+            }
+            next_edge += 1;
+            now = board_tick(ppm, next_edge - 1 + 1e-4);    // the task runs shortly after
+            pps_task(EV_PPS);
+        }
+
+        now = board_tick(ppm, t);
+        if (i)
+            local += now - last;
+        last = now;
+        pps_task(EV_SECOND);
+        ts[i] = pps_locked() ? (double) pps_time_us(now) : NAN;
+        fr[i] = (double) local / (ONE_SECOND / 1000000);
+    }
+    pps_format(report);
+}
+
+/** Difference of two wrapping us counters */
+static double wrap_diff ( double a, double b ) {
+
+    return (double) (INT32) ((UINT32) (INT64) a - (UINT32) (INT64) b);
+}
+
+int main ( int argc, char **argv ) {
+
+    double seconds = 600, ppm_a = 30, ppm_b = -45, jitter = 50, latency = 1000, t, d;
+    double *ta, *tb, *fa, *fb, sum_a = 0, sum_ab = 0, max_a = 0, max_ab = 0, max_fr = 0;
+    int drop = 0, glitch = 0, opt;
+    long i, n, used = 0;
+    char ra[PPS_MAX_LINE], rb[PPS_MAX_LINE];
+
+    while ((opt = getopt(argc, argv, "s:a:b:j:l:d:g:")) != -1){
+        switch (opt){
+            case 's': seconds = atof(optarg); break;
+            case 'a': ppm_a   = atof(optarg); break;
+            case 'b': ppm_b   = atof(optarg); break;
+            case 'j': jitter  = atof(optarg); break;
+            case 'l': latency = atof(optarg); break;
+            case 'd': drop    = atoi(optarg); break;
+            case 'g': glitch  = atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: ppssim [-s seconds] [-a ppm_a] [-b ppm_b] [-j jitter_ns] [-l latency_ns] [-d drop_percent] [-g glitch_percent]\n");
+                return 1;
+        }
+    }
+    n  = (long) (seconds / STEP_S);
+    ta = malloc(n * sizeof(double));
+    tb = malloc(n * sizeof(double));
+    fa = malloc(n * sizeof(double));
+    fb = malloc(n * sizeof(double));
+    if (n <= 0 || !ta || !tb || !fa || !fb)
+        return 1;
+
+    run_board(ppm_a, seconds, jitter, latency, drop, glitch, 1, ta, fa, ra);
+    run_board(ppm_b, seconds, jitter, latency, drop, glitch, 2, tb, fb, rb);
+
+    for (i = 0; i < n; i++){
+        t = sample_time(i);
+        d = fabs(fa[i] - fb[i]);
+        if (d > max_fr)
+            max_fr = d;
+        if (isnan(ta[i]) || isnan(tb[i]))
+            continue;
+        /* the first edge, at t = 1 s, is time 0 */
+        d = fabs(wrap_diff(ta[i], fmod((t - 1) * 1e6, 4294967296.0)));
+        sum_a += d * d;
+        if (d > max_a)
+            max_a = d;
+        d = fabs(wrap_diff(ta[i], tb[i]));
+        sum_ab += d * d;
+        if (d > max_ab)
+            max_ab = d;
+        used++;
+    }
+    printf("A %s", ra);
+    printf("B %s", rb);
+    if (used)
+        printf("SYNC %ld samples: A vs true rms %.3f max %.3f us, A vs B rms %.3f max %.3f us, free running max %.0f us\n",
+               used, sqrt(sum_a / used), max_a, sqrt(sum_ab / used), max_ab, max_fr);
+    else
+        printf("SYNC never locked\n");
+    return 0;
+}
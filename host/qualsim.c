@@ -0,0 +1,321 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  host
+ *  @{
+ *      @file       qualsim.c
+ *      @brief      Injects sensor faults into a simulated stream and checks the quality flags.
+ *      @details    Build on Linux from this directory:
+ *
+ *                  cc -O2 -I.. -o qualsim qualsim.c ../quality.c -lm
+ *
+ *                  qualsim [-s seconds] [-g gain] [-b field_nt] [-w noise_nt]
+ *                          [-r rotation_rad_s] [-e events_per_minute]
+ *
+ *                  A field of field_nt (default 50000) turning at rotation
+ *                  rad/s (default 0.5) is sampled every 10 to 11 ms at gain
+ *                  counts/uT (default 75, cycle count 200) with noise_nt
+ *                  RMS of noise (default 20). Faults are injected at random
+ *                  (default 6 a minute), one at a time:
+ *
+ *                  spike       one axis off by 5 to 500 uT for one sample
+ *                  stuck       the same reading for 30 samples
+ *                  saturated   an axis at the 24 bits limit for 3 samples
+ *                  magnet      a disturbance of 20 uT, ramped in and out at
+ *                              40 uT/s (under the slew limit), held 1 s
+ *                  step        one axis 30 uT off for 2 s, in and out at once
+ *                  i2c         read failed
+ *
+ *                  quality.c runs unmodified with the norm check at
+ *                  field_nt, twice: Hampel filter off and on. For each fault
+ *                  the report gives the samples it spoilt and the share
+ *                  flagged with the expected flag (magnet: samples clearly
+ *                  beyond the tolerance, step: samples flagged per edge),
+ *                  the flags on the magnet samples within the tolerance
+ *                  and on the QUALITY_HAMPEL_N samples after a fault, while
+ *                  the Hampel window still holds it, then the flags raised
+ *                  on clean samples and the output error on the spikes. Last the cost, host cycles (x86 time stamp
+ *                  counter) per sample with every check on.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "platform.h"
+#include "quality.h"
+
+#define PI_D        3.14159265358979
+#define STEP_S      (0.01)
+
+enum { F_CLEAN, F_SPIKE, F_STUCK, F_SAT, F_MAGNET, F_STEP, F_I2C, F_COUNT };
+
+static const char * const fault_name[F_COUNT] = { "clean", "spike", "stuck", "saturated", "magnet", "step", "i2c" };
+static const BYTE fault_flag[F_COUNT] = { 0, SAMPLE_JUMP | SAMPLE_REPLACED, SAMPLE_STUCK, SAMPLE_SATURATED,
+                                          SAMPLE_NORM, SAMPLE_JUMP | SAMPLE_REPLACED, SAMPLE_I2C_ERROR };
+
+static float gain = 75;
+
+UINT32 ReadCoreTimer ( void ) { return 0; }
+
+unsigned int INTDisableInterrupts ( void ) { return 0; }
+
+void INTRestoreInterrupts ( unsigned int status ) { (void)status; }
+
+const rm3100_epoch * RM3100_getEpoch ( BYTE epoch ) {
+
+    static rm3100_epoch e;
+
+    (void)epoch;
+    e.gain = gain;
+    return &e;
+}
+
+/** No calibration: field as read */
+float pipeline_field_norm2 ( const sensor_xyz *raw ) {
+
+    float x = raw->x / gain, y = raw->y / gain, z = raw->z / gain;
+
+    return x * x + y * y + z * z;
+}
+
+static double gauss ( double sigma ) {
+
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0), v = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+    return sigma * sqrt(-2 * log(u)) * cos(2 * PI_D * v);
+}
+
+static UINT64 cycles ( void ) {
+
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/** One simulated sample */
+typedef struct {
+    sensor_xyz raw;     /// as read
+    double     truth[3];/// field without fault, counts
+    UINT32     t;
+    BYTE       fault;   /// F_*
+    BOOL       clear;   /// magnet: clearly beyond the tolerance, or clearly within
+    BOOL       within;  /// magnet: within the tolerance
+    BOOL       edge;    /// step: first sample of an edge
+}sim_sample;
+
+/** Builds the stream; returns the count */
+static long make_stream ( sim_sample *s, long n, double field, double noise, double rot, double rate, double tol ) {
+
+    long i, left = 0;
+    int fault = F_CLEAN, axis = 0, k;
+    double t = 0, b[3], off[3] = { 0 }, mag = 0, step = 0, spike, dev;
+    sensor_xyz held = { 0 };
+
+    srand(7);
+    for (i = 0; i < n; i++){
+        t += STEP_S + (rand() % 1000) * 1e-6;
+        b[0] = field * cos(rot * t) * 0.6;
+        b[1] = field * sin(rot * t) * 0.6;
+        b[2] = field * 0.8;
+        s[i].t     = (UINT32) (UINT64) fmod(t * ONE_SECOND, 4294967296.0);
+        s[i].fault = F_CLEAN;
+        s[i].clear  = TRUE;
+        s[i].within = FALSE;
+        s[i].edge   = FALSE;
+
+        if (!left && fault == F_CLEAN && i > 100 && rand() < rate * RAND_MAX){
+            fault = 1 + rand() % (F_COUNT - 1);
+            axis  = rand() % 3;
+            left  = fault == F_STUCK ? 30 : fault == F_SAT ? 3 : fault == F_MAGNET ? 150 : fault == F_STEP ? 200 : 1;
+            held  = s[i-1].raw;
+            s[i].edge = fault == F_STEP;
+        }
+
+        /* disturbances that change the field itself */
+        if (fault == F_MAGNET){
+            if (left > 100)
+                mag += 20000.0 / 50;
+            else if (left <= 50)
+                mag -= 20000.0 / 50;
+        }
+        else
+            mag = 0;
+        step = fault == F_STEP ? 30000 : 0;
+        for (k = 0; k < 3; k++)
+            off[k] = (k == axis ? mag + step : 0);
+        for (k = 0; k < 3; k++)
+            s[i].truth[k] = (b[k] + off[k]) / 1000 * gain;
+        s[i].raw.x = lround(s[i].truth[0] + gauss(noise / 1000 * gain));
+        s[i].raw.y = lround(s[i].truth[1] + gauss(noise / 1000 * gain));
+        s[i].raw.z = lround(s[i].truth[2] + gauss(noise / 1000 * gain));
+        s[i].raw.flags = SAMPLE_OK;
+        s[i].raw.epoch = 0;
+
+        switch (left ? fault : F_CLEAN){
+            case F_SPIKE:
+                spike = (5 + rand() % 496) * gain * (rand() & 1 ? 1 : -1);
+                if (axis == 0) s[i].raw.x += spike;
+                else if (axis == 1) s[i].raw.y += spike;
+                else s[i].raw.z += spike;
+                break;
+            case F_STUCK:
+                s[i].raw = held;
+                break;
+            case F_SAT:
+                if (axis == 0) s[i].raw.x = 0x7FFFFF;
+                else if (axis == 1) s[i].raw.y = -0x800000;
+                else s[i].raw.z = 0x7FFFFF;
+                break;
+            case F_I2C:
+                s[i].raw.x = s[i].raw.y = s[i].raw.z = 0;
+                s[i].raw.flags = SAMPLE_I2C_ERROR;
+                break;
+            default:
+                break;
+        }
+        if (left){
+            s[i].fault = fault;
+            if (fault == F_MAGNET){
+                dev = fabs(sqrt(s[i].truth[0] * s[i].truth[0] + s[i].truth[1] * s[i].truth[1]
+                                + s[i].truth[2] * s[i].truth[2]) / gain * 1000 - field);
+                s[i].clear = fabs(dev - tol) > 5 * noise;
+                s[i].within = dev < tol;
+            }
+            if (!--left){
+                if (fault == F_STEP && i + 1 < n)
+                    s[i+1].edge = TRUE;     // back at once: second edge
+                fault = F_CLEAN;
+            }
+        }
+    }
+    return n;
+}
+
+/** Runs quality.c over the stream and prints the report */
+static void run ( const sim_sample *s, long n, BOOL hampel ) {
+
+    long inj[F_COUNT] = { 0 }, hit[F_COUNT] = { 0 }, fp[8] = { 0 }, edges = 0, edge_flags = 0, i, spikes = 0;
+    long within = 0, within_norm = 0, within_repl = 0, after = 0, after_repl = 0, since = n, edge_left = 0;
+    double err_in = 0, err_out = 0, e;
+    char line[QUALITY_MAX_LINE];
+    sensor_xyz raw;
+    BYTE flags;
+    int f, b;
+
+    quality_reset();
+    quality_set_hampel(hampel);
+    for (i = 0; i < n; i++){
+        raw   = s[i].raw;
+        flags = quality_check(&raw, s[i].t) | (raw.flags & SAMPLE_I2C_ERROR);
+        f     = s[i].fault;
+        since = f == F_CLEAN ? since + 1 : 0;
+        if (s[i].edge){
+            edges++;
+            edge_left = 2 * QUALITY_HAMPEL_N;
+        }
+        if (edge_left){
+            edge_left--;
+            edge_flags += (flags & (SAMPLE_JUMP | SAMPLE_REPLACED)) != 0;
+            continue;
+        }
+        if (f == F_STEP)
+            continue;
+        if (s[i].within){
+            within++;
+            within_norm += (flags & SAMPLE_NORM) != 0;
+            within_repl += (flags & SAMPLE_REPLACED) != 0;
+            continue;
+        }
+        if (f == F_CLEAN && since <= QUALITY_HAMPEL_N){
+            after++;                        // the window still holds the fault
+            after_repl += (flags & SAMPLE_REPLACED) != 0;
+            continue;
+        }
+        if (!s[i].clear)
+            continue;
+        inj[f]++;
+        if (f == F_CLEAN){
+            for (b = 0; b < 8; b++)
+                fp[b] += (flags >> b) & 1;
+        }
+        else if (flags & fault_flag[f])
+            hit[f]++;
+        if (f == F_SPIKE){
+            e = fabs(s[i].raw.x - s[i].truth[0]) + fabs(s[i].raw.y - s[i].truth[1]) + fabs(s[i].raw.z - s[i].truth[2]);
+            err_in += e * e;
+            e = fabs(raw.x - s[i].truth[0]) + fabs(raw.y - s[i].truth[1]) + fabs(raw.z - s[i].truth[2]);
+            err_out += e * e;
+            spikes++;
+        }
+    }
+
+    printf("Hampel %s\n", hampel ? "on" : "off");
+    for (f = 1; f < F_COUNT; f++)
+        if (f != F_STEP)
+            printf("  %-10s %7ld samples %6.2f %% flagged\n", fault_name[f], inj[f], inj[f] ? 100.0 * hit[f] / inj[f] : 0);
+    printf("  %-10s %7ld edges   %6.2f samples flagged per edge\n", "step", edges, edges ? (double) edge_flags / edges : 0);
+    printf("  %-10s %7ld samples within the tolerance, norm %ld replaced %ld\n", "magnet", within, within_norm, within_repl);
+    printf("  %-10s %7ld samples after a fault, replaced %ld\n", "recovery", after, after_repl);
+    printf("  %-10s %7ld samples, false flags: sat %ld stuck %ld jump %ld norm %ld replaced %ld\n", "clean",
+           inj[F_CLEAN], fp[2], fp[3], fp[4], fp[5], fp[6]);
+    if (spikes)
+        printf("  spike error %.1f uT RMS in, %.1f uT RMS out\n", sqrt(err_in / spikes) / gain, sqrt(err_out / spikes) / gain);
+    quality_format(line);
+    printf("  %s", line);
+}
+
+int main ( int argc, char **argv ) {
+
+    double seconds = 3600, field = 50000, noise = 20, rot = 0.5, events = 6, tol;
+    long n, i, reps;
+    sim_sample *s;
+    sensor_xyz raw;
+    UINT64 c0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:g:b:w:r:e:")) != -1){
+        switch (opt){
+            case 's': seconds = atof(optarg); break;
+            case 'g': gain    = atof(optarg); break;
+            case 'b': field   = atof(optarg); break;
+            case 'w': noise   = atof(optarg); break;
+            case 'r': rot     = atof(optarg); break;
+            case 'e': events  = atof(optarg); break;
+            default:
+                fprintf(stderr, "usage: qualsim [-s seconds] [-g gain] [-b field_nt] [-w noise_nt] [-r rotation_rad_s] [-e events_per_minute]\n");
+                return 1;
+        }
+    }
+    n = (long) (seconds / STEP_S);
+    s = malloc(n * sizeof(sim_sample));
+    if (n < 1000 || !s || gain <= 0 || field <= 0 || quality_set_norm((UINT32) field, 0)){
+        fprintf(stderr, "qualsim: bad arguments\n");
+        return 1;
+    }
+    tol = field * QUALITY_NORM_TOL_PCT / 100;
+    make_stream(s, n, field, noise, rot, events / 60 * STEP_S, tol);
+    printf("%ld samples, gain %.1f counts/uT, field %.0f nT (tolerance %.0f), noise %.0f nT\n", n, gain, field, tol, noise);
+    run(s, n, FALSE);
+    run(s, n, TRUE);
+
+    /* cost: every check on */
+    reps = 10;
+    c0 = cycles();
+    while (reps--){
+        quality_reset();
+        for (i = 0; i < n; i++){
+            raw = s[i].raw;
+            quality_check(&raw, s[i].t);
+        }
+    }
+    c0 = cycles() - c0;
+    printf("QUAL cost %.1f host cycles per sample\n", c0 ? (double) c0 / (10.0 * n) : NAN);
+    return 0;
+}
@@ -0,0 +1,465 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  host
+ *  @{
+ *      @file       rmaggregate.c
+ *      @brief      Merges the streams of several boards by time.
+ *      @details    Build on Linux from this directory:
+ *
+ *                  cc -O2 -I.. -o rmaggregate rmaggregate.c rmstream.c rmcap.c serial.c crc8.c ../compress.c -lm
+ *
+ *                  rmaggregate [-b baud] [-o out.rmcap] [-c capacity]
+ *                              [-u socket] [-d max_delay_ms] [-s stats_s]
+ *                              device[,format[,gain]] ...
+ *
+ *                  All ports are read non-blocking from one epoll loop and
+ *                  decoded with rmstream.c. Board n (in argument order) is
+ *                  src n in the output.
+ *
+ *                  Each board has its own clock, so device time is mapped
+ *                  to host time with an offset: the smallest host receive
+ *                  time - device time seen (the sample with the least
+ *                  transport delay). The minimum is restarted every
+ *                  RMA_OFFSET_WINDOW_S so the offset follows crystal drift.
+ *
+ *                  Every port has a reorder buffer sorted by sequence
+ *                  number (duplicates and samples older than the last one
+ *                  sent are dropped). The oldest head of all buffers is sent
+ *                  once every active port has delivered a later sample, or
+ *                  when it has waited max_delay_ms, or when a buffer is full.
+ *                  A port silent for RMA_IDLE_MS is not waited for.
+ *
+ *                  Merged samples go to the -o file (rmcap.h, t_us is the
+ *                  aligned host time in us since the epoch, src the board)
+ *                  and to every client of the -u unix stream socket as
+ *                  lines "src t_us seq x y z flags". A client that cannot
+ *                  keep up loses lines, it never stalls the merge.
+ *
+ *                  Test without boards by replaying recorded streams on
+ *                  pseudo-terminals (see rmcapture.c):
+ *
+ *                  rmcapture -R a.bin > a.txt & rmcapture -R b.bin > b.txt &
+ *                  sleep 1; rmaggregate -o m.rmcap $(cat a.txt),binary $(cat b.txt),binary
+ *
+ *                  The program ends on SIGINT, SIGTERM or when every port
+ *                  has hung up, after sending what is still buffered.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "rmstream.h"
+#include "rmcap.h"
+#include "serial.h"
+
+#define RMA_MAX_PORTS       (16)
+#define RMA_MAX_CLIENTS     (8)
+#define RMA_REORDER         (256)       /**< Reorder buffer per port, power of 2 */
+#define RMA_MAX_DELAY_MS    (200)
+#define RMA_IDLE_MS         (2000)
+#define RMA_OFFSET_WINDOW_S (60)
+#define RMA_READ_SIZE       (65536)
+#define RMA_LISTEN_ID       (RMA_MAX_PORTS)
+
+/** @details Buffered sample. */
+typedef struct {
+    rms_sample s;               /// t_us already aligned to host time
+    INT64      rx_us;           /// host receive time
+}rma_item;
+
+/** @details One board. */
+typedef struct {
+    const char *path;
+    int         fd;
+    BOOL        open;
+    rms_decoder dec;
+    rma_item    q[RMA_REORDER];
+    UINT32      head, tail;     /// q[tail..head) sorted by seq
+    /* clock alignment */
+    BOOL        aligned;
+    INT64       offset, win_min, win_start;
+    INT64       last_rx, last_t;
+    /* sequence */
+    BOOL        sent_any;
+    UINT32      next_seq;
+    /* counters */
+    UINT64      lost, late, dups;
+}rma_port;
+
+static rma_port ports[RMA_MAX_PORTS];
+static BYTE     n_ports = 0;
+static int      clients[RMA_MAX_CLIENTS];
+static BYTE     n_clients = 0;
+static rmcap    cap;
+static BOOL     to_disk = FALSE, disk_full = FALSE;
+static INT64    max_delay_us = RMA_MAX_DELAY_MS * 1000LL;
+/* merged counters */
+static UINT64   sent = 0, forced = 0, client_drops = 0;
+static INT64    lat_sum = 0, lat_max = 0;
+static INT64    start_us;
+
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal ( int sig ) { (void) sig; stop = 1; }
+
+/** Host time, us since the epoch */
+static INT64 now_us ( void ) {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (INT64) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void usage ( void ) {
+
+    fprintf(stderr,
+        "usage: rmaggregate [-b baud] [-o out.rmcap] [-c capacity] [-u socket]\n"
+        "                   [-d max_delay_ms] [-s stats_s] device[,format[,gain]] ...\n");
+    exit(2);
+}
+
+/** Device time to host time, see the file header */
+static INT64 rma_align ( rma_port *p, INT64 t_dev, INT64 rx ) {
+
+    INT64 d = rx - t_dev;
+
+    if (!p->aligned){
+        p->aligned   = TRUE;
+        p->offset    = p->win_min = d;
+        p->win_start = rx;
+    }
+    if (d < p->win_min)
+        p->win_min = d;
+    if (d < p->offset)
+        p->offset = d;
+    if (rx - p->win_start >= RMA_OFFSET_WINDOW_S * 1000000LL){
+        p->offset    = p->win_min;
+        p->win_min   = d;
+        p->win_start = rx;
+    }
+    return t_dev + p->offset;
+}
+
+/** Sends one merged sample to the file and the clients */
+static void rma_send ( BYTE src, const rma_item *it, INT64 now ) {
+
+    char line[128];
+    int  n, i;
+    INT64 lat = now - it->rx_us;
+
+    if (to_disk && !disk_full && rmcap_append(&cap, &it->s, src)){
+        disk_full = TRUE;
+        fprintf(stderr, "rmaggregate: output file full\n");
+    }
+
+    if (n_clients){
+        n = snprintf(line, sizeof(line), "%u %lld %u %.1f %.1f %.1f %u\n", src,
+                     (long long) it->s.t_us, it->s.seq, it->s.x, it->s.y, it->s.z, it->s.flags);
+        for (i = 0; i < n_clients; ){
+            if (send(clients[i], line, n, MSG_DONTWAIT | MSG_NOSIGNAL) == n){
+                i++;
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK){
+                client_drops++;
+                i++;
+                continue;
+            }
+            close(clients[i]);                          // gone
+            clients[i] = clients[--n_clients];
+        }
+    }
+
+    sent++;
+    lat_sum += lat;
+    if (lat > lat_max)
+        lat_max = lat;
+}
+
+/**
+ *  @brief  Sends buffered samples in time order.
+ *  @param[in]  now - host time
+ *  @param[in]  full - port whose buffer must make room, or NULL
+ *  @param[in]  flush - send everything
+ *  @return     none
+ */
+static void rma_merge ( INT64 now, rma_port *full, BOOL flush ) {
+
+    rma_port *p, *best;
+    rma_item *it;
+    INT64 watermark;
+    BYTE i;
+
+    for (;;){
+        best = NULL;
+        watermark = INT64_MAX;
+        for (i = 0; i < n_ports; i++){
+            p = &ports[i];
+            if (p->head != p->tail){
+                if (!best || p->q[p->tail & (RMA_REORDER-1)].s.t_us <
+                             best->q[best->tail & (RMA_REORDER-1)].s.t_us)
+                    best = p;
+            }
+            else if (p->open && p->aligned && now - p->last_rx < RMA_IDLE_MS * 1000LL){
+                if (p->last_t < watermark)
+                    watermark = p->last_t;              // its next sample is later
+            }
+        }
+        if (!best)
+            return;
+
+        it = &best->q[best->tail & (RMA_REORDER-1)];
+        if (!flush && it->s.t_us > watermark && now - it->rx_us < max_delay_us){
+            if (!full || full->head - full->tail < RMA_REORDER)
+                return;
+            forced++;
+        }
+
+        rma_send(best - ports, it, now);
+        if (best->sent_any && it->s.seq > best->next_seq)
+            best->lost += it->s.seq - best->next_seq;
+        best->sent_any = TRUE;
+        best->next_seq = it->s.seq + 1;
+        best->tail++;
+    }
+}
+
+/** Queues a decoded sample in its port reorder buffer */
+static void rma_push ( rma_port *p, rms_sample *s, INT64 rx ) {
+
+    UINT32 i;
+    rma_item *it;
+
+    if (p->sent_any && s->seq < p->next_seq){
+        p->late++;
+        return;
+    }
+    s->t_us    = rma_align(p, s->t_us, rx);
+    p->last_rx = rx;
+    p->last_t  = s->t_us;
+
+    if (p->head - p->tail >= RMA_REORDER)
+        rma_merge(rx, p, FALSE);
+
+    /* insertion from the newest end, streams are nearly always in order */
+    for (i = p->head; i != p->tail; i--){
+        it = &p->q[(i-1) & (RMA_REORDER-1)];
+        if (it->s.seq == s->seq){
+            p->dups++;
+            return;
+        }
+        if (it->s.seq < s->seq)
+            break;
+        p->q[i & (RMA_REORDER-1)] = *it;
+    }
+    p->q[i & (RMA_REORDER-1)].s     = *s;
+    p->q[i & (RMA_REORDER-1)].rx_us = rx;
+    p->head++;
+}
+
+/** Reads everything a port holds. Returns 1 when it hung up. */
+static BOOL rma_read ( rma_port *p ) {
+
+    static BYTE buf[RMA_READ_SIZE];
+    rms_sample s;
+    ssize_t n, i;
+    INT64 rx;
+
+    while ((n = read(p->fd, buf, sizeof(buf))) > 0){
+        rx = now_us();
+        for (i = 0; i < n; i++)
+            if (rms_decode(&p->dec, buf[i], &s))
+                rma_push(p, &s, rx);
+    }
+    return n == 0 || (errno != EAGAIN && errno != EINTR);
+}
+
+/** Accepts pending clients of the unix socket */
+static void rma_accept ( int listener ) {
+
+    int fd;
+
+    while ((fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0){
+        if (n_clients >= RMA_MAX_CLIENTS){
+            close(fd);
+            continue;
+        }
+        clients[n_clients++] = fd;
+    }
+}
+
+/** Opens the unix socket */
+static int rma_listen ( const char *path ) {
+
+    struct sockaddr_un addr;
+    int fd;
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    unlink(path);
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(fd, RMA_MAX_CLIENTS) < 0){
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/** Prints the counters, rates since the previous call */
+static void rma_stats ( INT64 now ) {
+
+    static UINT64 last_samples[RMA_MAX_PORTS], last_sent;
+    static INT64  last_now = 0;
+    double period_s;
+    rma_port *p;
+    BYTE i;
+
+    if (!last_now)
+        last_now = start_us;
+    period_s = now > last_now ? (now - last_now) / 1e6 : 1.0;
+    last_now = now;
+
+    for (i = 0; i < n_ports; i++){
+        p = &ports[i];
+        fprintf(stderr, "[%u] %s%s: %llu samples (%.0f/s), offset %lld us, %llu errors, "
+                "%llu resyncs, %llu lost, %llu late, %llu dups\n", i, p->path,
+                p->open ? "" : " (closed)", (unsigned long long) p->dec.samples,
+                (p->dec.samples - last_samples[i]) / period_s, (long long) p->offset,
+                (unsigned long long) p->dec.errors, (unsigned long long) rms_resyncs(&p->dec),
+                (unsigned long long) p->lost, (unsigned long long) p->late,
+                (unsigned long long) p->dups);
+        last_samples[i] = p->dec.samples;
+    }
+    fprintf(stderr, "merged: %llu sent (%.0f/s), latency avg %.1f ms max %.1f ms, "
+            "%llu forced, %u clients, %llu client drops\n", (unsigned long long) sent,
+            (sent - last_sent) / period_s, sent ? lat_sum / 1000.0 / sent : 0.0,
+            lat_max / 1000.0, (unsigned long long) forced, n_clients,
+            (unsigned long long) client_drops);
+    last_sent = sent;
+}
+
+int main ( int argc, char **argv ) {
+
+    struct epoll_event ev, events[RMA_MAX_PORTS + 1];
+    const char *out_path = NULL, *sock_path = NULL;
+    UINT64 capacity = 1ULL << 24;
+    long   baud = 230400;
+    int    opt, ep, listener = -1, n, i, open_ports;
+    INT64  stats_us = 10 * 1000000LL, next_stats, now;
+    char  *spec, *fmt, *gain;
+    BYTE   format;
+    rma_port *p;
+
+    while ((opt = getopt(argc, argv, "b:o:c:u:d:s:")) != -1){
+        switch (opt){
+            case 'b': baud = atol(optarg); break;
+            case 'o': out_path = optarg; break;
+            case 'c': capacity = strtoull(optarg, NULL, 0); break;
+            case 'u': sock_path = optarg; break;
+            case 'd': max_delay_us = atol(optarg) * 1000LL; break;
+            case 's': stats_us = atol(optarg) * 1000000LL; break;
+            default:  usage();
+        }
+    }
+    if (optind == argc || argc - optind > RMA_MAX_PORTS || !serial_speed(baud) || capacity == 0)
+        usage();
+
+    ep = epoll_create1(EPOLL_CLOEXEC);
+    for (i = optind; i < argc; i++){
+        p = &ports[n_ports];
+        spec = argv[i];
+        fmt  = strchr(spec, ',');
+        gain = NULL;
+        format = FMT_BINARY;
+        if (fmt){
+            *fmt++ = 0;
+            gain = strchr(fmt, ',');
+            if (gain)
+                *gain++ = 0;
+            if (rms_parse_format(fmt, &format))
+                usage();
+        }
+        rms_init(&p->dec, format, gain ? atof(gain) : 75.0f);
+        p->path = spec;
+        p->fd   = serial_open(spec, baud);
+        ev.events   = EPOLLIN;
+        ev.data.u32 = n_ports;
+        if (p->fd < 0 || epoll_ctl(ep, EPOLL_CTL_ADD, p->fd, &ev) < 0){
+            perror(spec);
+            return 1;
+        }
+        p->open = TRUE;
+        n_ports++;
+    }
+    if (sock_path){
+        listener = rma_listen(sock_path);
+        ev.events   = EPOLLIN;
+        ev.data.u32 = RMA_LISTEN_ID;
+        if (listener < 0 || epoll_ctl(ep, EPOLL_CTL_ADD, listener, &ev) < 0){
+            perror(sock_path);
+            return 1;
+        }
+    }
+    if (out_path){
+        if (rmcap_create(&cap, out_path, capacity, ports[0].dec.format, ports[0].dec.gain)){
+            perror(out_path);
+            return 1;
+        }
+        to_disk = TRUE;
+    }
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    start_us   = now_us();
+    next_stats = start_us + stats_us;
+    open_ports = n_ports;
+    while (!stop && open_ports){
+        n = epoll_wait(ep, events, RMA_MAX_PORTS + 1, 10);
+        for (i = 0; i < n; i++){
+            if (events[i].data.u32 == RMA_LISTEN_ID){
+                rma_accept(listener);
+                continue;
+            }
+            p = &ports[events[i].data.u32];
+            if (rma_read(p)){
+                epoll_ctl(ep, EPOLL_CTL_DEL, p->fd, NULL);
+                close(p->fd);
+                p->open = FALSE;
+                open_ports--;
+            }
+        }
+        now = now_us();
+        rma_merge(now, NULL, FALSE);
+        if (to_disk)
+            rmcap_publish(&cap);
+        if (stats_us && now >= next_stats){
+            rma_stats(now);
+            next_stats += stats_us;
+        }
+    }
+    rma_merge(now_us(), NULL, TRUE);
+
+    if (to_disk)
+        rmcap_close(&cap);
+    for (i = 0; i < n_clients; i++)
+        close(clients[i]);
+    if (listener >= 0){
+        close(listener);
+        unlink(sock_path);
+    }
+    rma_stats(now_us());
+    return 0;
+}
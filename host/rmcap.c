@@ -0,0 +1,164 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  host
+ *  @{
+ *      @file       rmcap.c
+ *      @brief      Columnar, memory mapped sample file.
+ */
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "rmcap.h"
+
+#define ALIGN_UP(x)     (((x) + RMCAP_ALIGN - 1) & ~(UINT64) (RMCAP_ALIGN - 1))
+
+/** Points the column pointers into the mapping */
+static void rmcap_columns ( rmcap *c ) {
+
+    BYTE *base = (BYTE *) c->h;
+
+    c->t_us  = (INT64 *)  (base + c->h->off_t_us);
+    c->seq   = (UINT32 *) (base + c->h->off_seq);
+    c->x     = (float *)  (base + c->h->off_x);
+    c->y     = (float *)  (base + c->h->off_y);
+    c->z     = (float *)  (base + c->h->off_z);
+    c->flags = base + c->h->off_flags;
+    c->src   = base + c->h->off_src;
+    c->index = (INT64 *)  (base + c->h->off_index);
+}
+
+/**
+ *  @brief  Creates a file with room for capacity samples and maps it.
+ *  @param[out] c - file
+ *  @param[in]  path, capacity, format (FMT_*), gain (counts per uT)
+ *  @return     0 if successful, 1 otherwise (errno is set).
+ */
+BOOL rmcap_create ( rmcap *c, const char *path, UINT64 capacity, BYTE format, float gain ) {
+
+    rmcap_header h;
+    UINT64 off;
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, RMCAP_MAGIC, sizeof(h.magic));
+    h.version      = RMCAP_VERSION;
+    h.index_stride = RMCAP_INDEX_STRIDE;
+    h.capacity     = capacity;
+    h.format       = format;
+    h.gain         = gain;
+
+    off = ALIGN_UP(sizeof(h));
+    h.off_t_us  = off;  off = ALIGN_UP(off + capacity * sizeof(INT64));
+    h.off_seq   = off;  off = ALIGN_UP(off + capacity * sizeof(UINT32));
+    h.off_x     = off;  off = ALIGN_UP(off + capacity * sizeof(float));
+    h.off_y     = off;  off = ALIGN_UP(off + capacity * sizeof(float));
+    h.off_z     = off;  off = ALIGN_UP(off + capacity * sizeof(float));
+    h.off_flags = off;  off = ALIGN_UP(off + capacity);
+    h.off_src   = off;  off = ALIGN_UP(off + capacity);
+    h.off_index = off;  off = off + (capacity / RMCAP_INDEX_STRIDE + 1) * sizeof(INT64);
+
+    c->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (c->fd < 0)
+        return TRUE;
+    c->size = off;
+    if (ftruncate(c->fd, off) < 0)
+        goto fail;
+    c->h = mmap(NULL, c->size, PROT_READ | PROT_WRITE, MAP_SHARED, c->fd, 0);
+    if (c->h == MAP_FAILED)
+        goto fail;
+
+    memcpy(c->h, &h, sizeof(h));
+    c->count = 0;
+    rmcap_columns(c);
+    return FALSE;
+
+fail:
+    close(c->fd);
+    return TRUE;
+}
+
+/**
+ *  @brief  Maps an existing file read only.
+ *  @param[out] c - file, c->h->count samples are valid
+ *  @param[in]  path
+ *  @return     0 if successful, 1 otherwise.
+ */
+BOOL rmcap_open ( rmcap *c, const char *path ) {
+
+    struct stat st;
+
+    c->fd = open(path, O_RDONLY);
+    if (c->fd < 0)
+        return TRUE;
+    if (fstat(c->fd, &st) < 0 || (size_t) st.st_size < sizeof(rmcap_header))
+        goto fail;
+    c->size = st.st_size;
+    c->h = mmap(NULL, c->size, PROT_READ, MAP_SHARED, c->fd, 0);
+    if (c->h == MAP_FAILED)
+        goto fail;
+    if (memcmp(c->h->magic, RMCAP_MAGIC, sizeof(c->h->magic)) || c->h->version != RMCAP_VERSION){
+        munmap(c->h, c->size);
+        goto fail;
+    }
+    c->count = c->h->count;
+    rmcap_columns(c);
+    return FALSE;
+
+fail:
+    close(c->fd);
+    return TRUE;
+}
+
+/**
+ *  @brief  Appends a sample. It is visible to readers after rmcap_publish.
+ *  @param[in]  c - file
+ *  @param[in]  s - sample
+ *  @param[in]  src - board
+ *  @return     0 if successful, 1 if the file is full.
+ */
+BOOL rmcap_append ( rmcap *c, const rms_sample *s, BYTE src ) {
+
+    UINT64 i = c->count;
+
+    if (i >= c->h->capacity)
+        return TRUE;
+
+    c->t_us[i]  = s->t_us;
+    c->seq[i]   = s->seq;
+    c->x[i]     = s->x;
+    c->y[i]     = s->y;
+    c->z[i]     = s->z;
+    c->flags[i] = s->flags;
+    c->src[i]   = src;
+    if (i % RMCAP_INDEX_STRIDE == 0)
+        c->index[i / RMCAP_INDEX_STRIDE] = s->t_us;
+    c->count = i + 1;
+    return FALSE;
+}
+
+/**
+ *  @brief  Makes the appended samples visible to readers.
+ *  @param[in]  c - file
+ *  @return     none
+ */
+void rmcap_publish ( rmcap *c ) {
+
+    __atomic_store_n(&c->h->count, c->count, __ATOMIC_RELEASE);
+}
+
+/**
+ *  @brief  Publishes, flushes and unmaps.
+ *  @param[in]  c - file
+ *  @return     none
+ */
+void rmcap_close ( rmcap *c ) {
+
+    if (c->h->count != c->count)
+        rmcap_publish(c);
+    msync(c->h, c->size, MS_SYNC);
+    munmap(c->h, c->size);
+    close(c->fd);
+}
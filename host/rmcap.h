@@ -0,0 +1,71 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  host
+ *  @{
+ *      @file       rmcap.h
+ *      @brief      Columnar, memory mapped sample file.
+ *      @details    Analysis tools mmap the file and use the columns as plain
+ *                  arrays, no parsing needed:
+ *
+ *                  offset 0        rmcap_header
+ *                  off_t_us        INT64  t_us[capacity]   device time, us
+ *                  off_seq         UINT32 seq[capacity]
+ *                  off_x/y/z       float  x[capacity]...   uT
+ *                  off_flags       BYTE   flags[capacity]
+ *                  off_src         BYTE   src[capacity]    board, 0 if one
+ *                  off_index       INT64  index[capacity / index_stride + 1]
+ *
+ *                  index[k] is t_us[k * index_stride], for a coarse time
+ *                  search before a binary search in t_us. The file is
+ *                  created at full size (sparse) so the columns never move;
+ *                  only the first count entries are valid. count is written
+ *                  after the columns, so a reader mapping a file that is
+ *                  still being captured only sees complete samples.
+ */
+#ifndef RMCAP_H
+#define	RMCAP_H
+
+#include <stddef.h>
+#include "platform.h"
+#include "rmstream.h"
+
+#define RMCAP_MAGIC         "RMCAP\0\0\0"
+#define RMCAP_VERSION       (1)
+#define RMCAP_INDEX_STRIDE  (4096)
+#define RMCAP_ALIGN         (64)
+
+/** @details File header, little endian, 256 bytes. */
+typedef struct {
+    char   magic[8];
+    UINT32 version;
+    UINT32 index_stride;
+    UINT64 capacity;            /// samples the columns have room for
+    UINT64 count;               /// valid samples
+    UINT64 off_t_us, off_seq, off_x, off_y, off_z, off_flags, off_src, off_index;
+    UINT32 format;              /// FMT_* of the captured stream
+    float  gain;                /// counts per uT of raw streams before their configuration
+    BYTE   reserved[256 - 104];
+}rmcap_header;
+
+/** @details Open file. */
+typedef struct {
+    int           fd;
+    size_t        size;
+    rmcap_header *h;
+    UINT64        count;        /// appended, published by rmcap_publish
+    INT64        *t_us;
+    UINT32       *seq;
+    float        *x, *y, *z;
+    BYTE         *flags, *src;
+    INT64        *index;
+}rmcap;
+
+BOOL rmcap_create  ( rmcap *c, const char *path, UINT64 capacity, BYTE format, float gain );
+BOOL rmcap_open    ( rmcap *c, const char *path );
+BOOL rmcap_append  ( rmcap *c, const rms_sample *s, BYTE src );
+void rmcap_publish ( rmcap *c );
+void rmcap_close   ( rmcap *c );
+
+#endif	/* RMCAP_H */
@@ -0,0 +1,228 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  host
+ *  @{
+ *      @file       rmcapture.c
+ *      @brief      Captures the board output stream into a columnar file.
+ *      @details    Build on Linux from this directory:
+ *
+ *                  cc -O2 -I.. -o rmcapture rmcapture.c rmstream.c rmcap.c serial.c crc8.c ../compress.c -lm
+ *
+ *                  Capture:
+ *                  rmcapture [-f text|binary|compressed] [-b baud] [-g gain]
+ *                            [-c capacity] [-w raw.bin] device out.rmcap
+ *
+ *                  The port is read non-blocking in large chunks; samples
+ *                  are published to the file after every chunk, so the file
+ *                  can be opened while the capture runs (see rmcap.h). -w
+ *                  also keeps the raw bytes. device may also be a recorded
+ *                  file. The capture ends on SIGINT,
+ *                  SIGTERM, when the port hangs up or when the file is full.
+ *
+ *                  Replay, to test without a board:
+ *                  rmcapture -R raw.bin [-b baud]
+ *
+ *                  opens a pseudo-terminal, prints its name and writes the
+ *                  recorded stream to it at the given baud rate, e.g.
+ *
+ *                  rmcapture -R raw.bin > pty.txt &
+ *                  sleep 1; rmcapture -f binary $(cat pty.txt) out.rmcap
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include "rmstream.h"
+#include "rmcap.h"
+#include "serial.h"
+
+#define READ_SIZE           (65536)
+#define DEFAULT_BAUD        (230400)
+#define DEFAULT_GAIN        (75.0f)             /**< CC = 200 */
+#define DEFAULT_CAPACITY    (1ULL << 24)
+#define REPLAY_SLICE_MS     (10)
+
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal ( int sig ) { (void) sig; stop = 1; }
+
+static double now_s ( void ) {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void usage ( void ) {
+
+    fprintf(stderr,
+        "usage: rmcapture [-f text|binary|compressed] [-b baud] [-g gain]\n"
+        "                 [-c capacity] [-w raw.bin] device out.rmcap\n"
+        "       rmcapture -R raw.bin [-b baud]\n");
+    exit(2);
+}
+
+/** Bytes waiting in the input queue of a terminal */
+static int unread ( int fd ) {
+
+    int n = 0;
+
+    ioctl(fd, FIONREAD, &n);
+    return n;
+}
+
+/** Writes a recorded stream to a new pseudo-terminal at the baud rate */
+static int replay ( const char *path, long baud ) {
+
+    static BYTE buf[READ_SIZE];
+    FILE *in;
+    int master, slave;
+    size_t n, slice = baud / 10 * REPLAY_SLICE_MS / 1000;
+    struct timespec pause = { 0, REPLAY_SLICE_MS * 1000000L };
+
+    in = fopen(path, "rb");
+    if (!in){
+        perror(path);
+        return 1;
+    }
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0){
+        perror("pty");
+        return 1;
+    }
+    /* keep a raw slave open so the stream passes unchanged and waits for
+       the reader instead of being lost */
+    slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    if (slave < 0 || serial_raw(slave, baud)){
+        perror("pty");
+        return 1;
+    }
+    printf("%s\n", ptsname(master));
+    fflush(stdout);
+
+    if (slice == 0)
+        slice = 1;
+    if (slice > sizeof(buf))
+        slice = sizeof(buf);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    while (!stop && (n = fread(buf, 1, slice, in)) > 0){
+        if (write(master, buf, n) != (ssize_t) n)
+            break;
+        nanosleep(&pause, NULL);
+    }
+    /* let the reader drain the pty before hanging up */
+    while (!stop && unread(slave) > 0)
+        nanosleep(&pause, NULL);
+    fclose(in);
+    close(slave);
+    close(master);
+    return 0;
+}
+
+int main ( int argc, char **argv ) {
+
+    static BYTE buf[READ_SIZE];
+    rms_decoder dec;
+    rms_sample  s;
+    rmcap       cap;
+    BYTE        format = FMT_TEXT;
+    long        baud = DEFAULT_BAUD;
+    float       gain = DEFAULT_GAIN;
+    UINT64      capacity = DEFAULT_CAPACITY;
+    const char *raw_path = NULL, *replay_path = NULL;
+    FILE       *raw = NULL;
+    struct pollfd pfd;
+    ssize_t     n, i;
+    BOOL        full = FALSE;
+    double      t0, t;
+    int         opt, fd;
+
+    while ((opt = getopt(argc, argv, "f:b:g:c:w:R:")) != -1){
+        switch (opt){
+            case 'f': if (rms_parse_format(optarg, &format)) usage(); break;
+            case 'b': baud = atol(optarg); break;
+            case 'g': gain = atof(optarg); break;
+            case 'c': capacity = strtoull(optarg, NULL, 0); break;
+            case 'w': raw_path = optarg; break;
+            case 'R': replay_path = optarg; break;
+            default:  usage();
+        }
+    }
+    if (!serial_speed(baud) || gain <= 0 || capacity == 0)
+        usage();
+    if (replay_path)
+        return replay(replay_path, baud);
+    if (argc - optind != 2)
+        usage();
+
+    fd = serial_open(argv[optind], baud);
+    if (fd < 0){
+        perror(argv[optind]);
+        return 1;
+    }
+    if (rmcap_create(&cap, argv[optind+1], capacity, format, gain)){
+        perror(argv[optind+1]);
+        return 1;
+    }
+    if (raw_path && !(raw = fopen(raw_path, "wb"))){
+        perror(raw_path);
+        return 1;
+    }
+    rms_init(&dec, format, gain);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    pfd.fd     = fd;
+    pfd.events = POLLIN;
+    t0 = now_s();
+    while (!stop && !full){
+        if (poll(&pfd, 1, 200) < 0){
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (!(pfd.revents & (POLLIN | POLLHUP | POLLERR)))
+            continue;
+
+        /* drain everything the driver holds before publishing */
+        while ((n = read(fd, buf, sizeof(buf))) > 0){
+            if (raw)
+                fwrite(buf, 1, n, raw);
+            for (i = 0; i < n; i++)
+                if (rms_decode(&dec, buf[i], &s) && rmcap_append(&cap, &s, 0)){
+                    full = TRUE;
+                    break;
+                }
+            if (full)
+                break;
+        }
+        rmcap_publish(&cap);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+            break;                                  // hung up
+    }
+    t = now_s() - t0;
+
+    rmcap_close(&cap);
+    if (raw)
+        fclose(raw);
+    close(fd);
+
+    fprintf(stderr, "%llu samples, %llu bytes in %.1f s (%.0f samples/s), "
+            "%llu errors, %llu resyncs, %llu skipped%s\n",
+            (unsigned long long) dec.samples, (unsigned long long) dec.bytes, t,
+            t > 0 ? dec.samples / t : 0.0, (unsigned long long) dec.errors,
+            (unsigned long long) rms_resyncs(&dec), (unsigned long long) dec.skipped,
+            full ? ", file full" : "");
+    return 0;
+}
@@ -0,0 +1,250 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  host
+ *  @{
+ *      @file       rmreplay.c
+ *      @brief      Runs a recorded board stream through the firmware on Linux.
+ *      @details    Build on Linux from this directory:
+ *
+ *                  cc -O2 -I.. -I. -o rmreplay rmreplay.c rmstream.c i2c_replay.c ../rm3100.c
+ *                     ../pipeline.c ../textfmt.c ../stats.c ../fft.c ../notch.c ../radio_link.c
+ *                     ../compress.c ../ahrs.c ../pps.c ../resample.c ../quality.c ../uart.c
+ *                     ../scheduler.c ../host_port.c -lm
+ *
+ *                  rmreplay [-f text|binary|compressed] [-g gain] [-c cycle_count]
+ *                           [-F text|binary|compressed] [-a average] [-k cal.txt]
+ *                           [-n fft_size] [-m mains_hz] [-t tmrc] [-G grid_hz]
+ *                           [-H] [-N norm_nt] [-L packets.bin] [-l loss_percent] [-r] recording
+ *
+ *                  recording is a UART log in format -f (e.g. rmcapture -w).
+ *                  Each sample is loaded in the replay register file
+ *                  (i2c_replay.c) and read back by the unmodified driver
+ *                  (getDataReadyStatus, ReadRM3100Raw), then pushed to the
+ *                  firmware pipeline with its original time stamp. The
+ *                  calibration, averaging, formatting and output stages run
+ *                  as on the board; the output (format -F) goes to stdout.
+ *
+ *                  -c sets the cycle count, hence the gain, like the board
+ *                  did (default 200); binary and compressed recordings that
+ *                  carry their configuration change it where the board did.
+ *                  -g is the gain the recording was made with, only needed
+ *                  for text recordings taken at another cycle count, or raw
+ *                  ones without configuration records. -k loads a calibration: 3 offsets then the 3x3
+ *                  matrix by rows, 12 numbers. -n turns the spectrum lines on
+ *                  (FFT command), -m the mains notch filter (NOTCH command),
+ *                  -t sets the TMRC rate the recording was made at so their
+ *                  frequencies are right. -G puts the output on a grid of
+ *                  grid_hz (GRID command), its counters go to stderr. -H turns
+ *                  the Hampel filter on (HAMPEL command), -N the norm check
+ *                  (NORM command); the quality counters go to stderr. -L runs the radio uplink on the
+ *                  loopback and writes each payload to packets.bin as a
+ *                  length byte and the payload, -l makes that share of the
+ *                  transmissions fail; the link statistics go to stderr. -r replays at the original
+ *                  rate, otherwise as fast as possible; the throughput is
+ *                  reported on stderr.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "rmstream.h"
+#include "i2c_replay.h"
+#include "scheduler.h"
+#include "fft.h"
+#include "notch.h"
+#include "radio_link.h"
+#include "resample.h"
+#include "quality.h"
+
+#define READ_SIZE   (65536)
+
+static FILE *packets = NULL;
+
+static INT64 now_us ( void ) {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (INT64) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void usage ( void ) {
+
+    fprintf(stderr,
+        "usage: rmreplay [-f text|binary|compressed] [-g gain] [-c cycle_count]\n"
+        "                [-F text|binary|compressed] [-a average] [-k cal.txt]\n"
+        "                [-n fft_size] [-m mains_hz] [-t tmrc] [-G grid_hz]\n"
+        "                [-H] [-N norm_nt] [-L packets.bin] [-l loss_percent] [-r] recording\n");
+    exit(2);
+}
+
+/** Loopback radio hook: length byte then payload */
+static void save_packet ( const BYTE *payload, BYTE len ) {
+
+    fputc(len, packets);
+    fwrite(payload, 1, len, packets);
+}
+
+/** Reads 3 offsets and a 3x3 matrix */
+static BOOL load_calibration ( const char *path ) {
+
+    float offsets[3], matrix[3][3];
+    FILE *f = fopen(path, "r");
+    BYTE i, n = 0;
+
+    if (!f)
+        return TRUE;
+    for (i = 0; i < 3; i++)
+        n += fscanf(f, "%f", &offsets[i]) == 1;
+    for (i = 0; i < 9; i++)
+        n += fscanf(f, "%f", &matrix[i / 3][i % 3]) == 1;
+    fclose(f);
+    if (n != 12)
+        return TRUE;
+
+    pipeline_set_calibration(offsets, matrix);
+    return FALSE;
+}
+
+/** The acquisition step of the board for one recorded sample */
+static void replay_sample ( const rms_sample *s ) {
+
+    mag_sample m;
+
+    if (s->cycle_count && s->cycle_count != getRM3100CycleCount())
+        setCycleCount(s->cycle_count);      // a new epoch, as on the board
+    i2c_replay_sample(&s->raw);
+    if (!getDataReadyStatus())
+        return;
+    m.raw = ReadRM3100Raw();
+    m.t   = (UINT32) (s->t_us * (ONE_SECOND / 1000000));
+    if (!(m.raw.flags & SAMPLE_I2C_ERROR))
+        pipeline_push(&m);
+
+    while (sched_run_once())
+        ;
+}
+
+int main ( int argc, char **argv ) {
+
+    static BYTE buf[READ_SIZE];
+    rms_decoder dec;
+    rms_sample  s;
+    BYTE   in_format = FMT_BINARY, out_format = FMT_TEXT;
+    int    average = 1, cc = 200, fft = 0, mains = 0, tmrc = 0, loss = 0, grid = 0, norm = 0, opt;
+    float  gain = 0;
+    BOOL   realtime = FALSE, first = TRUE, hampel = FALSE;
+    const char *cal = NULL, *radio = NULL;
+    char   line[QUALITY_MAX_LINE];
+    FILE  *in;
+    size_t n, i;
+    INT64  start, t0 = 0, wait;
+    struct timespec pause;
+    double t;
+
+    while ((opt = getopt(argc, argv, "f:g:c:F:a:k:n:m:t:G:HN:L:l:r")) != -1){
+        switch (opt){
+            case 'f': if (rms_parse_format(optarg, &in_format)) usage(); break;
+            case 'F': if (rms_parse_format(optarg, &out_format)) usage(); break;
+            case 'g': gain = atof(optarg); break;
+            case 'c': cc = atoi(optarg); break;
+            case 'a': average = atoi(optarg); break;
+            case 'k': cal = optarg; break;
+            case 'n': fft = atoi(optarg); break;
+            case 'm': mains = atoi(optarg); break;
+            case 'L': radio = optarg; break;
+            case 'l': loss = atoi(optarg); break;
+            case 't': tmrc = strtol(optarg, NULL, 0); break;
+            case 'G': grid = atoi(optarg); break;
+            case 'H': hampel = TRUE; break;
+            case 'N': norm = atoi(optarg); break;
+            case 'r': realtime = TRUE; break;
+            default:  usage();
+        }
+    }
+    if (argc - optind != 1)
+        usage();
+
+    i2c_init(0, MASTER, 0);
+    if (setCycleCount(cc) || pipeline_set_format(out_format) || pipeline_set_average(average)
+        || (tmrc && setCMMdatarate(tmrc)) || fft_set_size(fft) || notch_set_mains(mains)
+        || grid < 0 || grid > 0xFFFF || resample_set_rate(grid) || norm < 0 || quality_set_norm(norm, 0)){
+        fprintf(stderr, "rmreplay: bad cycle count, format, average, tmrc, fft size, mains, grid or norm\n");
+        return 2;
+    }
+    quality_set_hampel(hampel);
+    pipeline_set_rate(getRM3100SampleRate());   // as the acquisition does in CMM
+    if (mains && !fft){
+        fft_set_size(FFT_SIZE_MAX);
+        fft_set_report(FALSE);
+    }
+    if (cal && load_calibration(cal)){
+        fprintf(stderr, "rmreplay: cannot read calibration %s\n", cal);
+        return 1;
+    }
+    sched_add("processing", pipeline_process_task, EV_SAMPLE,              1);
+    sched_add("output",     pipeline_output_task,  EV_OUTPUT | EV_UART_TX, 2);
+    sched_add("radio",      radio_task,            EV_RADIO,               2);
+    sched_add("spectrum",   fft_task,              EV_FFT | EV_UART_TX,    6);
+    if (radio){
+        packets = fopen(radio, "wb");
+        if (!packets){
+            perror(radio);
+            return 1;
+        }
+        radio_loopback_hook(save_packet);
+        radio_loopback_loss(loss);
+        radio_link_enable(TRUE);
+    }
+
+    in = fopen(argv[optind], "rb");
+    if (!in){
+        perror(argv[optind]);
+        return 1;
+    }
+    rms_init(&dec, in_format, gain > 0 ? gain : getRM3100Gain());
+
+    start = now_us();
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0){
+        for (i = 0; i < n; i++){
+            if (!rms_decode(&dec, buf[i], &s))
+                continue;
+            if (first){
+                t0    = s.t_us;
+                first = FALSE;
+            }
+            if (realtime && (wait = s.t_us - t0 - (now_us() - start)) > 0){
+                pause.tv_sec  = wait / 1000000;
+                pause.tv_nsec = wait % 1000000 * 1000;
+                nanosleep(&pause, NULL);
+            }
+            replay_sample(&s);
+        }
+    }
+    fclose(in);
+    fflush(stdout);
+    if (packets){
+        radio_flush();
+        while (sched_run_once())
+            ;
+        fclose(packets);
+        radio_format(line);
+        fputs(line, stderr);
+    }
+    if (grid){
+        resample_format(line);
+        fputs(line, stderr);
+    }
+    quality_format(line);
+    fputs(line, stderr);
+
+    t = (now_us() - start) / 1e6;
+    fprintf(stderr, "%llu samples in %.3f s (%.0f samples/s), %llu decode errors, "
+            "%u dropped, %u lost\n", (unsigned long long) dec.samples, t,
+            t > 0 ? dec.samples / t : 0.0, (unsigned long long) dec.errors,
+            (unsigned) pipeline_dropped(), (unsigned) getRM3100LostSamples());
+    return 0;
+}
@@ -0,0 +1,229 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  host
+ *  @{
+ *      @file       rmstream.c
+ *      @brief      Host side decoder of the board output stream.
+ *      @details    Text lines are the 4 columns printed by the board, time is
+ *                  the running sum of the dt column. Binary frames are found
+ *                  by their sync bytes and accepted only with a valid crc; on
+ *                  a bad crc the search restarts right after the false sync.
+ *                  The compressed stream goes through zs_decode. Configuration
+ *                  frames and keyframes set the gain of the samples after
+ *                  them.
+ */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rmstream.h"
+
+/**
+ *  @brief  Resets a decoder.
+ *  @param[in]  d - decoder
+ *  @param[in]  format - FMT_*
+ *  @param[in]  gain - counts per uT, used by the raw formats until the
+ *  stream gives its cycle count, and for text
+ *  @return     none
+ */
+void rms_init ( rms_decoder *d, BYTE format, float gain ) {
+
+    memset(d, 0, sizeof(*d));
+    d->format = format;
+    d->gain   = gain;
+    zs_decoder_init(&d->zs);
+}
+
+/**
+ *  @brief  Format name to FMT_* value.
+ *  @param[in]  name - "text", "binary" or "compressed"
+ *  @param[out] format
+ *  @return     0 if successful, 1 otherwise.
+ */
+BOOL rms_parse_format ( const char *name, BYTE *format ) {
+
+    if (!strcmp(name, "text"))
+        *format = FMT_TEXT;
+    else if (!strcmp(name, "binary"))
+        *format = FMT_BINARY;
+    else if (!strcmp(name, "compressed"))
+        *format = FMT_COMPRESSED;
+    else
+        return TRUE;
+    return FALSE;
+}
+
+/**
+ *  @brief  Times the decoder lost the stream.
+ *  @param[in]  d - decoder
+ *  @return     resyncs
+ */
+UINT64 rms_resyncs ( const rms_decoder *d ) {
+
+    return d->format == FMT_COMPRESSED ? d->zs.resyncs : d->errors;
+}
+
+/** Extends device time and sequence number past their wrap */
+static void rms_extend ( rms_decoder *d, UINT32 t_us, UINT16 seq, rms_sample *out ) {
+
+    if (d->started){
+        if (t_us < d->last_t)
+            d->t_high += (INT64) 1 << 32;
+        if (seq < d->last_seq)
+            d->seq_high += 1 << 16;
+    }
+    d->started  = TRUE;
+    d->last_t   = t_us;
+    d->last_seq = seq;
+    out->t_us   = d->t_high + t_us;
+    out->seq    = d->seq_high + seq;
+}
+
+/** Configuration of the samples that follow */
+static void rms_config ( rms_decoder *d, BYTE epoch, UINT16 cycle_count ) {
+
+    if (cycle_count < CC_MIN || cycle_count > CC_MAX){
+        d->errors++;
+        return;
+    }
+    d->epoch       = epoch;
+    d->cycle_count = cycle_count;
+    d->epoch_gain  = CC_GAIN(cycle_count);
+}
+
+/** Fills a sample from raw counts */
+static void rms_from_raw ( rms_decoder *d, const sensor_xyz *raw, rms_sample *out ) {
+
+    float gain = d->cycle_count ? d->epoch_gain : d->gain;
+
+    out->raw   = *raw;
+    out->raw.epoch   = d->epoch;
+    out->cycle_count = d->cycle_count;
+    out->x     = (float) raw->x / gain;
+    out->y     = (float) raw->y / gain;
+    out->z     = (float) raw->z / gain;
+    out->flags = raw->flags;
+}
+
+/** Text: one line per sample, anything else is a reply and skipped */
+static BOOL rms_text ( rms_decoder *d, BYTE byte, rms_sample *out ) {
+
+    char *p, *end;
+    float v[4];
+    BYTE i;
+
+    if (byte != '\n'){
+        if (d->line_len < RMS_LINE_SIZE - 1)
+            d->line[d->line_len++] = byte;
+        return FALSE;
+    }
+    d->line[d->line_len] = 0;
+    d->line_len = 0;
+
+    p = d->line;
+    for (i = 0; i < 4; i++){
+        v[i] = strtof(p, &end);
+        if (end == p)
+            break;
+        p = end;
+    }
+    if (i < 4 || *p){
+        d->skipped++;
+        return FALSE;
+    }
+
+    d->t_text += v[3];
+    out->t_us  = (INT64) (d->t_text * 1e6 + 0.5);
+    out->seq   = d->text_seq++;
+    out->x     = v[0];
+    out->y     = v[1];
+    out->z     = v[2];
+    out->flags = 0;
+    out->raw.x = lroundf(v[0] * d->gain);
+    out->raw.y = lroundf(v[1] * d->gain);
+    out->raw.z = lroundf(v[2] * d->gain);
+    out->raw.flags = 0;
+    out->raw.epoch = 0;
+    out->cycle_count = 0;
+    return TRUE;
+}
+
+/** TRUE if a frame can start with these two bytes */
+static BOOL rms_sync ( BYTE sync1 ) { return sync1 == FRAME_SYNC1 || sync1 == FRAME_CFG_SYNC1; }
+
+/** Binary frames and configuration frames, see pipeline.h */
+static BOOL rms_binary ( rms_decoder *d, BYTE byte, rms_sample *out ) {
+
+    BYTE *f = d->frame, i, size;
+    sensor_xyz raw;
+
+    if ((d->frame_len == 0 && byte != FRAME_SYNC0) ||
+        (d->frame_len == 1 && !rms_sync(byte))){
+        d->frame_len = (byte == FRAME_SYNC0);
+        if (d->frame_len)
+            f[0] = byte;
+        d->skipped++;
+        return FALSE;
+    }
+    f[d->frame_len++] = byte;
+    size = (d->frame_len > 1 && f[1] == FRAME_CFG_SYNC1) ? FRAME_CFG_SIZE : FRAME_SIZE;
+    if (d->frame_len < size)
+        return FALSE;
+
+    if (pipeline_crc8(&f[2], size-3) != f[size-1]){
+        d->errors++;
+        /* the frame may start inside the rejected one */
+        for (i = 1; i < size; i++)
+            if (f[i] == FRAME_SYNC0 && (i == size-1 || rms_sync(f[i+1])))
+                break;
+        d->frame_len = size - i;
+        memmove(f, &f[i], d->frame_len);
+        return FALSE;
+    }
+    d->frame_len = 0;
+    if (size == FRAME_CFG_SIZE){
+        rms_config(d, f[2], f[3] | (UINT16) f[4] << 8);
+        return FALSE;
+    }
+
+    raw.x     = ((INT32)((UINT32) f[8]  << 24 | (UINT32) f[9]  << 16 | (UINT32) f[10] << 8)) >> 8;
+    raw.y     = ((INT32)((UINT32) f[11] << 24 | (UINT32) f[12] << 16 | (UINT32) f[13] << 8)) >> 8;
+    raw.z     = ((INT32)((UINT32) f[14] << 24 | (UINT32) f[15] << 16 | (UINT32) f[16] << 8)) >> 8;
+    raw.flags = f[17];
+    rms_from_raw(d, &raw, out);
+    rms_extend(d, f[4] | (UINT32) f[5] << 8 | (UINT32) f[6] << 16 | (UINT32) f[7] << 24,
+               f[2] | (UINT16) f[3] << 8, out);
+    return TRUE;
+}
+
+/**
+ *  @brief  Feeds one stream byte.
+ *  @param[in]  d    - decoder
+ *  @param[in]  byte - next byte from the board
+ *  @param[out] out  - decoded sample
+ *  @return     TRUE when out holds a new sample.
+ */
+BOOL rms_decode ( rms_decoder *d, BYTE byte, rms_sample *out ) {
+
+    zs_sample zs;
+    BOOL ok;
+
+    d->bytes++;
+    if (d->format == FMT_TEXT)
+        ok = rms_text(d, byte, out);
+    else if (d->format == FMT_BINARY)
+        ok = rms_binary(d, byte, out);
+    else{
+        ok = zs_decode(&d->zs, byte, &zs);
+        if (ok){
+            if (zs.cycle_count != d->cycle_count || zs.raw.epoch != d->epoch)
+                rms_config(d, zs.raw.epoch, zs.cycle_count);
+            rms_from_raw(d, &zs.raw, out);
+            rms_extend(d, zs.t_us, zs.seq, out);
+        }
+    }
+    if (ok)
+        d->samples++;
+    return ok;
+}
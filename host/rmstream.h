@@ -0,0 +1,71 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  host
+ *  @{
+ *      @file       rmstream.h
+ *      @brief      Host side decoder of the board output stream.
+ *      @details    Decodes any of the pipeline output formats (FMT_TEXT,
+ *                  FMT_BINARY, FMT_COMPRESSED) a byte at a time. Reply lines
+ *                  of the command channel mixed into the stream are skipped.
+ *                  The 32 bits device time and the 16 bits sequence number
+ *                  are extended so they never wrap. The raw formats are
+ *                  scaled with the gain of the cycle count the stream carries
+ *                  (binary configuration frames, compressed keyframes), the
+ *                  gain given to rms_init until one is seen.
+ */
+#ifndef RMSTREAM_H
+#define	RMSTREAM_H
+
+#include "platform.h"
+#include "pipeline.h"
+#include "compress.h"
+
+#define RMS_LINE_SIZE       (TEXTFMT_MAX_LINE)
+
+/** @details Decoded sample. */
+typedef struct {
+    INT64  t_us;        /// device time, us
+    UINT32 seq;         /// sample number
+    float  x, y, z;     /// field, uT
+    BYTE   flags;       /// SAMPLE_* flags, 0 in text format
+    sensor_xyz raw;     /// counts, x,y,z * gain in text format
+    UINT16 cycle_count; /// of the sample's epoch, 0 if the stream did not say
+}rms_sample;
+
+/** @details Decoder state and counters. */
+typedef struct {
+    BYTE       format;          /// FMT_*
+    float      gain;            /// counts per uT of the raw formats
+    /* configuration in the stream */
+    BYTE       epoch;
+    UINT16     cycle_count;     /// 0 until one is seen
+    float      epoch_gain;      /// CC_GAIN(cycle_count)
+    /* text */
+    char       line[RMS_LINE_SIZE];
+    UINT32     line_len;
+    double     t_text;          /// sum of the dt column, s
+    /* binary */
+    BYTE       frame[FRAME_SIZE];
+    BYTE       frame_len;
+    /* compressed */
+    zs_decoder zs;
+    /* wrap extension */
+    BOOL       started;
+    UINT32     last_t;
+    INT64      t_high;
+    UINT16     last_seq;
+    UINT32     seq_high;
+    UINT32     text_seq;
+    /* counters */
+    UINT64     bytes, samples, errors;
+    UINT64     skipped;         /// reply lines (text) or bytes outside frames
+}rms_decoder;
+
+void rms_init   ( rms_decoder *d, BYTE format, float gain );
+BOOL rms_decode ( rms_decoder *d, BYTE byte, rms_sample *out );
+BOOL rms_parse_format ( const char *name, BYTE *format );
+UINT64 rms_resyncs ( const rms_decoder *d );
+
+#endif	/* RMSTREAM_H */
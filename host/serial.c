@@ -0,0 +1,70 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  host
+ *  @{
+ *      @file       serial.c
+ *      @brief      Serial port setup shared by the host tools.
+ */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <unistd.h>
+#include "serial.h"
+
+/**
+ *  @brief  Baud rate to termios speed.
+ *  @param[in]  baud - bits per second
+ *  @return     B* constant, 0 if not supported
+ */
+speed_t serial_speed ( long baud ) {
+
+    switch (baud){
+        case 9600:   return B9600;
+        case 19200:  return B19200;
+        case 38400:  return B38400;
+        case 57600:  return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 921600: return B921600;
+        default:     return 0;
+    }
+}
+
+/**
+ *  @brief  Raw mode, 8N1. Pseudo-terminals ignore the speed.
+ *  @param[in]  fd - terminal
+ *  @param[in]  baud - bits per second
+ *  @return     0 if successful, 1 otherwise.
+ */
+BOOL serial_raw ( int fd, long baud ) {
+
+    struct termios tio;
+
+    if (tcgetattr(fd, &tio) < 0)
+        return TRUE;
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    cfsetispeed(&tio, serial_speed(baud));
+    cfsetospeed(&tio, serial_speed(baud));
+    return tcsetattr(fd, TCSANOW, &tio) < 0;
+}
+
+/**
+ *  @brief  Opens a port for non-blocking reads. A path that is not a
+ *  terminal (a recorded stream) is opened as is.
+ *  @param[in]  path - device
+ *  @param[in]  baud - bits per second
+ *  @return     file descriptor, -1 on error (errno is set)
+ */
+int serial_open ( const char *path, long baud ) {
+
+    int fd = open(path, O_RDONLY | O_NOCTTY | O_NONBLOCK);
+
+    if (fd >= 0 && isatty(fd) && serial_raw(fd, baud)){
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
@@ -0,0 +1,20 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  host
+ *  @{
+ *      @file       serial.h
+ *      @brief      Serial port setup shared by the host tools.
+ */
+#ifndef SERIAL_H
+#define	SERIAL_H
+
+#include <termios.h>
+#include "platform.h"
+
+speed_t serial_speed ( long baud );
+BOOL    serial_raw   ( int fd, long baud );
+int     serial_open  ( const char *path, long baud );
+
+#endif	/* SERIAL_H */
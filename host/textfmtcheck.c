@@ -0,0 +1,112 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  host
+ *  @{
+ *      @file       textfmtcheck.c
+ *      @brief      Checks textfmt_fixed against printf for every float.
+ *      @details    Build on Linux from this directory:
+ *
+ *                  cc -O2 -I.. -o textfmtcheck textfmtcheck.c ../textfmt.c
+ *
+ *                  textfmtcheck [-d decimals] [-f first] [-l last] [-s step] [-j jobs]
+ *
+ *                  Every float bit pattern from first to last (default all
+ *                  2^32: both signs, zeros, subnormals, infinities and NaNs)
+ *                  is formatted by textfmt_fixed and by snprintf "%.*f" of
+ *                  the same value, for decimals (default each of 0 to
+ *                  TEXTFMT_MAX_DECIMALS) or the one given. The strings and
+ *                  the returned length must be equal. -s takes every
+ *                  step-th pattern for a quick run; -j splits the range
+ *                  over that many processes.
+ *
+ *                  The first mismatches are printed with the bit pattern;
+ *                  exit status 1 if there was any.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "textfmt.h"
+
+#define MAX_REPORTED    (10)
+
+/** Checks the patterns first, first + step, ... up to last, returns the mismatches */
+static UINT64 check ( UINT32 first, UINT32 last, UINT32 step, BYTE d0, BYTE d1 ) {
+
+    union { float f; UINT32 u; } v;
+    char mine[TEXTFMT_MAX_FIELD + 1], ref[TEXTFMT_MAX_FIELD + 8];
+    UINT64 bad = 0, u;
+    BYTE d, n;
+    int r;
+
+    for (u = first; u <= last; u += step){
+        v.u = (UINT32) u;
+        for (d = d0; d <= d1; d++){
+            n = textfmt_fixed(mine, v.f, d);
+            r = snprintf(ref, sizeof(ref), "%.*f", d, (double) v.f);
+            if (r == n && !strcmp(mine, ref))
+                continue;
+            if (bad++ < MAX_REPORTED)
+                printf("MISMATCH 0x%08lx %.9g decimals %u: textfmt \"%s\" (%u) printf \"%s\" (%d)\n",
+                       (unsigned long) v.u, (double) v.f, d, mine, n, ref, r);
+        }
+    }
+    return bad;
+}
+
+int main ( int argc, char **argv ) {
+
+    UINT32 first = 0, last = 0xFFFFFFFF, step = 1, jobs = 1, j;
+    UINT64 span, lo, hi, bad = 0;
+    BYTE d0 = 0, d1 = TEXTFMT_MAX_DECIMALS;
+    int opt, status;
+    pid_t pid;
+
+    while ((opt = getopt(argc, argv, "d:f:l:s:j:")) != -1){
+        switch (opt){
+            case 'd': d0 = d1 = strtoul(optarg, NULL, 0); break;
+            case 'f': first = strtoul(optarg, NULL, 0); break;
+            case 'l': last  = strtoul(optarg, NULL, 0); break;
+            case 's': step  = strtoul(optarg, NULL, 0); break;
+            case 'j': jobs  = strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: textfmtcheck [-d decimals] [-f first] [-l last] [-s step] [-j jobs]\n");
+                return 1;
+        }
+    }
+    if (d1 > TEXTFMT_MAX_DECIMALS || first > last || !step || !jobs){
+        fprintf(stderr, "textfmtcheck: bad option\n");
+        return 1;
+    }
+
+    /* slices start on the step grid of the whole range */
+    span = ((UINT64) (last - first) / step + jobs) / jobs * step;
+    for (j = 0; j < jobs; j++){
+        lo = first + j * span;
+        if (lo > last)
+            break;
+        hi = lo + span - 1 > last ? last : lo + span - 1;
+        fflush(stdout);
+        pid = jobs > 1 ? fork() : 0;
+        if (pid < 0){
+            perror("textfmtcheck: fork");
+            return 1;
+        }
+        if (pid == 0){
+            bad = check((UINT32) lo, (UINT32) hi, step, d0, d1);
+            if (jobs > 1)
+                _exit(bad != 0);
+        }
+    }
+    if (jobs > 1)
+        while (wait(&status) > 0)
+            if (!WIFEXITED(status) || WEXITSTATUS(status))
+                bad = 1;
+
+    printf("textfmt 0x%08lx..0x%08lx step %lu decimals %u..%u: %s\n", (unsigned long) first,
+           (unsigned long) last, (unsigned long) step, d0, d1, bad ? "MISMATCH" : "ok");
+    return bad != 0;
+}
@@ -0,0 +1,172 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  host
+ *  @{
+ *      @file       txbench.c
+ *      @brief      Bytes formatted per microsecond into the transmit ring.
+ *      @details    Build on Linux from this directory:
+ *
+ *                  cc -O2 -I.. -o txbench txbench.c ../uart.c ../textfmt.c ../scheduler.c ../host_port.c
+ *
+ *                  txbench [-n lines]
+ *
+ *                  Formats n sample lines (default 1000000) of the text
+ *                  output format, "%.1f   %.1f   %.1f   %f\n", through
+ *
+ *                  sprintf     the former path: sprintf into a stack buffer,
+ *                              strlen, SendDataBuffer copies into the ring
+ *                  inplace     snprintf straight into a ring reservation
+ *                  textfmt     textfmt_sample in the reservation, as
+ *                              pipeline.c does now
+ *                  copy        SendDataBuffer of an already formatted line:
+ *                              the cost of the ring and of the host sink,
+ *                              paid by all three
+ *
+ *                  The host uart.c writes each commit to stdout, redirected
+ *                  to /dev/null here; the report goes to stderr. The
+ *                  figures are the host's, the ratios carry over to the
+ *                  PIC32 with its soft float printf being slower still.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "platform.h"
+#include "uart.h"
+#include "textfmt.h"
+
+#define FIELDS      (1024)      // distinct samples cycled through
+
+static float fx[FIELDS], fy[FIELDS], fz[FIELDS], fdt[FIELDS];
+
+static double now_us ( void ) {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static UINT64 run_sprintf ( UINT32 lines ) {
+
+    char buf[TEXTFMT_MAX_LINE];
+    UINT64 bytes = 0;
+    UINT32 i, k;
+
+    for (i = 0; i < lines; i++){
+        k = i & (FIELDS-1);
+        sprintf(buf, "%.1f   %.1f   %.1f   %f\n", fx[k], fy[k], fz[k], fdt[k]);
+        bytes += strlen(buf);
+        SendDataBuffer(buf, strlen(buf));
+    }
+    return bytes;
+}
+
+static UINT64 run_inplace ( UINT32 lines ) {
+
+    BYTE bounce[TEXTFMT_MAX_LINE], *p;
+    UINT64 bytes = 0;
+    UINT32 i, k, n;
+    uart_txw w;
+
+    for (i = 0; i < lines; i++){
+        k = i & (FIELDS-1);
+        while (UARTTxReserve(&w, TEXTFMT_MAX_LINE))
+            ;
+        p = UARTTxDirect(&w, TEXTFMT_MAX_LINE, bounce);
+        n = snprintf((char *) p, TEXTFMT_MAX_LINE, "%.1f   %.1f   %.1f   %f\n", fx[k], fy[k], fz[k], fdt[k]);
+        UARTTxAdvance(&w, p, n);
+        UARTTxCommit(&w);
+        bytes += n;
+    }
+    return bytes;
+}
+
+static UINT64 run_textfmt ( UINT32 lines ) {
+
+    BYTE bounce[TEXTFMT_MAX_LINE], *p;
+    UINT64 bytes = 0;
+    UINT32 i, k, n;
+    uart_txw w;
+
+    for (i = 0; i < lines; i++){
+        k = i & (FIELDS-1);
+        while (UARTTxReserve(&w, TEXTFMT_MAX_LINE))
+            ;
+        p = UARTTxDirect(&w, TEXTFMT_MAX_LINE, bounce);
+        n = textfmt_sample((char *) p, fx[k], fy[k], fz[k], fdt[k]);
+        UARTTxAdvance(&w, p, n);
+        UARTTxCommit(&w);
+        bytes += n;
+    }
+    return bytes;
+}
+
+static UINT64 run_copy ( UINT32 lines ) {
+
+    char buf[TEXTFMT_MAX_LINE];
+    UINT64 bytes = 0;
+    UINT32 i, n;
+
+    n = textfmt_sample(buf, fx[0], fy[0], fz[0], fdt[0]);
+    for (i = 0; i < lines; i++){
+        SendDataBuffer(buf, n);
+        bytes += n;
+    }
+    return bytes;
+}
+
+static void report ( const char *name, UINT64 (*run)( UINT32 ), UINT32 lines, double *base ) {
+
+    double t0, us;
+    UINT64 bytes;
+
+    fflush(stdout);
+    t0    = now_us();
+    bytes = run(lines);
+    fflush(stdout);
+    us    = now_us() - t0;
+    if (!*base)
+        *base = us;
+    fprintf(stderr, "%-8s %llu bytes %.1f ms %.2f bytes/us %.2f ns/line x%.2f\n", name,
+            (unsigned long long) bytes, us / 1e3, bytes / us, us * 1e3 / lines, *base / us);
+}
+
+int main ( int argc, char **argv ) {
+
+    UINT32 lines = 1000000, i;
+    double base = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1){
+        switch (opt){
+            case 'n': lines = strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: txbench [-n lines]\n");
+                return 1;
+        }
+    }
+    if (!lines || !freopen("/dev/null", "w", stdout)){
+        fprintf(stderr, "txbench: bad option or no /dev/null\n");
+        return 1;
+    }
+    setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+
+    srand(1);
+    for (i = 0; i < FIELDS; i++){               // field of the earth, uT
+        fx[i]  = (rand() % 1200000 - 600000) / 10000.0f;
+        fy[i]  = (rand() % 1200000 - 600000) / 10000.0f;
+        fz[i]  = (rand() % 1200000 - 600000) / 10000.0f;
+        fdt[i] = 0.0133f + (rand() % 100) * 1e-7f;
+    }
+
+    report("sprintf", run_sprintf, lines, &base);
+    report("inplace", run_inplace, lines, &base);
+    report("textfmt", run_textfmt, lines, &base);
+    report("copy",    run_copy,    lines, &base);
+    return 0;
+}
@@ -0,0 +1,236 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  host
+ *  @{
+ *      @file       zsfuzz.c
+ *      @brief      Feeds the compressed stream decoder random, truncated and
+ *                  spliced input.
+ *      @details    Build on Linux from this directory:
+ *
+ *                  cc -O2 -fsanitize=address,undefined -I.. -o zsfuzz zsfuzz.c ../compress.c crc8.c
+ *
+ *                  zsfuzz [-n rounds] [-s seed]
+ *
+ *                  After every byte the decoder must still be in bounds
+ *                  (len <= ZS_MAX_RECORD, vbytes <= ZS_MAX_VARINT); buf
+ *                  sits inside the decoder, so the sanitizer alone would not
+ *                  see it overflow into the next fields. Cases:
+ *
+ *                  clean       an encoded stream decodes to the samples
+ *                              encoded, epoch and cycle count included,
+ *                              without error or resync; the epoch changes
+ *                              now and then, which ends blocks early
+ *                  random      random bytes, with valid keyframes mixed in
+ *                  varint      a keyframe followed by endless continuation
+ *                              bytes, or by four 5 bytes varints and a flags
+ *                              byte: one decode error each, no overflow
+ *                  splice      a stream cut at a random byte and resumed at
+ *                              another: the last block must decode exactly
+ *
+ *                  One line per case with its counters; exit status 1 on the
+ *                  first failure.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "compress.h"
+
+#define N_SAMPLES       (4096)
+
+static BYTE       stream[N_SAMPLES * ZS_MAX_OUTPUT];
+static UINT32     key_at[N_SAMPLES];        // offset of each sample's record
+static sensor_xyz sent[N_SAMPLES];
+static UINT32     sent_t[N_SAMPLES];
+static UINT16     sent_cc[N_SAMPLES];
+static UINT32     stream_len, last_key;     // sample of the last keyframe
+
+static UINT32 rnd ( void ) { return (UINT32) random(); }
+
+static long clamp24 ( long v ) { return v > 0x7FFFFF ? 0x7FFFFF : v < -0x800000 ? -0x800000 : v; }
+
+/** Stream of random walk samples, with jumps, flags and an irregular rate */
+static void make_stream ( BYTE interval ) {
+
+    zstream z;
+    UINT32 i, t = rnd();
+    UINT16 cc = 200;
+    sensor_xyz s;
+
+    memset(&s, 0, sizeof(s));
+    zs_init(&z, interval);
+    stream_len = 0;
+    for (i = 0; i < N_SAMPLES; i++){
+        if (rnd() % 64 == 0){                       // full scale jump
+            s.x = (INT32) (rnd() & 0xFFFFFF) - 0x800000;
+            s.y = -s.x - 1;
+            s.z = (INT32) (rnd() & 0xFFFFFF) - 0x800000;
+        }
+        else{
+            s.x += (INT32) (rnd() % 201) - 100;
+            s.y += (INT32) (rnd() % 21) - 10;
+            s.z += (INT32) (rnd() % 2001) - 1000;
+        }
+        s.x = clamp24(s.x);                         // keyframes hold 24 bits
+        s.y = clamp24(s.y);
+        s.z = clamp24(s.z);
+        s.flags = rnd() % 16 == 0 ? rnd() & 0xFF : 0;
+        if (rnd() % 512 == 0){                      // sensor reconfigured
+            s.epoch++;
+            cc = CC_MIN + rnd() % (CC_MAX - CC_MIN + 1);
+        }
+        t += rnd() % 8 == 0 ? rnd() % 1000000 : 1667;  // ddt well within 30 bits
+        sent[i]    = s;
+        sent_t[i]  = t;
+        sent_cc[i] = cc;
+        key_at[i]  = stream_len;
+        if (z.left == 0 || s.epoch != z.epoch || cc != z.cycle_count)
+            last_key = i;
+        stream_len += zs_encode(&z, &stream[stream_len], t, &s, cc);
+    }
+}
+
+/** One byte into the decoder, with the bounds checked */
+static BOOL feed ( zs_decoder *d, BYTE byte, zs_sample *out ) {
+
+    BOOL ok = zs_decode(d, byte, out);
+
+    if (d->len > ZS_MAX_RECORD || d->vbytes > ZS_MAX_VARINT || d->varints > 4){
+        printf("FAIL decoder out of bounds: len %u vbytes %u varints %u\n", d->len, d->vbytes, d->varints);
+        exit(1);
+    }
+    return ok;
+}
+
+static BOOL same ( const zs_sample *s, UINT32 i ) {
+
+    return s->raw.x == sent[i].x && s->raw.y == sent[i].y && s->raw.z == sent[i].z
+           && s->raw.flags == sent[i].flags && s->t_us == sent_t[i] && s->seq == (UINT16) i
+           && s->raw.epoch == sent[i].epoch && s->cycle_count == sent_cc[i];
+}
+
+static void case_clean ( BYTE interval ) {
+
+    zs_decoder d;
+    zs_sample s;
+    UINT32 i, n = 0;
+
+    make_stream(interval);
+    zs_decoder_init(&d);
+    for (i = 0; i < stream_len; i++)
+        if (feed(&d, stream[i], &s) && !same(&s, n++)){
+            printf("FAIL clean interval %u: sample %lu differs\n", interval, (unsigned long) n - 1);
+            exit(1);
+        }
+    if (n != N_SAMPLES || d.errors || d.resyncs){
+        printf("FAIL clean interval %u: %lu samples, %lu errors, %lu resyncs\n", interval,
+               (unsigned long) n, (unsigned long) d.errors, (unsigned long) d.resyncs);
+        exit(1);
+    }
+}
+
+static void case_random ( UINT32 rounds ) {
+
+    zs_decoder d;
+    zs_sample s;
+    UINT32 r, i, k;
+
+    zs_decoder_init(&d);
+    for (r = 0; r < rounds; r++){
+        make_stream(1 + rnd() % 64);
+        for (i = 0; i < 1 << 16; i++){
+            if (rnd() % 4096 == 0)                  // a real keyframe now and then
+                for (k = 0; k < ZS_KEY_SIZE; k++)
+                    feed(&d, stream[k], &s);
+            feed(&d, rnd() % 4 ? rnd() : 0x80 | rnd(), &s);
+        }
+    }
+    printf("random    %lu keyframes %lu samples %lu resyncs %lu errors\n",
+           (unsigned long) d.keyframes, (unsigned long) d.samples,
+           (unsigned long) d.resyncs, (unsigned long) d.errors);
+}
+
+static void case_varint ( void ) {
+
+    zs_decoder d;
+    zs_sample s;
+    UINT32 i, k;
+
+    make_stream(255);
+    zs_decoder_init(&d);
+    for (k = 0; k < 16; k++){
+        for (i = 0; i < ZS_KEY_SIZE; i++)
+            feed(&d, stream[i], &s);
+        for (i = 0; i < 4 * ZS_MAX_RECORD; i++)
+            if (k % 3 == 2)                         // four longest varints, flags, one too many
+                feed(&d, i < 20 ? (i % 5 == 4 ? 0x01 : i % 5 ? 0x80 : 0x81) : 0x01, &s);
+            else
+                feed(&d, k % 3 ? 0xFF : 0x80, &s);
+    }
+    if (d.errors != 16){
+        printf("FAIL varint: %lu errors for 16 malformed records\n", (unsigned long) d.errors);
+        exit(1);
+    }
+    printf("varint    %lu keyframes %lu resyncs %lu errors\n", (unsigned long) d.keyframes,
+           (unsigned long) d.resyncs, (unsigned long) d.errors);
+}
+
+static void case_splice ( UINT32 rounds ) {
+
+    zs_decoder d;
+    zs_sample s, last[256];
+    UINT32 r, i, cut, resume, first_last, n, interval, fails = 0;
+
+    for (r = 0; r < rounds; r++){
+        interval = 1 + rnd() % 64;
+        make_stream(interval);
+        first_last = last_key;                                  // keyframe of the last block
+        cut    = rnd() % stream_len;
+        resume = rnd() % key_at[first_last - 4 * interval];     // 4 blocks left at least
+
+        zs_decoder_init(&d);
+        n = 0;
+        for (i = 0; i < cut; i++)
+            feed(&d, stream[i], &s);
+        for (i = resume; i < stream_len; i++)
+            if (feed(&d, stream[i], &s))
+                last[n++ % 256] = s;
+
+        for (i = first_last; i < N_SAMPLES; i++)
+            if (n < N_SAMPLES - i || !same(&last[(n - (N_SAMPLES - i)) % 256], i)){
+                fails++;
+                break;
+            }
+    }
+    printf("splice    %lu rounds %lu failed\n", (unsigned long) rounds, (unsigned long) fails);
+    if (fails)
+        exit(1);
+}
+
+int main ( int argc, char **argv ) {
+
+    UINT32 rounds = 64, seed = 1;
+    BYTE interval;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:")) != -1){
+        switch (opt){
+            case 'n': rounds = strtoul(optarg, NULL, 0); break;
+            case 's': seed   = strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: zsfuzz [-n rounds] [-s seed]\n");
+                return 1;
+        }
+    }
+    srandom(seed);
+
+    for (interval = 1; interval < 128; interval = interval * 2 + 1)
+        case_clean(interval);
+    printf("clean     ok\n");
+    case_varint();
+    case_random(rounds);
+    case_splice(rounds * 16);
+    return 0;
+}
@@ -0,0 +1,52 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  sched
+ *  @{
+ *      @file       host_port.c
+ *      @brief      Linux implementation of the PIC32 primitives used by the
+ *                  portable modules. Not part of the MPLAB project.
+ *      @details    Build the scheduler on a Linux host with e.g.
+ *                  cc -I. scheduler.c host_port.c my_test.c
+ *                  The core timer runs at ONE_SECOND ticks/s like the PIC32
+ *                  one. Interrupts do not exist on the host, so the
+ *                  enable/disable calls are no-ops. uart.c builds on the
+ *                  host too and writes the transmit ring to stdout.
+ */
+#if !defined(__PIC32MX__)
+
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+#include "platform.h"
+#include "uart.h"
+
+UINT32 ReadCoreTimer ( void ) {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (UINT32)((UINT64)ts.tv_sec * ONE_SECOND + (UINT64)ts.tv_nsec * (ONE_SECOND/1000000) / 1000);
+}
+
+unsigned int INTDisableInterrupts ( void ) { return 0; }
+
+void INTRestoreInterrupts ( unsigned int status ) { (void)status; }
+
+static const char *uart_input = "";
+
+/** Queues text for UARTReadByte, e.g. commands in a host test */
+void host_uart_input ( const char *text ) { uart_input = text; }
+
+BOOL UARTReadByte ( BYTE *data ) {
+
+    if (!*uart_input)
+        return FALSE;
+
+    *data = *uart_input++;
+    return TRUE;
+}
+
+UINT32 UARTRxOverruns ( void ) { return 0; }
+
+#endif
@@ -18,6 +18,21 @@
 #include "hardware.h"
 #include <peripheral/i2c.h>
 
+/** Waits for cond, gives up with I2C_ERR_TIMEOUT after timeout_ticks */
+#define I2C_WAIT_UNTIL(cond)    do { UINT32 t0 = ReadCoreTimer();                      \
+                                     while (!(cond))                                   \
+                                         if (CT_TICKS_SINCE(t0) > timeout_ticks) {     \
+                                             i2c_status.timeouts++;                    \
+                                             return I2C_ERR_TIMEOUT;                   \
+                                         }                                             \
+                                } while (0)
+
+/* Retry policy */
+static UINT32 timeout_ticks = uS_TO_CORE_TICKS(I2C_TIMEOUT_US);
+static BYTE   max_retries   = I2C_MAX_RETRIES;
+/* Bus health counters */
+static i2c_stats i2c_status;
+
 /**
  *  @brief  Initialize i2c module:
  *  I2C clock is BRG
@@ -44,76 +59,281 @@ void i2c_init(I2C_MODULE i2cnum, i2cmode mode, BYTE address) {
 }
 
 /**
- *  @brief  Write to device using generic i2c protocol
+ *  @brief  Sets how long a bus phase may take and how many times a failed
+ *  transaction is retried. Worst case blocking time of one i2c_write/i2c_read
+ *  is about (retries+1) * (length+5) * timeout plus one bus recovery.
+ *  @param[in]  retries    - extra attempts after a failed transaction
+ *  @param[in]  timeout_us - max duration of a single bus phase
+ *  @return     none
+ */
+void i2c_set_retry_policy(BYTE retries, UINT32 timeout_us) {
+
+        max_retries   = retries;
+        timeout_ticks = uS_TO_CORE_TICKS(timeout_us);
+}
+
+/**
+ *  @brief  Bus health counters (timeouts, nacks, retries, recoveries...)
+ *  @param[in]  none
+ *  @return     pointer to the counters
+ */
+const i2c_stats * i2c_get_stats(void) { return &i2c_status; }
+
+/** Busy waits about half a SCL period of the recovery clock (100 kHz) */
+static void i2c_half_clock(void) {
+
+        UINT32 t0 = ReadCoreTimer();
+        while (CT_TICKS_SINCE(t0) < uS_TO_CORE_TICKS(5))
+            ;
+}
+
+/**
+ *  @brief  Recovers a hung bus.
+ *  A slave that lost a clock edge keeps SDA low waiting for the rest of its
+ *  byte. The module is switched off, SCL is clocked by hand (up to 9 pulses)
+ *  until the slave releases SDA and a STOP condition is generated before the
+ *  module is enabled again. Pins are driven open-drain style through TRIS.
+ *  @param[in]  none
+ *  @return     none
+ */
+void i2c_recover(void) {
+
+	BYTE i;
+
+	I2CEnable(MPU_I2C, FALSE);
+
+        I2C_SCL_LAT  = 0;
+        I2C_SDA_LAT  = 0;
+        I2C_SDA_TRIS = 1;                               // release SDA
+        I2C_SCL_TRIS = 1;                               // release SCL
+        i2c_half_clock();
+
+	for(i=0;i<9 && !I2C_SDA_PIN;i++){               // clock out the stuck byte
+            I2C_SCL_TRIS = 0;
+            i2c_half_clock();
+            I2C_SCL_TRIS = 1;
+            i2c_half_clock();
+	}
+        I2C_SCL_TRIS = 0;                               // STOP: SDA low->high while SCL high
+        I2C_SDA_TRIS = 0;
+        i2c_half_clock();
+        I2C_SCL_TRIS = 1;
+        i2c_half_clock();
+        I2C_SDA_TRIS = 1;
+        i2c_half_clock();
+
+	I2CEnable(MPU_I2C, TRUE);
+        i2c_status.recoveries++;
+}
+
+/** Start (or repeated start) condition */
+static int i2c_start(BOOL restart) {
+
+        if (!restart)
+            I2C_WAIT_UNTIL(I2CBusIsIdle(MPU_I2C));
+        if ((restart ? I2CRepeatStart(MPU_I2C) : I2CStart(MPU_I2C)) != I2C_SUCCESS) {
+            i2c_status.collisions++;
+            return I2C_ERR_COLLISION;
+        }
+        I2C_WAIT_UNTIL(I2CGetStatus(MPU_I2C) & I2C_START);
+	return I2C_OK;
+}
+
+/** Sends one byte and checks the slave acknowledge */
+static int i2c_put(BYTE data) {
+
+        I2C_WAIT_UNTIL(I2CTransmitterIsReady(MPU_I2C));
+        if (I2CSendByte(MPU_I2C, data) != I2C_SUCCESS) {
+            i2c_status.collisions++;
+            return I2C_ERR_COLLISION;
+        }
+        I2C_WAIT_UNTIL(I2CTransmissionHasCompleted(MPU_I2C));
+        if (!I2CByteWasAcknowledged(MPU_I2C)) {
+            i2c_status.nacks++;
+            return I2C_ERR_NACK;
+        }
+	return I2C_OK;
+}
+
+/** Receives one byte, ACK all but the last one */
+static int i2c_get(BYTE *data, BOOL last) {
+
+        if (I2CReceiverEnable(MPU_I2C, TRUE) != I2C_SUCCESS)
+            return I2C_ERR_COLLISION;
+        I2C_WAIT_UNTIL(I2CReceivedDataIsAvailable(MPU_I2C));
+        *data = I2CGetByte(MPU_I2C);
+        I2CAcknowledgeByte(MPU_I2C, !last);
+        I2C_WAIT_UNTIL(I2CAcknowledgeHasCompleted(MPU_I2C));
+	return I2C_OK;
+}
+
+/** Stop condition */
+static int i2c_stop(void) {
+
+        I2CStop(MPU_I2C);
+        I2C_WAIT_UNTIL(I2CGetStatus(MPU_I2C) & I2C_STOP);
+	return I2C_OK;
+}
+
+/**
+ *  @brief  Leaves the bus in a known state after a failed transaction.
+ *  Always issues a STOP, and recovers the bus if it does not go idle.
+ */
+static void i2c_abort(void) {
+
+        UINT32 t0;
+
+        I2CReceiverEnable(MPU_I2C, FALSE);
+        I2CStop(MPU_I2C);
+
+        t0 = ReadCoreTimer();
+        while (!I2CBusIsIdle(MPU_I2C) || !I2C_SDA_PIN) {
+            if (CT_TICKS_SINCE(t0) > timeout_ticks) {
+                i2c_recover();
+                break;
+            }
+        }
+        I2CClearStatus(MPU_I2C, I2C_ARBITRATION_LOSS);
+}
+
+/** One attempt of a register write */
+static int i2c_write_once(unsigned char slave_addr, unsigned char reg_addr, unsigned char length, unsigned char const *data) {
+
+	BYTE i;
+        int  err;
+
+        if ((err = i2c_start(FALSE)) != I2C_OK)                    //Send the Start Bit
+            return err;
+        if ((err = i2c_put((slave_addr<<1)|(0x00))) != I2C_OK)
+            return err;
+        if ((err = i2c_put(reg_addr)) != I2C_OK)
+            return err;
+
+	for(i=0;i<length;i++){
+            if ((err = i2c_put(data[i])) != I2C_OK)
+                return err;
+	}
+        return i2c_stop();                                          //Send the Stop condition
+}
+
+/** One attempt of a register read */
+static int i2c_read_once(unsigned char slave_addr, unsigned char reg_addr, unsigned char length, unsigned char *data) {
+
+	BYTE i;
+        int  err;
+
+        if ((err = i2c_start(FALSE)) != I2C_OK)                    //Send the Start Bit
+            return err;
+        if ((err = i2c_put((slave_addr<<1)|(0x00))) != I2C_OK)
+            return err;
+        if ((err = i2c_put(reg_addr)) != I2C_OK)
+            return err;
+        if ((err = i2c_start(TRUE)) != I2C_OK)                     //Send the Restart Bit
+            return err;
+        if ((err = i2c_put((slave_addr<<1)|(0x01))) != I2C_OK)
+            return err;
+
+	for(i=0;i<length;i++) {
+            if ((err = i2c_get(&data[i], i == (length-1))) != I2C_OK)
+                return err;
+	}
+        return i2c_stop();                                          //Send the Stop condition
+}
+
+/**
+ *  @brief  Maximum extra attempts of a failed transaction (retry policy).
+ *  @param[in]  none
+ *  @return     retries
+ */
+BYTE i2c_get_max_retries(void) { return max_retries; }
+
+/**
+ *  @brief  One attempt of a register write, for callers that retry on a
+ *  later activation instead of waiting here (bus scheduler, DRDY poll).
+ *  The bus is left clean on failure; retries and failures are counted as
+ *  with i2c_write.
  *  @param[in]  slave_addr - slave address
  *  @param[in]  reg_addr   - register address
  *  @param[in]  length     - number of bytes to write
  *  @param[in]  *data      - pointer for data to write
- *  @return     0 if sucessfull, 1 otherwise
+ *  @param[in]  attempt    - 0 for the first one
+ *  @return     0 if sucessfull, I2C_ERR_* otherwise
  */
-int i2c_write(unsigned char slave_addr, unsigned char reg_addr, unsigned char length, unsigned char const *data) {
+int i2c_write_attempt(unsigned char slave_addr, unsigned char reg_addr, unsigned char length, unsigned char const *data, BYTE attempt) {
 
-	BYTE i;
+        int err;
 
-	StartI2C1();								//Send the Start Bit
-	IdleI2C1();									//Wait to complete
-        if (MasterWriteI2C1(((slave_addr<<1)|(0x00))))
-            return 1;
-	IdleI2C1();
-        if (MasterWriteI2C1(reg_addr))
-            return 1;
-	IdleI2C1();
+        if (attempt)
+            i2c_status.retries++;
+        err = i2c_write_once(slave_addr, reg_addr, length, data);
+        if (err != I2C_OK) {
+            i2c_abort();
+            if (attempt >= max_retries)
+                i2c_status.failures++;
+        }
+        return err;
+}
 
-	for(i=0;i<length;i++){
-            if (MasterWriteI2C1(data[i]))
-                return 1;
-	}
-        StopI2C1();								//Send the Stop condition
-        IdleI2C1();								//Wait to complete
+/**
+ *  @brief  One attempt of a register read (see i2c_write_attempt).
+ *  @param[in]  slave_addr - slave address
+ *  @param[in]  reg_addr   - register address
+ *  @param[in]  length     - number of bytes to read
+ *  @param[in]  *data      - pointer to where register data is to be transfered
+ *  @param[in]  attempt    - 0 for the first one
+ *  @return     0 if sucessfull, I2C_ERR_* otherwise
+ */
+int i2c_read_attempt(unsigned char slave_addr, unsigned char reg_addr, unsigned char length, unsigned char *data, BYTE attempt) {
+
+        int err;
 
-	return 0;
+        if (attempt)
+            i2c_status.retries++;
+        err = i2c_read_once(slave_addr, reg_addr, length, data);
+        if (err != I2C_OK) {
+            i2c_abort();
+            if (attempt >= max_retries)
+                i2c_status.failures++;
+        }
+        return err;
 }
 
 /**
  *  @brief  Write to device using generic i2c protocol
+ *  Every bus phase is bounded by the retry policy timeout. On failure a STOP
+ *  is always sent (and the bus recovered if needed) before retrying.
+ *  @param[in]  slave_addr - slave address
+ *  @param[in]  reg_addr   - register address
+ *  @param[in]  length     - number of bytes to write
+ *  @param[in]  *data      - pointer for data to write
+ *  @return     0 if sucessfull, I2C_ERR_* otherwise
+ */
+int i2c_write(unsigned char slave_addr, unsigned char reg_addr, unsigned char length, unsigned char const *data) {
+
+	BYTE attempt = 0;
+        int  err;
+
+        while ((err = i2c_write_attempt(slave_addr, reg_addr, length, data, attempt)) != I2C_OK && attempt < max_retries)
+            attempt++;
+	return err;
+}
+
+/**
+ *  @brief  Read from device using generic i2c protocol
+ *  Every bus phase is bounded by the retry policy timeout. On failure a STOP
+ *  is always sent (and the bus recovered if needed) before retrying.
  *  @param[in]  slave_addr - slave address
  *  @param[in]  reg_addr   - register address
  *  @param[in]  length     - number of bytes to read
  *  @param[in]  *data      - pointer to where register data is to be transfered
- *  @return     0 if sucessfull, 1 otherwise
+ *  @return     0 if sucessfull, I2C_ERR_* otherwise
  */
 int i2c_read(unsigned char slave_addr, unsigned char reg_addr, unsigned char length, unsigned char *data) {
 
-	BYTE i=2;
-
-	StartI2C1();								//Send the Start Bit
-	IdleI2C1();
-        if (MasterWriteI2C1(((slave_addr<<1)|(0x00))))
-            return 1;
-	IdleI2C1();
-        if (MasterWriteI2C1(reg_addr))
-            return 1;
-	IdleI2C1();
-        StartI2C1();                        //Send the Start Bit
-        IdleI2C1();                         //Wait to complete
-        if (MasterWriteI2C1(((slave_addr<<1)|(0x01))))
-            return 1;
-	IdleI2C1();
-	I2CReceiverEnable ( I2C1, TRUE);
+	BYTE attempt = 0;
+        int  err;
 
-	for(i=0;i<length;i++) {
-            data[i] = MasterReadI2C1();
-		if(i<(length-1)) {
-                    I2CAcknowledgeByte(MPU_I2C, TRUE);
-                    IdleI2C1();
-		}
-		else {
-                    I2CAcknowledgeByte(MPU_I2C, FALSE);
-                    IdleI2C1();
-		}
-	}
-        StopI2C1();								//Send the Stop condition
-        IdleI2C1();								//Wait to complete
-
-	return 0;
-}
\ No newline at end of file
+        while ((err = i2c_read_attempt(slave_addr, reg_addr, length, data, attempt)) != I2C_OK && attempt < max_retries)
+            attempt++;
+	return err;
+}
@@ -17,8 +17,10 @@
 #ifndef I2C_H
 #define	I2C_H
 
-#include <plib.h>
+#include "platform.h"
+#if defined(__PIC32MX__)
 #include <peripheral/i2c.h>
+#endif
 
 //#define MPU_I2C I2C1
 
@@ -28,9 +30,35 @@ typedef enum
     SLAVE
 }i2cmode;
 
+/** @details Transaction results. Anything but I2C_OK means the transfer was aborted. */
+#define I2C_OK              0
+#define I2C_ERR_TIMEOUT     1   /** a bus phase did not complete in time */
+#define I2C_ERR_NACK        2   /** slave did not acknowledge */
+#define I2C_ERR_COLLISION   3   /** bus collision / arbitration lost */
+
+/** @details Default retry policy. */
+#define I2C_TIMEOUT_US      (500)   /** max duration of a single bus phase (start, byte, stop) */
+#define I2C_MAX_RETRIES     (1)     /** extra attempts after a failed transaction */
+
+/** @details Bus health counters. */
+typedef struct {
+    UINT32 timeouts;    /// bus phases that timed out
+    UINT32 nacks;       /// bytes not acknowledged
+    UINT32 collisions;  /// bus collisions on start/write
+    UINT32 retries;     /// transactions retried
+    UINT32 failures;    /// transactions given up after all retries
+    UINT32 recoveries;  /// stuck bus recoveries (SDA clock-out + STOP)
+}i2c_stats;
+
 void i2c_init(I2C_MODULE i2cnum, i2cmode mode, BYTE address);
 int i2c_write(unsigned char slave_addr, unsigned char reg_addr, unsigned char length, unsigned char const *data);
 int i2c_read(unsigned char slave_addr, unsigned char reg_addr, unsigned char length, unsigned char *data);
+int i2c_write_attempt(unsigned char slave_addr, unsigned char reg_addr, unsigned char length, unsigned char const *data, BYTE attempt);
+int i2c_read_attempt(unsigned char slave_addr, unsigned char reg_addr, unsigned char length, unsigned char *data, BYTE attempt);
+void i2c_set_retry_policy(BYTE retries, UINT32 timeout_us);
+BYTE i2c_get_max_retries(void);
+void i2c_recover(void);
+const i2c_stats * i2c_get_stats(void);
 
 #endif	/* I2C_H */
 
@@ -5,56 +5,129 @@
 #include "hardware.h"
 #include "rm3100.h"
 #include "i2c.h"
+#include "scheduler.h"
+#include "pipeline.h"
+#include "cmd.h"
+#include "capture.h"
+#include "fft.h"
+#include "radio_link.h"
+#include "busched.h"
+#include "mpu.h"
+#include "ahrs.h"
+#include "pps.h"
+#include "config.h"
+#include "boot.h"
+#include "power.h"
 
 #define PI          3.14159265358979
 
+#define BIST_PERIOD_MIN 10                  /**< Minutes between background self tests, 0 - off */
+#define SAMPLE_PERIOD_MS 10                 /**< Single measurement request period */
+#define SAMPLE_TIMEOUT_MS 100               /**< Measurement given up if DRDY does not come */
 #define MAG_EXT_CAL 0                   /**< 1 - Using Calibrated Matrix; 0 - Default */
 
 /*================================================================
                  G L O B A L   V A R I A B L E S
 ================================================================*/
-// timer 1
-UINT8 T1overflow = 1;
-// external mpu int
-//BYTE new_data=0;
+// acquisition
+static UINT32 request_tick = 0;
+static BOOL   in_flight    = FALSE;
+static BYTE   bus_mag      = BUS_NO_DEVICE;
+static BYTE   bus_imu      = BUS_NO_DEVICE;
+static BYTE   mag_data[9];
+static UINT32 mag_tick     = 0;     // time stamp of the sample on the bus
+static BOOL   mag_sync     = FALSE; // ... timed by the PPS / trigger input
+static BOOL   request_sync = FALSE;
+static BOOL   on_grid      = FALSE; // single measurements on the PPS grid
+static UINT32 grid_tick    = 0;
+static bus_request mag_req;
+// housekeeping
+static UINT32 uptime_s     = 0;
+static UINT32 bus_events   = 0;
 
 
 #if !MAG_EXT_CAL                    /**< Identity matrix if not using external calibration data. */
-    float mag_offsets [3] = {0, 0, 0};
-    float mag_cal_matrix [3][3] = {{1, 0, 0 },
-                                   {0, 1, 0 },
-                                   {0, 0, 1 }};
+    const float mag_offsets [3] = {0, 0, 0};
+    const float mag_cal_matrix [3][3] = {{1, 0, 0 },
+                                         {0, 1, 0 },
+                                         {0, 0, 1 }};
 #else
-    float mag_offsets [3] = {   };                 /// from a calibration example
-    float mag_cal_matrix [3][3] = {{   }, /// from a calibration example
-                                   {   },
-                                   {   }};
+    const float mag_offsets [3] = {   };                 /// from a calibration example
+    const float mag_cal_matrix [3][3] = {{   }, /// from a calibration example
+                                         {   },
+                                         {   }};
 #endif
 
 /*================================================================
              F U N C T I O N S   P R O T O T Y P E S
 ================================================================*/
-// auxiliary
-float get_time (void);
-void  reset_timer (void);
+// tasks
+void acquisition_task  (UINT32 events);
+void housekeeping_task (UINT32 events);
+void mag_done          (bus_request *r);
+BOOL sample_due        (UINT32 events);
+BOOL drdy_due          (BOOL cmm);
+float sample_rate      (BOOL cmm);
 
 /**
- * Timer 1 ISR
+ * Core Timer ISR - scheduler tick
  *  Interrupt Priority Level = 2
- *  Vector 4
+ *  Vector 0
  */
-void __ISR(TIMER_1_INT_VECTOR, ipl1) _Timer1Handler(void) {
-    // Clear the interrupt flag
-    mT1ClearIntFlag();
-    // Protection to timer overflow
-    T1overflow ++;
+void __ISR(CORE_TIMER_INT_VECTOR, ipl2) _CoreTimerHandler(void) {
+    static UINT16 ticks = 0;
+
+    mCTClearIntFlag();
+    UpdateCoreTimer(CORE_TICK_PERIOD);
+
+    if (++ticks >= SCHED_TICK_HZ){
+        ticks = 0;
+        sched_post(EV_TICK | EV_SECOND);
+    }
+    else
+        sched_post(EV_TICK);
+}
+
+#if DRDY_INT_ENABLED
+/**
+ * External Interrupt 2 ISR - RM3100 DRDY pin
+ *  Interrupt Priority Level = 2
+ *  Vector 11
+ */
+void __ISR(EXTERNAL_2_INT_VECTOR, ipl2) INT2Interrupt() {
+
+    mINT2ClearIntFlag();
+    sched_post(EV_DRDY);
 }
+#endif
+
+#if PPS_INT_ENABLED
+/**
+ * External Interrupt 3 ISR - PPS / trigger input
+ *  Interrupt Priority Level = 4
+ *  Vector 15
+ */
+void __ISR(EXTERNAL_3_INT_VECTOR, ipl4) INT3Interrupt() {
 
-//    void __ISR(EXTERNAL_2_INT_VECTOR, ipl2) INT2Interrupt() {
-//
-//        mINT2ClearIntFlag();
-//        new_data = 1;
-//    }
+    UINT32 t = ReadCoreTimer();     // first thing, the capture jitter is the sync error
+
+    mINT3ClearIntFlag();
+    pps_edge(t);
+}
+#endif
+
+/**
+ * I2C 1 ISR - bus collision
+ *  Interrupt Priority Level = 3
+ *  Vector 25
+ */
+void __ISR(I2C_1_INT_VECTOR, ipl3) _I2C1Handler(void) {
+
+    if (INTGetFlag(INT_I2C1B)){
+        INTClearFlag(INT_I2C1B);
+        sched_post(EV_I2C);
+    }
+}
 
 
 /*================================================================
@@ -64,70 +137,223 @@ void __ISR(TIMER_1_INT_VECTOR, ipl1) _Timer1Handler(void) {
 ================================================================*/
 int main(void)
 {
+    BYTE   revid;
+    UINT16 probes;
+
+    boot_start ();              // core timer from here, reset cause
     BoardInit();                // PIC configurations + i2c,spi,uart,timers,interruptions inicializations
+    boot_mark (BOOT_BOARD);
 
-    int i = 0;
-    i = getRM3100Status ();
-    RM3100_init_SM_Operation ();
-    //RM3100_init_CMM_Operation ();
+    /* first sample first: sensor up, settings, conversion started */
+    revid = RM3100_probe (BOOT_PROBE_MS, &probes);
+    boot_set_sensor (revid, probes);
+    boot_mark (BOOT_SENSOR);
+    if (config_restore ()){     // settings saved with SAVE, or the defaults
+        RM3100_init_SM_Operation ();
+        //RM3100_init_CMM_Operation ();
+        pipeline_set_calibration (mag_offsets, mag_cal_matrix);
+    }
+    boot_mark (BOOT_CONFIG);
+    if (!(getRM3100CMMConfig () & CM_START)){
+        request_tick = ReadCoreTimer ();
+        in_flight    = !requestSingleMeasurement ();
+    }
+    boot_mark (BOOT_REQUEST);
 
-    sensor_xyz raw;
-    BYTE buf[64];
-    float converted_x,converted_y,converted_z;
-    float cycle_time,time_elapsed=0;
-    float gain = getRM3100Gain ();
+    /* the rest of the bring-up while it converts */
+    RM3100_setSelfTestPeriod (BIST_PERIOD_MIN * 60);
+    RM3100_startSelfTest ();    // in the background, in place of one of the first samples
+    radio_link_init ();
+    bus_mag = busched_add_device ("MAG", 0);
+    bus_imu = busched_add_device ("IMU", 1);
+    if (!mpu_init (bus_imu, ahrs_push_imu))
+        ahrs_init (MPU_RATE_HZ, MPU_GYRO_DPS, MPU_ACCEL_LSB_G);
 
-    float time_to_send=0;
     TRISAbits.TRISA2  = 0;	// set RA2 out
 
-    while(1){
+    sched_add("bus",          busched_task,          EV_BUS,                  0);
+    sched_add("pps",          pps_task,              EV_PPS | EV_SECOND,      0);
+    sched_add("acquisition",  acquisition_task,      EV_TICK | EV_DRDY | EV_PPS, 0);
+    sched_add("imu",          mpu_task,              EV_TICK,                 1);
+    sched_add("processing",   pipeline_process_task, EV_SAMPLE,               1);
+    sched_add("output",       pipeline_output_task,  EV_OUTPUT | EV_UART_TX,  2);
+    sched_add("radio",        radio_task,            EV_RADIO | EV_TICK,      2);
+    sched_add("ahrs",         ahrs_task,             EV_AHRS,                 3);
+    sched_add("capture",      capture_task,          EV_CAPTURE | EV_UART_TX, 3);
+    sched_add("command",      cmd_task,              EV_UART_RX,              4);
+    sched_add("housekeeping", housekeeping_task,     EV_SECOND | EV_I2C,      5);
+    sched_add("spectrum",     fft_task,              EV_FFT | EV_UART_TX,     6);
+    power_init ();              // idle hook, in place of the plain CPU idle
+    boot_mark (BOOT_READY);
 
-        cycle_time = get_time();
+    sched_run();
 
-        if (cycle_time > 0.01 && !time_to_send){
-            time_to_send = cycle_time;
-            reset_timer();
-            requestSingleMeasurement ();
-        }
+    return -1;
+}
+
+
+/**
+ *  @brief  Acquisition task: paces single measurements (or follows CMM),
+ *  queues the read on the shared bus when ready (mag_done hands the sample
+ *  to the pipeline). Between two measurements the background self test and
+ *  staged commands get their turn.
+ *  @param[in]  events - EV_TICK, EV_DRDY, EV_PPS
+ *  @return     none
+ */
+void acquisition_task (UINT32 events)
+{
+    BOOL cmm = (getRM3100CMMConfig () & CM_START) != 0;
+    UINT32 period;
+    float hz;
 
-        if(getDataReadyStatus ()){
-//        if(new_data){
+    if (RM3100_selfTestTask (!in_flight && !mag_req.busy))
+        return;                 // sensor busy with the self test
+    if (getRM3100SelfTest ()->runs)
+        boot_mark (BOOT_BIST);
+
+    if ((in_flight || cmm) && !mag_req.busy){
+        if ((events & EV_DRDY) || (!DRDY_INT_ENABLED && drdy_due (cmm) && getDataReadyStatus ())){
             LATAbits.LATA2 = 1;
-            time_elapsed = time_elapsed + time_to_send;
+            in_flight = FALSE;
+
+            /* the data must be off the bus before the next one is ready */
+            period = cmm ? (UINT32) (ONE_SECOND / getRM3100SampleRate ())
+                         : MS_TO_CORE_TICKS(SAMPLE_PERIOD_MS);
+            mag_tick         = cmm ? ReadCoreTimer () : request_tick;
+            mag_sync         = cmm ? pps_locked () : request_sync;
+            mag_req.op       = BUS_READ;
+            mag_req.addr     = RM3100_ADDRESS_00;
+            mag_req.reg      = MX;
+            mag_req.len      = sizeof(mag_data);
+            mag_req.data     = mag_data;
+            mag_req.done     = mag_done;
+            mag_req.deadline = busched_deadline (period);
+            if (busched_submit (bus_mag, &mag_req))
+                LATAbits.LATA2 = 0;
+        }
+        else if (in_flight && CT_TICKS_SINCE(request_tick) > MS_TO_CORE_TICKS(SAMPLE_TIMEOUT_MS)){
+            in_flight = FALSE;  // measurement lost, request a new one
+            power_miss ();
+        }
+    }
 
-//            new_data=0;
+    if (in_flight || mag_req.busy)
+        return;
 
-            raw = ReadRM3100Raw ( );
+    cmd_apply ();               // sample boundary
+    cmm = (getRM3100CMMConfig () & CM_START) != 0;
+    hz  = sample_rate (cmm);
+    power_set_rate (hz);
+    pipeline_set_rate (cmm || pps_get_mode () != PPS_TRIGGER ? hz : 0);
 
-            converted_x = (float) raw.x / gain ;
-            converted_y = (float) raw.y / gain ;
-            converted_z = (float) raw.z / gain ;
+    if (!cmm && sample_due (events)){
+        request_tick = ReadCoreTimer();
+        if (!requestSingleMeasurement ())
+            in_flight = TRUE;
+    }
+}
 
-            sprintf(buf,"%.1f   %.1f   %.1f   %f\n",converted_x,converted_y,converted_z, time_to_send);
-            SendDataBuffer(buf, strlen(buf));
-            time_to_send=0;
-            LATAbits.LATA2 = 0;
+/**
+ *  @brief  Paces single measurements: on each trigger edge, on the
+ *  SAMPLE_PERIOD_MS grid of the pulse while locked, otherwise every
+ *  SAMPLE_PERIOD_MS of the local clock.
+ *  @param[in]  events - of the acquisition task
+ *  @return     TRUE if a measurement is due now
+ */
+BOOL sample_due (UINT32 events)
+{
+    if (pps_get_mode () == PPS_TRIGGER){
+        on_grid      = FALSE;
+        request_sync = TRUE;
+        return (events & EV_PPS) != 0;
+    }
+    if (pps_locked ()){
+        if (!on_grid){
+            grid_tick = pps_next_grid (SAMPLE_PERIOD_MS * 1000);
+            on_grid   = TRUE;
         }
+        if ((INT32) (ReadCoreTimer () - grid_tick) < 0)
+            return FALSE;
+        grid_tick    = pps_next_grid (SAMPLE_PERIOD_MS * 1000);
+        request_sync = TRUE;
+        return TRUE;
     }
-    return -1;
+    on_grid      = FALSE;
+    request_sync = FALSE;
+    return CT_TICKS_SINCE(request_tick) >= MS_TO_CORE_TICKS(SAMPLE_PERIOD_MS);
 }
 
+/**
+ *  @brief  Rate the samples come at: the CMM rate, or a single measurement
+ *  every SAMPLE_PERIOD_MS, fewer if the conversion takes longer.
+ *  @param[in]  cmm - continuous mode running
+ *  @return     Hz
+ */
+float sample_rate (BOOL cmm)
+{
+    float max = getRM3100MaxDataRate ();
+
+    if (cmm)
+        return getRM3100SampleRate ();
+    return max > 0 && max < 1000.0f / SAMPLE_PERIOD_MS ? max : 1000.0f / SAMPLE_PERIOD_MS;
+}
 
-/** Temporization functions */
-float get_time (void)
+/**
+ *  @brief  Without the DRDY interrupt the STATUS register is read on each
+ *  tick; it is only read once the conversion can be over, 7/8 of the
+ *  conversion time after the request or of the CMM period after the last
+ *  sample, so at slow rates the CPU and the bus stay idle in between.
+ *  @param[in]  cmm - continuous mode running
+ *  @return     TRUE if DRDY is worth reading
+ */
+BOOL drdy_due (BOOL cmm)
 {
-    unsigned int temptime;
-    float elapsed_time;
+    float hz = cmm ? getRM3100SampleRate () : getRM3100MaxDataRate ();
 
-    // Colocar em funo
-    temptime = ReadTimer1(); // Reads time elapsed
-    elapsed_time = (float)((double) (temptime * T1overflow * 256 * 4) / PBCLK );// tempo = valortimer*overflow*prescaler*4/fosc ;
+    if (hz <= 0)
+        return TRUE;
+    return CT_TICKS_SINCE(cmm ? mag_tick : request_tick) >= (UINT32) (ONE_SECOND / hz) / 8 * 7;
+}
 
-    return elapsed_time;
+/**
+ *  @brief  End of the magnetometer read on the shared bus, called from the
+ *  bus task.
+ *  @param[in]  r - mag_req
+ *  @return     none
+ */
+void mag_done (bus_request *r)
+{
+    mag_sample s;
+
+    s.raw = UnpackRM3100Raw (r->data, r->status != I2C_OK);
+    if (r->status != I2C_OK || r->late)
+        power_miss ();
+    s.t   = mag_tick;
+    if (mag_sync)
+        s.raw.flags |= SAMPLE_SYNC;
+    if (!(s.raw.flags & SAMPLE_I2C_ERROR)){
+        boot_mark (BOOT_SAMPLE);
+        config_first_sample (ReadCoreTimer ());     // boot time, the core timer starts in boot_start
+    }
+    if (!capture_active ())
+        pipeline_push (&s);     // failed reads too: quality_check counts them, then they are dropped
+    else if (!(s.raw.flags & SAMPLE_I2C_ERROR))
+        capture_push (&s);
+
+    LATAbits.LATA2 = 0;
 }
 
-void reset_timer (void)
+/**
+ *  @brief  Housekeeping task: slow, low priority work.
+ *  @param[in]  events - EV_SECOND, EV_I2C
+ *  @return     none
+ */
+void housekeeping_task (UINT32 events)
 {
-    WriteTimer1(0x00);  // Timer set to 0
-    T1overflow = 1;
+    if (events & EV_SECOND){
+        uptime_s++;
+        power_second ();
+    }
+    if (events & EV_I2C)
+        bus_events++;
 }
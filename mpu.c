@@ -0,0 +1,188 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  I2C
+ *  @{
+ *      @file       mpu.c
+ *      @brief      Minimal MPU-6050 / MPU-6500 accelerometer and gyro driver.
+ *      @details    Three bus requests, at most one of them queued at a time:
+ *                  FIFO count, FIFO data and FIFO reset. The count is polled
+ *                  once per MPU_CHUNK worth of samples; the data is then read
+ *                  out chunk by chunk, each chunk queued from the end of the
+ *                  previous one.
+ */
+#include <string.h>
+#include "mpu.h"
+#include "busched.h"
+#include "i2c.h"
+
+#define MPU_SAMPLE_TICKS    (ONE_SECOND / MPU_RATE_HZ)
+#define MPU_POLL_TICKS      (MPU_CHUNK / MPU_SAMPLE * MPU_SAMPLE_TICKS)
+
+static BYTE          bus_dev = BUS_NO_DEVICE;
+static mpu_sample_fn sample_fn = NULL;
+static UINT16        level   = 0;       // FIFO bytes not read yet
+static UINT32        last_poll;
+static mpu_stats     stats;
+
+static BYTE count_data[2];
+static BYTE fifo_data[MPU_CHUNK];
+static BYTE reset_data = MPU_FIFO_ENABLE | MPU_FIFO_RESET;
+static bus_request count_req, fifo_req, reset_req;
+
+/** Core timer deadline of the FIFO overflow */
+static UINT32 mpu_overflow_deadline ( void ) {
+
+    UINT32 n = (MPU_FIFO_SIZE - level) / MPU_SAMPLE;
+
+    return busched_deadline((n ? n : 1) * MPU_SAMPLE_TICKS);
+}
+
+/** Queues the next chunk of the FIFO */
+static void mpu_read_fifo ( void ) {
+
+    UINT16 n = level < MPU_CHUNK ? level : MPU_CHUNK;
+
+    fifo_req.len      = n - n % MPU_SAMPLE;
+    fifo_req.deadline = mpu_overflow_deadline();
+    if (busched_submit(bus_dev, &fifo_req))
+        level = 0;                      // polled again
+}
+
+/** Empties the FIFO, its sample boundary is lost */
+static void mpu_reset_fifo ( void ) {
+
+    stats.overflows++;
+    level = 0;
+    busched_submit(bus_dev, &reset_req);
+}
+
+static void mpu_count_done ( bus_request *r ) {
+
+    if (r->status != I2C_OK){
+        stats.errors++;
+        return;
+    }
+    level = (UINT16) count_data[0] << 8 | count_data[1];
+    if (level >= MPU_FIFO_SIZE)
+        mpu_reset_fifo();
+    else if (level >= MPU_SAMPLE)
+        mpu_read_fifo();
+}
+
+static void mpu_fifo_done ( bus_request *r ) {
+
+    imu_sample s;
+    const BYTE *p;
+    BYTE i;
+
+    if (r->status != I2C_OK){
+        stats.errors++;
+        mpu_reset_fifo();
+        return;
+    }
+    for (i = 0; i < r->len; i += MPU_SAMPLE){
+        p    = &fifo_data[i];       // big endian, accel then gyro
+        s.ax = (INT16) (p[0]  << 8 | p[1]);
+        s.ay = (INT16) (p[2]  << 8 | p[3]);
+        s.az = (INT16) (p[4]  << 8 | p[5]);
+        s.gx = (INT16) (p[6]  << 8 | p[7]);
+        s.gy = (INT16) (p[8]  << 8 | p[9]);
+        s.gz = (INT16) (p[10] << 8 | p[11]);
+        stats.samples++;
+        if (sample_fn)
+            sample_fn(&s);
+    }
+    level -= r->len;
+    if (level >= MPU_SAMPLE)
+        mpu_read_fifo();
+}
+
+/**
+ *  @brief  Probes and sets up the IMU: MPU_RATE_HZ, +/- 4 g, +/- 500 dps,
+ *  accelerometer and gyro into the FIFO.
+ *  @param[in]  bus_device - from busched_add_device
+ *  @param[in]  fn - called with each sample from the bus task
+ *  @return     0 if successful, 1 if there is no IMU.
+ */
+BOOL mpu_init ( BYTE bus_device, mpu_sample_fn fn ) {
+
+    BYTE id = 0, v;
+
+    bus_dev = BUS_NO_DEVICE;
+    if (i2c_read(MPU_ADDRESS, MPU_WHO_AM_I, 1, &id) || (id != MPU6050_ID && id != MPU6500_ID))
+        return TRUE;
+
+    v = MPU_CLK_PLL_X;
+    if (i2c_write(MPU_ADDRESS, MPU_PWR_MGMT_1, 1, &v))
+        return TRUE;
+    v = 1000 / MPU_RATE_HZ - 1;
+    i2c_write(MPU_ADDRESS, MPU_SMPLRT_DIV, 1, &v);
+    v = MPU_DLPF_42HZ;
+    i2c_write(MPU_ADDRESS, MPU_CONFIG, 1, &v);
+    v = MPU_GYRO_500DPS;
+    i2c_write(MPU_ADDRESS, MPU_GYRO_CONFIG, 1, &v);
+    v = MPU_ACCEL_4G;
+    i2c_write(MPU_ADDRESS, MPU_ACCEL_CONFIG, 1, &v);
+    v = MPU_FIFO_ACCEL_GYRO;
+    i2c_write(MPU_ADDRESS, MPU_FIFO_EN, 1, &v);
+    v = MPU_FIFO_ENABLE | MPU_FIFO_RESET;
+    if (i2c_write(MPU_ADDRESS, MPU_USER_CTRL, 1, &v))
+        return TRUE;
+
+    memset(&stats, 0, sizeof(stats));
+    count_req.op   = BUS_READ;
+    count_req.addr = MPU_ADDRESS;
+    count_req.reg  = MPU_FIFO_COUNTH;
+    count_req.len  = sizeof(count_data);
+    count_req.data = count_data;
+    count_req.done = mpu_count_done;
+    fifo_req.op    = BUS_READ;
+    fifo_req.addr  = MPU_ADDRESS;
+    fifo_req.reg   = MPU_FIFO_R_W;
+    fifo_req.data  = fifo_data;
+    fifo_req.done  = mpu_fifo_done;
+    reset_req.op   = BUS_WRITE;
+    reset_req.addr = MPU_ADDRESS;
+    reset_req.reg  = MPU_USER_CTRL;
+    reset_req.len  = 1;
+    reset_req.data = &reset_data;
+    reset_req.deadline = BUS_NO_DEADLINE;
+
+    level     = 0;
+    last_poll = ReadCoreTimer();
+    sample_fn = fn;
+    bus_dev   = bus_device;
+    return FALSE;
+}
+
+/**
+ *  @brief  request IMU state
+ *  @param[in]  none
+ *  @return     TRUE if mpu_init found and set up the IMU
+ */
+BOOL mpu_present ( void ) { return bus_dev != BUS_NO_DEVICE; }
+
+/**
+ *  @brief  IMU task: polls the FIFO level once per chunk of samples.
+ *  @param[in]  events - EV_TICK
+ *  @return     none
+ */
+void mpu_task ( UINT32 events ) {
+
+    if (bus_dev == BUS_NO_DEVICE || count_req.busy || fifo_req.busy || reset_req.busy
+        || CT_TICKS_SINCE(last_poll) < MPU_POLL_TICKS)
+        return;
+
+    last_poll          = ReadCoreTimer();
+    count_req.deadline = mpu_overflow_deadline();
+    busched_submit(bus_dev, &count_req);
+}
+
+/**
+ *  @brief  Driver counters.
+ *  @param[out] s - copy of the counters
+ *  @return     none
+ */
+void mpu_get_stats ( mpu_stats *s ) { *s = stats; }
@@ -0,0 +1,77 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  I2C
+ *  @{
+ *      @file       mpu.h
+ *      @brief      Minimal MPU-6050 / MPU-6500 accelerometer and gyro driver.
+ *      @details    The IMU shares I2C1 with the RM3100. It samples into its
+ *                  FIFO at MPU_RATE_HZ (accelerometer then gyro, 12 bytes per
+ *                  sample); the driver polls the FIFO level every scheduler
+ *                  tick and reads it out in MPU_CHUNK bytes transactions
+ *                  through the bus scheduler (busched.h), with the FIFO
+ *                  overflow as deadline. A full FIFO is reset and counted.
+ *                  Each sample is handed to the callback given to mpu_init.
+ *
+ *                  Setup (mpu_init) writes the registers directly, before the
+ *                  scheduler runs.
+ */
+#ifndef MPU_H
+#define	MPU_H
+
+#include "platform.h"
+
+#define MPU_ADDRESS         0x68    /** AD0 low */
+
+/// Registers
+#define MPU_SMPLRT_DIV      0x19
+#define MPU_CONFIG          0x1A
+#define MPU_GYRO_CONFIG     0x1B
+#define MPU_ACCEL_CONFIG    0x1C
+#define MPU_FIFO_EN         0x23
+#define MPU_USER_CTRL       0x6A
+#define MPU_PWR_MGMT_1      0x6B
+#define MPU_FIFO_COUNTH     0x72
+#define MPU_FIFO_R_W        0x74
+#define MPU_WHO_AM_I        0x75
+
+/// Register values
+#define MPU_CLK_PLL_X       0x01    /** PWR_MGMT_1: out of sleep, gyro X PLL clock */
+#define MPU_DLPF_42HZ       0x03    /** CONFIG: 1 kHz internal rate */
+#define MPU_GYRO_500DPS     0x08
+#define MPU_ACCEL_4G        0x08
+#define MPU_FIFO_ACCEL_GYRO 0x78    /** FIFO_EN: accel, gyro x, y, z */
+#define MPU_FIFO_ENABLE     0x40    /** USER_CTRL */
+#define MPU_FIFO_RESET      0x04    /** USER_CTRL */
+#define MPU6050_ID          0x68
+#define MPU6500_ID          0x70
+
+#define MPU_RATE_HZ         (200)           /**< 1 kHz / (1 + SMPLRT_DIV) */
+#define MPU_GYRO_DPS        (500)           /**< full scale */
+#define MPU_ACCEL_LSB_G     (8192)          /**< +/- 4 g */
+#define MPU_SAMPLE          (12)            /**< FIFO bytes per sample */
+#define MPU_FIFO_SIZE       (512)           /**< MPU-6500, the MPU-6050 has 1024 */
+#define MPU_CHUNK           (4 * MPU_SAMPLE)    /**< FIFO bytes per bus transaction */
+
+/** @details One sample, sensor counts. */
+typedef struct {
+    INT16 ax, ay, az;
+    INT16 gx, gy, gz;
+}imu_sample;
+
+/** @details Driver counters. */
+typedef struct {
+    UINT32 samples;
+    UINT32 overflows;   /// FIFO resets
+    UINT32 errors;      /// failed transactions
+}mpu_stats;
+
+typedef void (*mpu_sample_fn)( const imu_sample *s );
+
+BOOL mpu_init      ( BYTE bus_device, mpu_sample_fn fn );
+BOOL mpu_present   ( void );
+void mpu_task      ( UINT32 events );
+void mpu_get_stats ( mpu_stats *s );
+
+#endif	/* MPU_H */
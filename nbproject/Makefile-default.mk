@@ -45,17 +45,17 @@ OBJECTDIR=build/${CND_CONF}/${IMAGE_TYPE}
 DISTDIR=dist/${CND_CONF}/${IMAGE_TYPE}
 
 # Source Files Quoted if spaced
-SOURCEFILES_QUOTED_IF_SPACED=hardware.c i2c.c main.c uart.c rm3100.c
+SOURCEFILES_QUOTED_IF_SPACED=hardware.c i2c.c main.c uart.c rm3100.c scheduler.c pipeline.c cmd.c nvm.c capture.c compress.c textfmt.c stats.c fft.c notch.c radio_link.c busched.c mpu.c ahrs.c pps.c resample.c config.c boot.c quality.c power.c
 
 # Object Files Quoted if spaced
-OBJECTFILES_QUOTED_IF_SPACED=${OBJECTDIR}/hardware.o ${OBJECTDIR}/i2c.o ${OBJECTDIR}/main.o ${OBJECTDIR}/uart.o ${OBJECTDIR}/rm3100.o
-POSSIBLE_DEPFILES=${OBJECTDIR}/hardware.o.d ${OBJECTDIR}/i2c.o.d ${OBJECTDIR}/main.o.d ${OBJECTDIR}/uart.o.d ${OBJECTDIR}/rm3100.o.d
+OBJECTFILES_QUOTED_IF_SPACED=${OBJECTDIR}/hardware.o ${OBJECTDIR}/i2c.o ${OBJECTDIR}/main.o ${OBJECTDIR}/uart.o ${OBJECTDIR}/rm3100.o ${OBJECTDIR}/scheduler.o ${OBJECTDIR}/pipeline.o ${OBJECTDIR}/cmd.o ${OBJECTDIR}/nvm.o ${OBJECTDIR}/capture.o ${OBJECTDIR}/compress.o ${OBJECTDIR}/textfmt.o ${OBJECTDIR}/stats.o ${OBJECTDIR}/fft.o ${OBJECTDIR}/notch.o ${OBJECTDIR}/radio_link.o ${OBJECTDIR}/busched.o ${OBJECTDIR}/mpu.o ${OBJECTDIR}/ahrs.o ${OBJECTDIR}/pps.o ${OBJECTDIR}/resample.o ${OBJECTDIR}/config.o ${OBJECTDIR}/boot.o ${OBJECTDIR}/quality.o ${OBJECTDIR}/power.o
+POSSIBLE_DEPFILES=${OBJECTDIR}/hardware.o.d ${OBJECTDIR}/i2c.o.d ${OBJECTDIR}/main.o.d ${OBJECTDIR}/uart.o.d ${OBJECTDIR}/rm3100.o.d ${OBJECTDIR}/scheduler.o.d ${OBJECTDIR}/pipeline.o.d ${OBJECTDIR}/cmd.o.d ${OBJECTDIR}/nvm.o.d ${OBJECTDIR}/capture.o.d ${OBJECTDIR}/compress.o.d ${OBJECTDIR}/textfmt.o.d ${OBJECTDIR}/stats.o.d ${OBJECTDIR}/fft.o.d ${OBJECTDIR}/notch.o.d ${OBJECTDIR}/radio_link.o.d ${OBJECTDIR}/busched.o.d ${OBJECTDIR}/mpu.o.d ${OBJECTDIR}/ahrs.o.d ${OBJECTDIR}/pps.o.d ${OBJECTDIR}/resample.o.d ${OBJECTDIR}/config.o.d ${OBJECTDIR}/boot.o.d ${OBJECTDIR}/quality.o.d ${OBJECTDIR}/power.o.d
 
 # Object Files
-OBJECTFILES=${OBJECTDIR}/hardware.o ${OBJECTDIR}/i2c.o ${OBJECTDIR}/main.o ${OBJECTDIR}/uart.o ${OBJECTDIR}/rm3100.o
+OBJECTFILES=${OBJECTDIR}/hardware.o ${OBJECTDIR}/i2c.o ${OBJECTDIR}/main.o ${OBJECTDIR}/uart.o ${OBJECTDIR}/rm3100.o ${OBJECTDIR}/scheduler.o ${OBJECTDIR}/pipeline.o ${OBJECTDIR}/cmd.o ${OBJECTDIR}/nvm.o ${OBJECTDIR}/capture.o ${OBJECTDIR}/compress.o ${OBJECTDIR}/textfmt.o ${OBJECTDIR}/stats.o ${OBJECTDIR}/fft.o ${OBJECTDIR}/notch.o ${OBJECTDIR}/radio_link.o ${OBJECTDIR}/busched.o ${OBJECTDIR}/mpu.o ${OBJECTDIR}/ahrs.o ${OBJECTDIR}/pps.o ${OBJECTDIR}/resample.o ${OBJECTDIR}/config.o ${OBJECTDIR}/boot.o ${OBJECTDIR}/quality.o ${OBJECTDIR}/power.o
 
 # Source Files
-SOURCEFILES=hardware.c i2c.c main.c uart.c rm3100.c
+SOURCEFILES=hardware.c i2c.c main.c uart.c rm3100.c scheduler.c pipeline.c cmd.c nvm.c capture.c compress.c textfmt.c stats.c fft.c notch.c radio_link.c busched.c mpu.c ahrs.c pps.c resample.c config.c boot.c quality.c power.c
 
 
 CFLAGS=
@@ -121,6 +121,126 @@ ${OBJECTDIR}/rm3100.o: rm3100.c  nbproject/Makefile-${CND_CONF}.mk
 	@${RM} ${OBJECTDIR}/rm3100.o 
 	@${FIXDEPS} "${OBJECTDIR}/rm3100.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/rm3100.o.d" -o ${OBJECTDIR}/rm3100.o rm3100.c   
 	
+${OBJECTDIR}/scheduler.o: scheduler.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/scheduler.o.d 
+	@${RM} ${OBJECTDIR}/scheduler.o 
+	@${FIXDEPS} "${OBJECTDIR}/scheduler.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/scheduler.o.d" -o ${OBJECTDIR}/scheduler.o scheduler.c   
+	
+${OBJECTDIR}/pipeline.o: pipeline.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/pipeline.o.d 
+	@${RM} ${OBJECTDIR}/pipeline.o 
+	@${FIXDEPS} "${OBJECTDIR}/pipeline.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/pipeline.o.d" -o ${OBJECTDIR}/pipeline.o pipeline.c   
+	
+${OBJECTDIR}/cmd.o: cmd.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/cmd.o.d 
+	@${RM} ${OBJECTDIR}/cmd.o 
+	@${FIXDEPS} "${OBJECTDIR}/cmd.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/cmd.o.d" -o ${OBJECTDIR}/cmd.o cmd.c   
+	
+${OBJECTDIR}/nvm.o: nvm.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/nvm.o.d 
+	@${RM} ${OBJECTDIR}/nvm.o 
+	@${FIXDEPS} "${OBJECTDIR}/nvm.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/nvm.o.d" -o ${OBJECTDIR}/nvm.o nvm.c   
+	
+${OBJECTDIR}/capture.o: capture.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/capture.o.d 
+	@${RM} ${OBJECTDIR}/capture.o 
+	@${FIXDEPS} "${OBJECTDIR}/capture.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/capture.o.d" -o ${OBJECTDIR}/capture.o capture.c   
+	
+${OBJECTDIR}/compress.o: compress.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/compress.o.d 
+	@${RM} ${OBJECTDIR}/compress.o 
+	@${FIXDEPS} "${OBJECTDIR}/compress.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/compress.o.d" -o ${OBJECTDIR}/compress.o compress.c   
+	
+${OBJECTDIR}/textfmt.o: textfmt.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/textfmt.o.d 
+	@${RM} ${OBJECTDIR}/textfmt.o 
+	@${FIXDEPS} "${OBJECTDIR}/textfmt.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/textfmt.o.d" -o ${OBJECTDIR}/textfmt.o textfmt.c   
+	
+${OBJECTDIR}/stats.o: stats.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/stats.o.d 
+	@${RM} ${OBJECTDIR}/stats.o 
+	@${FIXDEPS} "${OBJECTDIR}/stats.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/stats.o.d" -o ${OBJECTDIR}/stats.o stats.c   
+	
+${OBJECTDIR}/fft.o: fft.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/fft.o.d 
+	@${RM} ${OBJECTDIR}/fft.o 
+	@${FIXDEPS} "${OBJECTDIR}/fft.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/fft.o.d" -o ${OBJECTDIR}/fft.o fft.c   
+	
+${OBJECTDIR}/notch.o: notch.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/notch.o.d 
+	@${RM} ${OBJECTDIR}/notch.o 
+	@${FIXDEPS} "${OBJECTDIR}/notch.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/notch.o.d" -o ${OBJECTDIR}/notch.o notch.c   
+	
+${OBJECTDIR}/radio_link.o: radio_link.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/radio_link.o.d 
+	@${RM} ${OBJECTDIR}/radio_link.o 
+	@${FIXDEPS} "${OBJECTDIR}/radio_link.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/radio_link.o.d" -o ${OBJECTDIR}/radio_link.o radio_link.c   
+	
+${OBJECTDIR}/busched.o: busched.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/busched.o.d 
+	@${RM} ${OBJECTDIR}/busched.o 
+	@${FIXDEPS} "${OBJECTDIR}/busched.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/busched.o.d" -o ${OBJECTDIR}/busched.o busched.c   
+	
+${OBJECTDIR}/mpu.o: mpu.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/mpu.o.d 
+	@${RM} ${OBJECTDIR}/mpu.o 
+	@${FIXDEPS} "${OBJECTDIR}/mpu.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/mpu.o.d" -o ${OBJECTDIR}/mpu.o mpu.c   
+	
+${OBJECTDIR}/ahrs.o: ahrs.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/ahrs.o.d 
+	@${RM} ${OBJECTDIR}/ahrs.o 
+	@${FIXDEPS} "${OBJECTDIR}/ahrs.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/ahrs.o.d" -o ${OBJECTDIR}/ahrs.o ahrs.c   
+	
+${OBJECTDIR}/pps.o: pps.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/pps.o.d 
+	@${RM} ${OBJECTDIR}/pps.o 
+	@${FIXDEPS} "${OBJECTDIR}/pps.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/pps.o.d" -o ${OBJECTDIR}/pps.o pps.c   
+	
+${OBJECTDIR}/resample.o: resample.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/resample.o.d 
+	@${RM} ${OBJECTDIR}/resample.o 
+	@${FIXDEPS} "${OBJECTDIR}/resample.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/resample.o.d" -o ${OBJECTDIR}/resample.o resample.c   
+	
+${OBJECTDIR}/config.o: config.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/config.o.d 
+	@${RM} ${OBJECTDIR}/config.o 
+	@${FIXDEPS} "${OBJECTDIR}/config.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/config.o.d" -o ${OBJECTDIR}/config.o config.c   
+	
+${OBJECTDIR}/boot.o: boot.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/boot.o.d 
+	@${RM} ${OBJECTDIR}/boot.o 
+	@${FIXDEPS} "${OBJECTDIR}/boot.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/boot.o.d" -o ${OBJECTDIR}/boot.o boot.c   
+	
+${OBJECTDIR}/quality.o: quality.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/quality.o.d 
+	@${RM} ${OBJECTDIR}/quality.o 
+	@${FIXDEPS} "${OBJECTDIR}/quality.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/quality.o.d" -o ${OBJECTDIR}/quality.o quality.c   
+	
+${OBJECTDIR}/power.o: power.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/power.o.d 
+	@${RM} ${OBJECTDIR}/power.o 
+	@${FIXDEPS} "${OBJECTDIR}/power.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/power.o.d" -o ${OBJECTDIR}/power.o power.c   
+	
 else
 ${OBJECTDIR}/hardware.o: hardware.c  nbproject/Makefile-${CND_CONF}.mk
 	@${MKDIR} ${OBJECTDIR} 
@@ -152,6 +272,126 @@ ${OBJECTDIR}/rm3100.o: rm3100.c  nbproject/Makefile-${CND_CONF}.mk
 	@${RM} ${OBJECTDIR}/rm3100.o 
 	@${FIXDEPS} "${OBJECTDIR}/rm3100.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/rm3100.o.d" -o ${OBJECTDIR}/rm3100.o rm3100.c   
 	
+${OBJECTDIR}/scheduler.o: scheduler.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/scheduler.o.d 
+	@${RM} ${OBJECTDIR}/scheduler.o 
+	@${FIXDEPS} "${OBJECTDIR}/scheduler.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/scheduler.o.d" -o ${OBJECTDIR}/scheduler.o scheduler.c   
+	
+${OBJECTDIR}/pipeline.o: pipeline.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/pipeline.o.d 
+	@${RM} ${OBJECTDIR}/pipeline.o 
+	@${FIXDEPS} "${OBJECTDIR}/pipeline.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/pipeline.o.d" -o ${OBJECTDIR}/pipeline.o pipeline.c   
+	
+${OBJECTDIR}/cmd.o: cmd.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/cmd.o.d 
+	@${RM} ${OBJECTDIR}/cmd.o 
+	@${FIXDEPS} "${OBJECTDIR}/cmd.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/cmd.o.d" -o ${OBJECTDIR}/cmd.o cmd.c   
+	
+${OBJECTDIR}/nvm.o: nvm.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/nvm.o.d 
+	@${RM} ${OBJECTDIR}/nvm.o 
+	@${FIXDEPS} "${OBJECTDIR}/nvm.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/nvm.o.d" -o ${OBJECTDIR}/nvm.o nvm.c   
+	
+${OBJECTDIR}/capture.o: capture.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/capture.o.d 
+	@${RM} ${OBJECTDIR}/capture.o 
+	@${FIXDEPS} "${OBJECTDIR}/capture.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/capture.o.d" -o ${OBJECTDIR}/capture.o capture.c   
+	
+${OBJECTDIR}/compress.o: compress.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/compress.o.d 
+	@${RM} ${OBJECTDIR}/compress.o 
+	@${FIXDEPS} "${OBJECTDIR}/compress.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/compress.o.d" -o ${OBJECTDIR}/compress.o compress.c   
+	
+${OBJECTDIR}/textfmt.o: textfmt.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/textfmt.o.d 
+	@${RM} ${OBJECTDIR}/textfmt.o 
+	@${FIXDEPS} "${OBJECTDIR}/textfmt.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/textfmt.o.d" -o ${OBJECTDIR}/textfmt.o textfmt.c   
+	
+${OBJECTDIR}/stats.o: stats.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/stats.o.d 
+	@${RM} ${OBJECTDIR}/stats.o 
+	@${FIXDEPS} "${OBJECTDIR}/stats.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/stats.o.d" -o ${OBJECTDIR}/stats.o stats.c   
+	
+${OBJECTDIR}/fft.o: fft.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/fft.o.d 
+	@${RM} ${OBJECTDIR}/fft.o 
+	@${FIXDEPS} "${OBJECTDIR}/fft.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/fft.o.d" -o ${OBJECTDIR}/fft.o fft.c   
+	
+${OBJECTDIR}/notch.o: notch.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/notch.o.d 
+	@${RM} ${OBJECTDIR}/notch.o 
+	@${FIXDEPS} "${OBJECTDIR}/notch.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/notch.o.d" -o ${OBJECTDIR}/notch.o notch.c   
+	
+${OBJECTDIR}/radio_link.o: radio_link.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/radio_link.o.d 
+	@${RM} ${OBJECTDIR}/radio_link.o 
+	@${FIXDEPS} "${OBJECTDIR}/radio_link.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/radio_link.o.d" -o ${OBJECTDIR}/radio_link.o radio_link.c   
+	
+${OBJECTDIR}/busched.o: busched.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/busched.o.d 
+	@${RM} ${OBJECTDIR}/busched.o 
+	@${FIXDEPS} "${OBJECTDIR}/busched.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/busched.o.d" -o ${OBJECTDIR}/busched.o busched.c   
+	
+${OBJECTDIR}/mpu.o: mpu.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/mpu.o.d 
+	@${RM} ${OBJECTDIR}/mpu.o 
+	@${FIXDEPS} "${OBJECTDIR}/mpu.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/mpu.o.d" -o ${OBJECTDIR}/mpu.o mpu.c   
+	
+${OBJECTDIR}/ahrs.o: ahrs.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/ahrs.o.d 
+	@${RM} ${OBJECTDIR}/ahrs.o 
+	@${FIXDEPS} "${OBJECTDIR}/ahrs.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/ahrs.o.d" -o ${OBJECTDIR}/ahrs.o ahrs.c   
+	
+${OBJECTDIR}/pps.o: pps.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/pps.o.d 
+	@${RM} ${OBJECTDIR}/pps.o 
+	@${FIXDEPS} "${OBJECTDIR}/pps.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/pps.o.d" -o ${OBJECTDIR}/pps.o pps.c   
+	
+${OBJECTDIR}/resample.o: resample.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/resample.o.d 
+	@${RM} ${OBJECTDIR}/resample.o 
+	@${FIXDEPS} "${OBJECTDIR}/resample.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/resample.o.d" -o ${OBJECTDIR}/resample.o resample.c   
+	
+${OBJECTDIR}/config.o: config.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/config.o.d 
+	@${RM} ${OBJECTDIR}/config.o 
+	@${FIXDEPS} "${OBJECTDIR}/config.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/config.o.d" -o ${OBJECTDIR}/config.o config.c   
+	
+${OBJECTDIR}/boot.o: boot.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/boot.o.d 
+	@${RM} ${OBJECTDIR}/boot.o 
+	@${FIXDEPS} "${OBJECTDIR}/boot.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/boot.o.d" -o ${OBJECTDIR}/boot.o boot.c   
+	
+${OBJECTDIR}/quality.o: quality.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/quality.o.d 
+	@${RM} ${OBJECTDIR}/quality.o 
+	@${FIXDEPS} "${OBJECTDIR}/quality.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/quality.o.d" -o ${OBJECTDIR}/quality.o quality.c   
+	
+${OBJECTDIR}/power.o: power.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/power.o.d 
+	@${RM} ${OBJECTDIR}/power.o 
+	@${FIXDEPS} "${OBJECTDIR}/power.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/power.o.d" -o ${OBJECTDIR}/power.o power.c   
+	
 endif
 
 # ------------------------------------------------------------------------------------
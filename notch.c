@@ -0,0 +1,228 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  main
+ *  @{
+ *      @file       notch.c
+ *      @brief      Mains interference notch filter of the raw sample stream.
+ *      @details    The coefficients are worked out in float, only when the
+ *                  sample rate or the tracked frequency change, and kept in
+ *                  Q28. The filter itself is integer: direct form I with the
+ *                  states in counts Q6 and 32 x 32 -> 64 bits products, 5 per
+ *                  notch and axis, so a sample costs at most
+ *                  3 x NOTCH_HARMONICS x 5 multiply / adds.
+ *
+ *                  b1 is derived from the rounded b0, a1, a2 so that
+ *                  b0 + b1 + b2 = 1 + a1 + a2 exactly: the static field goes
+ *                  through with gain 1 whatever the rounding.
+ */
+#include <math.h>
+#include "notch.h"
+#include "fft.h"
+#include "pipeline.h"
+
+#define Q28     (1L << 28)
+
+/** @details Coefficients of one notch, Q28. b2 = b0. */
+typedef struct {
+    INT32 b0, b1, a1, a2;
+}notch_coef;
+
+/** @details State of one notch on one axis, counts Q6. */
+typedef struct {
+    INT32 x1, x2, y1, y2;
+}notch_state;
+
+static notch_coef  coef[NOTCH_HARMONICS];
+static notch_state state[3][NOTCH_HARMONICS];
+static BYTE   sections = 0;
+static UINT16 nominal  = 0;         // Hz, 0 = off
+static UINT32 mains    = 0;         // tracked, mHz
+static float  fs       = 0;         // sample rate the coefficients are for
+static UINT32 fft_seen = 0;         // last spectrum block used for tracking
+static BOOL   primed   = FALSE;
+
+/** Frequency f (mHz) folded into 0..fs/2 */
+static UINT32 notch_alias ( UINT32 f, UINT32 fs_mhz ) {
+
+    f %= fs_mhz;
+    return f > fs_mhz / 2 ? fs_mhz - f : f;
+}
+
+/** Places the notches for the current rate and mains frequency */
+static void notch_design ( void ) {
+
+    UINT32 fs_mhz = (UINT32) (fs * 1000 + 0.5f), fa[NOTCH_HARMONICS];
+    float c, t, a2;
+    BYTE h, i;
+
+    sections = 0;
+    if (!nominal || !fs_mhz)
+        return;
+
+    t  = tanf(3.14159265f * NOTCH_BW_MHZ / fs_mhz);
+    a2 = (1 - t) / (1 + t);
+    for (h = 1; h <= NOTCH_HARMONICS; h++){
+        fa[sections] = notch_alias(h * mains, fs_mhz);
+        if (fa[sections] < NOTCH_MIN_MHZ || fa[sections] + NOTCH_MIN_MHZ > fs_mhz / 2)
+            continue;                   // a pole would go to z = 1 or -1
+        for (i = 0; i < sections; i++)
+            if (fa[i] + NOTCH_BW_MHZ / 2 > fa[sections] && fa[i] < fa[sections] + NOTCH_BW_MHZ / 2)
+                break;
+        if (i < sections)
+            continue;                   // already notched
+
+        c = cosf(2 * 3.14159265f * fa[sections] / fs_mhz);
+        coef[sections].a2 = (INT32) lroundf(a2 * Q28);
+        coef[sections].a1 = (INT32) lroundf(-(1 + a2) * c * Q28);
+        coef[sections].b0 = (INT32) lroundf((1 + a2) / 2 * Q28);
+        coef[sections].b1 = Q28 + coef[sections].a1 + coef[sections].a2 - 2 * coef[sections].b0;
+        sections++;
+    }
+}
+
+/** Moves the notches to the mains frequency seen in the last spectrum */
+static void notch_track ( void ) {
+
+    fft_result r;
+    UINT32 best_amp = NOTCH_MIN_AMP, f, k, est = 0;
+    INT32 d;
+    BYTE axis, i, h, j;
+
+    for (axis = 0; axis < 3; axis++){
+        if (fft_get(axis, &r) || r.fs_mhz != (UINT32) (fs * 1000 + 0.5f))
+            return;
+        for (i = 0; i < FFT_PEAKS; i++){
+            if (r.peak[i].amp < best_amp || r.peak[i].freq_mhz < NOTCH_MIN_MHZ
+                || r.peak[i].freq_mhz + NOTCH_MIN_MHZ > r.fs_mhz / 2)
+                continue;               // near DC or fs/2: not notched, and folds both ways
+            /* unfold: the peak is k fs +/- f for one harmonic h of the mains,
+               aliased harmonics can fit too, the lowest one wins */
+            for (h = 1; h <= NOTCH_HARMONICS && r.peak[i].amp != best_amp; h++){
+                f = notch_alias(h * nominal * 1000, r.fs_mhz);
+                if (f < NOTCH_MIN_MHZ || f + NOTCH_MIN_MHZ > r.fs_mhz / 2)
+                    continue;           // this harmonic is never notched: nothing to track it by
+                k = (h * nominal * 1000 + r.fs_mhz / 2) / r.fs_mhz;
+                for (j = 0; j < 2; j++){
+                    if (!j && k * r.fs_mhz < r.peak[i].freq_mhz)
+                        continue;
+                    f = j ? k * r.fs_mhz + r.peak[i].freq_mhz : k * r.fs_mhz - r.peak[i].freq_mhz;
+                    d = (INT32) (f / h) - nominal * 1000;
+                    if (d >= -NOTCH_TRACK_MHZ && d <= NOTCH_TRACK_MHZ){
+                        best_amp = r.peak[i].amp;
+                        est      = f / h;
+                    }
+                }
+            }
+        }
+    }
+    if (!est)
+        return;
+
+    mains += ((INT32) est - (INT32) mains) / 2;
+    notch_design();
+}
+
+/**
+ *  @brief  Sets the nominal mains frequency and restarts the filter.
+ *  @param[in]  hz - 45 to 65, 0 = filter off
+ *  @return     0 if successful, 1 otherwise.
+ */
+BOOL notch_set_mains ( UINT16 hz ) {
+
+    if (hz && (hz < 45 || hz > 65))
+        return TRUE;
+
+    nominal = hz;
+    mains   = hz * 1000;
+    fs      = pipeline_get_rate();
+    notch_design();
+    notch_reset();
+    return FALSE;
+}
+
+/**
+ *  @brief  request tracked mains frequency
+ *  @param[in]  none
+ *  @return     mHz, 0 if the filter is off
+ */
+UINT32 notch_get_mains ( void ) { return nominal ? mains : 0; }
+
+/**
+ *  @brief  request nominal mains frequency
+ *  @param[in]  none
+ *  @return     Hz, 0 if the filter is off
+ */
+UINT16 notch_get_nominal ( void ) { return nominal; }
+
+/**
+ *  @brief  request number of notches in use per axis
+ *  @param[in]  none
+ *  @return     0 to NOTCH_HARMONICS
+ */
+BYTE notch_count ( void ) { return sections; }
+
+/**
+ *  @brief  Restarts the filter state from the next sample.
+ *  @param[in]  none
+ *  @return     none
+ */
+void notch_reset ( void ) { primed = FALSE; }
+
+/**
+ *  @brief  Filters a raw sample in place. Samples with a bus error are
+ *  left alone.
+ *  @param[in,out]  raw - counts
+ *  @return     none
+ */
+void notch_filter ( sensor_xyz *raw ) {
+
+    INT32 v[3] = { raw->x, raw->y, raw->z };
+    const notch_coef *c;
+    notch_state *s;
+    INT64 acc;
+    INT32 x, y;
+    fft_result r;
+    float rate;
+    BYTE a, i;
+
+    if (!nominal || (raw->flags & SAMPLE_I2C_ERROR))
+        return;
+
+    rate = pipeline_get_rate();
+    if (rate != fs){
+        fs = rate;
+        notch_design();
+    }
+    if (!fft_get(2, &r) && r.block != fft_seen){
+        fft_seen = r.block;
+        notch_track();
+    }
+
+    for (a = 0; a < 3; a++){
+        x = v[a] << 6;
+        if (!primed){
+            /* start in the steady state of a constant field */
+            for (i = 0; i < NOTCH_HARMONICS; i++)
+                state[a][i].x1 = state[a][i].x2 = state[a][i].y1 = state[a][i].y2 = x;
+        }
+        for (i = 0; i < sections; i++){
+            c   = &coef[i];
+            s   = &state[a][i];
+            acc = (INT64) c->b0 * (x + s->x2) + (INT64) c->b1 * s->x1
+                - (INT64) c->a1 * s->y1 - (INT64) c->a2 * s->y2;
+            y   = (INT32) ((acc + (1 << 27)) >> 28);
+            s->x2 = s->x1;
+            s->x1 = x;
+            s->y2 = s->y1;
+            s->y1 = y;
+            x = y;
+        }
+        v[a] = (x + 32) >> 6;
+    }
+    raw->x = v[0];
+    raw->y = v[1];
+    raw->z = v[2];
+    primed = TRUE;
+}
@@ -0,0 +1,53 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  main
+ *  @{
+ *      @file       notch.h
+ *      @brief      Mains interference notch filter of the raw sample stream.
+ *      @details    A cascade of up to NOTCH_HARMONICS second order notches per
+ *                  axis, at the mains fundamental and its harmonics as seen at
+ *                  the sample rate of the stream (pipeline_get_rate: CMM or
+ *                  single measurements, aliased when the rate is below twice
+ *                  the harmonic; no notch if the samples are not paced). Harmonics falling closer than NOTCH_MIN_MHZ to
+ *                  DC are skipped so the static field is never touched, and
+ *                  so are those as close to fs/2, where the notch has unity
+ *                  gain whatever its frequency and one of its poles nears
+ *                  z = -1. Harmonics aliasing on top of each other share
+ *                  one notch.
+ *                  Each notch is
+ *
+ *                  H(z) = (1 + a2) / 2 (1 - 2 c z^-1 + z^-2) / (1 - (1 + a2) c z^-1 + a2 z^-2)
+ *
+ *                  with c = cos(2 pi f / fs) and a2 set by NOTCH_BW_MHZ, unity
+ *                  gain at DC.
+ *
+ *                  The mains frequency drifts, so it is tracked: when a new
+ *                  spectrum block is available (fft.c) the strongest peak
+ *                  that unfolds to within NOTCH_TRACK_MHZ of the nominal
+ *                  frequency moves the notches; only harmonics that get a
+ *                  notch at the nominal frequency are unfolded, so at 100 Hz
+ *                  the 50 Hz mains, all on DC and fs/2, is left alone. Without spectrum the notches
+ *                  stay at the nominal frequency.
+ */
+#ifndef NOTCH_H
+#define	NOTCH_H
+
+#include "platform.h"
+#include "rm3100.h"
+
+#define NOTCH_HARMONICS     (5)         /**< notches per axis, max */
+#define NOTCH_BW_MHZ        (1000)      /**< -3 dB width of each notch */
+#define NOTCH_MIN_MHZ       (2000)      /**< no notch below this frequency */
+#define NOTCH_TRACK_MHZ     (1500)      /**< tracking range around the nominal frequency */
+#define NOTCH_MIN_AMP       (300)       /**< peak needed to track, milli counts */
+
+BOOL   notch_set_mains  ( UINT16 hz );
+UINT32 notch_get_mains  ( void );
+UINT16 notch_get_nominal( void );
+BYTE   notch_count      ( void );
+void   notch_reset      ( void );
+void   notch_filter     ( sensor_xyz *raw );
+
+#endif	/* NOTCH_H */
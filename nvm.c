@@ -0,0 +1,121 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  nvm
+ *  @brief       Program flash access.
+ *  @{
+ *      @file       nvm.c
+ *      @brief      Erase/program of reserved program flash regions.
+ *      @details    The CPU stalls while flash is erased or programmed, so
+ *                  callers schedule these operations between samples.
+ *                  Durations are measured for that purpose.
+ */
+#include "nvm.h"
+
+static nvm_stats stats;
+
+/** Accounts one operation */
+static BOOL nvm_done ( UINT32 start, unsigned int result ) {
+
+    UINT32 used = ReadCoreTimer() - start;
+
+    if (used > stats.max_ticks)
+        stats.max_ticks = used;
+    if (result){
+        stats.errors++;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+#if defined(__PIC32MX__)
+
+/**
+ *  @brief  Erases one flash page.
+ *  @param[in]  page - page aligned address
+ *  @return     0 if successful, 1 otherwise.
+ */
+BOOL nvm_erase_page ( const void *page ) {
+
+    UINT32 start = ReadCoreTimer();
+
+    stats.erases++;
+    return nvm_done(start, NVMErasePage((void *) page));
+}
+
+/**
+ *  @brief  Programs one flash row (NVM_ROW_SIZE bytes).
+ *  @param[in]  row  - row aligned address
+ *  @param[in]  data - word aligned RAM buffer
+ *  @return     0 if successful, 1 otherwise.
+ */
+BOOL nvm_write_row ( const void *row, const void *data ) {
+
+    UINT32 start = ReadCoreTimer();
+
+    stats.rows++;
+    return nvm_done(start, NVMWriteRow((void *) row, (void *) data));
+}
+
+/**
+ *  @brief  Programs one flash word.
+ *  @param[in]  address - word aligned address
+ *  @param[in]  word    - value
+ *  @return     0 if successful, 1 otherwise.
+ */
+BOOL nvm_write_word ( const void *address, UINT32 word ) {
+
+    UINT32 start = ReadCoreTimer();
+
+    stats.words++;
+    return nvm_done(start, NVMWriteWord((void *) address, word));
+}
+
+#else   /* host flash simulation */
+
+BOOL nvm_erase_page ( const void *page ) {
+
+    UINT32 start = ReadCoreTimer();
+
+    stats.erases++;
+    if ((uintptr_t) page & (NVM_PAGE_SIZE-1))
+        return nvm_done(start, 1);
+    memset((void *) page, 0xFF, NVM_PAGE_SIZE);
+    return nvm_done(start, 0);
+}
+
+BOOL nvm_write_row ( const void *row, const void *data ) {
+
+    UINT32 start = ReadCoreTimer();
+    BYTE *dst = (BYTE *) row;
+    const BYTE *src = data;
+    UINT32 i;
+
+    stats.rows++;
+    if ((uintptr_t) row & (NVM_ROW_SIZE-1))
+        return nvm_done(start, 1);
+    for (i = 0; i < NVM_ROW_SIZE; i++)
+        dst[i] &= src[i];
+    return nvm_done(start, 0);
+}
+
+BOOL nvm_write_word ( const void *address, UINT32 word ) {
+
+    UINT32 start = ReadCoreTimer();
+
+    stats.words++;
+    if ((uintptr_t) address & 3)
+        return nvm_done(start, 1);
+    *(UINT32 *) address &= word;
+    return nvm_done(start, 0);
+}
+
+#endif
+
+/**
+ *  @brief  Flash operation counters.
+ *  @param[in]  none
+ *  @return     pointer to the counters
+ */
+const nvm_stats * nvm_get_stats ( void ) { return &stats; }
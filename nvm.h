@@ -0,0 +1,44 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  nvm
+ *  @brief       Program flash access.
+ *  @{
+ *      @file       nvm.h
+ *      @brief      Erase/program of reserved program flash regions.
+ *      @details    On the PIC32 flash is memory mapped and programmed with the
+ *                  plib NVM calls. On the host the same calls work on a RAM
+ *                  array with flash semantics (erase to 0xFF, programming can
+ *                  only clear bits).
+ */
+#ifndef NVM_H
+#define	NVM_H
+
+#include "platform.h"
+
+#define NVM_PAGE_SIZE       (4096)      /**< Erase unit (PIC32MX795F512L) */
+#define NVM_ROW_SIZE        (512)       /**< Program unit */
+
+/** Reserves a page aligned region of program flash */
+#if defined(__PIC32MX__)
+#define NVM_REGION(name, size)  const BYTE name[size] __attribute__((aligned(NVM_PAGE_SIZE))) = { 0 }
+#else
+#define NVM_REGION(name, size)  BYTE name[size] __attribute__((aligned(NVM_PAGE_SIZE)))
+#endif
+
+/** @details Operation counters. */
+typedef struct {
+    UINT32 erases;
+    UINT32 rows;
+    UINT32 words;
+    UINT32 errors;
+    UINT32 max_ticks;   /// longest erase/program (core timer ticks)
+}nvm_stats;
+
+BOOL nvm_erase_page ( const void *page );
+BOOL nvm_write_row  ( const void *row, const void *data );
+BOOL nvm_write_word ( const void *address, UINT32 word );
+const nvm_stats * nvm_get_stats ( void );
+
+#endif	/* NVM_H */
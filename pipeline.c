@@ -0,0 +1,451 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  main
+ *  @{
+ *      @file       pipeline.c
+ *      @brief      Processing and output stages of the sample stream.
+ *      @details    Queues are single producer / single consumer and only
+ *                  touched from task context, so they need no locking.
+ */
+#include "pipeline.h"
+#include "scheduler.h"
+#include "uart.h"
+#include "compress.h"
+#include "fft.h"
+#include "notch.h"
+#include "radio_link.h"
+#include "ahrs.h"
+#include "pps.h"
+#include "resample.h"
+#include "quality.h"
+
+/* Acquisition -> processing */
+static mag_sample raw_q[PIPE_DEPTH];
+static BYTE       raw_head = 0, raw_tail = 0;
+/* Processing -> output */
+static mag_field  out_q[PIPE_DEPTH];
+static BYTE       out_head = 0, out_tail = 0;
+
+static UINT32     dropped = 0;
+/* Time base */
+static UINT32     last_t  = 0;
+static UINT64     elapsed = 0;
+/* Sensor configuration of the samples being processed */
+static BYTE       epoch   = 0;
+static BOOL       have_epoch = FALSE;
+static float      gain    = 75;
+static float      rate    = 0;          // Hz the samples come at, 0 = not paced
+/* Settings */
+static BYTE       format  = FMT_TEXT;
+static BYTE       average = 1;
+/* Averaging */
+static long       sum_x, sum_y, sum_z;
+static BYTE       n_sum   = 0, sum_flags = 0;
+/* Binary frames */
+static UINT16     seq     = 0;
+static BYTE       cfg_epoch;
+static BOOL       cfg_sent = FALSE;     // configuration frame of cfg_epoch
+/* Compressed stream */
+static zstream    zs;
+/* Statistics summary waiting for room in the transmit ring */
+static BOOL       summary_due = FALSE;
+/* Calibration, field = matrix * (field - offsets) */
+static float      cal_offsets[3];
+static float      cal_matrix[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+static BOOL       calibrated = FALSE;
+
+/**
+ *  @brief  Queues a raw sample for processing.
+ *  @param[in]  s - sample
+ *  @return     0 if queued, 1 if the queue was full and the sample dropped.
+ */
+BOOL pipeline_push ( const mag_sample *s ) {
+
+    if ((BYTE)(raw_head - raw_tail) >= PIPE_DEPTH){
+        dropped++;
+        return TRUE;
+    }
+    raw_q[raw_head++ & (PIPE_DEPTH-1)] = *s;
+    sched_post(EV_SAMPLE);
+
+    return FALSE;
+}
+
+/**
+ *  @brief  Sets the rate the samples are pushed at: the CMM rate, or the
+ *  request rate of single measurements, 0 if they are not paced (trigger
+ *  input). The acquisition sets it at the sample boundary, with the
+ *  configuration.
+ *  @param[in]  hz - sample rate
+ *  @return     none
+ */
+void pipeline_set_rate ( float hz ) { rate = hz; }
+
+/**
+ *  @brief  request sample rate of the stream
+ *  @param[in]  none
+ *  @return     Hz, 0 if the samples are not paced
+ */
+float pipeline_get_rate ( void ) { return rate; }
+
+/**
+ *  First sample of another sensor configuration: its gain from now on, and
+ *  nothing mixed across the change (partial average, grid interpolation,
+ *  filter state and statistics start again).
+ */
+static void pipeline_epoch ( sensor_xyz *raw ) {
+
+    if (have_epoch){
+        raw->flags |= SAMPLE_EPOCH;
+        resample_restart();
+        notch_reset();
+        stats_reset();
+        sum_x = sum_y = sum_z = 0;
+        n_sum = sum_flags = 0;
+    }
+    epoch      = raw->epoch;
+    gain       = RM3100_getEpoch(epoch)->gain;
+    have_epoch = TRUE;
+}
+
+/**
+ *  Next sample for the averaging: checked, through the front filters, then on the
+ *  output grid when resampling. Returns 0 with a sample, 1 if none is ready.
+ */
+static BOOL pipeline_next ( sensor_xyz *raw, UINT32 *t ) {
+
+    mag_sample *s;
+
+    while (resample_pull(raw, t)){
+        if (raw_tail == raw_head)
+            return TRUE;
+        s = &raw_q[raw_tail++ & (PIPE_DEPTH-1)];
+        if (!(s->raw.flags & SAMPLE_I2C_ERROR) && (!have_epoch || s->raw.epoch != epoch))
+            pipeline_epoch(&s->raw);
+        quality_check(&s->raw, s->t);   // counts failed reads, the stages below skip them
+        fft_update(&s->raw);            // the spectrum sees the interference
+        notch_filter(&s->raw);
+        stats_update(&s->raw);
+        if (resample_push(&s->raw, s->t)){
+            if (s->raw.flags & SAMPLE_I2C_ERROR)
+                continue;               // read failed, nothing to output
+            *raw = s->raw;              // no grid, as measured
+            *t   = s->t;
+            return FALSE;
+        }
+    }
+    return FALSE;
+}
+
+/** Applies the hard / soft iron correction to a field in uT */
+static void pipeline_calibrate ( mag_field *f ) {
+
+    float x = f->x - cal_offsets[0];
+    float y = f->y - cal_offsets[1];
+    float z = f->z - cal_offsets[2];
+
+    f->x = cal_matrix[0][0] * x + cal_matrix[0][1] * y + cal_matrix[0][2] * z;
+    f->y = cal_matrix[1][0] * x + cal_matrix[1][1] * y + cal_matrix[1][2] * z;
+    f->z = cal_matrix[2][0] * x + cal_matrix[2][1] * y + cal_matrix[2][2] * z;
+}
+
+/**
+ *  @brief  Magnitude of a raw sample converted and calibrated like the output.
+ *  @param[in]  raw - counts, of the epoch being processed
+ *  @return     |field|^2, uT^2
+ */
+float pipeline_field_norm2 ( const sensor_xyz *raw ) {
+
+    mag_field f;
+
+    f.x = (float) raw->x / gain;
+    f.y = (float) raw->y / gain;
+    f.z = (float) raw->z / gain;
+    if (calibrated)
+        pipeline_calibrate(&f);
+    return f.x * f.x + f.y * f.y + f.z * f.z;
+}
+
+/**
+ *  @brief  Processing task: resamples, averages and converts counts to uT.
+ *  @param[in]  events - EV_SAMPLE
+ *  @return     none
+ */
+void pipeline_process_task ( UINT32 events ) {
+
+    sensor_xyz raw;
+    UINT32     t;
+    mag_field  *f;
+
+    for (;;){
+        if ((BYTE)(out_head - out_tail) >= PIPE_DEPTH){
+            if (raw_tail != raw_head || resample_pending())
+                sched_post(EV_SAMPLE);  // output is behind, try again later
+            break;
+        }
+        if (pipeline_next(&raw, &t))
+            break;
+
+        sum_x     += raw.x;
+        sum_y     += raw.y;
+        sum_z     += raw.z;
+        sum_flags |= raw.flags;
+        if (++n_sum < average)
+            continue;
+
+        f = &out_q[out_head & (PIPE_DEPTH-1)];
+        if (average == 1){
+            f->x = (float) sum_x / gain ;
+            f->y = (float) sum_y / gain ;
+            f->z = (float) sum_z / gain ;
+        }
+        else{
+            f->x = (float) sum_x / average / gain ;
+            f->y = (float) sum_y / average / gain ;
+            f->z = (float) sum_z / average / gain ;
+        }
+        if (calibrated)
+            pipeline_calibrate(f);
+        ahrs_mag(f->x, f->y, f->z);
+        f->raw.x     = sum_x / average;
+        f->raw.y     = sum_y / average;
+        f->raw.z     = sum_z / average;
+        f->raw.flags = sum_flags;
+        f->raw.epoch = epoch;
+        f->flags     = sum_flags;
+
+        f->dt    = (float) (t - last_t) / ONE_SECOND;
+        elapsed += t - last_t;
+        f->t_us  = (UINT32) (elapsed / (ONE_SECOND/1000000));
+        if ((f->flags & SAMPLE_SYNC) && pps_locked())
+            f->t_us = pps_time_us(t);       // time of the pulse, same on every board
+        last_t   = t;
+
+        radio_push(f->t_us, &f->raw);
+
+        sum_x = sum_y = sum_z = 0;
+        n_sum = sum_flags = 0;
+        out_head++;
+    }
+    sched_post(EV_OUTPUT);
+}
+
+/** Packs a 24 bits 2's complement value big endian */
+static void put24 ( BYTE *p, long v ) {
+
+    p[0] = v >> 16;
+    p[1] = v >> 8;
+    p[2] = v;
+}
+
+/**
+ *  @brief  Builds a binary frame.
+ *  @param[out] frame - FRAME_SIZE bytes
+ *  @param[in]  seq, t_us, raw (counts and flags)
+ *  @return     FRAME_SIZE
+ */
+BYTE pipeline_pack_frame ( BYTE *frame, UINT16 seq, UINT32 t_us, const sensor_xyz *raw ) {
+
+    frame[0]  = FRAME_SYNC0;
+    frame[1]  = FRAME_SYNC1;
+    frame[2]  = seq;
+    frame[3]  = seq >> 8;
+    frame[4]  = t_us;
+    frame[5]  = t_us >> 8;
+    frame[6]  = t_us >> 16;
+    frame[7]  = t_us >> 24;
+    put24(&frame[8],  raw->x);
+    put24(&frame[11], raw->y);
+    put24(&frame[14], raw->z);
+    frame[17] = raw->flags;
+    frame[18] = pipeline_crc8(&frame[2], FRAME_SIZE-3);
+
+    return FRAME_SIZE;
+}
+
+/**
+ *  @brief  Builds a configuration frame.
+ *  @param[out] frame - FRAME_CFG_SIZE bytes
+ *  @param[in]  epoch, cycle_count - of the frames that follow
+ *  @return     FRAME_CFG_SIZE
+ */
+BYTE pipeline_pack_config ( BYTE *frame, BYTE epoch, UINT16 cycle_count ) {
+
+    frame[0] = FRAME_SYNC0;
+    frame[1] = FRAME_CFG_SYNC1;
+    frame[2] = epoch;
+    frame[3] = cycle_count;
+    frame[4] = cycle_count >> 8;
+    frame[5] = pipeline_crc8(&frame[2], FRAME_CFG_SIZE-3);
+
+    return FRAME_CFG_SIZE;
+}
+
+/**
+ *  @brief  Output task: formats processed samples straight into the UART
+ *  transmit ring. Waits for EV_UART_TX when the ring is full. In
+ *  FMT_SUMMARY samples are only counted and a statistics line is sent
+ *  every period.
+ *  @param[in]  events - EV_OUTPUT, EV_UART_TX
+ *  @return     none
+ */
+void pipeline_output_task ( UINT32 events ) {
+
+    BYTE bounce[PIPE_MAX_LINE];
+    BYTE *p;
+    UINT32 n;
+    uart_txw w;
+    mag_field *f;
+
+    if (format == FMT_SUMMARY){
+        out_tail = out_head;            // samples only feed the statistics
+        if (!summary_due)
+            summary_due = stats_due();
+        if (summary_due && !UARTTxReserve(&w, PIPE_MAX_LINE)){
+            p = UARTTxDirect(&w, PIPE_MAX_LINE, bounce);
+            UARTTxAdvance(&w, p, stats_format((char *) p));
+            UARTTxCommit(&w);
+            summary_due = FALSE;
+        }
+        return;
+    }
+
+    while (out_tail != out_head){
+        if (UARTTxReserve(&w, PIPE_MAX_LINE))
+            return;
+        p = UARTTxDirect(&w, PIPE_MAX_LINE, bounce);
+        f = &out_q[out_tail & (PIPE_DEPTH-1)];
+
+        if (format == FMT_BINARY){
+            n = 0;
+            if (!cfg_sent || f->raw.epoch != cfg_epoch){
+                cfg_epoch = f->raw.epoch;
+                cfg_sent  = TRUE;
+                n = pipeline_pack_config(p, cfg_epoch, RM3100_getEpoch(cfg_epoch)->cycle_count);
+            }
+            n += pipeline_pack_frame(p + n, seq++, f->t_us, &f->raw);
+        }
+        else if (format == FMT_COMPRESSED){
+            n = zs_encode(&zs, p, f->t_us, &f->raw, RM3100_getEpoch(f->raw.epoch)->cycle_count);
+        }
+        else{
+            n = textfmt_sample((char *) p, f->x, f->y, f->z, f->dt);
+        }
+        UARTTxAdvance(&w, p, n);
+        UARTTxCommit(&w);
+        out_tail++;
+    }
+}
+
+/**
+ *  @brief  Samples dropped because processing fell behind.
+ *  @param[in]  none
+ *  @return     dropped samples since reset
+ */
+UINT32 pipeline_dropped ( void ) { return dropped; }
+
+/**
+ *  @brief  Selects the output format. Call between samples.
+ *  @param[in]  FMT_* value
+ *  @return     0 if successful, 1 otherwise.
+ */
+BOOL pipeline_set_format ( BYTE fmt ) {
+
+    if (fmt >= FMT_COUNT)
+        return TRUE;
+
+    if (fmt == FMT_COMPRESSED)
+        zs_init(&zs, ZS_INTERVAL);     // start with a keyframe
+    cfg_sent = FALSE;                   // and binary with a configuration frame
+    format = fmt;
+    return FALSE;
+}
+/**
+ *  @brief  request output format
+ *  @param[in]  none
+ *  @return     FMT_* value
+ */
+BYTE pipeline_get_format ( void ) { return format; }
+
+/**
+ *  @brief  Sets the number of samples averaged into each output (boxcar
+ *  decimation filter). Call between samples.
+ *  @param[in]  n - 1 (no filter) to PIPE_MAX_AVERAGE
+ *  @return     0 if successful, 1 otherwise.
+ */
+BOOL pipeline_set_average ( BYTE n ) {
+
+    if (n < 1 || n > PIPE_MAX_AVERAGE)
+        return TRUE;
+
+    average = n;
+    sum_x = sum_y = sum_z = 0;
+    n_sum = sum_flags = 0;
+    return FALSE;
+}
+/**
+ *  @brief  request averaging length
+ *  @param[in]  none
+ *  @return     samples per output
+ */
+BYTE pipeline_get_average ( void ) { return average; }
+
+/**
+ *  @brief  Sets the calibration applied to the field in uT:
+ *  field = matrix * (field - offsets). Call between samples.
+ *  @param[in]  offsets - hard iron offsets, uT
+ *  @param[in]  matrix - soft iron correction
+ *  @return     none
+ */
+void pipeline_set_calibration ( const float offsets[3], const float matrix[3][3] ) {
+
+    BYTE i, j;
+
+    calibrated = FALSE;
+    for (i = 0; i < 3; i++){
+        cal_offsets[i] = offsets[i];
+        if (offsets[i] != 0)
+            calibrated = TRUE;
+        for (j = 0; j < 3; j++){
+            cal_matrix[i][j] = matrix[i][j];
+            if (matrix[i][j] != (i == j))
+                calibrated = TRUE;      // identity is skipped
+        }
+    }
+}
+
+/**
+ *  @brief  request calibration in use
+ *  @param[out] offsets - hard iron offsets, uT
+ *  @param[out] matrix - soft iron correction
+ *  @return     none
+ */
+void pipeline_get_calibration ( float offsets[3], float matrix[3][3] ) {
+
+    BYTE i, j;
+
+    for (i = 0; i < 3; i++){
+        offsets[i] = cal_offsets[i];
+        for (j = 0; j < 3; j++)
+            matrix[i][j] = cal_matrix[i][j];
+    }
+}
+
+/**
+ *  @brief  CRC-8 (poly 0x07, init 0) used by the binary frames.
+ *  @param[in]  data, length
+ *  @return     crc
+ */
+BYTE pipeline_crc8 ( const BYTE *data, BYTE length ) {
+
+    BYTE crc = 0, i;
+
+    while (length--){
+        crc ^= *data++;
+        for (i = 0; i < 8; i++)
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+    }
+    return crc;
+}
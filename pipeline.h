@@ -0,0 +1,77 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  main
+ *  @{
+ *      @file       pipeline.h
+ *      @brief      Processing and output stages of the sample stream.
+ *      @details    Acquisition pushes raw samples, the processing task converts
+ *                  them and the output task formats and sends them. Stages are
+ *                  linked by small queues and run as scheduler tasks.
+ */
+#ifndef PIPELINE_H
+#define	PIPELINE_H
+
+#include "platform.h"
+#include "rm3100.h"
+#include "textfmt.h"
+#include "stats.h"
+
+#define PIPE_DEPTH          (8)     /**< Queue length, power of 2 */
+#define PIPE_MAX_AVERAGE    (16)    /**< Max samples averaged into one output */
+#define PIPE_MAX_LINE       (STATS_MAX_LINE) /**< Transmit space reserved per output, >= TEXTFMT_MAX_LINE */
+
+/// Output formats
+#define FMT_TEXT            0       /** "%.1f   %.1f   %.1f   %f\n" lines in uT and seconds */
+#define FMT_BINARY          1       /** FRAME_SIZE bytes frames with raw counts */
+#define FMT_COMPRESSED      2       /** delta + varint stream, see compress.h */
+#define FMT_SUMMARY         3       /** a statistics line every period, see stats.h */
+#define FMT_COUNT           4
+
+/// Binary frame: sync(2) seq(2) t_us(4) x(3) y(3) z(3) flags(1) crc8(1)
+/// seq and t_us little endian, x,y,z raw counts 24 bits big endian 2's complement,
+/// crc8 (poly 0x07) over seq..flags.
+#define FRAME_SYNC0         0xA5
+#define FRAME_SYNC1         0x5A
+#define FRAME_SIZE          (19)
+/// Configuration frame, before the first frame of the stream and of each
+/// epoch: sync(2) epoch(1) cycle_count(2) crc8(1), cycle_count little endian,
+/// the frames after it are scaled with CC_GAIN(cycle_count).
+#define FRAME_CFG_SYNC1     0x5C
+#define FRAME_CFG_SIZE      (6)
+
+/** @details Raw sample as acquired. */
+typedef struct {
+    sensor_xyz raw;
+    UINT32     t;       /// core timer tick of the measurement
+}mag_sample;
+
+/** @details Sample converted to uT. */
+typedef struct {
+    sensor_xyz raw;     /// raw counts (averaged)
+    float x, y, z;
+    float dt;           /// seconds since the previous sample
+    UINT32 t_us;        /// microseconds since the first sample (wraps)
+    BYTE  flags;
+}mag_field;
+
+BOOL   pipeline_push         ( const mag_sample *s );
+void   pipeline_process_task ( UINT32 events );
+void   pipeline_output_task  ( UINT32 events );
+UINT32 pipeline_dropped      ( void );
+void   pipeline_set_rate     ( float hz );
+float  pipeline_get_rate     ( void );
+
+BOOL   pipeline_set_format   ( BYTE format );
+BYTE   pipeline_get_format   ( void );
+BOOL   pipeline_set_average  ( BYTE n );
+BYTE   pipeline_get_average  ( void );
+void   pipeline_set_calibration ( const float offsets[3], const float matrix[3][3] );
+void   pipeline_get_calibration ( float offsets[3], float matrix[3][3] );
+float  pipeline_field_norm2  ( const sensor_xyz *raw );
+BYTE   pipeline_crc8         ( const BYTE *data, BYTE length );
+BYTE   pipeline_pack_frame   ( BYTE *frame, UINT16 seq, UINT32 t_us, const sensor_xyz *raw );
+BYTE   pipeline_pack_config  ( BYTE *frame, BYTE epoch, UINT16 cycle_count );
+
+#endif	/* PIPELINE_H */
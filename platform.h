@@ -0,0 +1,45 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  sched
+ *  @{
+ *      @file       platform.h
+ *      @brief      Types and primitives shared by the PIC32 and the Linux host build.
+ *      @details    On the PIC32 this is just plib. On the host the few plib
+ *                  types and calls used by the portable modules (scheduler,
+ *                  pipeline...) are declared here and implemented in host_port.c.
+ */
+#ifndef PLATFORM_H
+#define	PLATFORM_H
+
+#if defined(__PIC32MX__)
+
+#include <plib.h>
+
+#else
+
+#include <stdint.h>
+#include <string.h>
+
+typedef unsigned char       BYTE;
+typedef unsigned char       UINT8;
+typedef unsigned short      UINT16;
+typedef unsigned int        UINT32;
+typedef unsigned long long  UINT64;
+typedef signed char         INT8;
+typedef short               INT16;
+typedef int                 INT32;
+typedef long long           INT64;
+typedef enum _BOOL { FALSE = 0, TRUE } BOOL;
+typedef unsigned int        I2C_MODULE;
+
+UINT32       ReadCoreTimer        ( void );
+unsigned int INTDisableInterrupts ( void );
+void         INTRestoreInterrupts ( unsigned int status );
+
+#endif
+
+#include "hardware.h"
+
+#endif	/* PLATFORM_H */
@@ -0,0 +1,235 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  sched
+ *  @{
+ *      @file       power.c
+ *      @brief      Idle policy of the scheduler and peripheral bus clock.
+ *      @details    The divider is kept as the PBDIV field (0..3, divider
+ *                  1..8), which GetPeripheralClock() reads back.
+ */
+#include <stdio.h>
+#include "power.h"
+#include "scheduler.h"
+#include "rm3100.h"
+#include "textfmt.h"
+#include "uart.h"
+
+static const char * const names[] = { "idle", "low", "run" };
+
+static BYTE   mode     = POWER_IDLE;
+static BYTE   pb_shift = 0;         // PBDIV in use
+static BYTE   target   = 0;         // PBDIV wanted by the policy
+static UINT16 hold     = 0;         // seconds left at the full bus clock
+static float  rate     = 0;         // configured sample rate, Hz
+static power_stats cur, last;       // this second, the one before
+static UINT32 busy_prev, second_start;
+
+/** Core timer ticks the tasks have run (wraps) */
+static UINT32 power_busy_ticks ( void ) {
+
+    const sched_task *t;
+    UINT32 busy = 0;
+    BYTE n;
+
+    for (t = sched_get_tasks(&n); n; n--, t++)
+        busy += t->ticks;
+    return busy;
+}
+
+/** TRUE if the UART baud rate is within POWER_BAUD_ERR_PCT at this
+ *  divider, BRG rounded to nearest as UARTSetDataRate does with BRGH */
+static BOOL power_baud_ok ( BYTE shift ) {
+
+    UINT32 quarter = (SYS_FREQ >> shift) / 4;
+    UINT32 baud    = quarter / ((quarter + UARTBAUDRATE / 2) / UARTBAUDRATE);
+    UINT32 err     = baud > UARTBAUDRATE ? baud - UARTBAUDRATE : UARTBAUDRATE - baud;
+
+    return err * 100 <= (UINT32) UARTBAUDRATE * POWER_BAUD_ERR_PCT;
+}
+
+/** Changes the bus divider when the UART is quiet, with the baud rates
+ *  that depend on it; otherwise it is tried again at the next idle */
+static void power_set_shift ( BYTE shift ) {
+
+#if defined(__PIC32MX__)
+    static const UINT32 code[] = { OSC_PB_DIV_1, OSC_PB_DIV_2, OSC_PB_DIV_4, OSC_PB_DIV_8 };
+    unsigned int status;
+
+    status = INTDisableInterrupts();
+    if (UARTIsIdle()){
+        OSCSetPBDIV(code[shift]);
+        UARTSetDataRate(UART_MODULE_ID, GetPeripheralClock(), UARTBAUDRATE);
+        I2CSetFrequency(MPU_I2C, GetPeripheralClock(), BRG);
+        pb_shift = shift;
+    }
+    INTRestoreInterrupts(status);
+#else
+    pb_shift = shift;
+#endif
+}
+
+/**
+ *  @brief  Installs the idle hook and starts the first second.
+ *  @param[in]  none
+ *  @return     none
+ */
+void power_init ( void ) {
+
+    memset(&cur, 0, sizeof(cur));
+    memset(&last, 0, sizeof(last));
+    busy_prev    = power_busy_ticks();
+    second_start = ReadCoreTimer();
+    sched_set_idle_hook(power_idle);
+}
+
+/**
+ *  @brief  Scheduler idle hook: nothing is pending. Called from the task
+ *  level, so no bus transaction is running.
+ *  @param[in]  none
+ *  @return     none
+ */
+void power_idle ( void ) {
+
+#if defined(__PIC32MX__)
+    UINT32 due, late;
+#endif
+
+    if (pb_shift != target)
+        power_set_shift(target);
+    if (mode == POWER_RUN)
+        return;
+
+#if defined(__PIC32MX__)
+    due = _CP0_GET_COMPARE();       // next scheduler tick
+    PowerSaveIdle();
+    late = ReadCoreTimer() - due;
+    if (late < CORE_TICK_PERIOD){   // woken by that tick, not before
+        cur.wakes++;
+        cur.wake_ticks += late;
+        if (late > cur.wake_max)
+            cur.wake_max = late;
+    }
+#endif
+}
+
+/**
+ *  @brief  Once a second: closes the figures of the second and moves the
+ *  bus divider (see power.h).
+ *  @param[in]  none
+ *  @return     none
+ */
+void power_second ( void ) {
+
+    UINT32 now = ReadCoreTimer(), busy = power_busy_ticks();
+    BYTE allowed = 0;
+    BOOL bad;
+
+    cur.busy_ticks    = busy - busy_prev;
+    cur.elapsed_ticks = now - second_start;
+    busy_prev    = busy;
+    second_start = now;
+    last = cur;
+    memset(&cur, 0, sizeof(cur));
+
+    if (mode == POWER_LOW)
+        while ((1 << (allowed + 1)) <= POWER_MAX_DIV && rate * (1 << (allowed + 1)) <= POWER_RATE_DIV_HZ
+               && power_baud_ok(allowed + 1))
+            allowed++;
+
+    bad = last.misses || last.wake_max > uS_TO_CORE_TICKS(POWER_WAKE_MAX_US)
+          || (UINT64) last.busy_ticks * 100 > (UINT64) last.elapsed_ticks * POWER_MAX_DUTY_PCT;
+    if (bad && pb_shift)
+        hold = POWER_HOLD_S;
+
+    if (hold){
+        hold--;
+        target = 0;
+    }
+    else if (target < allowed)
+        target++;
+    else
+        target = allowed;
+}
+
+/**
+ *  @brief  A sample came late or was lost; counted against the divider.
+ *  @param[in]  none
+ *  @return     none
+ */
+void power_miss ( void ) { cur.misses++; }
+
+/**
+ *  @brief  Sets the configured sample rate, for the divider and the
+ *  sensor current.
+ *  @param[in]  hz - samples per second
+ *  @return     none
+ */
+void power_set_rate ( float hz ) { rate = hz; }
+
+/**
+ *  @brief  Sets the idle policy. Leaving POWER_LOW puts the full bus clock
+ *  back at the next idle.
+ *  @param[in]  m - POWER_*
+ *  @return     0 if successful, 1 if unknown.
+ */
+BOOL power_set_mode ( BYTE m ) {
+
+    if (m > POWER_RUN)
+        return TRUE;
+
+    mode = m;
+    hold = 0;
+    if (m != POWER_LOW)
+        target = 0;
+    return FALSE;
+}
+
+/**
+ *  @brief  request idle policy
+ *  @param[in]  none
+ *  @return     POWER_*
+ */
+BYTE power_get_mode ( void ) { return mode; }
+
+/**
+ *  @brief  request peripheral bus divider in use
+ *  @param[in]  none
+ *  @return     1, 2, 4 or 8
+ */
+BYTE power_get_pbdiv ( void ) { return 1 << pb_shift; }
+
+/**
+ *  @brief  Estimated current of the last second (see power.h).
+ *  @param[out] sensor_ua - RM3100 at the configured rate, uA
+ *  @return     PIC32, uA
+ */
+UINT32 power_current_ua ( UINT32 *sensor_ua ) {
+
+    float duty = last.elapsed_ticks ? (float) last.busy_ticks / last.elapsed_ticks : 0;
+    float ua   = mode == POWER_RUN ? POWER_RUN_UA : duty * POWER_RUN_UA + (1 - duty) * POWER_IDLE_UA;
+
+    *sensor_ua = (UINT32) (rate * getRM3100CycleCount() * POWER_RM3100_UA_80 / 80);
+    return (UINT32) ua + (POWER_PB_UA >> pb_shift);
+}
+
+/**
+ *  @brief  Formats the policy and the last second (see power.h).
+ *  @param[out] out - POWER_MAX_LINE bytes
+ *  @return     line length
+ */
+UINT32 power_format ( char *out ) {
+
+    char r[TEXTFMT_MAX_FIELD + 1], d[TEXTFMT_MAX_FIELD + 1];
+    UINT32 ua, sensor_ua;
+
+    ua = power_current_ua(&sensor_ua);
+    textfmt_fixed(r, rate, 3);
+    textfmt_fixed(d, last.elapsed_ticks ? 100.0f * last.busy_ticks / last.elapsed_ticks : 0, 2);
+    return sprintf(out, "POWER mode %s pbdiv %u rate %s duty %s%% wake_ns %lu max_ns %lu hold %u misses %lu est_ua %lu sensor_ua %lu\n",
+                   names[mode], 1 << pb_shift, r, d,
+                   (unsigned long) (last.wakes ? (UINT64) last.wake_ticks * 1000000000 / ONE_SECOND / last.wakes : 0),
+                   (unsigned long) ((UINT64) last.wake_max * 1000000000 / ONE_SECOND),
+                   hold, (unsigned long) last.misses, (unsigned long) ua, (unsigned long) sensor_ua);
+}
@@ -0,0 +1,99 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  sched
+ *  @{
+ *      @file       power.h
+ *      @brief      Idle policy of the scheduler and peripheral bus clock.
+ *      @details    The scheduler calls power_idle when no task has anything
+ *                  pending. Modes (POWER command, kept by SAVE):
+ *
+ *                  POWER_IDLE  the CPU waits in idle mode for the next
+ *                              interrupt (core timer tick, DRDY, UART, PPS,
+ *                              timer 1); the peripherals keep running.
+ *                  POWER_LOW   the same, and the peripheral bus clock is
+ *                              divided (PBDIV 2, 4 or 8) when the configured
+ *                              sample rate allows it: rate times divider up
+ *                              to POWER_RATE_DIV_HZ. The UART and I2C baud
+ *                              rate dividers are set again with it; a
+ *                              divider is only used if the UART (BRGH, 4x)
+ *                              still gets within POWER_BAUD_ERR_PCT of
+ *                              UARTBAUDRATE. At 230400 that is all of them:
+ *                              -0.2% at PBDIV 1, +0.9% at 2, -1.4% at 4
+ *                              and 8.
+ *                  POWER_RUN   no wait, the CPU spins: the reference for the
+ *                              figures of the other two.
+ *
+ *                  Sleep mode is not used and SYS_FREQ is not lowered: both
+ *                  would stop or slow the core timer, the time base of the
+ *                  scheduler and of the sample time stamps.
+ *
+ *                  Each wait ended by the scheduler tick measures the wake
+ *                  up latency, from the tick due to the scheduler running
+ *                  again (the tick interrupt included). With the bus clock
+ *                  divided, a wake up longer than POWER_WAKE_MAX_US, a CPU
+ *                  duty cycle over POWER_MAX_DUTY_PCT, or a sample that came
+ *                  late or was lost (power_miss) puts the full clock back at
+ *                  once and holds it for POWER_HOLD_S; otherwise the divider
+ *                  goes up one step per second towards the one allowed.
+ *                  The divider only changes between two bytes on the UART,
+ *                  with nothing queued, and between bus transactions.
+ *
+ *                  The POWER command reports the last second as
+ *
+ *                  POWER mode idle|low|run pbdiv d rate r duty p% wake_ns w
+ *                  max_ns m hold h misses n est_ua c sensor_ua s
+ *
+ *                  est_ua is the PIC32 current worked out from the duty
+ *                  cycle and the divider with the typical figures of the
+ *                  datasheet (3.3 V, 25 C); sensor_ua is the RM3100 at the
+ *                  configured rate and cycle count. Board regulator, radio
+ *                  and IMU are not included.
+ */
+#ifndef POWER_H
+#define	POWER_H
+
+#include "platform.h"
+
+/// Modes
+#define POWER_IDLE          0   /** CPU idle between events, default (0 in older saved records) */
+#define POWER_LOW           1   /** idle and peripheral bus clock divided by the rate */
+#define POWER_RUN           2   /** no wait */
+
+#define POWER_MAX_DIV       (8)         /**< peripheral bus divider, 10 MHz bus */
+#define POWER_RATE_DIV_HZ   (160)       /**< sample rate times divider allowed */
+#define POWER_BAUD_ERR_PCT  (2)         /**< UART baud rate error allowed with the bus divided */
+#define POWER_WAKE_MAX_US   (20)        /**< longest wake up with the bus divided */
+#define POWER_MAX_DUTY_PCT  (50)        /**< busiest second with the bus divided */
+#define POWER_HOLD_S        (60)        /**< full bus clock kept after a miss */
+/** Typical currents, PIC32MX795F512L at 80 MHz */
+#define POWER_RUN_UA        (63000)     /**< core running */
+#define POWER_IDLE_UA       (24000)     /**< core in idle mode */
+#define POWER_PB_UA         (12000)     /**< peripheral bus at SYS_FREQ, scales with 1 / divider */
+/** RM3100: 260 uA at 8 Hz and cycle count 200, uA per Hz and cycle count, x 1/80 */
+#define POWER_RM3100_UA_80  (13)
+#define POWER_MAX_LINE      (192)
+
+/** @details Figures of the last second. */
+typedef struct {
+    UINT32 busy_ticks;      /// tasks running
+    UINT32 elapsed_ticks;
+    UINT32 wakes;           /// waits ended by the scheduler tick
+    UINT32 wake_ticks;      /// ... summed
+    UINT32 wake_max;        /// core timer ticks
+    UINT32 misses;          /// samples late or lost
+}power_stats;
+
+void   power_init      ( void );
+void   power_idle      ( void );
+void   power_second    ( void );
+void   power_miss      ( void );
+void   power_set_rate  ( float hz );
+BOOL   power_set_mode  ( BYTE mode );
+BYTE   power_get_mode  ( void );
+BYTE   power_get_pbdiv ( void );
+UINT32 power_current_ua( UINT32 *sensor_ua );
+UINT32 power_format    ( char *out );
+
+#endif	/* POWER_H */
@@ -0,0 +1,232 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  main
+ *  @{
+ *      @file       pps.c
+ *      @brief      External pulse per second / trigger input (INT3).
+ *      @details    The interrupt only stores the edge tick and posts EV_PPS;
+ *                  pps_task does the bookkeeping. The tracked rate (core
+ *                  timer ticks per second) is Q16, its error is folded in by
+ *                  1/2^PPS_TRACK_SHIFT per edge (the first interval sets it
+ *                  outright): a frequency loop, the phase is taken again at
+ *                  every edge. Time stamps are therefore
+ *                  off by the capture jitter of the last edge plus the rate
+ *                  error times the time since it.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "pps.h"
+#include "scheduler.h"
+
+#define PPS_RING        (4)             /**< edges waiting for the task, power of 2 */
+#define NS_PER_TICK     (1000000000 / ONE_SECOND)
+
+static volatile UINT32 ring[PPS_RING];
+static volatile BYTE   r_head = 0;
+static BYTE   r_tail = 0;
+
+static BYTE   mode      = PPS_OFF;
+static BOOL   have_edge = FALSE;
+static BOOL   lock      = FALSE;
+static BYTE   good      = 0;            // edges in a row within tolerance
+static BYTE   bad       = 0;            // rejected in a row
+static UINT32 last_edge;                // core timer tick
+static UINT32 seconds   = 0;            // since the first edge
+static INT64  period    = (INT64) ONE_SECOND << 16;
+static pps_stats stats;
+
+/**
+ *  @brief  Edge capture, from the INT3 interrupt.
+ *  @param[in]  tick - core timer at the edge
+ *  @return     none
+ */
+void pps_edge ( UINT32 tick ) {
+
+    if ((BYTE)(r_head - r_tail) < PPS_RING)
+        ring[r_head++ & (PPS_RING-1)] = tick;
+    sched_post(EV_PPS);
+}
+
+/** Checks an edge against the prediction and tracks the rate */
+static void pps_discipline ( UINT32 t ) {
+
+    UINT32 d = t - last_edge, p = (UINT32) (period >> 16), n;
+    INT64 err, tol;
+    INT32 ns;
+
+    if (!have_edge){
+        have_edge = TRUE;
+        last_edge = t;
+        return;
+    }
+
+    n   = (d + p / 2) / p;
+    err = ((INT64) d << 16) - (INT64) n * period;
+    tol = ((INT64) n * p * PPS_MAX_PPM / 1000000) << 16;
+    if (!n || err > tol || err < -tol){
+        stats.rejected++;
+        good = 0;
+        if (++bad >= PPS_LOCK_EDGES){
+            lock = FALSE;                   // the pulse moved, start again from it
+            last_edge = t;
+            bad = 0;
+        }
+        return;
+    }
+
+    ns = (INT32) ((err * NS_PER_TICK) >> 16);
+    stats.offset_ns = ns;
+    if (lock){
+        if ((UINT32) (ns < 0 ? -ns : ns) > stats.max_ns)
+            stats.max_ns = ns < 0 ? -ns : ns;
+        stats.sum_sq += (INT64) ns * ns;
+        stats.n_sq++;
+    }
+
+    if (good)
+        period += (err / n) >> PPS_TRACK_SHIFT;
+    else
+        period = ((INT64) d << 16) / n;     // first interval: take the rate as it is
+    stats.missed += n - 1;
+    seconds  += n;
+    last_edge = t;
+    bad = 0;
+    if (good < PPS_LOCK_EDGES && ++good == PPS_LOCK_EDGES)
+        lock = TRUE;
+}
+
+/**
+ *  @brief  PPS task: processes the captured edges, drops the lock after
+ *  PPS_HOLDOVER_MS without edge.
+ *  @param[in]  events - EV_PPS, EV_SECOND
+ *  @return     none
+ */
+void pps_task ( UINT32 events ) {
+
+    while (r_tail != r_head){
+        if (mode == PPS_SYNC)
+            pps_discipline(ring[r_tail & (PPS_RING-1)]);
+        if (mode != PPS_OFF)
+            stats.edges++;
+        r_tail++;
+    }
+
+    if (lock && CT_TICKS_SINCE(last_edge) > MS_TO_CORE_TICKS(PPS_HOLDOVER_MS)){
+        lock = FALSE;
+        good = 0;
+    }
+}
+
+/**
+ *  @brief  Sets the input mode; restarts the discipline and the statistics.
+ *  @param[in]  m - PPS_OFF, PPS_SYNC, PPS_TRIGGER
+ *  @return     0 if successful, 1 otherwise.
+ */
+BOOL pps_set_mode ( BYTE m ) {
+
+    if (m > PPS_TRIGGER)
+        return TRUE;
+
+    mode      = m;
+    have_edge = lock = FALSE;
+    good      = bad = 0;
+    seconds   = 0;
+    period    = (INT64) ONE_SECOND << 16;
+    r_tail    = r_head;
+    memset(&stats, 0, sizeof(stats));
+    return FALSE;
+}
+
+/**
+ *  @brief  request input mode
+ *  @param[in]  none
+ *  @return     PPS_OFF, PPS_SYNC, PPS_TRIGGER
+ */
+BYTE pps_get_mode ( void ) { return mode; }
+
+/**
+ *  @brief  request lock state
+ *  @param[in]  none
+ *  @return     TRUE if time stamps follow the pulse
+ */
+BOOL pps_locked ( void ) {
+
+    return mode == PPS_SYNC && lock && CT_TICKS_SINCE(last_edge) <= MS_TO_CORE_TICKS(PPS_HOLDOVER_MS);
+}
+
+/**
+ *  @brief  Synchronised time of a core timer tick, valid while locked.
+ *  @param[in]  tick - e.g. a sample time stamp, within PPS_HOLDOVER_MS of
+ *              the last edge
+ *  @return     microseconds since the first edge (wraps)
+ */
+UINT32 pps_time_us ( UINT32 tick ) {
+
+    INT32 dt = (INT32) (tick - last_edge);
+
+    return seconds * 1000000 + (UINT32) (((INT64) dt * 1000000 << 16) / period);
+}
+
+/**
+ *  @brief  Next instant on a grid of period_us counted from the last edge.
+ *  @param[in]  period_us - grid step, divides a second for the grid to
+ *              stay the same from edge to edge
+ *  @return     core timer tick
+ */
+UINT32 pps_next_grid ( UINT32 period_us ) {
+
+    UINT32 el = ReadCoreTimer() - last_edge;
+    UINT64 us = ((UINT64) el * 1000000 << 16) / period, k = us / period_us + 1;
+
+    return last_edge + (UINT32) ((k * period_us * period / 1000000) >> 16);
+}
+
+/**
+ *  @brief  request core timer rate against the pulse
+ *  @param[in]  none
+ *  @return     error in thousandths of ppm, positive if the oscillator is fast
+ */
+INT32 pps_ppm_milli ( void ) {
+
+    return (INT32) ((period - ((INT64) ONE_SECOND << 16)) * 1000000000 / ONE_SECOND >> 16);
+}
+
+/**
+ *  @brief  Edge statistics.
+ *  @param[out] s - copy of the counters
+ *  @return     none
+ */
+void pps_get_stats ( pps_stats *s ) { *s = stats; }
+
+/**
+ *  @brief  Formats the statistics: "PPS mode m lock l edges e missed m
+ *  rejected r ppm p.ppp offset_ns o jitter_ns j max_ns x".
+ *  @param[out] out - PPS_MAX_LINE bytes
+ *  @return     line length
+ */
+UINT32 pps_format ( char *out ) {
+
+    INT32 ppm = pps_ppm_milli();
+    UINT32 a  = ppm < 0 ? -ppm : ppm;
+    UINT64 ms = stats.n_sq ? stats.sum_sq / stats.n_sq : 0, r = 0, b = (UINT64) 1 << 62;
+
+    /* jitter: integer square root of the mean square offset */
+    while (b > ms)
+        b >>= 2;
+    while (b){
+        if (ms >= r + b){
+            ms -= r + b;
+            r   = (r >> 1) + b;
+        }
+        else
+            r >>= 1;
+        b >>= 2;
+    }
+    return sprintf(out, "PPS mode %u lock %u edges %lu missed %lu rejected %lu ppm %s%lu.%03lu offset_ns %ld jitter_ns %lu max_ns %lu\n",
+                   mode, pps_locked(), (unsigned long) stats.edges, (unsigned long) stats.missed,
+                   (unsigned long) stats.rejected, ppm < 0 ? "-" : "", (unsigned long) (a / 1000),
+                   (unsigned long) (a % 1000), (long) stats.offset_ns, (unsigned long) r,
+                   (unsigned long) stats.max_ns);
+}
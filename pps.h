@@ -0,0 +1,74 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  main
+ *  @{
+ *      @file       pps.h
+ *      @brief      External pulse per second / trigger input (INT3).
+ *      @details    PPS_SYNC: the edges of a 1 Hz pulse (GPS receiver, or a
+ *                  line shared by several boards) discipline the sample time
+ *                  stamps. Each edge is captured with the core timer in the
+ *                  interrupt; the core timer rate is tracked from the edge
+ *                  intervals and a time stamp is the number of edges seen
+ *                  plus the time since the last edge at the tracked rate.
+ *                  Boards on the same pulse then agree on the time within
+ *                  the capture jitter, whatever their oscillators; the
+ *                  second count starts at the lock, boards on the same
+ *                  pulse are told apart in whole seconds by their local
+ *                  times. Single measurements are requested on the sample
+ *                  period grid counted from the edge, so the boards also
+ *                  sample together (within the scheduler tick).
+ *
+ *                  Every edge is checked against the prediction of the
+ *                  previous ones: the difference is the offset statistic,
+ *                  its RMS the jitter. Edges more than PPS_MAX_PPM off the
+ *                  prediction are rejected as glitches, missing edges are
+ *                  bridged and counted. Without edge for PPS_HOLDOVER_MS the
+ *                  lock is lost and time stamps go back to the local clock.
+ *
+ *                  PPS_TRIGGER: every edge requests a single measurement at
+ *                  once, whatever its rate, for a trigger shared by several
+ *                  boards; the time stamp stays local.
+ *
+ *                  Samples timed by the pulse carry SAMPLE_SYNC.
+ */
+#ifndef PPS_H
+#define	PPS_H
+
+#include "platform.h"
+
+/// Modes
+#define PPS_OFF             0
+#define PPS_SYNC            1
+#define PPS_TRIGGER         2
+
+#define PPS_MAX_PPM         (500)       /**< edge accepted within this of the prediction */
+#define PPS_LOCK_EDGES      (4)         /**< good edges in a row to lock */
+#define PPS_HOLDOVER_MS     (2500)      /**< lock lost without edge */
+#define PPS_TRACK_SHIFT     (3)         /**< rate tracking, 1/8 of the error per edge */
+#define PPS_MAX_LINE        (128)
+
+/** @details Edge statistics, since the mode was set. */
+typedef struct {
+    UINT32 edges;
+    UINT32 missed;      /// bridged seconds without edge
+    UINT32 rejected;    /// glitches
+    INT32  offset_ns;   /// last edge against its prediction
+    UINT32 max_ns;      /// largest |offset| while locked
+    UINT64 sum_sq;      /// offsets while locked, ns^2
+    UINT32 n_sq;
+}pps_stats;
+
+void   pps_edge        ( UINT32 tick );
+BOOL   pps_set_mode    ( BYTE mode );
+BYTE   pps_get_mode    ( void );
+BOOL   pps_locked      ( void );
+void   pps_task        ( UINT32 events );
+UINT32 pps_time_us     ( UINT32 tick );
+UINT32 pps_next_grid   ( UINT32 period_us );
+INT32  pps_ppm_milli   ( void );
+void   pps_get_stats   ( pps_stats *s );
+UINT32 pps_format      ( char *out );
+
+#endif	/* PPS_H */
@@ -0,0 +1,290 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  main
+ *  @{
+ *      @file       quality.c
+ *      @brief      Sanity checks of the raw sample stream, flags per sample.
+ *      @details    The limits in counts are worked out again only when the
+ *                  gain or a setting changes; per sample there are only
+ *                  integer compares, one 32x64 bits product for the slew
+ *                  limit and, with the Hampel filter on, insertion sorts of
+ *                  QUALITY_HAMPEL_N values.
+ */
+#include <stdio.h>
+#include "quality.h"
+#include "pipeline.h"
+
+#define SAT_24BITS      ((1L << 23) - QUALITY_SAT_MARGIN)
+
+static quality_stats stats;
+/* Settings */
+static BOOL   hampel  = FALSE;
+static UINT32 slew    = QUALITY_SLEW_UT_S;
+static UINT32 norm_nt = 0, tol_nt = 0;      // 0 = no norm check
+static float  norm_lo2, norm_hi2;           // uT^2
+/* Limits in counts, for the gain of this epoch */
+static BYTE   epoch;
+static BOOL   have_epoch = FALSE;
+static float  gain;
+static INT32  sat_limit, jump_floor, hampel_floor;
+static UINT64 slew_q32;                     // counts per core timer tick, Q32
+/* History */
+static INT32  prev[3];
+static BOOL   have_prev = FALSE;
+static UINT16 same      = 0;
+static INT32  ref[3];                       // last sample accepted by the jump check
+static UINT32 ref_t;
+static BOOL   have_ref  = FALSE;
+static BYTE   runs      = 0;
+static INT32  win[3][QUALITY_HAMPEL_N];
+static BYTE   win_head  = 0, win_fill = 0;
+
+/** Limits in counts for the gain in use; the history starts again */
+static void quality_restart ( void ) {
+
+    float limit;
+
+    gain  = RM3100_getEpoch(epoch)->gain;
+    limit = QUALITY_RANGE_UT * gain;
+    sat_limit    = limit < SAT_24BITS ? (INT32) limit : SAT_24BITS;
+    jump_floor   = (INT32) (QUALITY_JUMP_FLOOR_NT * gain / 1000);
+    hampel_floor = (INT32) (QUALITY_HAMPEL_FLOOR_NT * gain / 1000);
+    if (hampel_floor < 1)
+        hampel_floor = 1;
+    slew_q32 = (UINT64) ((double) slew * gain * 4294967296.0 / ONE_SECOND);
+
+    have_prev = have_ref = FALSE;
+    same = runs = 0;
+    win_head = win_fill = 0;
+}
+
+/**
+ *  @brief  Clears the counters and the history.
+ *  @param[in]  none
+ *  @return     none
+ */
+void quality_reset ( void ) {
+
+    memset(&stats, 0, sizeof(stats));
+    quality_restart();
+}
+
+/** Median of QUALITY_HAMPEL_N values, sorts them */
+static INT32 quality_median ( INT32 *v ) {
+
+    INT32 x;
+    BYTE i, j;
+
+    for (i = 1; i < QUALITY_HAMPEL_N; i++){
+        x = v[i];
+        for (j = i; j && v[j-1] > x; j--)
+            v[j] = v[j-1];
+        v[j] = x;
+    }
+    return v[QUALITY_HAMPEL_N / 2];
+}
+
+/** Hampel test of one axis against the window; returns the median if the
+ *  value is an outlier, the value otherwise */
+static INT32 quality_hampel ( BYTE axis, INT32 v ) {
+
+    INT32 w[QUALITY_HAMPEL_N], med, thr;
+    BYTE i;
+
+    for (i = 0; i < QUALITY_HAMPEL_N; i++)
+        w[i] = win[axis][i];
+    med = quality_median(w);
+    for (i = 0; i < QUALITY_HAMPEL_N; i++)
+        w[i] = w[i] > med ? w[i] - med : med - w[i];
+    thr = (INT32) (((INT64) QUALITY_HAMPEL_K * quality_median(w) * 3036) >> 11);  // k 1.4826 MAD, over 32 bits past a MAD of 2^17
+    if (thr < hampel_floor)
+        thr = hampel_floor;
+
+    return (v > med ? v - med : med - v) > thr ? med : v;
+}
+
+/**
+ *  @brief  Checks a sample read, sets its quality flags and, with the
+ *  Hampel filter on, replaces outliers.
+ *  @param[in,out] raw - counts and flags
+ *  @param[in]  t - core timer tick of the measurement
+ *  @return     flags set by the checks
+ */
+BYTE quality_check ( sensor_xyz *raw, UINT32 t ) {
+
+    INT32  v[3] = { raw->x, raw->y, raw->z }, d, limit;
+    UINT32 dt;
+    BYTE   flags = 0, i;
+    BOOL   jump = FALSE;
+    float  n2;
+
+    stats.samples++;
+    if (raw->flags & SAMPLE_I2C_ERROR){
+        stats.i2c++;
+        return 0;
+    }
+    if (!have_epoch || raw->epoch != epoch){
+        epoch      = raw->epoch;        // sensor reconfigured
+        have_epoch = TRUE;
+        quality_restart();
+    }
+
+    /* range */
+    for (i = 0; i < 3; i++)
+        if (v[i] >= sat_limit || v[i] <= -sat_limit)
+            flags |= SAMPLE_SATURATED;
+
+    /* stuck */
+    if (have_prev && v[0] == prev[0] && v[1] == prev[1] && v[2] == prev[2]){
+        if (same < QUALITY_STUCK_N)
+            same++;
+    }
+    else
+        same = 0;
+    if (same >= QUALITY_STUCK_N)
+        flags |= SAMPLE_STUCK;
+    prev[0] = v[0];
+    prev[1] = v[1];
+    prev[2] = v[2];
+    have_prev = TRUE;
+
+    /* jump, against the last sample accepted */
+    if (slew && have_ref){
+        dt = t - ref_t;
+        if (dt > MS_TO_CORE_TICKS(QUALITY_JUMP_MAX_MS))
+            dt = MS_TO_CORE_TICKS(QUALITY_JUMP_MAX_MS);
+        limit = jump_floor + (INT32) ((slew_q32 * dt) >> 32);
+        for (i = 0; i < 3; i++){
+            d = v[i] - ref[i];
+            if (d > limit || d < -limit)
+                jump = TRUE;
+        }
+    }
+    if (jump && ++runs < QUALITY_JUMP_RESYNC)
+        flags |= SAMPLE_JUMP;
+    else{
+        runs  = 0;
+        ref[0] = v[0];
+        ref[1] = v[1];
+        ref[2] = v[2];
+        ref_t = t;
+        have_ref = TRUE;
+    }
+
+    /* outliers, against the readings before */
+    if (hampel){
+        if (win_fill == QUALITY_HAMPEL_N){
+            raw->x = quality_hampel(0, raw->x);
+            raw->y = quality_hampel(1, raw->y);
+            raw->z = quality_hampel(2, raw->z);
+            if (raw->x != v[0] || raw->y != v[1] || raw->z != v[2])
+                flags |= SAMPLE_REPLACED;
+        }
+        else
+            win_fill++;
+        for (i = 0; i < 3; i++)
+            win[i][win_head] = v[i];    // as measured, steps go through
+        if (++win_head == QUALITY_HAMPEL_N)
+            win_head = 0;
+    }
+
+    /* magnitude, calibrated */
+    if (norm_nt){
+        n2 = pipeline_field_norm2(raw);
+        if (n2 < norm_lo2 || n2 > norm_hi2)
+            flags |= SAMPLE_NORM;
+    }
+
+    if (flags & SAMPLE_SATURATED)
+        stats.saturated++;
+    if (flags & SAMPLE_STUCK)
+        stats.stuck++;
+    if (flags & SAMPLE_JUMP)
+        stats.jumps++;
+    if (flags & SAMPLE_NORM)
+        stats.norm++;
+    if (flags & SAMPLE_REPLACED)
+        stats.replaced++;
+
+    raw->flags |= flags;
+    return flags;
+}
+
+/**
+ *  @brief  Turns the Hampel filter on or off; the window fills again.
+ *  @param[in]  on
+ *  @return     none
+ */
+void quality_set_hampel ( BOOL on ) {
+
+    hampel   = on;
+    win_head = win_fill = 0;
+}
+/**
+ *  @brief  request Hampel filter state
+ *  @param[in]  none
+ *  @return     TRUE if on
+ */
+BOOL quality_get_hampel ( void ) { return hampel; }
+
+/**
+ *  @brief  Sets the slew limit of the jump check.
+ *  @param[in]  ut_s - uT/s, 0 = no jump check
+ *  @return     0 if successful, 1 if out of range.
+ */
+BOOL quality_set_slew ( UINT32 ut_s ) {
+
+    if (ut_s > 100000)
+        return TRUE;
+
+    slew = ut_s;
+    quality_restart();
+    return FALSE;
+}
+
+/**
+ *  @brief  Sets the field magnitude expected after calibration.
+ *  @param[in]  nt - magnitude, nT, 0 = no norm check
+ *  @param[in]  tol - tolerance, nT, 0 = QUALITY_NORM_TOL_PCT of the magnitude
+ *  @return     0 if successful, 1 if out of range.
+ */
+BOOL quality_set_norm ( UINT32 nt, UINT32 tol ) {
+
+    float lo, hi;
+
+    if (nt > 2 * QUALITY_RANGE_UT * 1000 || tol > 2 * QUALITY_RANGE_UT * 1000)
+        return TRUE;
+
+    if (!tol)
+        tol = nt / 100 * QUALITY_NORM_TOL_PCT;
+    lo = tol < nt ? (nt - tol) / 1000.0f : 0;
+    hi = (nt + tol) / 1000.0f;
+    norm_lo2 = lo * lo;
+    norm_hi2 = hi * hi;
+    norm_nt  = nt;
+    tol_nt   = tol;
+    return FALSE;
+}
+
+/**
+ *  @brief  request counters
+ *  @param[in]  none
+ *  @return     pointer to them
+ */
+const quality_stats * quality_get_stats ( void ) { return &stats; }
+
+/**
+ *  @brief  Formats the counters and settings (see quality.h).
+ *  @param[out] out - QUALITY_MAX_LINE bytes
+ *  @return     line length
+ */
+UINT32 quality_format ( char *out ) {
+
+    return sprintf(out, "QUAL n %lu i2c %lu sat %lu stuck %lu jump %lu norm %lu replaced %lu hampel %u slew %lu norm_nt %lu tol_nt %lu\n",
+                   (unsigned long) stats.samples, (unsigned long) stats.i2c, (unsigned long) stats.saturated,
+                   (unsigned long) stats.stuck, (unsigned long) stats.jumps, (unsigned long) stats.norm,
+                   (unsigned long) stats.replaced, hampel, (unsigned long) slew,
+                   (unsigned long) norm_nt, (unsigned long) tol_nt);
+}
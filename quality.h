@@ -0,0 +1,103 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  main
+ *  @{
+ *      @file       quality.h
+ *      @brief      Sanity checks of the raw sample stream, flags per sample.
+ *      @details    Every sample read goes through quality_check at the front
+ *                  of the processing stage, before the filters, statistics
+ *                  and resampler, and gets SAMPLE_* flags that travel with
+ *                  it to the output (binary and compressed frames carry
+ *                  them, the text and summary formats do not; averaged and
+ *                  grid samples get the flags of the samples they were
+ *                  made of):
+ *
+ *                  SAMPLE_SATURATED  an axis beyond QUALITY_RANGE_UT, or
+ *                                    within QUALITY_SAT_MARGIN counts of
+ *                                    the 24 bits limits
+ *                  SAMPLE_STUCK      x, y and z the same as in the
+ *                                    previous QUALITY_STUCK_N readings; at
+ *                                    cycle count 50 the noise is under one
+ *                                    count and three axes repeat by chance
+ *                                    about one sample in 8, so N is set for
+ *                                    about one false flag a year at 100 Hz
+ *                  SAMPLE_JUMP       an axis moved more than
+ *                                    QUALITY_JUMP_FLOOR_NT plus the slew
+ *                                    limit (SLEW command) times the interval
+ *                                    since the last accepted sample. After
+ *                                    QUALITY_JUMP_RESYNC jumps in a row the
+ *                                    new level is accepted.
+ *                  SAMPLE_NORM       the calibrated field magnitude off the
+ *                                    expected one (NORM command) by more
+ *                                    than the tolerance
+ *                  SAMPLE_REPLACED   Hampel filter (HAMPEL command): an
+ *                                    axis further than QUALITY_HAMPEL_K
+ *                                    robust deviations (1.4826 MAD, at least
+ *                                    QUALITY_HAMPEL_FLOOR_NT) from the median
+ *                                    of the previous QUALITY_HAMPEL_N
+ *                                    readings was replaced by that median.
+ *                                    The window is causal, so there is no
+ *                                    added latency; it keeps the readings as
+ *                                    measured, so a real step goes through
+ *                                    after (N + 1) / 2 samples; so does a
+ *                                    ramp starting faster than the floor
+ *                                    per sample.
+ *
+ *                  Samples with SAMPLE_I2C_ERROR (the bus read failed) are
+ *                  pushed like the others so they are counted here, restart
+ *                  the spectrum block, and are dropped before the output. The
+ *                  checks are in counts, their limits follow the gain of
+ *                  the sample's configuration epoch, and the history starts
+ *                  again with each new epoch.
+ *                  The cost per sample is constant: a few compares per
+ *                  check, two sorts of QUALITY_HAMPEL_N values per axis with
+ *                  the filter on and the calibration (12 float operations)
+ *                  with the norm check on.
+ *
+ *                  QUAL reports the counters since reset as
+ *
+ *                  QUAL n N i2c a sat b stuck c jump d norm e replaced f
+ *                  hampel 0|1 slew s norm_nt r tol_nt t
+ */
+#ifndef QUALITY_H
+#define	QUALITY_H
+
+#include "platform.h"
+#include "rm3100.h"
+
+#define QUALITY_RANGE_UT        (800)       /**< rated range of the RM3100 */
+#define QUALITY_SAT_MARGIN      (0x1000)    /**< counts from +-2^23 */
+#define QUALITY_STUCK_N         (12)        /**< readings the same in a row */
+#define QUALITY_SLEW_UT_S       (2000)      /**< default slew limit, uT/s, 0 = no jump check */
+#define QUALITY_JUMP_FLOOR_NT   (1000)      /**< jump always allowed, covers the noise */
+#define QUALITY_JUMP_MAX_MS     (1000)      /**< longer intervals allow no more */
+#define QUALITY_JUMP_RESYNC     (4)         /**< jumps in a row taken as a new level */
+#define QUALITY_HAMPEL_N        (7)         /**< window, odd */
+#define QUALITY_HAMPEL_K        (3)         /**< robust deviations */
+#define QUALITY_HAMPEL_FLOOR_NT (500)       /**< smallest threshold, well above the noise and the lag of the median */
+#define QUALITY_NORM_TOL_PCT    (10)        /**< default tolerance of the norm check */
+#define QUALITY_MAX_LINE        (160)
+
+/** @details Counters since reset. */
+typedef struct {
+    UINT32 samples;     /// checked
+    UINT32 i2c;         /// read failed
+    UINT32 saturated;
+    UINT32 stuck;
+    UINT32 jumps;
+    UINT32 norm;
+    UINT32 replaced;    /// samples with an axis replaced by the Hampel filter
+}quality_stats;
+
+void   quality_reset      ( void );
+BYTE   quality_check      ( sensor_xyz *raw, UINT32 t );
+void   quality_set_hampel ( BOOL on );
+BOOL   quality_get_hampel ( void );
+BOOL   quality_set_slew   ( UINT32 ut_s );
+BOOL   quality_set_norm   ( UINT32 nt, UINT32 tol_nt );
+const quality_stats * quality_get_stats ( void );
+UINT32 quality_format     ( char *out );
+
+#endif	/* QUALITY_H */
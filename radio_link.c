@@ -0,0 +1,341 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  uart
+ *  @{
+ *      @file       radio_link.c
+ *      @brief      Batched sample uplink over the MRF24J40 802.15.4 radio.
+ *      @details    radio_push runs in the processing task and only encodes;
+ *                  the radio itself is driven by radio_task (EV_RADIO, and
+ *                  EV_TICK to poll the transmit result and flush old
+ *                  samples). A sample that does not fit is encoded again as
+ *                  the keyframe of the next packet, the encoder state is
+ *                  rolled back, so packets are filled to the byte.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "radio_link.h"
+#include "compress.h"
+#include "scheduler.h"
+#if RADIO_ENABLED
+#include "MRF24J40.h"                   // TX_RESULT_*
+#else
+#define TX_RESULT_BUSY      0           /**< same values as the MRF24J40 driver */
+#define TX_RESULT_SUCCESS   1
+#define TX_RESULT_FAILED    2
+#endif
+
+/// Buffer states
+#define SLOT_FREE       0
+#define SLOT_FILL       1
+#define SLOT_READY      2       /**< full, waiting for the air */
+#define SLOT_AIR        3       /**< being sent */
+
+/** @details One payload buffer. */
+typedef struct {
+    BYTE    data[RADIO_PAYLOAD];
+    BYTE    len;
+    BYTE    count;      /// samples
+    BYTE    state;      /// SLOT_*
+    BYTE    sends;      /// link level attempts
+    UINT32  t_first;    /// core timer at the first sample
+    zstream z;
+}radio_slot;
+
+static radio_slot  slot[2];
+static BYTE        fill    = 0;     // slot taking samples
+static UINT16      seq     = 0;     // sequence number of the next sample
+static BOOL        enabled = FALSE;
+static radio_stats stats;
+
+/*================================================================
+                     B A C K E N D S
+================================================================*/
+#if RADIO_ENABLED
+
+/** Hands a payload to the MRF24J40 driver */
+static void radio_hw_send ( const BYTE *p, BYTE len ) {
+
+    Tx.frameType       = PACKET_TYPE_DATA;
+    Tx.securityEnabled = 0;
+    Tx.framePending    = 0;
+    Tx.ackRequest      = 1;
+    Tx.panIDcomp       = 1;
+    Tx.dstAddrMode     = SHORT_ADDR_FIELD;
+    Tx.frameVersion    = 0;
+    Tx.srcAddrMode     = SHORT_ADDR_FIELD;
+    Tx.dstPANID        = RadioStatus.MyPANID;
+    Tx.dstAddr         = RADIO_DEST_ADDR;
+    Tx.srcAddr         = RadioStatus.MyShortAddress;
+    Tx.payload         = (UINT8 *) p;
+    Tx.payloadLength   = len;
+    RadioTXPacket();
+}
+
+/** TX_RESULT_* of the last packet, with the driver's status counters */
+static BYTE radio_hw_result ( BYTE *retries, BOOL *cca ) {
+
+    BYTE r = RadioTXResult();
+
+    *retries = RadioStatus.TX_RETRIES;
+    *cca     = RadioStatus.TX_CCAFAIL;
+    return r;
+}
+
+#else
+
+static void (*loop_hook)( const BYTE *payload, BYTE len ) = NULL;
+static BYTE   loop_loss = 0;        // percent of failed attempts
+static UINT32 loop_rand = 1;
+static BYTE   loop_result;
+
+static void radio_hw_send ( const BYTE *p, BYTE len ) {
+
+    loop_rand   = loop_rand * 1103515245 + 12345;
+    loop_result = ((loop_rand >> 16) % 100) < loop_loss ? TX_RESULT_FAILED : TX_RESULT_SUCCESS;
+    if (loop_result == TX_RESULT_SUCCESS && loop_hook)
+        loop_hook(p, len);
+    sched_post(EV_RADIO);           // done at once, like the TX interrupt
+}
+
+static BYTE radio_hw_result ( BYTE *retries, BOOL *cca ) {
+
+    *retries = loop_result == TX_RESULT_FAILED ? 3 : 0;    // the radio gives up after 3
+    *cca     = loop_result == TX_RESULT_FAILED && (loop_rand & 0x100);
+    return loop_result;
+}
+
+#endif
+
+/**
+ *  @brief  Sets a function receiving every payload the loopback "sends".
+ *  Does nothing with the real radio.
+ *  @param[in]  hook - NULL for none
+ *  @return     none
+ */
+void radio_loopback_hook ( void (*hook)( const BYTE *payload, BYTE len ) ) {
+#if !RADIO_ENABLED
+    loop_hook = hook;
+#endif
+}
+
+/**
+ *  @brief  Sets the loopback failure rate. Does nothing with the real radio.
+ *  @param[in]  percent - 0 to 100 of the attempts fail
+ *  @return     none
+ */
+void radio_loopback_loss ( BYTE percent ) {
+#if !RADIO_ENABLED
+    loop_loss = percent;
+#endif
+}
+
+/*================================================================
+                     L I N K
+================================================================*/
+/**
+ *  @brief  Starts the radio (channel, addresses). With the loopback there
+ *  is nothing to start.
+ *  @param[in]  none
+ *  @return     0 if successful, 1 otherwise.
+ */
+BOOL radio_link_init ( void ) {
+#if RADIO_ENABLED
+    if (!RadioInit())
+        return TRUE;
+    RadioSetAddress(RADIO_SHORT_ADDR, 0, RADIO_PANID);
+    if (!RadioSetChannel(RADIO_CHANNEL))
+        return TRUE;
+#endif
+    return FALSE;
+}
+
+/** Makes a slot the filling one */
+static void radio_open ( BYTE i ) {
+
+    radio_slot *s = &slot[i];
+
+    s->len   = 0;
+    s->count = 0;
+    s->sends = 0;
+    s->state = SLOT_FILL;
+    zs_init(&s->z, 255);        // one keyframe per packet, the block never ends
+    fill = i;
+}
+
+/**
+ *  @brief  Starts or stops the uplink; starting clears the statistics.
+ *  @param[in]  on - TRUE to send samples
+ *  @return     none
+ */
+void radio_link_enable ( BOOL on ) {
+
+    if (on && !enabled){
+        memset(&stats, 0, sizeof(stats));
+        slot[0].state = slot[1].state = SLOT_FREE;
+        radio_open(0);
+    }
+    enabled = on;
+}
+
+/**
+ *  @brief  request uplink state
+ *  @param[in]  none
+ *  @return     TRUE if samples are sent
+ */
+BOOL radio_link_active ( void ) { return enabled; }
+
+/** Queues the filling slot for the air if the other one is free */
+static BOOL radio_close ( void ) {
+
+    if (slot[fill ^ 1].state != SLOT_FREE)
+        return TRUE;
+
+    slot[fill].state = SLOT_READY;
+    radio_open(fill ^ 1);
+    sched_post(EV_RADIO);
+    return FALSE;
+}
+
+/**
+ *  @brief  Adds a processed sample to the filling packet.
+ *  @param[in]  t_us - time stamp
+ *  @param[in]  raw - counts and flags
+ *  @return     none
+ */
+void radio_push ( UINT32 t_us, const sensor_xyz *raw ) {
+
+    BYTE rec[ZS_MAX_OUTPUT];
+    radio_slot *s = &slot[fill];
+    zstream save = s->z;
+    UINT16 cc = RM3100_getEpoch(raw->epoch)->cycle_count;
+    BYTE n = 0;
+
+    if (!enabled)
+        return;
+
+    if (s->count){
+        if (raw->epoch == s->z.epoch && cc == s->z.cycle_count)
+            n = zs_encode(&s->z, rec, t_us, raw, cc);
+        if (!n || s->len + n > RADIO_PAYLOAD){
+            s->z = save;                    // goes in the next packet instead, new epochs too
+            if (radio_close()){
+                stats.dropped += s->count;  // both buffers busy
+                radio_open(fill);
+            }
+            s = &slot[fill];
+        }
+    }
+    if (!s->count){
+        s->z.seq   = seq;
+        s->t_first = ReadCoreTimer();
+        n = zs_encode(&s->z, rec, t_us, raw, cc);
+    }
+    memcpy(&s->data[s->len], rec, n);
+    s->len += n;
+    s->count++;
+    seq++;
+}
+
+/**
+ *  @brief  Queues the filling packet, whatever its size, e.g. at the end of
+ *  a replay.
+ *  @param[in]  none
+ *  @return     none
+ */
+void radio_flush ( void ) {
+
+    if (enabled && slot[fill].count)
+        radio_close();
+}
+
+/** Air time of one attempt and its ACK */
+static UINT32 radio_air_us ( BYTE len ) {
+
+    return (RADIO_FRAME_BYTES + len) * RADIO_US_PER_BYTE + RADIO_ACK_US;
+}
+
+/**
+ *  @brief  Radio task: polls the packet on the air, resends or frees it,
+ *  then sends the next one. Flushes samples older than RADIO_FLUSH_MS.
+ *  @param[in]  events - EV_RADIO, EV_TICK
+ *  @return     none
+ */
+void radio_task ( UINT32 events ) {
+
+    radio_slot *s;
+    BYTE i, r, retries;
+    BOOL cca;
+
+    if (!enabled)
+        return;
+
+    for (i = 0; i < 2; i++){
+        s = &slot[i];
+        if (s->state != SLOT_AIR)
+            continue;
+        r = radio_hw_result(&retries, &cca);
+        if (r == TX_RESULT_BUSY)
+            return;
+        stats.retries += retries;
+        stats.air_us  += (UINT64) radio_air_us(s->len) * (1 + retries);
+        if (r == TX_RESULT_SUCCESS){
+            stats.packets++;
+            stats.samples += s->count;
+            stats.bytes   += s->len;
+            s->state = SLOT_FREE;
+        }
+        else{
+            stats.failures++;
+            if (cca)
+                stats.cca_failures++;
+            if (s->sends <= RADIO_RESEND){
+                s->sends++;
+                radio_hw_send(s->data, s->len);
+                return;
+            }
+            stats.lost += s->count;
+            s->state = SLOT_FREE;
+        }
+    }
+
+    s = &slot[fill];
+    if (s->count && MS_TO_CORE_TICKS(RADIO_FLUSH_MS) <= CT_TICKS_SINCE(s->t_first))
+        radio_close();
+
+    for (i = 0; i < 2; i++){
+        s = &slot[i];
+        if (s->state == SLOT_READY){
+            s->state = SLOT_AIR;
+            s->sends = 1;
+            radio_hw_send(s->data, s->len);
+            break;
+        }
+    }
+}
+
+/**
+ *  @brief  Link statistics.
+ *  @param[out] s - copy of the counters
+ *  @return     none
+ */
+void radio_get_stats ( radio_stats *s ) { *s = stats; }
+
+/**
+ *  @brief  Formats the statistics:
+ *  "RADIO pkts n spp s.ss air_us a fail f cca c retries r dropped d lost l\n",
+ *  spp samples per packet, air_us air time per sample.
+ *  @param[out] out - RADIO_MAX_LINE bytes
+ *  @return     line length
+ */
+UINT32 radio_format ( char *out ) {
+
+    UINT32 spp100 = stats.packets ? stats.samples * 100 / stats.packets : 0;
+    UINT32 air    = stats.samples ? (UINT32) (stats.air_us / stats.samples) : 0;
+
+    return sprintf(out, "RADIO pkts %lu spp %lu.%02lu air_us %lu fail %lu cca %lu retries %lu dropped %lu lost %lu\n",
+                   (unsigned long) stats.packets, (unsigned long) (spp100 / 100), (unsigned long) (spp100 % 100),
+                   (unsigned long) air, (unsigned long) stats.failures, (unsigned long) stats.cca_failures,
+                   (unsigned long) stats.retries, (unsigned long) stats.dropped, (unsigned long) stats.lost);
+}
@@ -0,0 +1,77 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  uart
+ *  @{
+ *      @file       radio_link.h
+ *      @brief      Batched sample uplink over the MRF24J40 802.15.4 radio.
+ *      @details    Processed samples are packed into 802.15.4 data frames of
+ *                  at most RADIO_PAYLOAD bytes. Each payload is one
+ *                  compressed block (compress.h): a keyframe then delta
+ *                  records, as many as fit, so every packet decodes on its
+ *                  own and a lost packet only loses its samples. The
+ *                  keyframe carries the sequence number of the first sample
+ *                  and the sensor configuration; a sample of another epoch
+ *                  starts a new packet.
+ *
+ *                  Two payload buffers: one is on the air (or waiting for
+ *                  it) while the other fills. A packet goes out when the
+ *                  next sample does not fit or when its first sample is
+ *                  RADIO_FLUSH_MS old. A failed packet is sent again up to
+ *                  RADIO_RESEND times, on top of the radio's own retries,
+ *                  while samples keep filling the other buffer; if that one
+ *                  fills up before the air is free its samples are dropped
+ *                  and counted.
+ *
+ *                  With RADIO_ENABLED 0 (hardware.h) a loopback stands in for
+ *                  the radio: a packet is "sent" at once to an optional hook
+ *                  and a simulated loss rate exercises the failure paths.
+ *                  The statistics (radio_get_stats, RADIO command) report
+ *                  samples per packet and air time per sample in both cases.
+ */
+#ifndef RADIO_LINK_H
+#define	RADIO_LINK_H
+
+#include "platform.h"
+#include "rm3100.h"
+
+#define RADIO_PAYLOAD       (103)       /**< TX_PAYLOAD_SIZE of the MRF24J40 driver */
+#define RADIO_FLUSH_MS      (250)       /**< max age of a sample before its packet goes */
+#define RADIO_RESEND        (1)         /**< link level resends of a failed packet */
+#define RADIO_CHANNEL       (15)
+#define RADIO_PANID         (0x4D47)
+#define RADIO_SHORT_ADDR    (0x0001)
+#define RADIO_DEST_ADDR     (0x0000)    /**< coordinator / receiver */
+#define RADIO_MAX_LINE      (144)       /**< RADIO report, 141 characters with every counter at 2^32 - 1 */
+
+    // 250 kbps O-QPSK: 32 us per byte
+#define RADIO_US_PER_BYTE   (32)
+#define RADIO_FRAME_BYTES   (17)        /**< PHY 6, MAC header 9 (short addresses, PAN id compressed), FCS 2 */
+#define RADIO_ACK_US        (192 + 11 * RADIO_US_PER_BYTE)  /**< turnaround + ACK frame */
+
+/** @details Link statistics, since radio_link_enable. */
+typedef struct {
+    UINT32 packets;     /// sent and acknowledged
+    UINT32 samples;     /// in acknowledged packets
+    UINT32 bytes;       /// payload bytes acknowledged
+    UINT32 failures;    /// attempts that failed (no ACK or channel busy)
+    UINT32 cca_failures;/// failures due to a busy channel
+    UINT32 retries;     /// radio level retries
+    UINT32 dropped;     /// samples dropped, both buffers busy
+    UINT32 lost;        /// samples in packets given up
+    UINT64 air_us;      /// estimated air time of all attempts and ACKs
+}radio_stats;
+
+BOOL radio_link_init   ( void );
+void radio_link_enable ( BOOL on );
+BOOL radio_link_active ( void );
+void radio_push        ( UINT32 t_us, const sensor_xyz *raw );
+void radio_flush       ( void );
+void radio_task        ( UINT32 events );
+void radio_get_stats   ( radio_stats *s );
+UINT32 radio_format    ( char *out );
+void radio_loopback_hook ( void (*hook)( const BYTE *payload, BYTE len ) );
+void radio_loopback_loss ( BYTE percent );
+
+#endif	/* RADIO_LINK_H */
@@ -0,0 +1,212 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  main
+ *  @{
+ *      @file       resample.c
+ *      @brief      Resampling of the raw sample stream onto a uniform time grid.
+ *      @details    Integer only. When a sample arrives the reciprocal of its
+ *                  interval to the previous one is taken once (Q32, a 32 bits
+ *                  division); each grid sample then costs a 32 x 32 -> 64
+ *                  bits product for the Q16 weight and one per axis for
+ *                  x0 + (x1 - x0) w, no division. Counts are 24 bits, so
+ *                  (x1 - x0) w fits in 42 bits.
+ */
+#include <stdio.h>
+#include "resample.h"
+
+#define W_ONE       (1L << 16)          /**< weight 1.0, Q16 */
+
+static UINT16 rate      = 0;            // Hz, 0 = off
+static UINT32 period;                   // core timer ticks, integer part
+static UINT32 rem;                      // ONE_SECOND % rate, spread over the periods
+static UINT32 acc;
+static BOOL   have      = FALSE;        // a sample is held in x1
+static sensor_xyz x0, x1;
+static UINT32 t0, t1;
+static UINT32 inv;                      // 2^32 / (t1 - t0)
+static UINT32 next;                     // next grid instant, core timer
+static resample_stats stats;
+
+/** Moves the grid to its next instant */
+static void resample_step ( void ) {
+
+    next += period;
+    acc  += rem;
+    if (acc >= rate){
+        acc -= rate;
+        next++;
+    }
+}
+
+/**
+ *  @brief  Sets the output grid rate and restarts the grid at the next sample.
+ *  @param[in]  hz - 1 to RESAMPLE_MAX_RATE, 0 = off (samples as measured)
+ *  @return     0 if successful, 1 otherwise.
+ */
+BOOL resample_set_rate ( UINT16 hz ) {
+
+    if (hz > RESAMPLE_MAX_RATE)
+        return TRUE;
+
+    rate = hz;
+    if (hz){
+        period = ONE_SECOND / hz;
+        rem    = ONE_SECOND % hz;
+    }
+    resample_reset();
+    return FALSE;
+}
+
+/**
+ *  @brief  request output grid rate
+ *  @param[in]  none
+ *  @return     Hz, 0 if off
+ */
+UINT16 resample_get_rate ( void ) { return rate; }
+
+/**
+ *  @brief  Drops the held samples; the grid restarts at the next sample.
+ *  @param[in]  none
+ *  @return     none
+ */
+void resample_restart ( void ) {
+
+    have = FALSE;
+    acc  = 0;
+}
+
+/**
+ *  @brief  Drops the held samples and the counters; the grid restarts at the
+ *  next sample.
+ *  @param[in]  none
+ *  @return     none
+ */
+void resample_reset ( void ) {
+
+    resample_restart();
+    memset(&stats, 0, sizeof(stats));
+}
+
+/**
+ *  @brief  Takes a time stamped sample. Grid samples it releases must be
+ *  pulled before the next one is pushed.
+ *  @param[in]  raw - counts and flags
+ *  @param[in]  t - core timer tick of the measurement
+ *  @return     0 if taken (or ignored), 1 if off or grid samples are pending.
+ */
+BOOL resample_push ( const sensor_xyz *raw, UINT32 t ) {
+
+    UINT32 d = t - t1, n;
+
+    if (!rate || resample_pending())
+        return TRUE;
+
+    if ((raw->flags & SAMPLE_I2C_ERROR) || (have && (INT32) d <= 0)){
+        stats.invalid++;
+        return FALSE;
+    }
+    stats.in++;
+
+    if (!have){
+        /* first sample: on the grid */
+        have = TRUE;
+        x0   = x1 = *raw;
+        t0   = t1 = next = t;
+        inv  = 0;
+        return FALSE;
+    }
+
+    x0 = x1;
+    t0 = t1;
+    x1 = *raw;
+    t1 = t;
+
+    if (d > MS_TO_CORE_TICKS(RESAMPLE_MAX_GAP_MS)){
+        /* not bridged: the grid goes on from this sample, same phase */
+        stats.gaps++;
+        n     = (INT32) (t1 - next) > 0 ? (t1 - next) / period : 0;
+        next += n * period;
+        acc  += n * rem;
+        next += acc / rate;
+        acc  %= rate;
+        while ((INT32) (next - t1) < 0){
+            resample_step();
+            n++;
+        }
+        stats.skipped += n;
+        x0  = x1;
+        t0  = t1;
+        inv = 0;
+        return FALSE;
+    }
+
+    inv = 0xFFFFFFFF / d;
+    return FALSE;
+}
+
+/**
+ *  @brief  request grid samples waiting
+ *  @param[in]  none
+ *  @return     TRUE if resample_pull has a sample
+ */
+BOOL resample_pending ( void ) {
+
+    return rate && have && (INT32) (next - t1) <= 0;
+}
+
+/** x0 + (x1 - x0) w, rounded */
+static INT32 lerp ( INT32 a, INT32 b, UINT32 w ) {
+
+    return a + (INT32) (((INT64) (b - a) * w + (W_ONE / 2)) >> 16);
+}
+
+/**
+ *  @brief  Next grid sample, interpolated between the samples around it.
+ *  @param[out] raw - counts, flags of the samples used
+ *  @param[out] t - grid instant, core timer tick
+ *  @return     0 if a sample was produced, 1 if none is pending.
+ */
+BOOL resample_pull ( sensor_xyz *raw, UINT32 *t ) {
+
+    UINT32 w;
+
+    if (!resample_pending())
+        return TRUE;
+
+    w = (UINT32) (((UINT64) (next - t0) * inv + (W_ONE / 2)) >> 16);
+    raw->x     = lerp(x0.x, x1.x, w);
+    raw->y     = lerp(x0.y, x1.y, w);
+    raw->z     = lerp(x0.z, x1.z, w);
+    raw->flags = (w ? x1.flags : 0) | (w < W_ONE ? x0.flags : 0);
+    *t = next;
+
+    if (t1 - next > stats.max_latency)
+        stats.max_latency = t1 - next;
+    stats.out++;
+    resample_step();
+    return FALSE;
+}
+
+/**
+ *  @brief  Counters since the rate was set.
+ *  @param[out] s - copy
+ *  @return     none
+ */
+void resample_get_stats ( resample_stats *s ) { *s = stats; }
+
+/**
+ *  @brief  Formats the counters: "GRID rate r in n out o invalid i gaps g
+ *  skipped s latency_us l".
+ *  @param[out] out - RESAMPLE_MAX_LINE bytes
+ *  @return     line length
+ */
+UINT32 resample_format ( char *out ) {
+
+    return sprintf(out, "GRID rate %u in %lu out %lu invalid %lu gaps %lu skipped %lu latency_us %lu\n",
+                   rate, (unsigned long) stats.in, (unsigned long) stats.out,
+                   (unsigned long) stats.invalid, (unsigned long) stats.gaps,
+                   (unsigned long) stats.skipped,
+                   (unsigned long) (stats.max_latency / (ONE_SECOND / 1000000)));
+}
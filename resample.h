@@ -0,0 +1,66 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  main
+ *  @{
+ *      @file       resample.h
+ *      @brief      Resampling of the raw sample stream onto a uniform time grid.
+ *      @details    Single measurements are requested from the scheduler tick
+ *                  and go through the shared bus, so the sample instants are
+ *                  only as regular as the polling: 10 to 11 ms apart at the
+ *                  default period, more when the bus is busy. With a grid
+ *                  rate set (GRID command) the processing stage turns the
+ *                  time stamped samples into samples at exactly that rate on
+ *                  the core timer, by linear interpolation between the two
+ *                  samples around each grid instant; downstream (averaging,
+ *                  output, the dt of the text lines) then sees a uniform
+ *                  stream. The grid starts at the first sample; the period
+ *                  is ONE_SECOND / rate with the remainder spread Bresenham
+ *                  style, so there is no drift whatever the rate.
+ *
+ *                  A grid instant is produced as soon as the first sample at
+ *                  or after it arrives: the latency is below one input
+ *                  interval, which is itself bounded by RESAMPLE_MAX_GAP_MS.
+ *                  Intervals longer than that (sensor stopped, I2C errors in
+ *                  a row) are not bridged: the grid instants inside are
+ *                  skipped and counted, the grid keeps its phase. Samples
+ *                  with SAMPLE_I2C_ERROR are ignored and interpolated over.
+ *
+ *                  Linear interpolation is a low pass: half way between two
+ *                  samples a component at f is scaled by cos(pi f / fs),
+ *                  at 100 Hz a 5 Hz signal loses at most 1.2 %. Content
+ *                  near the input Nyquist frequency is best removed by
+ *                  averaging (AVG) on the grid.
+ */
+#ifndef RESAMPLE_H
+#define	RESAMPLE_H
+
+#include "platform.h"
+#include "rm3100.h"
+
+#define RESAMPLE_MAX_RATE   (1000)      /**< Hz */
+#define RESAMPLE_MAX_GAP_MS (250)       /**< longer input intervals are not interpolated */
+#define RESAMPLE_MAX_LINE   (96)
+
+/** @details Counters since the rate was set. */
+typedef struct {
+    UINT32 in;          /// samples taken
+    UINT32 out;         /// grid samples produced
+    UINT32 invalid;     /// samples ignored: I2C error, time going back
+    UINT32 gaps;        /// intervals not bridged
+    UINT32 skipped;     /// grid instants lost in the gaps
+    UINT32 max_latency; /// core timer ticks from a grid instant to the sample that released it
+}resample_stats;
+
+BOOL   resample_set_rate   ( UINT16 hz );
+UINT16 resample_get_rate   ( void );
+void   resample_reset      ( void );
+void   resample_restart    ( void );
+BOOL   resample_push       ( const sensor_xyz *raw, UINT32 t );
+BOOL   resample_pending    ( void );
+BOOL   resample_pull       ( sensor_xyz *raw, UINT32 *t );
+void   resample_get_stats  ( resample_stats *s );
+UINT32 resample_format     ( char *out );
+
+#endif	/* RESAMPLE_H */
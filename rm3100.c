@@ -16,7 +16,8 @@
  */
 #include "i2c.h"
 #include "rm3100.h"
-#include <plib.h>
+#include "platform.h"
+#include <string.h>
 
 /** @details Information of the ASIC configurations */
 struct config {
@@ -24,15 +25,216 @@ struct config {
     float sample_rate;
     float max_data_rate;
     float gain;
+    UINT32 lost_samples;
+    BYTE cmm_conf;
+    BYTE tmrc;
+    UINT32 max_rate_mhz;
+    UINT32 nt_per_count_q16;
+    BYTE epoch;
 };
-/* Default Values */
+/**
+ *  @details Lookup tables, evaluated by the compiler.
+ *  Cycle count table: gain and max data rate with the PNI formulas, the max
+ *  rate also in mHz for integer compares and nT/count in Q16 for fixed-point
+ *  conversions. Indexed by cycle count - CC_MIN.
+ */
+typedef struct {
+    float  gain;
+    float  max_data_rate;
+    UINT32 max_rate_mhz;
+    UINT32 nt_per_count_q16;
+}cc_entry;
+
+#define CC_MAXRATE(cc)      (1 / (float)((float) 0.000011*(cc) + 0.000075))
+#define CC_MAXRATE_MHZ(cc)  ((UINT32)(1000 * CC_MAXRATE(cc)))
+#define CC_SCALE_Q16(cc)    ((UINT32)(1000.0 * 65536 / CC_GAIN(cc) + 0.5))
+#define CC_ROW(cc)          { CC_GAIN(cc), CC_MAXRATE(cc), CC_MAXRATE_MHZ(cc), CC_SCALE_Q16(cc) }
+#define CC_ROWS10(cc)       CC_ROW(cc),   CC_ROW(cc+1), CC_ROW(cc+2), CC_ROW(cc+3), CC_ROW(cc+4), \
+                            CC_ROW(cc+5), CC_ROW(cc+6), CC_ROW(cc+7), CC_ROW(cc+8), CC_ROW(cc+9)
+
+static const cc_entry cc_lut[CC_MAX - CC_MIN + 1] = {
+    CC_ROWS10(30),
+    CC_ROWS10(40),
+    CC_ROWS10(50),
+    CC_ROWS10(60),
+    CC_ROWS10(70),
+    CC_ROWS10(80),
+    CC_ROWS10(90),
+    CC_ROWS10(100),
+    CC_ROWS10(110),
+    CC_ROWS10(120),
+    CC_ROWS10(130),
+    CC_ROWS10(140),
+    CC_ROWS10(150),
+    CC_ROWS10(160),
+    CC_ROWS10(170),
+    CC_ROWS10(180),
+    CC_ROWS10(190),
+    CC_ROWS10(200),
+    CC_ROWS10(210),
+    CC_ROWS10(220),
+    CC_ROWS10(230),
+    CC_ROWS10(240),
+    CC_ROWS10(250),
+    CC_ROWS10(260),
+    CC_ROWS10(270),
+    CC_ROWS10(280),
+    CC_ROWS10(290),
+    CC_ROWS10(300),
+    CC_ROWS10(310),
+    CC_ROWS10(320),
+    CC_ROWS10(330),
+    CC_ROWS10(340),
+    CC_ROWS10(350),
+    CC_ROWS10(360),
+    CC_ROWS10(370),
+    CC_ROWS10(380),
+    CC_ROWS10(390),
+    CC_ROW(400)
+};
+
+/* Default Values, from the table formulas */
+#define CC_DEFAULT          (200)
+
 struct config rm = {
-    .cycle_count   = 200,
+    .cycle_count   = CC_DEFAULT,
     .sample_rate   = 37,
-    .max_data_rate = 440,
-    .gain          = 75
+    .max_data_rate = CC_MAXRATE(CC_DEFAULT),
+    .gain          = CC_GAIN(CC_DEFAULT),
+    .lost_samples  = 0,
+    .cmm_conf      = CMM_OFF,
+    .tmrc          = CMM_UPDATERATE_37,
+    .max_rate_mhz  = CC_MAXRATE_MHZ(CC_DEFAULT),
+    .nt_per_count_q16 = CC_SCALE_Q16(CC_DEFAULT),
+    .epoch         = 0
 };
 
+/** Data rate table, indexed by TMRC code - CMM_UPDATERATE_600 */
+static const struct {
+    float  rate;
+    UINT32 rate_mhz;
+} tmrc_lut[CMM_UPDATERATE_0_075 - CMM_UPDATERATE_600 + 1] = {
+    { 600,   600000 }, { 300,   300000 }, { 150,   150000 }, { 75,    75000 },
+    { 37,     37000 }, { 18,     18000 }, { 9,       9000 }, { 4.5,    4500 },
+    { 2.3,     2300 }, { 1.2,     1200 }, { 0.6,      600 }, { 0.3,     300 },
+    { 0.15,     150 }, { 0.075,     75 }
+};
+/* Background self test */
+static bist_job bist = {
+    .state = BIST_IDLE
+};
+/* Configuration staged by commands, written at a sample boundary */
+static rm3100_config staged;
+static BOOL          staged_set = FALSE;
+/* Scaling of the last configurations, for the samples still in the pipeline */
+static rm3100_epoch  epochs[RM3100_EPOCHS] = {
+    { CC_GAIN(CC_DEFAULT), 37, CC_SCALE_Q16(CC_DEFAULT), CC_DEFAULT }
+};
+
+/// Parts of a configuration to write
+#define WR_CC       0x01
+#define WR_TMRC     0x02
+#define WR_CMM      0x04
+
+/** Writes the 3 cycle count registers, one burst */
+static BOOL rm3100_writeCC ( UINT16 value ) {
+
+    BYTE to_reg[6];
+
+    to_reg[0] = value>>8;
+    to_reg[1] = value;
+    to_reg[2] = to_reg[0];
+    to_reg[3] = to_reg[1];
+    to_reg[4] = to_reg[0];
+    to_reg[5] = to_reg[1];
+
+    return i2c_write(RM3100_ADDRESS_00, CCX_MSB_REG, 6, to_reg);
+}
+
+/**
+ *  Writes parts of a valid configuration in one sequence: a running CMM is
+ *  stopped around cycle count and rate changes and the CMM register goes
+ *  last. The driver state is switched only when every write went through,
+ *  with a new epoch if the gain or the rate changed; if a write fails the
+ *  settings in use are written back.
+ */
+static BOOL rm3100_write ( const rm3100_config *c, BYTE parts ) {
+
+    const cc_entry *e;
+    rm3100_epoch *ep;
+    BYTE to_reg;
+    BOOL err = FALSE, restart, changed;
+
+    restart = (rm.cmm_conf & CM_START) && (parts & (WR_CC | WR_TMRC));
+    if (restart){
+        to_reg = rm.cmm_conf & ~CM_START;
+        err |= i2c_write(RM3100_ADDRESS_00, CMM_REG, 1, &to_reg);
+    }
+    if (!err && (parts & WR_CC))
+        err |= rm3100_writeCC(c->cycle_count);
+    if (!err && (parts & WR_TMRC)){
+        to_reg = c->tmrc;
+        err |= i2c_write(RM3100_ADDRESS_00, CMM_TMRC_REG, 1, &to_reg);
+    }
+    if (!err && ((parts & WR_CMM) || restart)){
+        to_reg = (parts & WR_CMM) ? c->cmm : rm.cmm_conf;
+        err |= i2c_write(RM3100_ADDRESS_00, CMM_REG, 1, &to_reg);
+    }
+    if (err){
+        if (parts & WR_CC)
+            rm3100_writeCC(rm.cycle_count);
+        to_reg = rm.tmrc;
+        if (parts & WR_TMRC)
+            i2c_write(RM3100_ADDRESS_00, CMM_TMRC_REG, 1, &to_reg);
+        to_reg = rm.cmm_conf;
+        if ((parts & WR_CMM) || restart)
+            i2c_write(RM3100_ADDRESS_00, CMM_REG, 1, &to_reg);
+        return TRUE;
+    }
+
+    changed = ((parts & WR_CC) && c->cycle_count != rm.cycle_count)
+              || ((parts & WR_TMRC) && c->tmrc != rm.tmrc);
+    if (parts & WR_CC){
+        e = &cc_lut[c->cycle_count - CC_MIN];
+        rm.cycle_count      = c->cycle_count;
+        rm.gain             = e->gain;
+        rm.max_data_rate    = e->max_data_rate;
+        rm.max_rate_mhz     = e->max_rate_mhz;
+        rm.nt_per_count_q16 = e->nt_per_count_q16;
+    }
+    if (parts & WR_TMRC){
+        rm.tmrc        = c->tmrc;
+        rm.sample_rate = tmrc_lut[c->tmrc - CMM_UPDATERATE_600].rate;
+    }
+    if (parts & WR_CMM)
+        rm.cmm_conf = c->cmm;
+    if (changed){
+        ep = &epochs[++rm.epoch & (RM3100_EPOCHS-1)];
+        ep->gain             = rm.gain;
+        ep->sample_rate      = rm.sample_rate;
+        ep->nt_per_count_q16 = rm.nt_per_count_q16;
+        ep->cycle_count      = rm.cycle_count;
+    }
+    return FALSE;
+}
+
+/** Checks a configuration as a whole; the cycle count is clamped like
+ *  setCycleCount does. CMM can only run at a rate the cycle count allows. */
+static BOOL rm3100_validate ( rm3100_config *c ) {
+
+    if (c->cycle_count > CC_MAX)
+        c->cycle_count = CC_MAX;
+    else if (c->cycle_count < CC_MIN)
+        c->cycle_count = CC_MIN;
+
+    if (c->tmrc < CMM_UPDATERATE_600 || c->tmrc > CMM_UPDATERATE_0_075)
+        return TRUE;
+    if ((c->cmm & CM_START)
+        && tmrc_lut[c->tmrc - CMM_UPDATERATE_600].rate_mhz > cc_lut[c->cycle_count - CC_MIN].max_rate_mhz)
+        return TRUE;
+    return FALSE;
+}
+
 /**
  *  @brief  Inicializes the Ev. Board to do Single Measurents (On Request).
  *  in main cycle is necessary to use requestSingleMeasurement() and
@@ -61,6 +263,79 @@ void RM3100_init_CMM_Operation ( void ) {
     setCMMdatarate(CMM_UPDATERATE_300);
 }
 
+/**
+ *  @brief  Stages a whole configuration, checked before it is taken. It is
+ *  written by RM3100_commitConfig(), the settings in use stay until then.
+ *  @param[in]  c - cycle count (clamped to CC_MIN..CC_MAX), rate, CMM
+ *  @return     0 if staged, 1 if the configuration is not valid.
+ */
+BOOL RM3100_stageConfig ( const rm3100_config *c ) {
+
+    rm3100_config v = *c;
+
+    if (rm3100_validate (&v))
+        return TRUE;
+
+    staged     = v;
+    staged_set = TRUE;
+    return FALSE;
+}
+/**
+ *  @brief  Writes the staged configuration. Call at a sample boundary, with
+ *  no measurement in flight: samples read after it carry a new epoch.
+ *  @param[in]  none
+ *  @return     0 if written or nothing staged, 1 if the sensor did not take it
+ *  (the previous configuration stays in use).
+ */
+BOOL RM3100_commitConfig ( void ) {
+
+    if (!staged_set)
+        return FALSE;
+
+    staged_set = FALSE;
+    return rm3100_write (&staged, WR_CC | WR_TMRC | WR_CMM);
+}
+/**
+ *  @brief  request staged state
+ *  @param[in]  none
+ *  @return     TRUE if a configuration waits for RM3100_commitConfig()
+ */
+BOOL RM3100_configPending ( void ) { return staged_set; }
+/**
+ *  @brief  request configuration in use
+ *  @param[out] c - configuration
+ *  @return     none
+ */
+void RM3100_getConfig ( rm3100_config *c ) {
+
+    c->cycle_count = rm.cycle_count;
+    c->tmrc        = rm.tmrc;
+    c->cmm         = rm.cmm_conf;
+}
+/**
+ *  @brief  request staged configuration, the one in use if none is staged
+ *  @param[out] c - configuration
+ *  @return     none
+ */
+void RM3100_getStagedConfig ( rm3100_config *c ) {
+
+    if (staged_set)
+        *c = staged;
+    else
+        RM3100_getConfig (c);
+}
+/**
+ *  @brief  request configuration epoch, tagged on each sample read
+ *  @param[in]  none
+ *  @return     epoch, counts the gain / rate changes (wraps)
+ */
+BYTE getRM3100Epoch (void){ return rm.epoch; }
+/**
+ *  @brief  request scaling of an epoch, valid for the last RM3100_EPOCHS
+ *  @param[in]  epoch - of a sample
+ *  @return     gain, rate and scale the sample was measured with
+ */
+const rm3100_epoch * RM3100_getEpoch ( BYTE epoch ) { return &epochs[epoch & (RM3100_EPOCHS-1)]; }
 
 /**
  *  @brief  request current gain value - Only depends off cycle count value
@@ -86,43 +361,74 @@ float getRM3100MaxDataRate (void){ return rm.max_data_rate; }
  *  @return     actual cycle count value
  */
 unsigned int getRM3100CycleCount (void){ return rm.cycle_count; }
+/**
+ *  @brief  request scale for fixed-point conversions - Only depends off cycle count value
+ *  @param[in]  none
+ *  @return     nT per count in Q16 (nT = counts * scale >> 16)
+ */
+UINT32 getRM3100ScaleQ16 (void){ return rm.nt_per_count_q16; }
+/**
+ *  @brief  Finds the data rate code closest to a requested rate that is
+ *  allowed with the current cycle count.
+ *  @param[in]  rate_mhz - desired rate in mHz
+ *  @return     CMM_UPDATERATE_* value
+ */
+BYTE RM3100_closestDataRate ( UINT32 rate_mhz ) {
+
+    BYTE i, best = CMM_UPDATERATE_0_075 - CMM_UPDATERATE_600;
+    UINT32 diff, best_diff = 0xFFFFFFFF;
+
+    for (i = 0; i <= CMM_UPDATERATE_0_075 - CMM_UPDATERATE_600; i++){
+        if (tmrc_lut[i].rate_mhz > rm.max_rate_mhz)
+            continue;
+        diff = tmrc_lut[i].rate_mhz > rate_mhz ? tmrc_lut[i].rate_mhz - rate_mhz
+                                               : rate_mhz - tmrc_lut[i].rate_mhz;
+        if (diff < best_diff){
+            best_diff = diff;
+            best      = i;
+        }
+    }
+    return CMM_UPDATERATE_600 + best;
+}
+/**
+ *  @brief  request last Continuous Measurement Mode register value
+ *  @param[in]  none
+ *  @return     CMM configuration BYTE (CM_START set if CMM is running)
+ */
+BYTE getRM3100CMMConfig (void){ return rm.cmm_conf; }
+/**
+ *  @brief  request Continuous Measurement Mode data rate code
+ *  @param[in]  none
+ *  @return     CMM_UPDATERATE_* value
+ */
+BYTE getRM3100DataRateCode (void){ return rm.tmrc; }
+/**
+ *  @brief  request number of samples lost to bus errors
+ *  @param[in]  none
+ *  @return     samples returned with SAMPLE_I2C_ERROR since reset
+ */
+UINT32 getRM3100LostSamples (void){ return rm.lost_samples; }
 
 /**
  *  @brief  Sets cycle count and updates gain and max_data_rate values
+ *  at once, as a new epoch (init, replay; commands use RM3100_stageConfig)
  *  @param[in]  desire value PNI recomends values between 30 and 400 Hz
  *  @return     0 if successful, 1 otherwise.
  */
 BOOL setCycleCount ( unsigned int value ) {
 
-    BYTE to_reg[6];
+    rm3100_config c;
 
-    if (value > 65535 || value<0)
+    if (value > 65535)
         return TRUE;
-    else{
-
-        if (value > 400)
-            value=400;
-        else if (value < 30)
-            value=30;
 
-        to_reg[0] = value>>8;
-        to_reg[1] = value;
-        to_reg[2] = to_reg[0];
-        to_reg[3] = to_reg[1];
-        to_reg[4] = to_reg[0];
-        to_reg[5] = to_reg[1];
-
-        if (i2c_write(RM3100_ADDRESS_00, CCX_MSB_REG, 6,to_reg))
-            return TRUE;
-        else{
-            rm.cycle_count   = value;
-            rm.gain          = (float) rm.cycle_count * 0.37 + 1;
+    if (value > CC_MAX)
+        value=CC_MAX;
+    else if (value < CC_MIN)
+        value=CC_MIN;
 
-            float x = (float) 0.000011*value + 0.000075;
-            rm.max_data_rate = 1 / x;
-        }
-    }
-    return FALSE;
+    c.cycle_count = value;
+    return rm3100_write (&c, WR_CC);
 }
 /**
  *  @brief  Sets data rate in Continuous Measurement Mode.
@@ -132,53 +438,15 @@ BOOL setCycleCount ( unsigned int value ) {
  */
 BOOL setCMMdatarate ( BYTE conf ) {
 
+    rm3100_config c;
+
     if (conf < CMM_UPDATERATE_600 || conf > CMM_UPDATERATE_0_075)
         return TRUE;
-    else{
-        BYTE *ptr;
-        float temp = 1000;
-
-        switch (conf){
-            case CMM_UPDATERATE_600: temp=600;
-                                    break;
-            case CMM_UPDATERATE_300: temp=300;
-                                    break;
-            case CMM_UPDATERATE_150: temp=150;
-                                    break;
-            case CMM_UPDATERATE_75 : temp=75;
-                                    break;
-            case CMM_UPDATERATE_37 : temp=37;
-                                    break;
-            case CMM_UPDATERATE_18 : temp=18;
-                                    break;
-            case CMM_UPDATERATE_9  : temp=9;
-                                    break;
-            case CMM_UPDATERATE_4_5: temp=4.5;
-                                    break;
-            case CMM_UPDATERATE_2_3: temp=2.3;
-                                    break;
-            case CMM_UPDATERATE_1_2: temp=1.2;
-                                    break;
-            case CMM_UPDATERATE_0_6: temp=0.6;
-                                    break;
-            case CMM_UPDATERATE_0_3: temp=0.3;
-                                    break;
-            case CMM_UPDATERATE_0_15: temp=0.15;
-                                    break;
-            case CMM_UPDATERATE_0_075: temp=0.075;
-                                    break;
-        }
-        if (temp > rm.max_data_rate)
-            return TRUE;
+    if (tmrc_lut[conf - CMM_UPDATERATE_600].rate_mhz > rm.max_rate_mhz)
+        return TRUE;
 
-        ptr = &conf ;
-        if (i2c_write(RM3100_ADDRESS_00, CMM_TMRC_REG, 1, ptr))
-            return TRUE;
-        else{
-            rm.sample_rate = temp;
-        }
-    }
-    return FALSE;
+    c.tmrc = conf;
+    return rm3100_write (&c, WR_TMRC);
 }
 /**
  *  @brief  Continuous Measurement Mode (CMM) Register Configuration.
@@ -187,13 +455,10 @@ BOOL setCMMdatarate ( BYTE conf ) {
  */
 BOOL continuousModeConfig ( BYTE conf ) {
 
-    BYTE *ptr;
+    rm3100_config c;
 
-    ptr = &conf ;
-    if (i2c_write(RM3100_ADDRESS_00, CMM_REG, 1, ptr))
-        return TRUE;
-
-    return FALSE;
+    c.cmm = conf;
+    return rm3100_write (&c, WR_CMM);
 }
 /**
  *  @brief      Request Single Measurement to PNI ASIC.
@@ -212,98 +477,232 @@ BOOL requestSingleMeasurement ( void ) {
     return FALSE;
 }
 /**
- *  @brief      Get data ready Status
+ *  @brief      Get data ready Status. One bus attempt per call: it is
+ *  polled, so a failed read is not retried here. Each poll is a new
+ *  transaction, the next one is not a retry of this one.
  *  @param[in]  none
- *  @return     1 if data ready, 0 otherwise.
+ *  @return     1 if data ready, 0 otherwise (or if the bus failed).
  */
 BOOL getDataReadyStatus ( void ) {
 
     BYTE data[1];
 
-    i2c_read(RM3100_ADDRESS_00, STATUS_REG, 1, data);
+    if (i2c_read_attempt(RM3100_ADDRESS_00, STATUS_REG, 1, data, 0))
+        return FALSE;
 
     return (data[0] & STATUS_MASK);
 }
 /**
- *  @brief      Self test to Ev Board.
+ *  @brief      Self test to Ev Board (blocking, bounded by BIST_TIMEOUT_MS).
  *  @param[in]  none
- *  @return     1 if all axis OK, 0 otherwise.
+ *  @return     BIST_MASK bits of the axis that passed, 0 if failed.
  */
 BOOL getRM3100Status ( void ) {
 
-    BYTE data[1];
-    BYTE to_reg = STE_ON | BW_11 | BP_11;
-    BYTE *ptr;
-
-    ptr = &to_reg;
-    if (i2c_write(RM3100_ADDRESS_00, BIST_REG, 1, ptr))
+    if (RM3100_startSelfTest ())
         return FALSE;
 
-    if (requestSingleMeasurement ())
-        return FALSE;
+    while (RM3100_selfTestTask (TRUE))
+        ;
 
-    while(!getDataReadyStatus());
-    
-    if (i2c_read(RM3100_ADDRESS_00, BIST_REG, 1, data))
+    if (bist.state != BIST_DONE)
         return FALSE;
 
-    if (data[0] & STE_ON){
-        to_reg = STE_OFF;
-        ptr = &to_reg;
-        if (i2c_write(RM3100_ADDRESS_00, BIST_REG, 1, ptr))
-            return FALSE;
+    return (bist.result & BIST_MASK);
+}
+/**
+ *  @brief      Schedules a self test in the background.
+ *  It starts on the next call to RM3100_selfTestTask() with a gap.
+ *  @param[in]  none
+ *  @return     0 if scheduled, 1 if one is already in progress.
+ */
+BOOL RM3100_startSelfTest ( void ) {
 
-        return (data[0] & BIST_MASK);
-    }
+    if (bist.state == BIST_PENDING || bist.state == BIST_RUNNING)
+        return TRUE;
+
+    bist.state = BIST_PENDING;
     return FALSE;
 }
+/**
+ *  @brief      Sets the period of the automatic health check.
+ *  @param[in]  seconds between self tests, 0 to disable.
+ *  @return     none
+ */
+void RM3100_setSelfTestPeriod ( UINT32 seconds ) {
+
+    bist.period_s      = seconds;
+    bist.elapsed_s     = 0;
+    bist.elapsed_ticks = 0;
+    bist.last_tick     = ReadCoreTimer();
+}
+/**
+ *  @brief      Self test job result and counters.
+ *  @param[in]  none
+ *  @return     pointer to the job
+ */
+const bist_job * getRM3100SelfTest ( void ) { return &bist; }
+
+/** Leaves self test mode, drops the self test reading and restores CMM */
+static BOOL bistFinish ( bist_state state ) {
+
+    BYTE data[9];
+    BYTE to_reg = STE_OFF;
+    BOOL err;
+
+    err  = i2c_write(RM3100_ADDRESS_00, BIST_REG, 1, &to_reg);
+    err |= i2c_read(RM3100_ADDRESS_00, MX, 9, data);      // clears DRDY
+    if (rm.cmm_conf & CM_START)
+        err |= continuousModeConfig (rm.cmm_conf);
+
+    bist.state     = err ? BIST_FAILED : state;
+    bist.duration  = CT_TICKS_SINCE(bist.started);
+    bist.elapsed_s = 0;
+    bist.runs++;
+    if (bist.state == BIST_FAILED)
+        bist.bus_errors++;
+    else if (bist.state == BIST_TIMEOUT)
+        bist.timeouts++;
+    else if ((bist.result & BIST_MASK) != BIST_MASK)
+        bist.failures++;
+
+    return FALSE;
+}
+/**
+ *  @brief      Runs the background self test. Never blocks.
+ *  Call it from the main loop. A pending test only starts when gap is set,
+ *  i.e. no measurement is in flight, so it takes the place of exactly one
+ *  sample. In CMM the stream is stopped during the test and restarted after.
+ *  @param[in]  gap - TRUE if the sensor is free (no measurement requested)
+ *  @return     TRUE while the self test owns the sensor.
+ */
+BOOL RM3100_selfTestTask ( BOOL gap ) {
+
+    BYTE data[1];
+    BYTE to_reg;
+    UINT32 now;
+
+    if (bist.period_s){
+        now = ReadCoreTimer();
+        bist.elapsed_ticks += now - bist.last_tick;
+        bist.last_tick = now;
+        while (bist.elapsed_ticks >= ONE_SECOND){
+            bist.elapsed_ticks -= ONE_SECOND;
+            bist.elapsed_s++;
+        }
+        if (bist.elapsed_s >= bist.period_s && bist.state != BIST_RUNNING)
+            bist.state = BIST_PENDING;
+    }
+
+    switch (bist.state){
+        case BIST_PENDING:
+            if (!gap)
+                return FALSE;
+
+            bist.started = ReadCoreTimer();
+            bist.result  = 0;
+            if (rm.cmm_conf & CM_START){
+                to_reg = rm.cmm_conf & ~CM_START;
+                if (i2c_write(RM3100_ADDRESS_00, CMM_REG, 1, &to_reg))
+                    return bistFinish (BIST_FAILED);
+            }
+            to_reg = STE_ON | BW_11 | BP_11;
+            if (i2c_write(RM3100_ADDRESS_00, BIST_REG, 1, &to_reg) || requestSingleMeasurement ())
+                return bistFinish (BIST_FAILED);
+
+            bist.state = BIST_RUNNING;
+            return TRUE;
+
+        case BIST_RUNNING:
+            if (i2c_read(RM3100_ADDRESS_00, STATUS_REG, 1, data))
+                return bistFinish (BIST_FAILED);
+            if (!(data[0] & STATUS_MASK)){
+                if (CT_TICKS_SINCE(bist.started) > MS_TO_CORE_TICKS(BIST_TIMEOUT_MS))
+                    return bistFinish (BIST_TIMEOUT);
+                return TRUE;
+            }
+            if (i2c_read(RM3100_ADDRESS_00, BIST_REG, 1, data))
+                return bistFinish (BIST_FAILED);
+
+            bist.result = data[0] & BIST_MASK;
+            return bistFinish (BIST_DONE);
+
+        default:
+            return FALSE;
+    }
+}
 /**
  *  @brief      Request RM3100 Ev. Board Revision
  *  @param[in]  none
- *  @return     Revision value.
+ *  @return     Revision value, 0 if the sensor did not answer.
  */
 BYTE getRM3100revision ( void ) {
 
     BYTE data[1];
 
-    i2c_read(RM3100_ADDRESS_00, REVID_REG, 1, data);
+    if (i2c_read(RM3100_ADDRESS_00, REVID_REG, 1, data))
+        return 0;
 
     return data[0];
 }
 
+/**
+ *  @brief      Polls REVID_REG until the sensor answers (power up, reset).
+ *  @param[in]  timeout_ms - gives up after this long
+ *  @param[out] tries - reads it took
+ *  @return     revision, 0 if the sensor did not answer.
+ */
+BYTE RM3100_probe ( UINT32 timeout_ms, UINT16 *tries ) {
+
+    UINT32 start = ReadCoreTimer();
+    BYTE id;
+
+    *tries = 0;
+    do{
+        (*tries)++;
+        id = getRM3100revision ();
+    }while (!id && CT_TICKS_SINCE(start) < MS_TO_CORE_TICKS(timeout_ms));
+
+    return id;
+}
+
 /**
  *  @brief      Read the raw magnetic values of all 3 axis.
  *  @param[in]  none
- *  @return     x,y,z 32 bits raw_data of sensor_xyz type
+ *  @return     x,y,z 32 bits raw_data of sensor_xyz type.
+ *              flags has SAMPLE_I2C_ERROR set if the read failed.
  */
 sensor_xyz ReadRM3100Raw ( void ) {
     
-    sensor_xyz raw;
     BYTE data[9] ={0};
-    long reading = 0;
-
-    i2c_read(RM3100_ADDRESS_00, MX, 9, data);
-
-    reading  = *data <<8;
-    reading |= *(data+1);
-    reading  = reading <<8;
-    reading |= *(data+2);
-    reading  = reading <<8;
-    raw.x    = reading >>8;
-
-    reading  = *(data+3) <<8;
-    reading |= *(data+4);
-    reading  = reading <<8;
-    reading |= *(data+5);
-    reading  = reading <<8;
-    raw.y    = reading >>8;
-
-    reading  = *(data+6) <<8;
-    reading |= *(data+7);
-    reading  = reading <<8;
-    reading |= *(data+8);
-    reading  = reading <<8;
-    raw.z    = reading >>8;
+
+    return UnpackRM3100Raw (data, i2c_read(RM3100_ADDRESS_00, MX, 9, data) != 0);
+}
+
+/**
+ *  @brief      Converts the 9 bytes read from MX on, e.g. by a scheduled
+ *              bus transaction (busched.c).
+ *  @param[in]  data - MX..MZ registers, cleared if the read failed
+ *  @param[in]  failed - TRUE if the read failed, counted as a lost sample
+ *  @return     x,y,z 32 bits raw_data of sensor_xyz type.
+ */
+sensor_xyz UnpackRM3100Raw ( BYTE *data, BOOL failed ) {
+
+    sensor_xyz raw;
+
+    raw.flags = SAMPLE_OK;
+    raw.epoch = rm.epoch;
+    if (failed){
+        memset(data, 0, 9);
+        raw.flags |= SAMPLE_I2C_ERROR;
+        rm.lost_samples++;
+    }
+
+    /* 24 bits 2's complement, big endian. Sign extended through INT32 so
+       it also holds where long is 64 bits (host replay) */
+    raw.x = ((INT32)((UINT32) data[0] << 24 | (UINT32) data[1] << 16 | (UINT32) data[2] << 8)) >> 8;
+    raw.y = ((INT32)((UINT32) data[3] << 24 | (UINT32) data[4] << 16 | (UINT32) data[5] << 8)) >> 8;
+    raw.z = ((INT32)((UINT32) data[6] << 24 | (UINT32) data[7] << 16 | (UINT32) data[8] << 8)) >> 8;
 
     return raw;
 }
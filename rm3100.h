@@ -15,7 +15,7 @@
  *                  | 1.0          |    8/9/2014    | MR          | First Release          |
  *                  \n\n
  */
-#include <plib.h>
+#include "platform.h"
 
 #ifndef RM3100_H
 #define	RM3100_H
@@ -76,6 +76,14 @@
 #define CMM_UPDATERATE_0_15           0x9E
 #define CMM_UPDATERATE_0_075          0x9F
 
+/// Cycle count limits recommended by PNI
+#define CC_MIN                        30
+#define CC_MAX                        400
+#define CC_GAIN(cc)                   ((float)((float)(cc) * 0.37 + 1))   /**< counts / uT, PNI formula */
+
+/// Configuration epochs kept for the samples still in the pipeline, power of 2
+#define RM3100_EPOCHS                 16
+
 /// Configurations for Self test
 #define STE_ON    0x80
 #define STE_OFF   0x00
@@ -88,10 +96,26 @@
 #define BP_10    0x02
 #define BP_11    0x03
 
+#define BIST_XOK       0x10 /** Self test result per axis */
+#define BIST_YOK       0x20
+#define BIST_ZOK       0x40
+#define BIST_TIMEOUT_MS 50   /** Self test gives up if DRDY does not come */
+
 #define SM_ALL_AXIS    0x70 /** Single measument mode */
 #define STATUS_MASK    0x80 /** To get status of data ready */
 #define BIST_MASK      0x70 /** To get status of the Ev Board */
 
+/// Sample flags
+#define SAMPLE_OK           0x00
+#define SAMPLE_I2C_ERROR    0x01 /** Read failed, x,y,z are not valid */
+#define SAMPLE_SYNC         0x02 /** Timed by the PPS / trigger input (pps.h) */
+#define SAMPLE_SATURATED    0x04 /** Quality checks (quality.h): out of range */
+#define SAMPLE_STUCK        0x08 /** same reading over and over */
+#define SAMPLE_JUMP         0x10 /** moved faster than the slew limit */
+#define SAMPLE_NORM         0x20 /** field magnitude off the expected one */
+#define SAMPLE_REPLACED     0x40 /** outlier replaced by the Hampel filter */
+#define SAMPLE_EPOCH        0x80 /** first sample of a new sensor configuration */
+
 /*************** VAR ****************/
 /** @details Saves Raw data from sensors. */
 typedef struct {
@@ -99,13 +123,64 @@ typedef struct {
          y,/// x-axis data.
          z;/// y-axis data.
            /// z-axis data.
+   BYTE  flags;/// SAMPLE_* flags.
+   BYTE  epoch;/// configuration it was measured with, see RM3100_getEpoch.
 }sensor_xyz ;
 
+/** @details Sensor configuration, staged and written as a whole. */
+typedef struct {
+    UINT16 cycle_count;
+    BYTE   tmrc;        /// CMM_UPDATERATE_*
+    BYTE   cmm;         /// CMM register, CM_START runs CMM
+}rm3100_config;
+
+/** @details What the samples of one configuration are scaled with. */
+typedef struct {
+    float  gain;                /// counts / uT
+    float  sample_rate;         /// CMM rate, Hz
+    UINT32 nt_per_count_q16;
+    UINT16 cycle_count;
+}rm3100_epoch;
+
+/** @details States of the background self test job. */
+typedef enum {
+    BIST_IDLE,      /// nothing to do
+    BIST_PENDING,   /// waiting for a gap in the sample stream
+    BIST_RUNNING,   /// self test measurement in progress
+    BIST_DONE,      /// finished, result is valid
+    BIST_FAILED,    /// bus error
+    BIST_TIMEOUT    /// no DRDY within BIST_TIMEOUT_MS
+}bist_state;
+
+/** @details Background self test job. */
+typedef struct {
+    bist_state state;
+    BYTE   result;       /// BIST_XOK | BIST_YOK | BIST_ZOK of the last run
+    UINT32 started;      /// core timer tick when the measurement was requested
+    UINT32 duration;     /// core ticks used by the last run
+    UINT32 period_s;     /// seconds between periodic runs, 0 = only on request
+    UINT32 elapsed_s;    /// seconds since the last run
+    UINT32 elapsed_ticks;
+    UINT32 last_tick;
+    UINT32 runs,         /// completed runs
+           failures,     /// runs with an axis not OK
+           timeouts,     /// runs with no DRDY in time
+           bus_errors;   /// runs that hit a bus error
+}bist_job;
+
 
 /************ FUNCTIONS ************/
 sensor_xyz  ReadRM3100Raw      ( void );
+sensor_xyz  UnpackRM3100Raw    ( BYTE *data, BOOL failed );
 void RM3100_init_CMM_Operation ( void );
 void RM3100_init_SM_Operation  ( void );
+BOOL RM3100_stageConfig        ( const rm3100_config * );
+BOOL RM3100_commitConfig       ( void );
+BOOL RM3100_configPending      ( void );
+void RM3100_getConfig          ( rm3100_config * );
+void RM3100_getStagedConfig    ( rm3100_config * );
+BYTE getRM3100Epoch            ( void );
+const rm3100_epoch * RM3100_getEpoch ( BYTE );
 
 BOOL setCycleCount        ( unsigned int );
 BOOL setCMMdatarate           ( BYTE );
@@ -113,12 +188,23 @@ BOOL continuousModeConfig     ( BYTE );
 BOOL requestSingleMeasurement ( void );
 BOOL getDataReadyStatus       ( void );
 BYTE getRM3100revision        ( void );
+BYTE RM3100_probe             ( UINT32, UINT16 * );
 BOOL getRM3100Status          ( void );
 
+BOOL RM3100_startSelfTest     ( void );
+void RM3100_setSelfTestPeriod ( UINT32 );
+BOOL RM3100_selfTestTask      ( BOOL );
+const bist_job * getRM3100SelfTest ( void );
+
 float        getRM3100Gain        ( void );
 float        getRM3100SampleRate  ( void );
 float        getRM3100MaxDataRate ( void );
 unsigned int getRM3100CycleCount  ( void );
+UINT32       getRM3100LostSamples ( void );
+BYTE         getRM3100CMMConfig   ( void );
+BYTE         getRM3100DataRateCode( void );
+UINT32       getRM3100ScaleQ16    ( void );
+BYTE RM3100_closestDataRate   ( UINT32 );
 
 #endif	/* RM3100_H */
 
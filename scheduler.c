@@ -0,0 +1,153 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  sched
+ *  @brief       Cooperative run-to-completion scheduler.
+ *  @{
+ *      @file       scheduler.c
+ *      @brief      Event driven task scheduler.
+ *      @details    Builds unchanged on the PIC32 and on Linux (see host_port.c),
+ *                  where sched_run_once() gives a deterministic single step.
+ */
+#include "scheduler.h"
+
+/* Tasks, kept sorted by priority */
+static sched_task tasks[SCHED_MAX_TASKS];
+static BYTE       n_tasks = 0;
+/* Idle */
+static void     (*idle_hook)( void ) = 0;
+static UINT32     idle_ticks = 0;
+
+/**
+ *  @brief  Registers a task.
+ *  @param[in]  name - for run-time reports
+ *  @param[in]  fn   - task body, receives the events that woke it
+ *  @param[in]  mask - events the task waits for
+ *  @param[in]  prio - 0 is the highest priority
+ *  @return     0 if successful, 1 if the task table is full.
+ */
+BOOL sched_add ( const char *name, task_fn fn, UINT32 mask, BYTE prio ) {
+
+    BYTE i;
+
+    if (n_tasks >= SCHED_MAX_TASKS)
+        return TRUE;
+
+    for (i = n_tasks; i > 0 && tasks[i-1].prio > prio; i--)
+        tasks[i] = tasks[i-1];
+
+    memset(&tasks[i], 0, sizeof(sched_task));
+    tasks[i].name = name;
+    tasks[i].run  = fn;
+    tasks[i].mask = mask;
+    tasks[i].prio = prio;
+    n_tasks++;
+
+    return FALSE;
+}
+
+/**
+ *  @brief  Posts events to every task waiting for them. Safe from ISRs.
+ *  @param[in]  events - EV_* flags
+ *  @return     none
+ */
+void sched_post ( UINT32 events ) {
+
+    BYTE i;
+    unsigned int status;
+
+    status = INTDisableInterrupts();
+    for (i = 0; i < n_tasks; i++)
+        tasks[i].pending |= events & tasks[i].mask;
+    INTRestoreInterrupts(status);
+}
+
+/**
+ *  @brief  Runs the highest priority task with pending events, once.
+ *  @param[in]  none
+ *  @return     TRUE if a task ran, FALSE if nothing was pending.
+ */
+BOOL sched_run_once ( void ) {
+
+    BYTE i;
+    UINT32 events, start, used;
+    unsigned int status;
+
+    for (i = 0; i < n_tasks; i++) {
+        if (!tasks[i].pending)
+            continue;
+
+        status = INTDisableInterrupts();
+        events = tasks[i].pending;
+        tasks[i].pending = 0;
+        INTRestoreInterrupts(status);
+
+        start = ReadCoreTimer();
+        tasks[i].run(events);
+        used = ReadCoreTimer() - start;
+
+        tasks[i].runs++;
+        tasks[i].ticks += used;
+        if (used > tasks[i].max_ticks)
+            tasks[i].max_ticks = used;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ *  @brief  Idles the CPU until the next interrupt.
+ *  An event posted between the last check and the wait instruction is only
+ *  served on the next interrupt, so wake up latency is bounded by one tick.
+ */
+static void sched_idle ( void ) {
+
+    UINT32 start = ReadCoreTimer();
+
+    if (idle_hook)
+        idle_hook();
+#if defined(__PIC32MX__)
+    else
+        PowerSaveIdle();
+#endif
+    idle_ticks += ReadCoreTimer() - start;
+}
+
+/**
+ *  @brief  Scheduler main loop. Never returns.
+ *  @param[in]  none
+ *  @return     none
+ */
+void sched_run ( void ) {
+
+    while (1) {
+        if (!sched_run_once())
+            sched_idle();
+    }
+}
+
+/**
+ *  @brief  Replaces the default idle (CPU idle mode until next interrupt).
+ *  @param[in]  hook - called with nothing pending, 0 for the default
+ *  @return     none
+ */
+void sched_set_idle_hook ( void (*hook)( void ) ) { idle_hook = hook; }
+
+/**
+ *  @brief  Core timer ticks spent idle (wraps).
+ *  @param[in]  none
+ *  @return     idle ticks
+ */
+UINT32 sched_idle_ticks ( void ) { return idle_ticks; }
+
+/**
+ *  @brief  Task table with run-time accounting, sorted by priority.
+ *  @param[out] count - number of tasks
+ *  @return     pointer to the first task
+ */
+const sched_task * sched_get_tasks ( BYTE *count ) {
+
+    *count = n_tasks;
+    return tasks;
+}
@@ -0,0 +1,63 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  sched
+ *  @brief       Cooperative run-to-completion scheduler.
+ *  @{
+ *      @file       scheduler.h
+ *      @brief      Event driven task scheduler.
+ *      @details    ISRs only post event flags. Each task is registered with
+ *                  the events it waits for and a priority (0 is the highest).
+ *                  The scheduler runs the highest priority task with pending
+ *                  events until it returns, and idles the CPU when nothing is
+ *                  pending.
+ */
+#ifndef SCHEDULER_H
+#define	SCHEDULER_H
+
+#include "platform.h"
+
+#define SCHED_MAX_TASKS     (16)
+#define SCHED_TICK_HZ       (1000)                          /**< Core timer tick rate */
+#define CORE_TICK_PERIOD    (ONE_SECOND/SCHED_TICK_HZ)      /**< Core timer ticks per scheduler tick */
+
+/// Event flags
+#define EV_TICK         0x0001  /** scheduler tick (core timer ISR) */
+#define EV_SECOND       0x0002  /** once per second (core timer ISR) */
+#define EV_DRDY         0x0008  /** RM3100 data ready pin */
+#define EV_I2C          0x0010  /** I2C bus event */
+#define EV_UART_RX      0x0020  /** byte(s) received */
+#define EV_UART_TX      0x0040  /** transmit buffer has room */
+#define EV_SAMPLE       0x0080  /** raw sample queued for processing */
+#define EV_OUTPUT       0x0100  /** processed sample queued for output */
+#define EV_CAPTURE      0x0200  /** burst capture has flash work or data to dump */
+#define EV_FFT          0x0400  /** spectrum analysis has a step to run */
+#define EV_RADIO        0x0800  /** radio packet ready or transmit done */
+#define EV_BUS          0x1000  /** I2C transaction queued */
+#define EV_AHRS         0x2000  /** IMU samples queued */
+#define EV_PPS          0x4000  /** PPS / trigger edge captured */
+
+typedef void (*task_fn)( UINT32 events );
+
+/** @details Task control block with run-time accounting. */
+typedef struct {
+    const char *name;
+    task_fn     run;
+    UINT32      mask;       /// events the task waits for
+    UINT32      pending;    /// events posted and not yet handled
+    BYTE        prio;       /// 0 - highest
+    UINT32      runs;       /// number of activations
+    UINT32      ticks;      /// core timer ticks spent running (wraps)
+    UINT32      max_ticks;  /// longest activation
+}sched_task;
+
+BOOL   sched_add           ( const char *name, task_fn fn, UINT32 mask, BYTE prio );
+void   sched_post          ( UINT32 events );
+BOOL   sched_run_once      ( void );
+void   sched_run           ( void );
+void   sched_set_idle_hook ( void (*hook)( void ) );
+UINT32 sched_idle_ticks    ( void );
+const sched_task * sched_get_tasks ( BYTE *count );
+
+#endif	/* SCHEDULER_H */
@@ -0,0 +1,290 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  main
+ *  @{
+ *      @file       stats.c
+ *      @brief      Per axis statistics of the raw sample stream.
+ *      @details    stats_update costs per axis one 64 bits division (the
+ *                  Welford mean) and a few 64 bits multiply / adds. Memory is
+ *                  the 3 x STATS_WINDOW ring plus a few words per axis.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "stats.h"
+
+static stats_axis ax[3];
+static INT32      ring[3][STATS_WINDOW];
+static UINT32     n      = 0;               // samples since reset
+static UINT32     period = STATS_PERIOD;
+static UINT32     since  = 0;               // samples since the last summary
+static UINT32     target = 0;               // noise target, nT, 0 = none
+
+/** Integer square root, floor */
+static UINT32 isqrt64 ( UINT64 v ) {
+
+    UINT64 r = 0, bit = (UINT64) 1 << 62;
+
+    while (bit > v)
+        bit >>= 2;
+    while (bit){
+        if (v >= r + bit){
+            v -= r + bit;
+            r  = (r >> 1) + bit;
+        }
+        else
+            r >>= 1;
+        bit >>= 2;
+    }
+    return (UINT32) r;
+}
+
+/**
+ *  @brief  Clears running and window statistics.
+ *  @param[in]  none
+ *  @return     none
+ */
+void stats_reset ( void ) {
+
+    memset(ax, 0, sizeof(ax));
+    n = since = 0;
+}
+
+/**
+ *  @brief  Adds a raw sample. Samples with a bus error are ignored.
+ *  @param[in]  raw - counts
+ *  @return     none
+ */
+void stats_update ( const sensor_xyz *raw ) {
+
+    const INT32 v[3] = { raw->x, raw->y, raw->z };
+    UINT32 slot = n & (STATS_WINDOW-1);
+    stats_axis *a;
+    INT64 d, delta;
+    UINT64 inc;
+    INT32 x, old;
+    BYTE i;
+
+    if (raw->flags & SAMPLE_I2C_ERROR)
+        return;
+
+    for (i = 0; i < 3; i++){
+        a = &ax[i];
+        x = v[i];
+        if (n == 0){
+            a->ref = a->min = a->max = x;
+        }
+        /* running, Welford on x - ref */
+        d           = (INT64) (x - a->ref) << 16;
+        delta       = d - a->mean_q16;
+        a->mean_q16 += delta / (INT64) (n + 1);
+        inc         = (UINT64) ((delta >> 8) * ((d - a->mean_q16) >> 8));   // >= 0
+        a->m2_q16   = (a->m2_q16 + inc < a->m2_q16) ? ~(UINT64) 0 : a->m2_q16 + inc;
+        if (x < a->min)
+            a->min = x;
+        if (x > a->max)
+            a->max = x;
+
+        /* window, exact sums */
+        if (n >= STATS_WINDOW){
+            old      = ring[i][slot];
+            a->sum  -= old;
+            a->sum2 -= (INT64) old * old;
+        }
+        ring[i][slot] = x;
+        a->sum  += x;
+        a->sum2 += (INT64) x * x;
+    }
+    n++;
+    since++;
+}
+
+/**
+ *  @brief  Statistics of one axis.
+ *  @param[in]  axis - 0 x, 1 y, 2 z
+ *  @param[out] r - values in counts Q8
+ *  @return     0 if successful, 1 if there is no sample yet.
+ */
+BOOL stats_get ( BYTE axis, stats_result *r ) {
+
+    const stats_axis *a = &ax[axis];
+    UINT32 k = n < STATS_WINDOW ? n : STATS_WINDOW, i;
+    UINT64 q, rms2;
+    INT32 x;
+
+    if (axis > 2 || k == 0)
+        return TRUE;
+
+    /* k^2 * variance, exact */
+    q = (UINT64) ((INT64) k * a->sum2 - a->sum * a->sum);
+    r->mean = (INT32) ((a->sum * 256) / (INT64) k);
+    if (q / k < ((UINT64) 1 << 47))
+        r->std = isqrt64(((q / k) << 16) / k);
+    else
+        r->std = (INT32) ((UINT64) isqrt64(q) * 256 / k);
+
+    rms2 = (UINT64) ((INT64) r->mean * r->mean) + (UINT64) r->std * r->std;
+    r->rms = rms2 >> 62 ? 0x7FFFFFFF : (INT32) isqrt64(rms2);
+
+    r->min = r->max = ring[axis][0];
+    for (i = 1; i < k; i++){
+        x = ring[axis][i];
+        if (x < r->min)
+            r->min = x;
+        if (x > r->max)
+            r->max = x;
+    }
+    r->min *= 256;
+    r->max *= 256;
+
+    r->run_mean = a->ref * 256 + (INT32) (a->mean_q16 >> 8);
+    r->run_std  = n > 1 ? isqrt64(a->m2_q16 / (n - 1)) : 0;
+    r->run_min  = a->min * 256;
+    r->run_max  = a->max * 256;
+    return FALSE;
+}
+
+/**
+ *  @brief  Samples since reset.
+ *  @param[in]  none
+ *  @return     count
+ */
+UINT32 stats_count ( void ) { return n; }
+
+/**
+ *  @brief  Sets the summary period and restarts the statistics.
+ *  @param[in]  samples - 1 to 1000000
+ *  @return     0 if successful, 1 otherwise.
+ */
+BOOL stats_set_period ( UINT32 samples ) {
+
+    if (samples < 1 || samples > 1000000)
+        return TRUE;
+
+    period = samples;
+    stats_reset();
+    return FALSE;
+}
+/**
+ *  @brief  request summary period
+ *  @param[in]  none
+ *  @return     samples
+ */
+UINT32 stats_get_period ( void ) { return period; }
+
+/**
+ *  @brief  Sets the noise target used for the cycle count suggestion.
+ *  @param[in]  noise_nt - nT, 0 = no suggestion
+ *  @return     none
+ */
+void stats_set_target ( UINT32 noise_nt ) { target = noise_nt; }
+
+/**
+ *  @brief  TRUE once per period, when a summary is due.
+ *  @param[in]  none
+ *  @return     TRUE if a summary should be sent now.
+ */
+BOOL stats_due ( void ) {
+
+    if (since < period)
+        return FALSE;
+
+    since = 0;
+    return TRUE;
+}
+
+/** Counts Q8 to nT x 10, rounded */
+static INT32 q8_to_nt10 ( INT32 v ) {
+
+    INT64 p = (INT64) v * getRM3100ScaleQ16() * 10;
+
+    return (INT32) ((p + ((INT64) 1 << 23)) >> 24);
+}
+
+/**
+ *  @brief  Mean window std of the 3 axes.
+ *  @param[in]  none
+ *  @return     noise, nT x 10
+ */
+UINT32 stats_noise_nt10 ( void ) {
+
+    stats_result r;
+    UINT32 sum = 0;
+    BYTE i;
+
+    for (i = 0; i < 3; i++){
+        if (stats_get(i, &r))
+            return 0;
+        sum += q8_to_nt10(r.std);
+    }
+    return sum / 3;
+}
+
+/**
+ *  @brief  Cycle count expected to give a noise level, assuming the
+ *  noise goes as 1 / sqrt(cycle count).
+ *  @param[in]  target_nt10 - nT x 10
+ *  @return     cycle count within CC_MIN..CC_MAX, 0 if unknown.
+ */
+UINT16 stats_suggest_cycle_count ( UINT32 target_nt10 ) {
+
+    UINT64 noise = stats_noise_nt10 (), cc;
+
+    if (!target_nt10 || !noise)
+        return 0;
+
+    cc = (getRM3100CycleCount () * noise * noise + target_nt10 * target_nt10 - 1)
+         / ((UINT64) target_nt10 * target_nt10);
+    if (cc < CC_MIN)
+        cc = CC_MIN;
+    if (cc > CC_MAX)
+        cc = CC_MAX;
+    return (UINT16) cc;
+}
+
+/** Writes a nT x 10 value as " -12.3", returns the length */
+static UINT32 put_nt ( char *out, INT32 v10 ) {
+
+    UINT32 u = v10 < 0 ? -v10 : v10;
+
+    return sprintf(out, " %s%u.%u", v10 < 0 ? "-" : "", (unsigned) (u / 10), (unsigned) (u % 10));
+}
+
+/**
+ *  @brief  Formats the summary line (see stats.h).
+ *  @param[out] out - STATS_MAX_LINE bytes
+ *  @return     line length, 0 if there is no sample yet
+ */
+UINT32 stats_format ( char *out ) {
+
+    static const char axis_name[3] = { 'X', 'Y', 'Z' };
+    stats_result r;
+    UINT32 len;
+    UINT16 cc;
+    BYTE i;
+
+    if (!n)
+        return 0;
+
+    len = sprintf(out, "STAT %u", (unsigned) n);
+    for (i = 0; i < 3; i++){
+        stats_get(i, &r);
+        out[len++] = ' ';
+        out[len++] = axis_name[i];
+        len += put_nt(&out[len], q8_to_nt10(r.mean));
+        len += put_nt(&out[len], q8_to_nt10(r.std));
+        len += put_nt(&out[len], q8_to_nt10(r.min));
+        len += put_nt(&out[len], q8_to_nt10(r.max));
+        len += put_nt(&out[len], q8_to_nt10(r.rms));
+    }
+    len += sprintf(&out[len], " NOISE");
+    len += put_nt(&out[len], stats_noise_nt10());
+    len += sprintf(&out[len], " CC %u", getRM3100CycleCount());
+    cc = stats_suggest_cycle_count(target * 10);
+    if (cc)
+        len += sprintf(&out[len], " SUGGEST %u", cc);
+    out[len++] = '\n';
+    out[len]   = 0;
+    return len;
+}
@@ -0,0 +1,76 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  main
+ *  @{
+ *      @file       stats.h
+ *      @brief      Per axis statistics of the raw sample stream.
+ *      @details    Two sets of statistics per axis, updated with every raw
+ *                  sample in constant time and in integer arithmetic:
+ *
+ *                  Running (since stats_reset): Welford mean and variance of
+ *                  the deviation from the first sample, in Q16 counts, and
+ *                  min / max.
+ *
+ *                  Window (last STATS_WINDOW samples): exact 64 bits sums of
+ *                  x and x^2 kept by adding the new sample and subtracting the
+ *                  one leaving the ring. The variance is
+ *                  (n * sum(x^2) - sum(x)^2) / n^2, computed exactly, so there
+ *                  is no cancellation or drift. Min / max / RMS are worked out
+ *                  from the ring when a summary is requested.
+ *
+ *                  Counts are 24 bits, so with a 256 sample window every sum
+ *                  fits in 62 bits.
+ *
+ *                  The summary (FMT_SUMMARY output) is one line every period
+ *                  samples, values in nT:
+ *
+ *                  STAT n X mean std min max rms Y ... Z ... NOISE nT CC cc [SUGGEST cc]
+ *
+ *                  mean/std/min/max/rms are over the window, n counts the
+ *                  samples since reset. NOISE is the mean window std of the
+ *                  3 axes. The RM3100 noise goes about as 1 / sqrt(cycle
+ *                  count), so SUGGEST is the cycle count expected to reach
+ *                  the target set with stats_set_target (NOISE command).
+ */
+#ifndef STATS_H
+#define	STATS_H
+
+#include "platform.h"
+#include "rm3100.h"
+
+#define STATS_WINDOW        (256)   /**< Window length, power of 2, max 256 */
+#define STATS_PERIOD        (100)   /**< Default samples between summaries */
+#define STATS_MAX_LINE      (256)
+
+/** @details Running and window state of one axis. */
+typedef struct {
+    INT32  ref;         /// first sample, running stats are of x - ref
+    INT64  mean_q16;    /// running mean of x - ref, Q16
+    UINT64 m2_q16;      /// running sum of squared deviations, Q16 (saturates)
+    INT32  min, max;    /// running
+    INT64  sum;         /// window sum of x
+    INT64  sum2;        /// window sum of x^2
+}stats_axis;
+
+/** @details Values of one axis, counts Q8. */
+typedef struct {
+    INT32 mean, std, min, max, rms;     /// window
+    INT32 run_mean, run_std;            /// since reset
+    INT32 run_min, run_max;
+}stats_result;
+
+void   stats_reset       ( void );
+void   stats_update      ( const sensor_xyz *raw );
+BOOL   stats_get         ( BYTE axis, stats_result *r );
+UINT32 stats_count       ( void );
+BOOL   stats_set_period  ( UINT32 samples );
+UINT32 stats_get_period  ( void );
+void   stats_set_target  ( UINT32 noise_nt );
+BOOL   stats_due         ( void );
+UINT32 stats_noise_nt10  ( void );
+UINT16 stats_suggest_cycle_count ( UINT32 target_nt10 );
+UINT32 stats_format      ( char *out );
+
+#endif	/* STATS_H */
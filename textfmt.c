@@ -0,0 +1,166 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  uart
+ *  @{
+ *      @file       textfmt.c
+ *      @brief      Integer only float to decimal formatting.
+ *      @details    A finite float is m * 2^e with m < 2^24. For e >= 0 it is
+ *                  an integer. For e < 0 the integer part is m >> -e and the
+ *                  decimals are the remaining bits times 10^decimals, rounded
+ *                  by comparing what is shifted out against one half. Below
+ *                  2^-44 nothing can reach the 6th decimal, so 64 bits hold
+ *                  every intermediate value.
+ */
+#include "textfmt.h"
+
+static const UINT32 pow10[TEXTFMT_MAX_DECIMALS + 1] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000
+};
+
+/** Writes v in decimal, returns the number of digits */
+static BYTE put_uint ( char *out, UINT64 v ) {
+
+    char   tmp[20];
+    BYTE   n = 0, i;
+    UINT32 v32;
+
+    while (v > 0xFFFFFFFF){             // only for |v| >= 2^32
+        tmp[n++] = '0' + (char) (v % 10);
+        v /= 10;
+    }
+    v32 = (UINT32) v;
+    do {
+        tmp[n++] = '0' + (char) (v32 % 10);
+        v32 /= 10;
+    } while (v32);
+
+    for (i = 0; i < n; i++)
+        out[i] = tmp[n - 1 - i];
+    return n;
+}
+
+/** Writes m * 2^e in decimal when it does not fit in 64 bits, returns the
+ *  number of digits. Doubles a decimal digit string e times. */
+static BYTE put_big ( char *out, UINT32 m, int e ) {
+
+    BYTE d[40];                         // low digit first, FLT_MAX has 39
+    BYTE n = 0, i, t, carry;
+
+    while (m){
+        d[n++] = m % 10;
+        m /= 10;
+    }
+    while (e--){
+        carry = 0;
+        for (i = 0; i < n; i++){
+            t     = d[i] * 2 + carry;
+            carry = t >= 10;
+            d[i]  = t - 10 * carry;
+        }
+        if (carry)
+            d[n++] = 1;
+    }
+
+    for (i = 0; i < n; i++)
+        out[i] = '0' + d[n - 1 - i];
+    return n;
+}
+
+/**
+ *  @brief  Formats a float like printf "%.<decimals>f".
+ *  @param[out] out - at least TEXTFMT_MAX_FIELD + 1 bytes, zero terminated
+ *  @param[in]  v - value
+ *  @param[in]  decimals - 0 to TEXTFMT_MAX_DECIMALS
+ *  @return     number of characters written, without the terminating zero
+ */
+BYTE textfmt_fixed ( char *out, float v, BYTE decimals ) {
+
+    union { float f; UINT32 u; } bits;
+    UINT32 m, q = 0;
+    UINT64 ip, frac, scaled, mask, half;
+    int    e, s;
+    BYTE   n = 0, i;
+
+    bits.f = v;
+    if (bits.u >> 31)
+        out[n++] = '-';                 // also "-0.0"
+
+    e = (bits.u >> 23) & 0xFF;
+    m = bits.u & 0x7FFFFF;
+    if (e == 0xFF){
+        out[n++] = m ? 'n' : 'i';
+        out[n++] = m ? 'a' : 'n';
+        out[n++] = m ? 'n' : 'f';
+        out[n]   = 0;
+        return n;
+    }
+    if (e)
+        m |= 0x800000;                  // normal, hidden bit
+    else
+        e = 1;                          // subnormal
+    e -= 150;                           // v = m * 2^e
+
+    if (e >= 40)
+        n += put_big(&out[n], m, e);
+    else if (e >= 0)
+        n += put_uint(&out[n], (UINT64) m << e);
+    else{
+        s = -e;
+        ip = 0;
+        if (s <= 44){
+            mask   = ((UINT64) 1 << s) - 1;
+            half   = (UINT64) 1 << (s - 1);
+            ip     = (UINT64) m >> s;
+            frac   = m & mask;
+            scaled = frac * pow10[decimals];
+            q      = (UINT32) (scaled >> s);
+            scaled &= mask;
+            /* round half to even on the last digit kept */
+            if (scaled > half || (scaled == half && ((decimals ? q : ip) & 1)))
+                q++;
+            if (q == pow10[decimals]){
+                q = 0;
+                ip++;
+            }
+        }
+        n += put_uint(&out[n], ip);
+    }
+
+    if (decimals){
+        out[n++] = '.';
+        for (i = decimals; i--; ){
+            out[n + i] = '0' + q % 10;
+            q /= 10;
+        }
+        n += decimals;
+    }
+    out[n] = 0;
+    return n;
+}
+
+/**
+ *  @brief  Formats a sample line, same bytes as
+ *  printf "%.1f   %.1f   %.1f   %f\n".
+ *  @param[out] out - TEXTFMT_MAX_LINE bytes, zero terminated
+ *  @param[in]  x, y, z - field, uT
+ *  @param[in]  dt - sample interval, s
+ *  @return     line length, without the terminating zero
+ */
+BYTE textfmt_sample ( char *out, float x, float y, float z, float dt ) {
+
+    BYTE n;
+
+    n  = textfmt_fixed(out, x, 1);
+    out[n++] = ' '; out[n++] = ' '; out[n++] = ' ';
+    n += textfmt_fixed(&out[n], y, 1);
+    out[n++] = ' '; out[n++] = ' '; out[n++] = ' ';
+    n += textfmt_fixed(&out[n], z, 1);
+    out[n++] = ' '; out[n++] = ' '; out[n++] = ' ';
+    n += textfmt_fixed(&out[n], dt, 6);
+    out[n++] = '\n';
+    out[n]   = 0;
+
+    return n;
+}
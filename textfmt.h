@@ -0,0 +1,30 @@
+/**
+ *  Driver developed in HERMES project
+ */
+/**
+ *  @addtogroup  uart
+ *  @{
+ *      @file       textfmt.h
+ *      @brief      Integer only float to decimal formatting.
+ *      @details    Produces the same bytes as printf "%.Nf" (correct rounding,
+ *                  ties to even, "-0.0", "inf", "nan") for any float, using
+ *                  shifts and integer multiplies instead of the soft-float
+ *                  printf machinery. The float is taken apart as
+ *                  mantissa * 2^exponent and the decimal digits are worked
+ *                  out exactly from those two integers.
+ */
+#ifndef TEXTFMT_H
+#define	TEXTFMT_H
+
+#include "platform.h"
+
+#define TEXTFMT_MAX_DECIMALS    (6)
+/** Longest field: sign, 39 integer digits, point and 6 decimals */
+#define TEXTFMT_MAX_FIELD       (1 + 39 + 1 + TEXTFMT_MAX_DECIMALS)
+/** Longest sample line, with its terminating zero */
+#define TEXTFMT_MAX_LINE        (4 * TEXTFMT_MAX_FIELD + 3 * 3 + 2)
+
+BYTE textfmt_fixed ( char *out, float v, BYTE decimals );
+BYTE textfmt_sample ( char *out, float x, float y, float z, float dt );
+
+#endif	/* TEXTFMT_H */
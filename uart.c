@@ -1,38 +1,260 @@
+
+#include <string.h>
 #include "uart.h"
+#include "scheduler.h"
+
+BYTE                   uart_tx_buf[UART_TX_SIZE];
+static volatile UINT32 tx_head = 0;            // written by UARTTxCommit
+static volatile UINT32 tx_tail = 0;            // written by tx_drain
+static volatile BOOL   tx_waiting = FALSE;     // a writer found the ring full
+
+#if defined(__PIC32MX__)
+
+static volatile BYTE   rx_buf[UART_RX_SIZE];
+static volatile BYTE   rx_head = 0;            // written by the ISR
+static volatile BYTE   rx_tail = 0;            // written by UARTReadByte
+static volatile UINT32 rx_overruns = 0;
+
+// *****************************************************************************
+// static void tx_drain(void)
+//  Moves bytes from the transmit ring to the UART FIFO while there is room
+// *****************************************************************************
+static void tx_drain(void)
+{
+    while(tx_tail != tx_head && UARTTransmitterIsReady(UART_MODULE_ID))
+    {
+        UARTSendDataByte(UART_MODULE_ID, uart_tx_buf[tx_tail & (UART_TX_SIZE-1)]);
+        tx_tail++;
+    }
+}
+
+// *****************************************************************************
+// static void tx_start(void)
+//  The TX interrupt fires while the FIFO is not full and drains the ring
+// *****************************************************************************
+static void tx_start(void)
+{
+    INTEnable(INT_SOURCE_UART_TX(UART_MODULE_ID), INT_ENABLED);
+}
+
+// *****************************************************************************
+// UART 1 ISR - fills the receive ring, drains the transmit ring
+//  Interrupt Priority Level = 2
+//  Vector 24
+// *****************************************************************************
+void __ISR(UART_1_INT_VECTOR, ipl2) _UART1Handler(void)
+{
+    if(INTGetFlag(INT_SOURCE_UART_RX(UART_MODULE_ID)))
+    {
+        while(UARTReceivedDataIsAvailable(UART_MODULE_ID))
+        {
+            if((BYTE)(rx_head - rx_tail) < UART_RX_SIZE)
+                rx_buf[rx_head++ & (UART_RX_SIZE-1)] = UARTGetDataByte(UART_MODULE_ID);
+            else
+            {
+                UARTGetDataByte(UART_MODULE_ID);
+                rx_overruns++;
+            }
+        }
+        INTClearFlag(INT_SOURCE_UART_RX(UART_MODULE_ID));
+        sched_post(EV_UART_RX);
+    }
+    if(INTGetEnable(INT_SOURCE_UART_TX(UART_MODULE_ID)) && INTGetFlag(INT_SOURCE_UART_TX(UART_MODULE_ID)))
+    {
+        tx_drain();
+        INTClearFlag(INT_SOURCE_UART_TX(UART_MODULE_ID));
+        if(tx_tail == tx_head)
+            INTEnable(INT_SOURCE_UART_TX(UART_MODULE_ID), INT_DISABLED);
+        if(tx_waiting && tx_head - tx_tail <= UART_TX_SIZE/2)
+        {
+            tx_waiting = FALSE;
+            sched_post(EV_UART_TX);
+        }
+    }
+    if(INTGetFlag(INT_SOURCE_UART_ERROR(UART_MODULE_ID)))
+    {
+        U1STAbits.OERR = 0;     // hardware FIFO overrun, restart reception
+        rx_overruns++;
+        INTClearFlag(INT_SOURCE_UART_ERROR(UART_MODULE_ID));
+    }
+}
+
+// *****************************************************************************
+// BOOL UARTReadByte(BYTE *data)
+//  Non blocking, TRUE if a byte was read from the receive ring
+// *****************************************************************************
+BOOL UARTReadByte(BYTE *data)
+{
+    if(rx_tail == rx_head)
+        return FALSE;
+
+    *data = rx_buf[rx_tail & (UART_RX_SIZE-1)];
+    rx_tail++;
+
+    return TRUE;
+}
+
+// *****************************************************************************
+// UINT32 UARTRxOverruns(void)
+// *****************************************************************************
+UINT32 UARTRxOverruns(void)
+{
+    return rx_overruns;
+}
+
+// *****************************************************************************
+// BOOL UARTIsIdle(void)
+//  TRUE with nothing queued, the last byte out and no byte coming in: the
+//  baud rate can be changed
+// *****************************************************************************
+BOOL UARTIsIdle(void)
+{
+    return tx_tail == tx_head && UARTTransmissionHasCompleted(UART_MODULE_ID)
+           && (UARTGetLineStatus(UART_MODULE_ID) & UART_RECEIVER_IDLE);
+}
+
+#else   /* host build, the ring is written to stdout on commit */
+
+#include <stdio.h>
+
+static void tx_drain(void)
+{
+    UINT32 off = tx_tail & (UART_TX_SIZE-1), n = tx_head - tx_tail;
+
+    if(off + n > UART_TX_SIZE)
+    {
+        fwrite(&uart_tx_buf[off], 1, UART_TX_SIZE - off, stdout);
+        n  -= UART_TX_SIZE - off;
+        off = 0;
+    }
+    fwrite(&uart_tx_buf[off], 1, n, stdout);
+    tx_tail = tx_head;
+}
+
+static void tx_start(void)
+{
+    tx_drain();
+}
+
+#endif
 
 // *****************************************************************************
-// void UARTTxBuffer(char *buffer, UINT32 size)
+// void SendDataBuffer(const char *buffer, UINT32 size)
+//  Copies into the transmit ring, waits only while the ring is full
 // *****************************************************************************
 void SendDataBuffer(const char *buffer, UINT32 size)
 {
+    uart_txw w;
+    UINT32 n;
+    unsigned int status;
+
     while(size)
     {
-        while(!UARTTransmitterIsReady(UART_MODULE_ID))
-            ;
+        n = size < UART_TX_SIZE/2 ? size : UART_TX_SIZE/2;
+        while(UARTTxReserve(&w, n))
+        {
+            status = INTDisableInterrupts();    // also works with interrupts off
+            tx_drain();
+            INTRestoreInterrupts(status);
+        }
+        UARTTxWrite(&w, buffer, n);
+        UARTTxCommit(&w);
 
-        UARTSendDataByte(UART_MODULE_ID, *buffer);
+        buffer += n;
+        size   -= n;
+    }
+}
 
-        buffer++;
-        size--;
+// *****************************************************************************
+// BOOL UARTTxReserve(uart_txw *w, UINT32 size)
+//  Reserves size bytes at the head of the transmit ring.
+//  Returns 0 if successful, 1 if the ring is full; EV_UART_TX is posted
+//  once it has drained to half.
+// *****************************************************************************
+BOOL UARTTxReserve(uart_txw *w, UINT32 size)
+{
+    unsigned int status;
+
+    if(size > UARTTxFree())
+    {
+        // the ISR may have drained the ring since the check: look again
+        // with it masked, otherwise nobody would post EV_UART_TX
+        status = INTDisableInterrupts();
+        tx_waiting = TRUE;
+        if(tx_head - tx_tail <= UART_TX_SIZE/2)
+        {
+            tx_waiting = FALSE;
+            sched_post(EV_UART_TX);
+        }
+        INTRestoreInterrupts(status);
+        return TRUE;
     }
+    w->pos = tx_head;
+    w->end = tx_head + size;
 
-    while(!UARTTransmissionHasCompleted(UART_MODULE_ID))
-        ;
+    return FALSE;
 }
 
 // *****************************************************************************
-// UINT32 GetMenuChoice(void)
+// BYTE *UARTTxDirect(uart_txw *w, UINT32 size, BYTE *bounce)
+//  Returns where a formatter may write size contiguous bytes: the ring
+//  itself, or bounce when the reservation wraps around its end
 // *****************************************************************************
-UINT32 GetMenuChoice(void)
+BYTE *UARTTxDirect(uart_txw *w, UINT32 size, BYTE *bounce)
 {
-    UINT8  menu_item;
+    UINT32 off = w->pos & (UART_TX_SIZE-1);
 
-    while(!UARTReceivedDataIsAvailable(UART_MODULE_ID))
-        ;
+    if(off + size > UART_TX_SIZE)
+        return bounce;
 
-    menu_item = UARTGetDataByte(UART_MODULE_ID);
+    return &uart_tx_buf[off];
+}
 
-    menu_item -= '0';
+// *****************************************************************************
+// void UARTTxAdvance(uart_txw *w, const BYTE *p, UINT32 n)
+//  Accounts for n bytes written at p, copies them if p is the bounce buffer
+// *****************************************************************************
+void UARTTxAdvance(uart_txw *w, const BYTE *p, UINT32 n)
+{
+    if(p == &uart_tx_buf[w->pos & (UART_TX_SIZE-1)])
+        w->pos += n;
+    else
+        UARTTxWrite(w, p, n);
+}
 
-    return (UINT32)menu_item;
-}
\ No newline at end of file
+// *****************************************************************************
+// void UARTTxWrite(uart_txw *w, const void *data, UINT32 n)
+//  Copies n bytes into the reservation, wrapping around the ring
+// *****************************************************************************
+void UARTTxWrite(uart_txw *w, const void *data, UINT32 n)
+{
+    UINT32 off = w->pos & (UART_TX_SIZE-1);
+    UINT32 first = UART_TX_SIZE - off;
+
+    if(n <= first)
+        memcpy(&uart_tx_buf[off], data, n);
+    else
+    {
+        memcpy(&uart_tx_buf[off], data, first);
+        memcpy(uart_tx_buf, (const BYTE *)data + first, n - first);
+    }
+    w->pos += n;
+}
+
+// *****************************************************************************
+// void UARTTxCommit(const uart_txw *w)
+//  Publishes the bytes written so far; unused reserved space is released
+// *****************************************************************************
+void UARTTxCommit(const uart_txw *w)
+{
+    tx_head = w->pos;
+    tx_start();
+}
+
+// *****************************************************************************
+// UINT32 UARTTxFree(void)
+// *****************************************************************************
+UINT32 UARTTxFree(void)
+{
+    return UART_TX_SIZE - (tx_head - tx_tail);
+}
@@ -4,16 +4,46 @@
  *
  * Created on 25 de Agosto de 2014, 11:57
  */
-#include <plib.h>
+#include "platform.h"
 
 #ifndef UART_H
 #define	UART_H
 
 
 #define UART_MODULE_ID UART1 // PIM is connected to Explorer through UART2 module
+#define UART_RX_SIZE   (64)  // receive ring, power of 2
+#define UART_TX_SIZE   (1024) // transmit ring, power of 2
+
+/* Reservation in the transmit ring. Formatters write in place through it:
+ *
+ *     uart_txw w;
+ *     if (!UARTTxReserve(&w, max)) {
+ *         p = UARTTxDirect(&w, max, bounce);  // ring, or bounce at the wrap
+ *         n = format(p, ...);
+ *         UARTTxAdvance(&w, p, n);
+ *         UARTTxCommit(&w);
+ *     }
+ */
+typedef struct {
+    UINT32 pos;     // next byte, free running ring index
+    UINT32 end;     // end of the reserved space
+} uart_txw;
+
+extern BYTE uart_tx_buf[UART_TX_SIZE];
+
+/* Writes one byte of a reservation, wrapping around the ring */
+#define UART_TXW_PUT(w, c)  (uart_tx_buf[(w)->pos++ & (UART_TX_SIZE-1)] = (BYTE)(c))
 
 void SendDataBuffer(const char *buffer, UINT32 size);
-UINT32 GetMenuChoice(void);
+BOOL UARTTxReserve(uart_txw *w, UINT32 size);
+BYTE *UARTTxDirect(uart_txw *w, UINT32 size, BYTE *bounce);
+void UARTTxAdvance(uart_txw *w, const BYTE *p, UINT32 n);
+void UARTTxWrite(uart_txw *w, const void *data, UINT32 n);
+void UARTTxCommit(const uart_txw *w);
+UINT32 UARTTxFree(void);
+BOOL UARTReadByte(BYTE *data);
+UINT32 UARTRxOverruns(void);
+BOOL UARTIsIdle(void);
 
 #endif	/* UART_H */
 